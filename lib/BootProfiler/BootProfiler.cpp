@@ -0,0 +1,58 @@
+#include "BootProfiler.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "BootProfiler";
+
+BootProfiler::Mark BootProfiler::_marks[BootProfiler::MAX_MARKS];
+size_t BootProfiler::_count = 0;
+bool BootProfiler::_finished = false;
+portMUX_TYPE BootProfiler::_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void BootProfiler::mark(const char* phase) {
+    int64_t now = esp_timer_get_time();
+    int core = xPortGetCoreID();
+
+    portENTER_CRITICAL(&_lock);
+    bool stored = !_finished && _count < MAX_MARKS;
+    if (stored) {
+        _marks[_count++] = { phase, now, core };
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (stored) {
+        ESP_LOGI(TAG, "[%7.1f ms] %s (core %d)", now / 1000.0, phase, core);
+    }
+}
+
+void BootProfiler::finish(const char* phase) {
+    if (_finished) {
+        return;
+    }
+    mark(phase);
+
+    portENTER_CRITICAL(&_lock);
+    _finished = true;
+    portEXIT_CRITICAL(&_lock);
+
+    summary();
+}
+
+void BootProfiler::summary() {
+    // Marks are only appended until finish(), so a copy of the count is enough
+    portENTER_CRITICAL(&_lock);
+    size_t count = _count;
+    portEXIT_CRITICAL(&_lock);
+
+    ESP_LOGI(TAG, "Boot timeline (%u phases):", count);
+    int64_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Mark& m = _marks[i];
+        ESP_LOGI(TAG, "  %8.1f ms  +%7.1f ms  core %d  %s",
+                 m.us / 1000.0, (m.us - previous) / 1000.0, m.core, m.phase);
+        previous = m.us;
+    }
+    if (count > 0) {
+        ESP_LOGI(TAG, "Boot to '%s': %.1f ms", _marks[count - 1].phase, _marks[count - 1].us / 1000.0);
+    }
+}
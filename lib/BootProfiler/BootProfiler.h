@@ -0,0 +1,33 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include "Arduino.h"
+
+// Boot timeline: mark() stamps a named phase with the esp_timer time since
+// power-on and the core it ran on; finish() adds a last mark and prints the
+// whole timeline once. Safe to call from any task on either core. Phase
+// names are stored by pointer and must be string literals.
+class BootProfiler {
+public:
+    static void mark(const char* phase);
+    static void finish(const char* phase);
+    static void summary();
+
+    static bool isFinished() { return _finished; }
+
+private:
+    struct Mark {
+        const char* phase;
+        int64_t us;
+        int core;
+    };
+
+    static const size_t MAX_MARKS = 24;
+
+    static Mark _marks[MAX_MARKS];
+    static size_t _count;
+    static bool _finished;
+    static portMUX_TYPE _lock;
+};
+
+#endif
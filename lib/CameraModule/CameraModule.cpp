@@ -8,7 +8,52 @@ static const char *TAG = "CameraModule";
 
 #define XCLK_FREQ 20000000
 
-CameraModule::CameraModule(const char* frame_size_str, const char* jpeg_quality_str) {
+static const struct {
+    const char* name;
+    framesize_t size;
+} FRAME_SIZES[] = {
+    { "96x96", FRAMESIZE_96X96 },
+    { "QQVGA", FRAMESIZE_QQVGA },
+    { "QCIF", FRAMESIZE_QCIF },
+    { "HQVGA", FRAMESIZE_HQVGA },
+    { "240X240", FRAMESIZE_240X240 },
+    { "QVGA", FRAMESIZE_QVGA },
+    { "CIF", FRAMESIZE_CIF },
+    { "HVGA", FRAMESIZE_HVGA },
+    { "VGA", FRAMESIZE_VGA },
+    { "SVGA", FRAMESIZE_SVGA },
+    { "XGA", FRAMESIZE_XGA },
+    { "HD", FRAMESIZE_HD },
+    { "SXGA", FRAMESIZE_SXGA },
+    { "UXGA", FRAMESIZE_UXGA },
+};
+
+bool CameraModule::parseFrameSize(const char* name, framesize_t& out) {
+    if (!name) {
+        return false;
+    }
+    for (const auto& entry : FRAME_SIZES) {
+        if (strcmp(name, entry.name) == 0) {
+            out = entry.size;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* CameraModule::frameSizeName(framesize_t frameSize) {
+    for (const auto& entry : FRAME_SIZES) {
+        if (entry.size == frameSize) {
+            return entry.name;
+        }
+    }
+    return nullptr;
+}
+
+CameraModule::CameraModule(const char* frame_size_str, const char* jpeg_quality_str)
+    : _plan(),
+      _pipelineDepth(6)
+{
     _config.ledc_channel = LEDC_CHANNEL_0;
     _config.ledc_timer = LEDC_TIMER_0;
     _config.pin_d0 = Y2_GPIO_NUM;
@@ -31,29 +76,65 @@ CameraModule::CameraModule(const char* frame_size_str, const char* jpeg_quality_
     
     _config.pixel_format = PIXFORMAT_JPEG;
 
-    if (strcmp(frame_size_str, "96x96") == 0) _config.frame_size = FRAMESIZE_96X96;
-    else if (strcmp(frame_size_str, "QQVGA") == 0) _config.frame_size = FRAMESIZE_QQVGA;
-    else if (strcmp(frame_size_str, "QCIF") == 0) _config.frame_size = FRAMESIZE_QCIF;
-    else if (strcmp(frame_size_str, "HQVGA") == 0) _config.frame_size = FRAMESIZE_HQVGA;
-    else if (strcmp(frame_size_str, "240X240") == 0) _config.frame_size = FRAMESIZE_240X240;
-    else if (strcmp(frame_size_str, "QVGA") == 0) _config.frame_size = FRAMESIZE_QVGA;
-    else if (strcmp(frame_size_str, "CIF") == 0) _config.frame_size = FRAMESIZE_CIF;
-    else if (strcmp(frame_size_str, "HVGA") == 0) _config.frame_size = FRAMESIZE_HVGA;
-    else if (strcmp(frame_size_str, "VGA") == 0) _config.frame_size = FRAMESIZE_VGA;
-    else if (strcmp(frame_size_str, "SVGA") == 0) _config.frame_size = FRAMESIZE_SVGA;
-    else if (strcmp(frame_size_str, "XGA") == 0) _config.frame_size = FRAMESIZE_XGA;
-    else if (strcmp(frame_size_str, "HD") == 0) _config.frame_size = FRAMESIZE_HD;
-    else if (strcmp(frame_size_str, "SXGA") == 0) _config.frame_size = FRAMESIZE_SXGA;
-    else if (strcmp(frame_size_str, "UXGA") == 0) _config.frame_size = FRAMESIZE_UXGA;
-    else _config.frame_size = FRAMESIZE_VGA; // Default
-
-     _config.fb_location = CAMERA_FB_IN_PSRAM;
-     _config.jpeg_quality = atoi(jpeg_quality_str);
-     _config.fb_count = 8;
+    if (!parseFrameSize(frame_size_str, _config.frame_size)) {
+        _config.frame_size = FRAMESIZE_VGA; // Default
+    }
+
+    _config.jpeg_quality = atoi(jpeg_quality_str);
+    // Pool count, placement and grab mode are planned in setup()
+    _config.fb_location = CAMERA_FB_IN_PSRAM;
+    _config.fb_count = 2;
     _config.grab_mode = CAMERA_GRAB_LATEST;
+
+    _quality = _config.jpeg_quality;
+    _frameSize = _config.frame_size;
+}
+
+void CameraModule::_applyPlan(framesize_t frameSize) {
+    _plan = FrameBufferPlanner::plan(frameSize, _quality, _pipelineDepth);
+
+    _config.frame_size = frameSize;
+    _config.fb_count = _plan.fbCount;
+    _config.fb_location = _plan.location;
+    _config.grab_mode = _plan.grabMode;
+
+    ESP_LOGI(TAG, "Frame buffers: %u x %u bytes in %s, %s (%s), %u KB headroom, pipeline depth %u of %u",
+             _plan.fbCount, _plan.fbBytes, _plan.location == CAMERA_FB_IN_DRAM ? "DRAM" : "PSRAM",
+             _plan.grabMode == CAMERA_GRAB_LATEST ? "grab latest" : "grab when empty",
+             _plan.reason, _plan.headroomBytes / 1024, _plan.pipelineDepth, _pipelineDepth);
+    if (_plan.jpegEstimate > _plan.fbBytes) {
+        ESP_LOGW(TAG, "JPEG quality %d may produce ~%u byte frames, larger than the %u byte buffers",
+                 _quality, _plan.jpegEstimate, _plan.fbBytes);
+    }
+}
+
+bool CameraModule::reconfigure(framesize_t frameSize) {
+    framesize_t previous = _config.frame_size;
+
+    esp_camera_deinit();
+    _config.jpeg_quality = _quality;
+    _applyPlan(frameSize);
+
+    esp_err_t err = esp_camera_init(&_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Camera re-init for frame size %d failed: %s, restoring %d",
+                 frameSize, esp_err_to_name(err), previous);
+        _applyPlan(previous);
+        if (esp_camera_init(&_config) != ESP_OK) {
+            ESP_LOGE(TAG, "Camera restore failed, restarting");
+            ESP.restart();
+        }
+        return false;
+    }
+
+    _frameSize = frameSize;
+    ESP_LOGI(TAG, "Camera reconfigured for frame size %d", frameSize);
+    return true;
 }
 
 void CameraModule::setup() {
+    _applyPlan(_config.frame_size);
+
     esp_err_t err = esp_camera_init(&_config);
     if (err != ESP_OK) {
         delay(100);
@@ -77,6 +158,32 @@ camera_fb_t* CameraModule::get_frame() {
     return esp_camera_fb_get();
 }
 
+bool CameraModule::set_quality(int quality) {
+    sensor_t* sensor = esp_camera_sensor_get();
+    if (!sensor || quality < 0 || quality > 63) {
+        return false;
+    }
+    if (sensor->set_quality(sensor, quality) != 0) {
+        ESP_LOGW(TAG, "Sensor rejected JPEG quality %d", quality);
+        return false;
+    }
+    _quality = quality;
+    return true;
+}
+
+bool CameraModule::set_framesize(framesize_t frameSize) {
+    sensor_t* sensor = esp_camera_sensor_get();
+    if (!sensor || frameSize > _config.frame_size) {
+        return false;
+    }
+    if (sensor->set_framesize(sensor, frameSize) != 0) {
+        ESP_LOGW(TAG, "Sensor rejected frame size %d", frameSize);
+        return false;
+    }
+    _frameSize = frameSize;
+    return true;
+}
+
 void CameraModule::return_frame(camera_fb_t* frame) {
     if (frame) {
         esp_camera_fb_return(frame);
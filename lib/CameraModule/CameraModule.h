@@ -2,16 +2,48 @@
 #define CAMERA_MODULE_H
 
 #include "esp_camera.h"
+#include "FrameSource.h"
+#include "FrameBufferPlanner.h"
 
-class CameraModule {
+class CameraModule : public FrameSource {
 public:
     CameraModule(const char* frame_size, const char* jpeg_quality);
+
+    // Maps a frame size name as stored in the settings ("VGA", "SVGA", ...)
+    static bool parseFrameSize(const char* name, framesize_t& out);
+    // The reverse; nullptr for sizes without a settings name
+    static const char* frameSizeName(framesize_t frameSize);
+
+    // Frames the consumer may hold at once (sender queue depth); sizes the
+    // frame buffer pool. Must be called before setup().
+    void setPipelineDepth(size_t frames) { _pipelineDepth = frames; }
     void setup();
-    camera_fb_t* get_frame();
-    void return_frame(camera_fb_t* frame);
+
+    // Re-initialises the driver with a pool planned for frameSize. Every
+    // frame buffer must have been returned before calling this.
+    bool reconfigure(framesize_t frameSize);
+    const FrameBufferPlan& get_plan() const { return _plan; }
+
+    camera_fb_t* get_frame() override;
+    void return_frame(camera_fb_t* frame) override;
+
+    // Runtime sensor adjustments. Frame buffers are sized for the frame size
+    // the pool was planned for, so set_framesize() refuses anything larger
+    // (use reconfigure() for that).
+    bool set_quality(int quality);
+    bool set_framesize(framesize_t frameSize);
+    int get_quality() const { return _quality; }
+    framesize_t get_framesize() const { return _frameSize; }
+    framesize_t get_max_framesize() const { return _config.frame_size; }
 
 private:
+    void _applyPlan(framesize_t frameSize);
+
     camera_config_t _config;
+    FrameBufferPlan _plan;
+    size_t _pipelineDepth;
+    int _quality;
+    framesize_t _frameSize;
 };
 
 #endif
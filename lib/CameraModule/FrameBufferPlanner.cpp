@@ -0,0 +1,54 @@
+#include "FrameBufferPlanner.h"
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+
+FrameBufferPlan FrameBufferPlanner::plan(framesize_t frameSize, int quality, size_t pipelineDepth) {
+    FrameBufferPlan p = {};
+    p.frameSize = frameSize;
+
+    size_t pixels = (size_t)resolution[frameSize].width * resolution[frameSize].height;
+    p.fbBytes = pixels / 5;
+
+    // Rough JPEG bytes per pixel for the OV2640 encoder: ~0.16 at quality 10,
+    // approaching the w*h/5 buffer size below quality 8
+    float bytesPerPixel = std::min(0.5f, std::max(0.04f, 1.6f / (float)std::max(quality, 1)));
+    p.jpegEstimate = (size_t)(pixels * bytesPerPixel);
+
+    size_t wanted = std::min(std::max(pipelineDepth + 2, MIN_FB_COUNT), MAX_FB_COUNT);
+
+    uint32_t dramCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    size_t dramFree = heap_caps_get_free_size(dramCaps);
+    size_t dramBlock = heap_caps_get_largest_free_block(dramCaps);
+    size_t dramBudget = dramFree > DRAM_RESERVE ? dramFree - DRAM_RESERVE : 0;
+
+    if (p.fbBytes <= DRAM_FB_LIMIT && p.fbBytes <= dramBlock && p.fbBytes * wanted <= dramBudget) {
+        p.location = CAMERA_FB_IN_DRAM;
+        p.fbCount = wanted;
+        p.freeBytes = dramFree;
+        p.reason = "small frame, fits DRAM";
+    } else if (psramFound()) {
+        size_t psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+        size_t psramBudget = psramFree > PSRAM_RESERVE ? psramFree - PSRAM_RESERVE : 0;
+        size_t fits = p.fbBytes ? psramBudget / p.fbBytes : 0;
+
+        p.location = CAMERA_FB_IN_PSRAM;
+        p.fbCount = std::max(std::min(wanted, fits), MIN_FB_COUNT);
+        p.freeBytes = psramFree;
+        p.reason = p.fbCount < wanted ? "PSRAM limited count" : "large frame, PSRAM";
+    } else {
+        size_t fits = p.fbBytes ? dramBudget / p.fbBytes : 0;
+
+        p.location = CAMERA_FB_IN_DRAM;
+        p.fbCount = std::max(std::min(wanted, fits), MIN_FB_COUNT);
+        p.freeBytes = dramFree;
+        p.reason = p.fbCount < wanted ? "no PSRAM, DRAM limited count" : "no PSRAM";
+    }
+
+    p.pipelineDepth = p.fbCount > 2 ? p.fbCount - 2 : 0;
+
+    size_t used = p.fbBytes * p.fbCount;
+    p.headroomBytes = p.freeBytes > used ? p.freeBytes - used : 0;
+    p.grabMode = p.fbCount > 1 ? CAMERA_GRAB_LATEST : CAMERA_GRAB_WHEN_EMPTY;
+    return p;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAME_BUFFER_PLANNER_H
+#define FRAME_BUFFER_PLANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_camera.h"
+
+struct FrameBufferPlan {
+    framesize_t frameSize;
+    size_t fbBytes;                 // per buffer, as esp_camera sizes JPEG buffers (w * h / 5)
+    size_t jpegEstimate;            // expected JPEG size at the chosen quality
+    size_t fbCount;
+    size_t pipelineDepth;           // buffers left for queued and sink-held frames: fbCount - 2
+    camera_fb_location_t location;
+    camera_grab_mode_t grabMode;
+    size_t freeBytes;               // free in the chosen heap before allocation
+    size_t headroomBytes;           // left in that heap after the buffers
+    const char* reason;
+};
+
+// Picks frame buffer count, placement and grab mode for a frame size.
+//
+// The pipeline holds one buffer per queued frame plus the one being sent,
+// local sinks (MJPEG viewers, the recorder) may pin more, and the driver
+// needs one to capture into, so the wanted count is pipelineDepth (sender
+// queue depth + frames held by sinks) + 2, capped at MAX_FB_COUNT. Small frames go to
+// internal DRAM (faster, no PSRAM cache contention) as long as WiFi and
+// lwIP keep DRAM_RESERVE; everything else goes to PSRAM, keeping
+// PSRAM_RESERVE free. A single buffer must use GRAB_WHEN_EMPTY.
+// pipelineDepth reports what the capped pool leaves for the queue and
+// the sinks, which can be less than was asked for.
+class FrameBufferPlanner {
+public:
+    static FrameBufferPlan plan(framesize_t frameSize, int quality, size_t pipelineDepth);
+
+    static const size_t MIN_FB_COUNT = 1;
+    static const size_t MAX_FB_COUNT = 8;
+    static const size_t DRAM_FB_LIMIT = 32 * 1024;     // largest buffer considered "small"
+    static const size_t DRAM_RESERVE = 96 * 1024;
+    static const size_t PSRAM_RESERVE = 512 * 1024;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include "esp_camera.h"
+
+// Producer of JPEG frame buffers for the streaming pipeline. Every frame
+// obtained from get_frame() must be handed back through return_frame() of
+// the same source, from whichever task finished with it.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+    virtual camera_fb_t* get_frame() = 0;
+    virtual void return_frame(camera_fb_t* frame) = 0;
+
+    // Called by the sender before return_frame() once frame has been
+    // written to the transport. Sources that must not lose frames use it
+    // to tell a delivered frame from a dropped one.
+    virtual void frame_sent(camera_fb_t* frame) {}
+};
+
+#endif
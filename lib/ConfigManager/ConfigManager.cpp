@@ -1,10 +1,26 @@
 #include "ConfigManager.h"
 #include "esp_log.h"
 #include "WiFi.h"
+#include "freertos/event_groups.h"
+#include "esp_system.h"
+#include "esp_netif.h"
+#include "lwip/dhcp.h"
 #include "../WiFiPortal/WiFiPortal.h"
+#include <time.h>
 
 static const char *TAG = "ConfigManager";
 
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000
+#define WIFI_FAST_CONNECT_DHCP_TIMEOUT_MS 8000
+#define WIFI_SCAN_CONNECT_TIMEOUT_MS 20000
+
+#define WIFI_ASSOCIATED_BIT (1 << 0)
+#define WIFI_GOT_IP_BIT (1 << 1)
+#define WIFI_FAILED_BIT (1 << 2)
+
+static EventGroupHandle_t s_wifiEvents = nullptr;
+static volatile uint32_t s_associatedAt = 0;
+
 ConfigManager* ConfigManager::_instance = nullptr;
 
 const char* wifiReasonToString(uint8_t reason) {
@@ -43,10 +59,14 @@ const char* wifiReasonToString(uint8_t reason) {
     }
 }
 
-ConfigManager::ConfigManager() : _wifi_connected(false) {
+ConfigManager::ConfigManager() : _wifi_connected(false), _leaseRenewAt(0), _renewingLease(false) {
     _instance = this;
+    _ssid[0] = '\0';
     strcpy(_frame_size, "VGA");
     strcpy(_jpeg_quality, "10");
+    strcpy(_transport, "http");
+    strcpy(_upload_mode, "length");
+    _max_fps[0] = '\0';
 }
 
 void ConfigManager::loadServerConfig() {
@@ -55,10 +75,16 @@ void ConfigManager::loadServerConfig() {
     String server_port_pref = _preferences.getString("server_port", "8080");
     String frame_size_pref = _preferences.getString("frame_size", "VGA");
     String jpeg_quality_pref = _preferences.getString("jpeg_quality", "10");
+    String transport_pref = _preferences.getString("transport", "http");
+    String upload_mode_pref = _preferences.getString("upload_mode", "length");
+    String max_fps_pref = _preferences.getString("max_fps", "");
     server_ip_pref.toCharArray(_server_ip, sizeof(_server_ip));
     server_port_pref.toCharArray(_server_port, sizeof(_server_port));
     frame_size_pref.toCharArray(_frame_size, sizeof(_frame_size));
     jpeg_quality_pref.toCharArray(_jpeg_quality, sizeof(_jpeg_quality));
+    transport_pref.toCharArray(_transport, sizeof(_transport));
+    upload_mode_pref.toCharArray(_upload_mode, sizeof(_upload_mode));
+    max_fps_pref.toCharArray(_max_fps, sizeof(_max_fps));
     _preferences.end();
 
     ESP_LOGI(TAG, "Server configuration loaded.");
@@ -87,33 +113,86 @@ void ConfigManager::connectToWiFi() {
             ESP_LOGE(TAG, "Invalid password length: %u (max 64)", password.length());
         }
 
-        ESP_LOGI(TAG, "Resetting WiFi before connection...");
-        WiFi.disconnect(true, true);
+        if (!s_wifiEvents) {
+            s_wifiEvents = xEventGroupCreate();
+        }
+        xEventGroupClearBits(s_wifiEvents, WIFI_ASSOCIATED_BIT | WIFI_GOT_IP_BIT | WIFI_FAILED_BIT);
+
+        // The driver's own flash copy of the credentials is not used; skipping
+        // it saves a flash write on every begin()
+        WiFi.persistent(false);
         WiFi.mode(WIFI_STA);
-        delay(100);
 
         WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
-            if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+            if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+                s_associatedAt = millis();
+                xEventGroupSetBits(s_wifiEvents, WIFI_ASSOCIATED_BIT);
+            } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+                xEventGroupSetBits(s_wifiEvents, WIFI_GOT_IP_BIT);
+            } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
                 ESP_LOGE(TAG, "WiFi Disconnected - Reason: %d (%s)",
                          info.wifi_sta_disconnected.reason,
                          wifiReasonToString(info.wifi_sta_disconnected.reason));
+                xEventGroupSetBits(s_wifiEvents, WIFI_FAILED_BIT);
             }
         });
 
-        ESP_LOGI(TAG, "Found saved credentials. Trying to connect to '%s'...", ssid.c_str());
-
         WiFi.setSleep(false);
         ESP_LOGI(TAG, "WiFi power management disabled for maximum throughput");
 
         WiFi.setHostname("wheelbot-cam");
-        WiFi.begin(ssid.c_str(), password.c_str());
-
-        int timeout = 0;
-        while (WiFi.status() != WL_CONNECTED && timeout < 40) {
-            delay(500);
-            timeout++;
-            if (timeout % 2 == 0) {
-                ESP_LOGI(TAG, ".");
+
+        uint32_t start = millis();
+        bool connected = false;
+        WiFiCache cache;
+        bool cached = _loadWiFiCache(ssid, cache);
+
+        bool staticIp = false;
+
+        if (cached) {
+            // An address whose lease may have run out could belong to another host by now:
+            // join the cached access point directly, but ask DHCP for the address
+            staticIp = _leaseFresh(cache);
+            ESP_LOGI(TAG, "Fast connect to '%s' on channel %u, BSSID %02x:%02x:%02x:%02x:%02x:%02x, IP %s",
+                     ssid.c_str(), cache.channel, cache.bssid[0], cache.bssid[1], cache.bssid[2],
+                     cache.bssid[3], cache.bssid[4], cache.bssid[5],
+                     staticIp ? IPAddress(cache.ip).toString().c_str() : "from DHCP");
+
+            if (staticIp) {
+                WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.netmask), IPAddress(cache.dns));
+            }
+            WiFi.begin(ssid.c_str(), password.c_str(), cache.channel, cache.bssid);
+            connected = _waitForWiFi(staticIp ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_FAST_CONNECT_DHCP_TIMEOUT_MS, true);
+
+            if (!connected) {
+                ESP_LOGW(TAG, "Fast connect failed after %lums, falling back to a full scan with DHCP",
+                         millis() - start);
+                WiFi.disconnect();
+                WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+                clearWiFiCache();
+                cached = false;
+                staticIp = false;
+                xEventGroupClearBits(s_wifiEvents, WIFI_ASSOCIATED_BIT | WIFI_GOT_IP_BIT | WIFI_FAILED_BIT);
+            }
+        }
+
+        if (!connected) {
+            ESP_LOGI(TAG, "Found saved credentials. Trying to connect to '%s'...", ssid.c_str());
+            WiFi.begin(ssid.c_str(), password.c_str());
+            connected = _waitForWiFi(WIFI_SCAN_CONNECT_TIMEOUT_MS, false);
+        }
+
+        if (connected) {
+            uint32_t now = millis();
+            ESP_LOGI(TAG, "WiFi associated %lums after boot (%s connect: associated in %lums, IP after %lums)",
+                     s_associatedAt, cached ? "fast" : "scan", s_associatedAt - start, now - start);
+            // A fresh DHCP lease is recorded with its length and the time it was obtained
+            _saveWiFiCache(ssid, staticIp ? &cache : nullptr);
+
+            snprintf(_ssid, sizeof(_ssid), "%s", ssid.c_str());
+            _leaseRenewAt = 0;
+            if (staticIp && cache.leaseSeconds != LEASE_INFINITE) {
+                _leaseRenewAt = cache.obtainedAt + cache.leaseSeconds / 2;
             }
         }
     }
@@ -127,13 +206,134 @@ void ConfigManager::connectToWiFi() {
     }
 }
 
+bool ConfigManager::_waitForWiFi(uint32_t timeoutMs, bool failFast) {
+    EventBits_t waitFor = WIFI_GOT_IP_BIT | (failFast ? WIFI_FAILED_BIT : 0);
+    EventBits_t bits = xEventGroupWaitBits(s_wifiEvents, waitFor, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeoutMs));
+
+    // Without failFast a disconnect is just a retry by the driver; keep waiting for the IP
+    return (bits & WIFI_GOT_IP_BIT) && WiFi.status() == WL_CONNECTED;
+}
+
+bool ConfigManager::_loadWiFiCache(const String& ssid, WiFiCache& cache) {
+    if (!_preferences.begin("wheelbot-cam", true)) {
+        return false;
+    }
+
+    bool ok = _preferences.getBytesLength("wifi_cache") == sizeof(cache) &&
+              _preferences.getBytes("wifi_cache", &cache, sizeof(cache)) == sizeof(cache);
+    _preferences.end();
+
+    // Credentials changed in the portal: the cached network is no longer ours
+    if (ok && strncmp(cache.ssid, ssid.c_str(), sizeof(cache.ssid)) != 0) {
+        ESP_LOGI(TAG, "Cached WiFi association is for another SSID, ignoring it");
+        ok = false;
+    }
+    return ok && cache.channel != 0 && cache.ip != 0;
+}
+
+bool ConfigManager::_leaseFresh(const WiFiCache& cache) {
+    if (cache.leaseSeconds == LEASE_INFINITE) {
+        return true;
+    }
+
+    // Power loss restarts the RTC clock, so the lease's age is unknown
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (cache.leaseSeconds == 0 || reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT ||
+        reason == ESP_RST_UNKNOWN) {
+        ESP_LOGI(TAG, "Age of the cached DHCP lease unknown (reset reason %d)", (int)reason);
+        return false;
+    }
+
+    uint32_t now = (uint32_t)time(nullptr);
+    if (now < cache.obtainedAt || now - cache.obtainedAt >= cache.leaseSeconds / 2) {
+        ESP_LOGI(TAG, "Cached DHCP lease is past half its %us lifetime", cache.leaseSeconds);
+        return false;
+    }
+    return true;
+}
+
+static uint32_t dhcpLeaseSeconds() {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    struct netif* lwipNetif = netif ? (struct netif*)esp_netif_get_netif_impl(netif) : nullptr;
+    struct dhcp* dhcp = lwipNetif ? netif_dhcp_data(lwipNetif) : nullptr;
+    return dhcp ? dhcp->offered_t0_lease : 0;
+}
+
+void ConfigManager::_saveWiFiCache(const String& ssid, const WiFiCache* previous) {
+    WiFiCache cache;
+    memset(&cache, 0, sizeof(cache));
+    snprintf(cache.ssid, sizeof(cache.ssid), "%s", ssid.c_str());
+
+    uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) {
+        return;
+    }
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = (uint8_t)WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.netmask = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP(0);
+    if (previous) {
+        // Same static address: still the lease obtained back then
+        cache.leaseSeconds = previous->leaseSeconds;
+        cache.obtainedAt = previous->obtainedAt;
+    } else {
+        cache.leaseSeconds = dhcpLeaseSeconds();
+        cache.obtainedAt = (uint32_t)time(nullptr);
+    }
+
+    // Only write NVS when the association actually changed
+    if (previous && memcmp(previous, &cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace 'wheelbot-cam' for writing");
+        return;
+    }
+    _preferences.putBytes("wifi_cache", &cache, sizeof(cache));
+    _preferences.end();
+    ESP_LOGI(TAG, "WiFi association cached (channel %u, IP %s, lease %us)",
+             cache.channel, WiFi.localIP().toString().c_str(), cache.leaseSeconds);
+}
+
+void ConfigManager::clearWiFiCache() {
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace 'wheelbot-cam' for writing");
+        return;
+    }
+
+    _preferences.remove("wifi_cache");
+    _preferences.end();
+}
+
 void ConfigManager::setup() {
     loadServerConfig();
     connectToWiFi();
 }
 
 void ConfigManager::loop() {
-    // Nothing to do here for now
+    if (_renewingLease) {
+        if (s_wifiEvents && (xEventGroupGetBits(s_wifiEvents) & WIFI_GOT_IP_BIT)) {
+            _renewingLease = false;
+            _saveWiFiCache(String(_ssid), nullptr);
+        }
+        return;
+    }
+
+    if (_leaseRenewAt == 0 || (uint32_t)time(nullptr) < _leaseRenewAt || WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+
+    // Static addresses are never renewed: hand this one to the DHCP client,
+    // which keeps the lease from here on. The address is usually the same,
+    // but the interface is briefly reset and the stream reconnects.
+    ESP_LOGI(TAG, "Cached DHCP lease half spent, switching to DHCP");
+    _leaseRenewAt = 0;
+    _renewingLease = true;
+    xEventGroupClearBits(s_wifiEvents, WIFI_GOT_IP_BIT);
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
 }
 
 const char* ConfigManager::get_server_ip() {
@@ -152,6 +352,42 @@ const char* ConfigManager::get_jpeg_quality() {
     return _jpeg_quality;
 }
 
+const char* ConfigManager::get_transport() {
+    return _transport;
+}
+
+const char* ConfigManager::get_upload_mode() {
+    return _upload_mode;
+}
+
+const char* ConfigManager::get_max_fps() {
+    return _max_fps;
+}
+
+void ConfigManager::save_stream_settings(const char* frame_size, const char* jpeg_quality, const char* max_fps) {
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace 'wheelbot-cam' for writing");
+        return;
+    }
+
+    if (frame_size) {
+        _preferences.putString("frame_size", frame_size);
+        snprintf(_frame_size, sizeof(_frame_size), "%s", frame_size);
+    }
+    if (jpeg_quality) {
+        _preferences.putString("jpeg_quality", jpeg_quality);
+        snprintf(_jpeg_quality, sizeof(_jpeg_quality), "%s", jpeg_quality);
+    }
+    if (max_fps) {
+        _preferences.putString("max_fps", max_fps);
+        snprintf(_max_fps, sizeof(_max_fps), "%s", max_fps);
+    }
+    _preferences.end();
+
+    ESP_LOGI(TAG, "Stream settings saved - Frame size: %s, Quality: %s, FPS: %s",
+             _frame_size, _jpeg_quality, _max_fps[0] ? _max_fps : "default");
+}
+
 bool ConfigManager::get_wifi_connected() {
     return _wifi_connected;
 }
@@ -164,6 +400,7 @@ void ConfigManager::clearWiFiCredentials() {
 
     _preferences.remove("ssid");
     _preferences.remove("password");
+    _preferences.remove("wifi_cache");
     _preferences.end();
     ESP_LOGI(TAG, "WiFi credentials cleared");
 }
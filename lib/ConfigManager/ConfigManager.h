@@ -9,25 +9,64 @@ class ConfigManager {
     void setup();
     void loadServerConfig();
     void connectToWiFi();
+    // Hands a cached static address back to DHCP once its lease is half spent
     void loop();
     const char* get_server_ip();
     const char* get_server_port();
     const char* get_frame_size();
     const char* get_jpeg_quality();
+    const char* get_transport();
+    const char* get_upload_mode();
+    // Empty unless an FPS limit was saved with save_stream_settings()
+    const char* get_max_fps();
+    // Writes the given settings to NVS; nullptr leaves one unchanged
+    void save_stream_settings(const char* frame_size, const char* jpeg_quality, const char* max_fps);
     bool get_wifi_connected();
     void clearWiFiCredentials();
+    // Cached association (BSSID, channel, DHCP lease) used for the fast connect
+    void clearWiFiCache();
 
     bool get_force_captive_portal();
     void set_force_captive_portal(bool force);
     void clear_force_captive_portal();
 
  private:
+    // Last successful association, stored as one NVS blob ("wifi_cache").
+    // Addresses are kept in IPAddress' uint32_t form. obtainedAt is time()
+    // from the RTC clock, which keeps counting across every reset except
+    // power-on and brownout.
+    struct WiFiCache {
+        char ssid[33];
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t netmask;
+        uint32_t dns;
+        uint32_t leaseSeconds;      // 0 = unknown, LEASE_INFINITE = never expires
+        uint32_t obtainedAt;
+    };
+
+    bool _loadWiFiCache(const String& ssid, WiFiCache& cache);
+    void _saveWiFiCache(const String& ssid, const WiFiCache* previous);
+    bool _waitForWiFi(uint32_t timeoutMs, bool failFast);
+    // True while the cached address may still be used as a static IP
+    static bool _leaseFresh(const WiFiCache& cache);
+
     char _server_ip[16];
     char _server_port[6];
     char _frame_size[10];
     char _jpeg_quality[4];
+    char _transport[8];
+    char _upload_mode[8];
+    char _max_fps[16];
     Preferences _preferences;
     bool _wifi_connected;
+    char _ssid[33];
+    uint32_t _leaseRenewAt;     // time() to switch the static address to DHCP, 0 = DHCP already runs
+    bool _renewingLease;
+
+    static const uint32_t LEASE_INFINITE = 0xFFFFFFFF;
 
     static ConfigManager* _instance;
 };
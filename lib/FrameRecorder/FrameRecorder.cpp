@@ -0,0 +1,295 @@
+#include "FrameRecorder.h"
+#include "SharedFrameSource.h"
+#include "MjpegServer.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <cstring>
+#include <cstdio>
+
+static const char* TAG = "FrameRecorder";
+
+// Below the camera and network tasks, on the core the capture task does not use
+#define RECORDER_TASK_STACK 3072
+#define RECORDER_TASK_PRIORITY 1
+#define RECORDER_TASK_CORE 0
+
+FrameRecorder::FrameRecorder(uint32_t seconds, float fps, size_t arenaBytes, const char* boundary)
+    : _seconds(seconds),
+      _intervalMs(fps > 0 ? (uint32_t)(1000.0f / fps) : 0),
+      _arenaBytes(arenaBytes),
+      _boundary(boundary),
+      _partHeader(boundary),
+      _arena(nullptr),
+      _entries(nullptr),
+      _maxEntries((uint32_t)(seconds * (fps > 0 ? fps : 1)) + 1),
+      _head(0),
+      _count(0),
+      _writePos(0),
+      _bytesUsed(0),
+      _mutex(nullptr),
+      _task(nullptr),
+      _pending(nullptr),
+      _frames(nullptr),
+      _lastTakenMs(0),
+      _dumping(false),
+      _ready(false),
+      _stored(0),
+      _evicted(0),
+      _skipped(0),
+      _dumps(0)
+{
+}
+
+FrameRecorder::~FrameRecorder() {
+    if (_task) {
+        vTaskDelete(_task);
+        _task = nullptr;
+    }
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+    heap_caps_free(_arena);
+    delete[] _entries;
+}
+
+bool FrameRecorder::begin() {
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        return false;
+    }
+
+    _arena = (uint8_t*)heap_caps_malloc(_arenaBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _entries = new Entry[_maxEntries];
+    if (!_arena) {
+        ESP_LOGE(TAG, "Failed to allocate %u byte arena in PSRAM", _arenaBytes);
+        _release();
+        return false;
+    }
+
+    BaseType_t result = xTaskCreatePinnedToCore(FrameRecorder::recorderTaskWrapper, "Recorder",
+                                                RECORDER_TASK_STACK, this, RECORDER_TASK_PRIORITY,
+                                                &_task, RECORDER_TASK_CORE);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create recorder task");
+        _task = nullptr;
+        _release();
+        return false;
+    }
+
+    // Publishes the arena, entries and task to the capture task
+    _ready.store(true, std::memory_order_release);
+
+    ESP_LOGI(TAG, "Recording the last %us at %.1f FPS into %u KB of PSRAM",
+             _seconds, _intervalMs ? 1000.0f / _intervalMs : 0.0f, _arenaBytes / 1024);
+    return true;
+}
+
+void FrameRecorder::_release() {
+    heap_caps_free(_arena);
+    _arena = nullptr;
+    delete[] _entries;
+    _entries = nullptr;
+    vSemaphoreDelete(_mutex);
+    _mutex = nullptr;
+}
+
+void FrameRecorder::publish(camera_fb_t* fb, SharedFrameSource* frames) {
+    uint32_t now = millis();
+    if (_intervalMs > 0 && now - _lastTakenMs < _intervalMs) {
+        return;
+    }
+
+    if (_dumping.load() || _pending.load(std::memory_order_acquire) != nullptr) {
+        _skipped++;
+        return;
+    }
+
+    _lastTakenMs = now;
+    _frames = frames;
+    frames->retain(fb);
+    _pending.store(fb, std::memory_order_release);
+    xTaskNotifyGive(_task);
+}
+
+void FrameRecorder::recorderTaskWrapper(void* parameter) {
+    static_cast<FrameRecorder*>(parameter)->recorderTask();
+}
+
+void FrameRecorder::recorderTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        camera_fb_t* fb = _pending.load(std::memory_order_acquire);
+        if (!fb) {
+            continue;
+        }
+
+        // A frame taken just before dump() started must not change the ring
+        // it is sending; the check is under the lock dump() takes to freeze it
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (_dumping.load()) {
+            _skipped++;
+        } else {
+            _store(fb);
+        }
+        xSemaphoreGive(_mutex);
+
+        _frames->return_frame(fb);
+        _pending.store(nullptr, std::memory_order_release);
+    }
+}
+
+void FrameRecorder::_evictOldest() {
+    _bytesUsed -= _entries[_head].len;
+    _head = (_head + 1) % _maxEntries;
+    _count--;
+    _evicted++;
+    if (_count == 0) {
+        _writePos = 0;
+    }
+}
+
+bool FrameRecorder::_reserve(uint32_t len, uint32_t& offset) {
+    // Each pass either finds room or evicts one frame: O(1) per stored frame on average
+    while (true) {
+        if (_count == 0) {
+            _writePos = 0;
+            offset = 0;
+            return true;
+        }
+
+        uint32_t tail = _entries[_head].offset;
+        if (tail < _writePos) {
+            // Live data in [tail, _writePos): free at the end, then at the start
+            if (_writePos + len <= _arenaBytes) {
+                offset = _writePos;
+                return true;
+            }
+            if (len <= tail) {
+                offset = 0;
+                return true;
+            }
+        } else if (tail > _writePos && _writePos + len <= tail) {
+            // Wrapped: free in [_writePos, tail)
+            offset = _writePos;
+            return true;
+        }
+
+        _evictOldest();
+    }
+}
+
+void FrameRecorder::_store(const camera_fb_t* fb) {
+    if (fb->len > _arenaBytes) {
+        _skipped++;
+        return;
+    }
+
+    uint32_t now = millis();
+    while (_count > 0 && (_count == _maxEntries || now - _entries[_head].storedMs > _seconds * 1000)) {
+        _evictOldest();
+    }
+
+    uint32_t offset;
+    _reserve(fb->len, offset);
+    memcpy(_arena + offset, fb->buf, fb->len);
+
+    Entry& entry = _entries[(_head + _count) % _maxEntries];
+    entry.offset = offset;
+    entry.len = fb->len;
+    entry.storedMs = now;
+    entry.timestamp = fb->timestamp;
+
+    _writePos = offset + fb->len;
+    _bytesUsed += fb->len;
+    _count++;
+    _stored++;
+}
+
+bool FrameRecorder::dump(int sock, RecordingFormat format) {
+    if (!_arena || _dumping.exchange(true)) {
+        static const char BUSY[] = "Recording not available";
+        MjpegServer::sendResponse(sock, 503, "text/plain", BUSY, sizeof(BUSY) - 1);
+        return false;
+    }
+
+    // Waits for a copy in progress; afterwards the recorder task sees
+    // _dumping under the same lock and drops frames until the dump is done
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    uint32_t count = _count;
+    uint32_t bytes = _bytesUsed;
+    xSemaphoreGive(_mutex);
+
+    long start = millis();
+    char head[320];
+    int headLen;
+    if (format == RecordingFormat::MJPEG) {
+        headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: video/x-motion-jpeg\r\n"
+                           "Content-Length: %u\r\n"
+                           "Content-Disposition: attachment; filename=\"pre-event.mjpeg\"\r\n"
+                           "X-Frame-Count: %u\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           bytes, count);
+    } else {
+        headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: multipart/x-mixed-replace; boundary=%s\r\n"
+                           "X-Frame-Count: %u\r\n"
+                           "Cache-Control: no-cache, no-store\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           _boundary, count);
+    }
+
+    bool ok = MjpegServer::sendAll(sock, head, headLen);
+    char partHeader[160];
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const Entry& entry = _entry(i);
+        if (format == RecordingFormat::MULTIPART) {
+            camera_fb_t fb = {};
+            fb.len = entry.len;
+            fb.timestamp = entry.timestamp;
+            size_t len = _partHeader.format(&fb, partHeader, sizeof(partHeader));
+            ok = MjpegServer::sendAll(sock, partHeader, len);
+        }
+        ok = ok && MjpegServer::sendAll(sock, _arena + entry.offset, entry.len);
+    }
+    if (ok && format == RecordingFormat::MULTIPART) {
+        int len = snprintf(partHeader, sizeof(partHeader), "\r\n--%s--\r\n", _boundary);
+        ok = MjpegServer::sendAll(sock, partHeader, len);
+    }
+
+    _dumps++;
+    _dumping.store(false);
+
+    ESP_LOGI(TAG, "Dumped %u frames (%u bytes) in %ldms%s", count, bytes, millis() - start,
+             ok ? "" : ", client went away");
+    return ok;
+}
+
+FrameRecorderStats FrameRecorder::getStats() const {
+    FrameRecorderStats stats = {};
+    if (!_mutex) {
+        return stats;
+    }
+
+    xSemaphoreTake(const_cast<SemaphoreHandle_t>(_mutex), portMAX_DELAY);
+    stats.frames = _count;
+    stats.bytesUsed = _bytesUsed;
+    stats.arenaBytes = _arena ? _arenaBytes : 0;
+    stats.oldestAgeMs = _count > 0 ? millis() - _entries[_head].storedMs : 0;
+    stats.stored = _stored;
+    stats.evicted = _evicted;
+    stats.dumps = _dumps;
+    xSemaphoreGive(const_cast<SemaphoreHandle_t>(_mutex));
+
+    stats.skipped = _skipped.load();
+    return stats;
+}
@@ -0,0 +1,99 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include "Arduino.h"
+#include "FrameSink.h"
+#include "MultipartHeader.h"
+#include <atomic>
+
+struct FrameRecorderStats {
+    uint32_t frames;          // frames in the ring now
+    uint32_t bytesUsed;       // JPEG bytes in the ring now
+    uint32_t arenaBytes;
+    uint32_t oldestAgeMs;
+    uint32_t stored;          // cumulative
+    uint32_t evicted;
+    uint32_t skipped;         // recorder busy, dump in progress or frame larger than the arena
+    uint32_t dumps;
+};
+
+enum class RecordingFormat {
+    MULTIPART,    // multipart/x-mixed-replace parts with X-Timestamp, like /stream
+    MJPEG         // JPEGs back to back in one body, for saving as a .mjpeg file
+};
+
+// Pre-event recorder: keeps the last `seconds` of frames at `fps` in a
+// PSRAM arena so an incident can be pulled after the fact with dump().
+//
+// publish() only retains the frame buffer and wakes the recorder task,
+// which copies the JPEG into the arena and hands the buffer straight back;
+// the capture path never waits for the copy. Frames are laid out as a
+// circular log: each one is written behind the newest, wrapping to the
+// start of the arena when it does not fit at the end, and the oldest
+// frames are evicted until the new one fits. Memory is fixed at begin().
+class FrameRecorder : public FrameSink {
+public:
+    FrameRecorder(uint32_t seconds, float fps, size_t arenaBytes, const char* boundary = "wheelbot");
+    ~FrameRecorder();
+
+    // Allocates the arena in PSRAM. Call after the camera is set up so the
+    // frame buffer pool gets planned first; the recorder can be registered
+    // as a sink before that and takes no frames until begin() succeeds.
+    bool begin();
+
+    bool wantsFrames() const override { return _ready.load(std::memory_order_acquire); }
+    size_t maxFramesHeld() const override { return 1; }
+    void publish(camera_fb_t* fb, SharedFrameSource* frames) override;
+
+    // Writes the whole ring as an HTTP response on sock, as fast as the
+    // socket takes it. Recording pauses for the duration.
+    bool dump(int sock, RecordingFormat format);
+
+    FrameRecorderStats getStats() const;
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t len;
+        uint32_t storedMs;
+        struct timeval timestamp;
+    };
+
+    static void recorderTaskWrapper(void* parameter);
+    void recorderTask();
+
+    void _release();
+    void _store(const camera_fb_t* fb);
+    bool _reserve(uint32_t len, uint32_t& offset);
+    void _evictOldest();
+    const Entry& _entry(uint32_t index) const { return _entries[(_head + index) % _maxEntries]; }
+
+    uint32_t _seconds;
+    uint32_t _intervalMs;
+    size_t _arenaBytes;
+    const char* _boundary;
+    MultipartHeader _partHeader;
+
+    uint8_t* _arena;
+    Entry* _entries;
+    uint32_t _maxEntries;
+    uint32_t _head;
+    uint32_t _count;
+    uint32_t _writePos;
+    uint32_t _bytesUsed;
+
+    SemaphoreHandle_t _mutex;
+    TaskHandle_t _task;
+    std::atomic<camera_fb_t*> _pending;
+    SharedFrameSource* _frames;
+    uint32_t _lastTakenMs;
+    std::atomic<bool> _dumping;
+    std::atomic<bool> _ready;
+
+    uint32_t _stored;
+    uint32_t _evicted;
+    std::atomic<uint32_t> _skipped;
+    uint32_t _dumps;
+};
+
+#endif
@@ -0,0 +1,312 @@
+#include "MetricsExporter.h"
+#include "Streamer.h"
+#include "LatencyHistogram.h"
+#include "MjpegServer.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+static const char* const DROP_REASONS[] = { "queue_full", "evicted", "stale", "disconnected" };
+static_assert(sizeof(DROP_REASONS) / sizeof(DROP_REASONS[0]) == (size_t)DropReason::COUNT,
+              "one label per DropReason");
+
+// QualityController::getStats().lastDecision values
+static const char* const QUALITY_DECISIONS[] = {
+    "hold", "quality_down", "quality_up", "framesize_down", "framesize_up"
+};
+
+// Tasks reported by name; the ones not running are left out
+static const char* const TASKS[] = {
+    "loopTask", "Capture", "TaskSender", "Rollover", "WsReader", "MjpegAccept",
+    "MjpegViewer", "Recorder", "Backlog", "CameraInit", "tiT", "wifi", "esp_timer"
+};
+
+MetricsExporter::MetricsExporter(Streamer* streamer, MjpegServer* server)
+    : _streamer(streamer),
+      _server(server)
+{
+}
+
+bool MetricsExporter::serve(int sock) {
+    Output out;
+    out.sock = sock;
+    out.len = 0;
+    out.ok = true;
+
+    _printf(out,
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: close\r\n"
+            "\r\n");
+
+    _writeStream(out);
+    _writeSystem(out);
+    _writeWiFi(out);
+    _writeTasks(out);
+    return _flush(out);
+}
+
+void MetricsExporter::_writeStream(Output& out) {
+    StreamCounters c;
+    _streamer->getCounters(c);
+
+    _counter(out, "wheelbot_frames_captured_total", "Frames taken from the camera", c.framesCaptured);
+    _counter(out, "wheelbot_frames_queued_total", "Frames handed to the send queue", c.framesQueued);
+    _counter(out, "wheelbot_frames_sent_total", "Frames written to the transport", c.framesSent);
+    _counter(out, "wheelbot_sent_bytes_total", "JPEG bytes written to the transport", c.bytesSent);
+
+    _family(out, "wheelbot_frames_dropped_total", "counter", "Frames dropped by the send queue");
+    char labels[48];
+    for (size_t i = 0; i < (size_t)DropReason::COUNT; i++) {
+        snprintf(labels, sizeof(labels), "reason=\"%s\"", DROP_REASONS[i]);
+        _sample(out, "wheelbot_frames_dropped_total", labels, c.framesDroppedBy[i]);
+    }
+
+    _gauge(out, "wheelbot_queue_depth", "Frames waiting in the send queue", c.queueDepth);
+    _gauge(out, "wheelbot_queue_capacity", "Send queue limit under the drop policy", c.queueLimit);
+    _writeSendHistogram(out, c.sendTimeUs);
+
+    const QualityControllerStats* quality = _streamer->getQualityStats();
+    if (quality) {
+        _gauge(out, "wheelbot_jpeg_quality", "JPEG quality set by the adaptive controller, lower is better",
+               quality->quality);
+        _gauge(out, "wheelbot_frame_width_pixels", "Frame width set by the adaptive controller",
+               resolution[quality->frameSize].width);
+        _gauge(out, "wheelbot_frame_height_pixels", "Frame height set by the adaptive controller",
+               resolution[quality->frameSize].height);
+        _family(out, "wheelbot_quality_changes_total", "counter", "Adaptive controller steps since its last reset");
+        _sample(out, "wheelbot_quality_changes_total", "setting=\"quality\"", quality->qualityChanges);
+        _sample(out, "wheelbot_quality_changes_total", "setting=\"frame_size\"", quality->frameSizeChanges);
+
+        // One series per decision, 1 for the last one
+        _family(out, "wheelbot_quality_decision", "gauge", "Last adaptive controller decision");
+        for (size_t i = 0; i < sizeof(QUALITY_DECISIONS) / sizeof(QUALITY_DECISIONS[0]); i++) {
+            snprintf(labels, sizeof(labels), "decision=\"%s\"", QUALITY_DECISIONS[i]);
+            _sample(out, "wheelbot_quality_decision", labels, strcmp(quality->lastDecision, QUALITY_DECISIONS[i]) == 0);
+        }
+    }
+
+    _counter(out, "wheelbot_reconnects_total", "Successful connects after the first", c.reconnects);
+    _counter(out, "wheelbot_connect_failures_total", "Failed connection attempts", c.connectFailures);
+    _counter(out, "wheelbot_send_errors_total", "Connections lost while sending", c.sendErrors);
+    _gauge(out, "wheelbot_stream_connected", "1 while the push stream is up", c.connected ? 1 : 0);
+    _gauge(out, "wheelbot_stream_paused", "1 while uploading is paused by a control message", c.paused ? 1 : 0);
+    _family(out, "wheelbot_last_recovery_seconds", "gauge",
+            "Last connection drop to the first frame sent on the new connection, 0 before the first");
+    _sampleSeconds(out, "wheelbot_last_recovery_seconds", nullptr, (uint64_t)_streamer->getStats().lastRecoveryMs * 1000);
+
+    if (_server) {
+        _gauge(out, "wheelbot_mjpeg_viewers", "Clients on the local /stream", _server->getViewerCount());
+    }
+
+    const FrameBufferPlan& fb = _streamer->getFrameBufferPlan();
+    snprintf(labels, sizeof(labels), "location=\"%s\"", fb.location == CAMERA_FB_IN_PSRAM ? "psram" : "dram");
+    _family(out, "wheelbot_frame_buffers", "gauge", "Camera frame buffers in the pool");
+    _sample(out, "wheelbot_frame_buffers", labels, fb.fbCount);
+    _gauge(out, "wheelbot_frame_buffer_bytes", "Size of one camera frame buffer", fb.fbBytes);
+    _gauge(out, "wheelbot_frame_buffer_pipeline_depth", "Frame buffers left for queued and sink-held frames",
+           fb.pipelineDepth);
+    _gauge(out, "wheelbot_frame_buffer_headroom_bytes", "Free heap left by the pool when it was planned",
+           fb.headroomBytes);
+
+    const SceneChangeStats* scene = _streamer->getSceneStats();
+    if (scene) {
+        _family(out, "wheelbot_scene_frames_total", "counter", "Frames through scene-change gating");
+        _sample(out, "wheelbot_scene_frames_total", "result=\"checked\"", scene->framesChecked);
+        _sample(out, "wheelbot_scene_frames_total", "result=\"skipped\"", scene->framesSkipped);
+        _sample(out, "wheelbot_scene_frames_total", "result=\"keepalive\"", scene->keepAlives);
+        _counter(out, "wheelbot_scene_saved_bytes_total", "JPEG bytes of skipped frames", scene->bytesSaved);
+        _family(out, "wheelbot_scene_check_seconds", "gauge", "Detector cost per frame, moving average");
+        _sampleSeconds(out, "wheelbot_scene_check_seconds", nullptr, scene->usPerFrame);
+        _family(out, "wheelbot_scene_decode_seconds", "gauge", "Cost of one thumbnail decode, moving average");
+        _sampleSeconds(out, "wheelbot_scene_decode_seconds", nullptr, scene->decodeUs);
+    }
+
+    uint8_t coreLoad[CoreLoadMonitor::CORES];
+    if (_streamer->getCoreLoad(coreLoad)) {
+        _family(out, "wheelbot_core_busy_percent", "gauge", "CPU core busy over the last metrics interval");
+        for (int i = 0; i < CoreLoadMonitor::CORES; i++) {
+            snprintf(labels, sizeof(labels), "core=\"%d\"", i);
+            _sample(out, "wheelbot_core_busy_percent", labels, coreLoad[i]);
+        }
+    }
+
+    BacklogStats backlog;
+    if (_streamer->getBacklogStats(backlog)) {
+        _gauge(out, "wheelbot_backlog_pending_bytes", "Stored frames not uploaded yet", backlog.pendingBytes);
+        _family(out, "wheelbot_backlog_frames_total", "counter", "Frames through the outage backlog");
+        _sample(out, "wheelbot_backlog_frames_total", "event=\"recorded\"", backlog.recorded);
+        _sample(out, "wheelbot_backlog_frames_total", "event=\"uploaded\"", backlog.uploaded);
+        _sample(out, "wheelbot_backlog_frames_total", "event=\"skipped\"", backlog.skipped);
+        _counter(out, "wheelbot_backlog_evicted_segments_total", "Segments dropped unsent for space",
+                 backlog.evictedSegments);
+        _counter(out, "wheelbot_backlog_flash_writes_total", "Batched flash writes", backlog.flashWrites);
+    }
+}
+
+void MetricsExporter::_writeSendHistogram(Output& out, uint64_t sumUs) {
+    const LatencyHistogram* histogram = _streamer->getSendHistogram();
+    if (!histogram) {
+        return;
+    }
+
+    _family(out, "wheelbot_send_duration_seconds", "histogram", "Transport write time per frame");
+
+    // Powers of two line up with the histogram's own bucket edges: 1 ms to 4 s
+    uint64_t cumulative = 0;
+    size_t i = 0;
+    char labels[24];
+    for (int shift = 10; shift <= 22; shift++) {
+        uint32_t bound = 1u << shift;
+        while (i + 1 < LatencyHistogram::BUCKETS && LatencyHistogram::bucketLowerBound(i + 1) <= bound) {
+            cumulative += histogram->bucketCount(i++);
+        }
+        snprintf(labels, sizeof(labels), "le=\"%u.%06u\"", bound / 1000000, bound % 1000000);
+        _sample(out, "wheelbot_send_duration_seconds_bucket", labels, cumulative);
+    }
+    while (i < LatencyHistogram::BUCKETS) {
+        cumulative += histogram->bucketCount(i++);
+    }
+    _sample(out, "wheelbot_send_duration_seconds_bucket", "le=\"+Inf\"", cumulative);
+    _sampleSeconds(out, "wheelbot_send_duration_seconds_sum", nullptr, sumUs);
+    _sample(out, "wheelbot_send_duration_seconds_count", nullptr, cumulative);
+}
+
+void MetricsExporter::_writeSystem(Output& out) {
+    _family(out, "wheelbot_uptime_seconds", "gauge", "Time since boot");
+    _sampleSeconds(out, "wheelbot_uptime_seconds", nullptr, esp_timer_get_time());
+
+    struct Region {
+        const char* label;
+        uint32_t caps;
+    };
+    static const Region REGIONS[] = {
+        { "region=\"internal\"", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+        { "region=\"psram\"", MALLOC_CAP_SPIRAM }
+    };
+    size_t regions = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0 ? 2 : 1;
+
+    _family(out, "wheelbot_heap_size_bytes", "gauge", "Heap size");
+    for (size_t i = 0; i < regions; i++) {
+        _sample(out, "wheelbot_heap_size_bytes", REGIONS[i].label, heap_caps_get_total_size(REGIONS[i].caps));
+    }
+    _family(out, "wheelbot_heap_free_bytes", "gauge", "Free heap");
+    for (size_t i = 0; i < regions; i++) {
+        _sample(out, "wheelbot_heap_free_bytes", REGIONS[i].label, heap_caps_get_free_size(REGIONS[i].caps));
+    }
+    _family(out, "wheelbot_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    for (size_t i = 0; i < regions; i++) {
+        _sample(out, "wheelbot_heap_min_free_bytes", REGIONS[i].label,
+                heap_caps_get_minimum_free_size(REGIONS[i].caps));
+    }
+    _family(out, "wheelbot_heap_largest_free_block_bytes", "gauge", "Largest allocatable block");
+    for (size_t i = 0; i < regions; i++) {
+        _sample(out, "wheelbot_heap_largest_free_block_bytes", REGIONS[i].label,
+                heap_caps_get_largest_free_block(REGIONS[i].caps));
+    }
+}
+
+void MetricsExporter::_writeWiFi(Output& out) {
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        _gauge(out, "wheelbot_wifi_connected", "1 while associated with an access point", 0);
+        return;
+    }
+    _gauge(out, "wheelbot_wifi_connected", "1 while associated with an access point", 1);
+    _gauge(out, "wheelbot_wifi_rssi_dbm", "Signal strength of the access point", ap.rssi);
+    _gauge(out, "wheelbot_wifi_channel", "Primary channel", ap.primary);
+
+    wifi_bandwidth_t bandwidth = WIFI_BW_HT20;
+    esp_wifi_get_bandwidth(WIFI_IF_STA, &bandwidth);
+    bool ht40 = bandwidth == WIFI_BW_HT40;
+
+    // The driver does not expose the rate in use, so this is the top rate of
+    // the negotiated PHY mode (MCS7 with short guard interval for 11n)
+    const char* mode = ap.phy_11n ? "11n" : ap.phy_11g ? "11g" : "11b";
+    uint32_t rate = ap.phy_11n ? (ht40 ? 150000000 : 72200000) : ap.phy_11g ? 54000000 : 11000000;
+
+    char labels[48];
+    snprintf(labels, sizeof(labels), "mode=\"%s\",bandwidth=\"%s\"", mode, ap.phy_11n && ht40 ? "ht40" : "ht20");
+    _family(out, "wheelbot_wifi_phy_rate_max_bits_per_second", "gauge", "Top PHY rate of the link mode");
+    _sample(out, "wheelbot_wifi_phy_rate_max_bits_per_second", labels, rate);
+}
+
+void MetricsExporter::_writeTasks(Output& out) {
+    _family(out, "wheelbot_task_stack_free_min_bytes", "gauge", "Stack high-water mark: least free stack seen");
+
+    char labels[40];
+    for (size_t i = 0; i < sizeof(TASKS) / sizeof(TASKS[0]); i++) {
+        TaskHandle_t task = xTaskGetHandle(TASKS[i]);
+        if (!task) {
+            continue;
+        }
+        snprintf(labels, sizeof(labels), "task=\"%s\"", TASKS[i]);
+        _sample(out, "wheelbot_task_stack_free_min_bytes", labels, uxTaskGetStackHighWaterMark(task));
+    }
+}
+
+void MetricsExporter::_family(Output& out, const char* name, const char* type, const char* help) {
+    _printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsExporter::_counter(Output& out, const char* name, const char* help, int64_t value) {
+    _family(out, name, "counter", help);
+    _sample(out, name, nullptr, value);
+}
+
+void MetricsExporter::_gauge(Output& out, const char* name, const char* help, int64_t value) {
+    _family(out, name, "gauge", help);
+    _sample(out, name, nullptr, value);
+}
+
+void MetricsExporter::_sample(Output& out, const char* name, const char* labels, int64_t value) {
+    if (labels) {
+        _printf(out, "%s{%s} %lld\n", name, labels, (long long)value);
+    } else {
+        _printf(out, "%s %lld\n", name, (long long)value);
+    }
+}
+
+void MetricsExporter::_sampleSeconds(Output& out, const char* name, const char* labels, uint64_t us) {
+    unsigned long long seconds = us / 1000000;
+    unsigned fraction = (unsigned)(us % 1000000);
+    if (labels) {
+        _printf(out, "%s{%s} %llu.%06u\n", name, labels, seconds, fraction);
+    } else {
+        _printf(out, "%s %llu.%06u\n", name, seconds, fraction);
+    }
+}
+
+void MetricsExporter::_printf(Output& out, const char* format, ...) {
+    for (int attempt = 0; attempt < 2 && out.ok; attempt++) {
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(out.buf + out.len, sizeof(out.buf) - out.len, format, args);
+        va_end(args);
+
+        if (len < 0) {
+            return;
+        }
+        if (out.len + len < sizeof(out.buf)) {
+            out.len += len;
+            return;
+        }
+        // Did not fit: send what is buffered and format again into the empty buffer
+        if (out.len == 0) {
+            return;
+        }
+        _flush(out);
+    }
+}
+
+bool MetricsExporter::_flush(Output& out) {
+    if (out.ok && out.len > 0) {
+        out.ok = MjpegServer::sendAll(out.sock, out.buf, out.len);
+    }
+    out.len = 0;
+    return out.ok;
+}
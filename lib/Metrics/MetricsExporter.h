@@ -0,0 +1,55 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "Arduino.h"
+
+class Streamer;
+class MjpegServer;
+
+// Serves the Prometheus text exposition format (version 0.0.4): stream
+// counters, the send-duration histogram, heap and PSRAM, WiFi link and
+// task stack high-water marks.
+//
+// serve() runs on the HTTP server's task and streams the response through
+// a small stack buffer, so a scrape allocates nothing and needs no
+// Content-Length. Stream counters are read lock-free (see StreamCounters);
+// only the heap and task queries take the allocator and scheduler locks
+// for their duration, and never on the frame path.
+class MetricsExporter {
+public:
+    MetricsExporter(Streamer* streamer, MjpegServer* server = nullptr);
+
+    // Writes a complete HTTP response to sock
+    bool serve(int sock);
+
+private:
+    struct Output {
+        int sock;
+        char buf[512];
+        size_t len;
+        bool ok;
+    };
+
+    void _writeStream(Output& out);
+    void _writeSendHistogram(Output& out, uint64_t sumUs);
+    void _writeSystem(Output& out);
+    void _writeWiFi(Output& out);
+    void _writeTasks(Output& out);
+
+    // "# HELP" and "# TYPE" lines, once per metric family
+    static void _family(Output& out, const char* name, const char* type, const char* help);
+    // Family with a single unlabelled sample
+    static void _counter(Output& out, const char* name, const char* help, int64_t value);
+    static void _gauge(Output& out, const char* name, const char* help, int64_t value);
+    // One sample; labels without the braces, e.g. reason="stale", or nullptr
+    static void _sample(Output& out, const char* name, const char* labels, int64_t value);
+    // Microseconds written as seconds, without going through float
+    static void _sampleSeconds(Output& out, const char* name, const char* labels, uint64_t us);
+    static void _printf(Output& out, const char* format, ...);
+    static bool _flush(Output& out);
+
+    Streamer* _streamer;
+    MjpegServer* _server;
+};
+
+#endif
@@ -0,0 +1,359 @@
+#include "MjpegServer.h"
+#include "SharedFrameSource.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <strings.h>
+
+static const char* TAG = "MjpegServer";
+
+// Marks a viewer slot without a client; publish() never overwrites it
+static camera_fb_t* const VIEWER_CLOSED = reinterpret_cast<camera_fb_t*>(1);
+
+// Route handlers run here and format into stack buffers
+#define ACCEPT_TASK_STACK 6144
+#define VIEWER_TASK_STACK 4096
+#define SERVER_TASK_PRIORITY 2
+#define SOCKET_RECV_TIMEOUT_MS 2000
+#define SOCKET_SEND_TIMEOUT_MS 5000
+
+MjpegServer::MjpegServer(uint16_t port, const char* boundary)
+    : _port(port),
+      _boundary(boundary),
+      _partHeader(boundary),
+      _listenSock(-1),
+      _acceptTask(nullptr),
+      _viewerCount(0),
+      _routeCount(0)
+{
+    for (size_t i = 0; i < MAX_VIEWERS; i++) {
+        _viewers[i].server = this;
+        _viewers[i].sock = -1;
+        _viewers[i].task = nullptr;
+        _viewers[i].active.store(false);
+        _viewers[i].pending.store(VIEWER_CLOSED);
+        _viewers[i].frames = nullptr;
+    }
+}
+
+MjpegServer::~MjpegServer() {
+    if (_acceptTask) {
+        vTaskDelete(_acceptTask);
+        _acceptTask = nullptr;
+    }
+    if (_listenSock >= 0) {
+        close(_listenSock);
+        _listenSock = -1;
+    }
+}
+
+void MjpegServer::on(const char* path, Handler handler) {
+    if (_routeCount >= sizeof(_routes) / sizeof(_routes[0])) {
+        ESP_LOGE(TAG, "Route table full, ignoring %s", path);
+        return;
+    }
+    _routes[_routeCount].path = path;
+    _routes[_routeCount].handler = handler;
+    _routeCount++;
+}
+
+bool MjpegServer::begin() {
+    _listenSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_listenSock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(_listenSock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(_port);
+
+    if (bind(_listenSock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(_listenSock, MAX_VIEWERS) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %u: errno %d", _port, errno);
+        close(_listenSock);
+        _listenSock = -1;
+        return false;
+    }
+
+    BaseType_t result = xTaskCreate(MjpegServer::acceptTaskWrapper, "MjpegAccept",
+                                    ACCEPT_TASK_STACK, this, SERVER_TASK_PRIORITY, &_acceptTask);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create accept task");
+        close(_listenSock);
+        _listenSock = -1;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "MJPEG server listening on port %u (max %u viewers)", _port, MAX_VIEWERS);
+    return true;
+}
+
+bool MjpegServer::sendAll(int sock, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t written = ::send(sock, p, len, 0);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        len -= written;
+    }
+    return true;
+}
+
+void MjpegServer::sendResponse(int sock, int status, const char* contentType, const char* body, size_t len) {
+    const char* reason = "OK";
+    switch (status) {
+        case 200: reason = "OK"; break;
+        case 202: reason = "Accepted"; break;
+        case 204: reason = "No Content"; break;
+        case 400: reason = "Bad Request"; break;
+        case 404: reason = "Not Found"; break;
+        case 405: reason = "Method Not Allowed"; break;
+        case 500: reason = "Internal Server Error"; break;
+        case 503: reason = "Service Unavailable"; break;
+    }
+
+    char head[192];
+    int headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %u\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           status, reason, contentType, len);
+    if (sendAll(sock, head, headLen) && len > 0) {
+        sendAll(sock, body, len);
+    }
+}
+
+void MjpegServer::acceptTaskWrapper(void* parameter) {
+    static_cast<MjpegServer*>(parameter)->acceptTask();
+}
+
+void MjpegServer::viewerTaskWrapper(void* parameter) {
+    Viewer* viewer = static_cast<Viewer*>(parameter);
+    viewer->server->viewerTask(viewer);
+}
+
+bool MjpegServer::_readRequest(int sock, HttpRequest& request) {
+    char buf[1536];
+    size_t len = 0;
+    char* headerEnd = nullptr;
+
+    while (len < sizeof(buf) - 1) {
+        ssize_t n = recv(sock, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        len += n;
+        buf[len] = '\0';
+        headerEnd = strstr(buf, "\r\n\r\n");
+        if (headerEnd) {
+            break;
+        }
+    }
+    if (!headerEnd) {
+        return false;
+    }
+
+    char target[192];
+    if (sscanf(buf, "%7s %191s", request.method, target) != 2) {
+        return false;
+    }
+
+    char* query = strchr(target, '?');
+    if (query) {
+        *query++ = '\0';
+    }
+    snprintf(request.path, sizeof(request.path), "%s", target);
+    snprintf(request.query, sizeof(request.query), "%s", query ? query : "");
+
+    size_t contentLength = 0;
+    for (char* line = strstr(buf, "\r\n"); line && line < headerEnd; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            contentLength = strtoul(line + 2 + 15, nullptr, 10);
+            break;
+        }
+    }
+
+    char* bodyStart = headerEnd + 4;
+    size_t have = len - (bodyStart - buf);
+    size_t want = contentLength < sizeof(request.body) - 1 ? contentLength : sizeof(request.body) - 1;
+    size_t copy = have < want ? have : want;
+    memcpy(request.body, bodyStart, copy);
+    request.bodyLen = copy;
+
+    while (request.bodyLen < want) {
+        ssize_t n = recv(sock, request.body + request.bodyLen, want - request.bodyLen, 0);
+        if (n <= 0) {
+            break;
+        }
+        request.bodyLen += n;
+    }
+    request.body[request.bodyLen] = '\0';
+    return true;
+}
+
+void MjpegServer::acceptTask() {
+    HttpRequest* request = new HttpRequest();
+
+    while (true) {
+        struct sockaddr_in client;
+        socklen_t clientLen = sizeof(client);
+        int sock = accept(_listenSock, (struct sockaddr*)&client, &clientLen);
+        if (sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        struct timeval rcv = { SOCKET_RECV_TIMEOUT_MS / 1000, (SOCKET_RECV_TIMEOUT_MS % 1000) * 1000 };
+        struct timeval snd = { SOCKET_SEND_TIMEOUT_MS / 1000, (SOCKET_SEND_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+
+        if (!_readRequest(sock, *request)) {
+            close(sock);
+            continue;
+        }
+
+        if (strcmp(request->path, "/stream") == 0) {
+            _startViewer(sock);
+            continue;
+        }
+
+        bool handled = false;
+        for (size_t i = 0; i < _routeCount; i++) {
+            if (strcmp(request->path, _routes[i].path) == 0) {
+                _routes[i].handler(sock, *request);
+                handled = true;
+                break;
+            }
+        }
+        if (!handled) {
+            static const char NOT_FOUND[] = "Not Found";
+            sendResponse(sock, 404, "text/plain", NOT_FOUND, sizeof(NOT_FOUND) - 1);
+        }
+
+        close(sock);
+    }
+}
+
+void MjpegServer::_startViewer(int sock) {
+    Viewer* viewer = nullptr;
+    for (size_t i = 0; i < MAX_VIEWERS; i++) {
+        if (!_viewers[i].active.load()) {
+            viewer = &_viewers[i];
+            break;
+        }
+    }
+
+    if (!viewer) {
+        static const char BUSY[] = "Too many viewers";
+        sendResponse(sock, 503, "text/plain", BUSY, sizeof(BUSY) - 1);
+        close(sock);
+        return;
+    }
+
+    char head[256];
+    int headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: multipart/x-mixed-replace; boundary=%s\r\n"
+                           "Cache-Control: no-cache, no-store\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           _boundary);
+    if (!sendAll(sock, head, headLen)) {
+        close(sock);
+        return;
+    }
+
+    // Viewer tasks are created on first use and then parked between clients,
+    // so publish() never notifies a deleted task.
+    if (!viewer->task) {
+        BaseType_t result = xTaskCreate(MjpegServer::viewerTaskWrapper, "MjpegViewer",
+                                        VIEWER_TASK_STACK, viewer, SERVER_TASK_PRIORITY, &viewer->task);
+        if (result != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create viewer task");
+            viewer->task = nullptr;
+            close(sock);
+            return;
+        }
+    }
+
+    viewer->sock = sock;
+    viewer->active.store(true);
+    viewer->pending.store(nullptr);
+    _viewerCount++;
+
+    ESP_LOGI(TAG, "Viewer connected (%u active)", _viewerCount.load());
+}
+
+bool MjpegServer::wantsFrames() const {
+    return _viewerCount.load() > 0;
+}
+
+void MjpegServer::publish(camera_fb_t* fb, SharedFrameSource* frames) {
+    for (size_t i = 0; i < MAX_VIEWERS; i++) {
+        Viewer& viewer = _viewers[i];
+
+        // Busy (still writing a frame) or no client: skip
+        if (viewer.pending.load(std::memory_order_acquire) != nullptr) {
+            continue;
+        }
+
+        viewer.frames = frames;
+        frames->retain(fb);
+
+        camera_fb_t* expected = nullptr;
+        if (viewer.pending.compare_exchange_strong(expected, fb, std::memory_order_acq_rel)) {
+            xTaskNotifyGive(viewer.task);
+        } else {
+            frames->return_frame(fb);
+        }
+    }
+}
+
+void MjpegServer::viewerTask(Viewer* viewer) {
+    char header[160];
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        camera_fb_t* fb = viewer->pending.load(std::memory_order_acquire);
+        if (fb == nullptr || fb == VIEWER_CLOSED) {
+            continue;
+        }
+
+        size_t headerLen = _partHeader.format(fb, header, sizeof(header));
+        bool ok = sendAll(viewer->sock, header, headerLen) && sendAll(viewer->sock, fb->buf, fb->len);
+
+        viewer->frames->return_frame(fb);
+
+        if (ok) {
+            viewer->pending.store(nullptr, std::memory_order_release);
+            continue;
+        }
+
+        viewer->pending.store(VIEWER_CLOSED, std::memory_order_release);
+        close(viewer->sock);
+        viewer->sock = -1;
+        _viewerCount--;
+        viewer->active.store(false);
+
+        ESP_LOGI(TAG, "Viewer disconnected (%u active)", _viewerCount.load());
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef MJPEG_SERVER_H
+#define MJPEG_SERVER_H
+
+#include "Arduino.h"
+#include "FrameSink.h"
+#include "MultipartHeader.h"
+#include <atomic>
+#include <functional>
+
+struct HttpRequest {
+    char method[8];
+    char path[64];
+    char query[128];
+    char body[1024];
+    size_t bodyLen;
+};
+
+// Small on-device HTTP server. GET /stream serves multipart/x-mixed-replace
+// MJPEG to up to MAX_VIEWERS clients: each viewer gets its own send task and
+// shares the captured camera_fb_t by reference. A viewer still writing the
+// previous frame is skipped, so a slow client only lowers its own frame
+// rate. Other paths are dispatched to handlers registered with on().
+class MjpegServer : public FrameSink {
+public:
+    typedef std::function<void(int sock, const HttpRequest& request)> Handler;
+
+    MjpegServer(uint16_t port = 81, const char* boundary = "wheelbot");
+    ~MjpegServer();
+
+    bool begin();
+    void on(const char* path, Handler handler);
+
+    bool wantsFrames() const override;
+    // A slow viewer may still be writing an older frame than the others
+    size_t maxFramesHeld() const override { return MAX_VIEWERS; }
+    void publish(camera_fb_t* fb, SharedFrameSource* frames) override;
+
+    uint32_t getViewerCount() const { return _viewerCount.load(); }
+
+    // Helpers for route handlers
+    static bool sendAll(int sock, const void* data, size_t len);
+    static void sendResponse(int sock, int status, const char* contentType, const char* body, size_t len);
+
+    static const size_t MAX_VIEWERS = 4;
+
+private:
+    struct Viewer {
+        MjpegServer* server;
+        int sock;
+        TaskHandle_t task;
+        std::atomic<bool> active;
+        std::atomic<camera_fb_t*> pending;
+        SharedFrameSource* frames;
+    };
+
+    struct Route {
+        const char* path;
+        Handler handler;
+    };
+
+    static void acceptTaskWrapper(void* parameter);
+    static void viewerTaskWrapper(void* parameter);
+    void acceptTask();
+    void viewerTask(Viewer* viewer);
+
+    bool _readRequest(int sock, HttpRequest& request);
+    void _startViewer(int sock);
+
+    uint16_t _port;
+    const char* _boundary;
+    MultipartHeader _partHeader;
+    int _listenSock;
+    TaskHandle_t _acceptTask;
+
+    Viewer _viewers[MAX_VIEWERS];
+    std::atomic<uint32_t> _viewerCount;
+
+    Route _routes[8];
+    size_t _routeCount;
+};
+
+#endif
@@ -0,0 +1,407 @@
+#include "BacklogStore.h"
+#include <LittleFS.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG = "BacklogStore";
+
+#define BACKLOG_DIR "/backlog"
+#define BACKLOG_RECORD_MAGIC 0x4B4C4257   // "WBLK"
+// Left free on the partition for the web files and settings
+#define BACKLOG_FS_RESERVE (16 * 1024)
+
+// Flash I/O at the lowest priority, on the core the capture task does not use
+#define BACKLOG_TASK_STACK 4096
+#define BACKLOG_TASK_PRIORITY 1
+#define BACKLOG_TASK_CORE 0
+
+BacklogStore::BacklogStore(const StreamConfig& config)
+    : _config(config),
+      _intervalMs(config.backlogFPS > 0 ? (uint32_t)(1000.0f / config.backlogFPS) : 0),
+      _task(nullptr),
+      _fill(nullptr),
+      _fillLen(0),
+      _fillFrames(0),
+      _fillStartedMs(0),
+      _lastRecordMs(0),
+      _flushBuf(nullptr),
+      _flushLen(0),
+      _flushFrames(0),
+      _flushPending(false),
+      _readSeq(0),
+      _readOffset(0),
+      _writeSeq(0),
+      _writeSize(0),
+      _storedBytes(0),
+      _replayBuf(nullptr),
+      _replayFb(),
+      _replayTimestamp(),
+      _loadedSeq(0),
+      _loadedOffset(0),
+      _loadedLen(0),
+      _replayState(EMPTY),
+      _replaySent(false),
+      _pendingBytes(0),
+      _segments(0),
+      _recorded(0),
+      _uploaded(0),
+      _skipped(0),
+      _evictedSegments(0),
+      _flashWrites(0)
+{
+}
+
+BacklogStore::~BacklogStore() {
+    if (_task) {
+        vTaskDelete(_task);
+        _task = nullptr;
+    }
+    heap_caps_free(_fill);
+    heap_caps_free(_flushBuf);
+    heap_caps_free(_replayBuf);
+}
+
+void BacklogStore::_path(uint32_t seq, char* out, size_t outSize) {
+    snprintf(out, outSize, BACKLOG_DIR "/%08u.seg", seq);
+}
+
+bool BacklogStore::begin() {
+    if (!LittleFS.begin()) {
+        ESP_LOGE(TAG, "Failed to mount LittleFS");
+        return false;
+    }
+    if (!LittleFS.exists(BACKLOG_DIR) && !LittleFS.mkdir(BACKLOG_DIR)) {
+        ESP_LOGE(TAG, "Failed to create " BACKLOG_DIR);
+        return false;
+    }
+
+    uint32_t caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    _fill = (uint8_t*)heap_caps_malloc(_config.backlogBatchBytes, caps);
+    _flushBuf = (uint8_t*)heap_caps_malloc(_config.backlogBatchBytes, caps);
+    _replayBuf = (uint8_t*)heap_caps_malloc(_config.backlogBatchBytes, caps);
+    if (!_fill || !_flushBuf || !_replayBuf) {
+        ESP_LOGE(TAG, "Failed to allocate %u byte batch buffers in PSRAM", _config.backlogBatchBytes);
+        heap_caps_free(_fill);
+        heap_caps_free(_flushBuf);
+        heap_caps_free(_replayBuf);
+        _fill = _flushBuf = _replayBuf = nullptr;
+        return false;
+    }
+    _replayFb.buf = _replayBuf;
+    _replayFb.format = PIXFORMAT_JPEG;
+
+    _scan();
+
+    BaseType_t result = xTaskCreatePinnedToCore(BacklogStore::backlogTaskWrapper, "Backlog",
+                                                BACKLOG_TASK_STACK, this, BACKLOG_TASK_PRIORITY,
+                                                &_task, BACKLOG_TASK_CORE);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create backlog task");
+        _task = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Backlog: %u KB budget, %.1f FPS during outages, %u KB left from before reboot",
+             _config.backlogMaxBytes / 1024, _intervalMs ? 1000.0f / _intervalMs : 0.0f,
+             _storedBytes / 1024);
+    _publishStats();
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+void BacklogStore::_scan() {
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    _storedBytes = 0;
+
+    File dir = LittleFS.open(BACKLOG_DIR);
+    for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+        // Older cores return the full path, newer ones the bare name
+        const char* name = strrchr(file.name(), '/');
+        name = name ? name + 1 : file.name();
+
+        char* end;
+        uint32_t seq = strtoul(name, &end, 10);
+        if (end != name && strcmp(end, ".seg") == 0) {
+            first = std::min(first, seq);
+            last = std::max(last, seq);
+            _storedBytes += file.size();
+        }
+        file.close();
+    }
+    dir.close();
+
+    // Never append to a segment from before the reboot: its tail may be torn
+    _readSeq = first == UINT32_MAX ? 0 : first;
+    _readOffset = 0;
+    _writeSeq = first == UINT32_MAX ? 0 : last + 1;
+    _writeSize = 0;
+}
+
+bool BacklogStore::isDue() const {
+    return _fill && (_intervalMs == 0 || millis() - _lastRecordMs >= _intervalMs);
+}
+
+void BacklogStore::record(const camera_fb_t* fb) {
+    if (!isDue()) {
+        return;
+    }
+
+    uint32_t now = millis();
+    _lastRecordMs = now;
+
+    size_t need = sizeof(RecordHeader) + fb->len;
+    if (need > _config.backlogBatchBytes ||
+        (_fillLen + need > _config.backlogBatchBytes && !_swapBatch())) {
+        _skipped++;
+        return;
+    }
+
+    if (_fillLen == 0) {
+        _fillStartedMs = now;
+    }
+
+    RecordHeader header = {};
+    header.magic = BACKLOG_RECORD_MAGIC;
+    header.len = fb->len;
+    header.width = (uint16_t)fb->width;
+    header.height = (uint16_t)fb->height;
+    header.sec = (uint32_t)fb->timestamp.tv_sec;
+    header.usec = (uint32_t)fb->timestamp.tv_usec;
+    memcpy(_fill + _fillLen, &header, sizeof(header));
+    memcpy(_fill + _fillLen + sizeof(header), fb->buf, fb->len);
+    _fillLen += need;
+    _fillFrames++;
+
+    // Bounds what a power cut during a long outage can lose
+    if (now - _fillStartedMs >= _config.backlogFlushMs) {
+        _swapBatch();
+    }
+}
+
+void BacklogStore::flush() {
+    _swapBatch();
+}
+
+bool BacklogStore::_swapBatch() {
+    if (_fillLen == 0 || _flushPending.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    std::swap(_fill, _flushBuf);
+    _flushLen = _fillLen;
+    _flushFrames = _fillFrames;
+    _fillLen = 0;
+    _fillFrames = 0;
+    _flushPending.store(true, std::memory_order_release);
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+void BacklogStore::backlogTaskWrapper(void* parameter) {
+    static_cast<BacklogStore*>(parameter)->backlogTask();
+}
+
+void BacklogStore::backlogTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (_flushPending.load(std::memory_order_acquire)) {
+            _writeBatch();
+            _flushPending.store(false, std::memory_order_release);
+        }
+
+        if (_replayState.load() == CONSUMED) {
+            _advance();
+            _replayState.store(EMPTY);
+        }
+
+        if (_replayState.load() == EMPTY && _load()) {
+            _replayState.store(READY, std::memory_order_release);
+        }
+
+        _publishStats();
+    }
+}
+
+void BacklogStore::_writeBatch() {
+    size_t len = _flushLen;
+
+    if (_writeSize > 0 && _writeSize + len > _config.backlogSegmentBytes) {
+        _writeSeq++;
+        _writeSize = 0;
+    }
+
+    // Oldest segments go first, both for the budget and for free space on the partition
+    while (_readSeq < _writeSeq &&
+           (_storedBytes + len > _config.backlogMaxBytes ||
+            LittleFS.totalBytes() - LittleFS.usedBytes() < len + BACKLOG_FS_RESERVE)) {
+        _dropOldest();
+    }
+
+    if (_storedBytes + len > _config.backlogMaxBytes ||
+        LittleFS.totalBytes() - LittleFS.usedBytes() < len + BACKLOG_FS_RESERVE) {
+        ESP_LOGW(TAG, "No room for a %u byte batch, %u frames lost", len, _flushFrames);
+        _skipped += _flushFrames;
+        return;
+    }
+
+    char path[32];
+    _path(_writeSeq, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_APPEND);
+    size_t written = 0;
+    if (file) {
+        written = file.write(_flushBuf, len);
+        file.close();
+    }
+    _flashWrites++;
+    _storedBytes += written;
+    _writeSize += written;
+
+    if (written != len) {
+        ESP_LOGE(TAG, "Short write to %s (%u of %u bytes)", path, written, len);
+        _skipped += _flushFrames;
+        if (written > 0) {
+            // The torn record ends this segment; the reader skips what follows it
+            _writeSeq++;
+            _writeSize = 0;
+        }
+        return;
+    }
+
+    _recorded += _flushFrames;
+    ESP_LOGD(TAG, "Wrote %u frames (%u bytes) to %s", _flushFrames, len, path);
+}
+
+void BacklogStore::_dropOldest() {
+    char path[32];
+    _path(_readSeq, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    size_t size = file ? file.size() : 0;
+    if (file) {
+        file.close();
+    }
+
+    ESP_LOGW(TAG, "Backlog full, dropping %s unsent", path);
+    _finishSegment(size);
+    _evictedSegments++;
+}
+
+void BacklogStore::_finishSegment(size_t size) {
+    char path[32];
+    _path(_readSeq, path, sizeof(path));
+    LittleFS.remove(path);
+
+    _storedBytes -= std::min((uint32_t)size, _storedBytes);
+    _readSeq++;
+    _readOffset = 0;
+}
+
+bool BacklogStore::_load() {
+    while (true) {
+        if (_readSeq == _writeSeq && _readOffset >= _writeSize) {
+            if (_writeSize > 0) {
+                // All uploaded: free the flash and start the next outage in a new segment
+                _finishSegment(_writeSize);
+                _writeSeq = _readSeq;
+                _writeSize = 0;
+            }
+            return false;
+        }
+
+        char path[32];
+        _path(_readSeq, path, sizeof(path));
+        File file = LittleFS.open(path, FILE_READ);
+        size_t size = file ? file.size() : 0;
+
+        RecordHeader header;
+        if (file && _readOffset + sizeof(header) <= size && file.seek(_readOffset) &&
+            file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) {
+            if (header.magic == BACKLOG_RECORD_MAGIC && header.len <= _config.backlogBatchBytes &&
+                _readOffset + sizeof(header) + header.len <= size &&
+                file.read(_replayBuf, header.len) == header.len) {
+                file.close();
+
+                _replayFb.len = header.len;
+                _replayFb.width = header.width;
+                _replayFb.height = header.height;
+                _replayTimestamp.tv_sec = header.sec;
+                _replayTimestamp.tv_usec = header.usec;
+                _loadedSeq = _readSeq;
+                _loadedOffset = _readOffset;
+                _loadedLen = sizeof(header) + header.len;
+                return true;
+            }
+            ESP_LOGW(TAG, "Damaged record in %s at %u, skipping the rest of the segment", path, _readOffset);
+        }
+        if (file) {
+            file.close();
+        }
+
+        if (_readSeq == _writeSeq) {
+            _readOffset = _writeSize;
+        } else {
+            _finishSegment(size);
+        }
+    }
+}
+
+void BacklogStore::_advance() {
+    // The segment may have been dropped for space while the frame was out
+    if (_loadedSeq == _readSeq && _loadedOffset == _readOffset) {
+        _readOffset += _loadedLen;
+    }
+    _uploaded++;
+}
+
+void BacklogStore::_publishStats() {
+    _pendingBytes = _storedBytes - std::min(_readOffset, _storedBytes);
+    _segments = _writeSeq - _readSeq + (_writeSize > 0 ? 1 : 0);
+}
+
+camera_fb_t* BacklogStore::get_frame() {
+    int expected = READY;
+    if (!_replayState.compare_exchange_strong(expected, IN_FLIGHT, std::memory_order_acq_rel)) {
+        return nullptr;
+    }
+    // A failed attempt may have left the frame restamped
+    _replayFb.timestamp = _replayTimestamp;
+    _replaySent = false;
+    return &_replayFb;
+}
+
+void BacklogStore::frame_sent(camera_fb_t* frame) {
+    if (frame == &_replayFb) {
+        _replaySent = true;
+    }
+}
+
+void BacklogStore::return_frame(camera_fb_t* frame) {
+    if (frame != &_replayFb) {
+        return;
+    }
+
+    if (_replaySent.exchange(false)) {
+        _replayState.store(CONSUMED);
+        xTaskNotifyGive(_task);
+    } else {
+        // Dropped or the send failed: offer the same frame again
+        _replayState.store(READY);
+    }
+}
+
+BacklogStats BacklogStore::getStats() const {
+    BacklogStats stats = {};
+    stats.pendingBytes = _pendingBytes.load();
+    stats.segments = _segments.load();
+    stats.recorded = _recorded.load();
+    stats.uploaded = _uploaded.load();
+    stats.skipped = _skipped.load();
+    stats.evictedSegments = _evictedSegments.load();
+    stats.flashWrites = _flashWrites.load();
+    return stats;
+}
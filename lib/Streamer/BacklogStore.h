@@ -0,0 +1,128 @@
+#ifndef BACKLOG_STORE_H
+#define BACKLOG_STORE_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "FrameSource.h"
+#include "StreamConfig.h"
+#include <atomic>
+
+struct BacklogStats {
+    uint32_t pendingBytes;        // on flash and not uploaded yet
+    uint32_t segments;
+    uint32_t recorded;            // frames written to flash, cumulative
+    uint32_t uploaded;
+    uint32_t skipped;             // writer busy, frame larger than a batch or flash full
+    uint32_t evictedSegments;     // dropped unsent to stay within backlogMaxBytes
+    uint32_t flashWrites;
+};
+
+// Store-and-forward log for frames captured while the push stream is down.
+//
+// record() copies frames into a RAM batch; full batches (or one older than
+// backlogFlushMs) are appended to the current segment file in a single
+// write by the backlog task, so the flash sees few large sequential writes
+// instead of one small write per frame. Segments are append-only files
+// under /backlog that are deleted whole once uploaded or when the budget
+// runs out, oldest first; nothing is ever rewritten in place and the read
+// position lives in RAM only. After a reboot the remaining segments are
+// uploaded from their start.
+//
+// The upload side is a FrameSource: get_frame() returns the oldest stored
+// frame, with its original capture timestamp, once the task has loaded it.
+// A frame leaves the log only after frame_sent(); one returned without it
+// (dropped or failed) is offered again.
+class BacklogStore : public FrameSource {
+public:
+    BacklogStore(const StreamConfig& config);
+    ~BacklogStore();
+
+    // Mounts LittleFS, picks up segments left from before a reboot and
+    // starts the backlog task. Call after the camera is set up.
+    bool begin();
+
+    // True when record() would take the next frame
+    bool isDue() const;
+    // Capture task only
+    void record(const camera_fb_t* fb);
+    // Hands a partial batch to the writer, e.g. once the outage is over
+    void flush();
+
+    camera_fb_t* get_frame() override;
+    void return_frame(camera_fb_t* frame) override;
+    void frame_sent(camera_fb_t* frame) override;
+
+    BacklogStats getStats() const;
+
+private:
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t len;
+        uint16_t width;
+        uint16_t height;
+        uint32_t sec;
+        uint32_t usec;
+    };
+
+    enum ReplayState {
+        EMPTY,
+        READY,
+        IN_FLIGHT,
+        CONSUMED
+    };
+
+    static void backlogTaskWrapper(void* parameter);
+    void backlogTask();
+
+    bool _swapBatch();
+    void _scan();
+    void _writeBatch();
+    void _dropOldest();
+    bool _load();
+    void _advance();
+    void _finishSegment(size_t size);
+    void _publishStats();
+    static void _path(uint32_t seq, char* out, size_t outSize);
+
+    const StreamConfig& _config;
+    uint32_t _intervalMs;
+    TaskHandle_t _task;
+
+    // Filled by the capture task; handed to the writer whole
+    uint8_t* _fill;
+    size_t _fillLen;
+    uint32_t _fillFrames;
+    uint32_t _fillStartedMs;
+    uint32_t _lastRecordMs;
+    uint8_t* _flushBuf;
+    size_t _flushLen;
+    uint32_t _flushFrames;
+    std::atomic<bool> _flushPending;
+
+    // Segment files: _readSeq is the oldest, _writeSeq the one appended to.
+    // Only the backlog task touches these.
+    uint32_t _readSeq;
+    uint32_t _readOffset;
+    uint32_t _writeSeq;
+    uint32_t _writeSize;
+    uint32_t _storedBytes;
+
+    uint8_t* _replayBuf;
+    camera_fb_t _replayFb;
+    struct timeval _replayTimestamp;
+    uint32_t _loadedSeq;
+    uint32_t _loadedOffset;
+    uint32_t _loadedLen;
+    std::atomic<int> _replayState;
+    std::atomic<bool> _replaySent;
+
+    std::atomic<uint32_t> _pendingBytes;
+    std::atomic<uint32_t> _segments;
+    std::atomic<uint32_t> _recorded;
+    std::atomic<uint32_t> _uploaded;
+    std::atomic<uint32_t> _skipped;
+    std::atomic<uint32_t> _evictedSegments;
+    std::atomic<uint32_t> _flashWrites;
+};
+
+#endif
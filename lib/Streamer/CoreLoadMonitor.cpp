@@ -0,0 +1,105 @@
+#include "CoreLoadMonitor.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_freertos_hooks.h"
+
+static const char* TAG = "CoreLoadMonitor";
+
+// An idle loop iteration takes a few microseconds; anything longer was preemption
+#define IDLE_GAP_US 50
+
+std::atomic<uint64_t> CoreLoadMonitor::_idleUs[CoreLoadMonitor::CORES];
+int64_t CoreLoadMonitor::_lastIdleUs[CoreLoadMonitor::CORES];
+
+CoreLoadMonitor::CoreLoadMonitor()
+    : _running(false),
+      _sampleStartUs(0)
+{
+    for (int i = 0; i < CORES; i++) {
+        _sampleIdleUs[i] = 0;
+    }
+}
+
+CoreLoadMonitor::~CoreLoadMonitor() {
+    stop();
+}
+
+bool CoreLoadMonitor::_onIdle(int core) {
+    int64_t now = esp_timer_get_time();
+    int64_t gap = now - _lastIdleUs[core];
+    if (gap < IDLE_GAP_US) {
+        _idleUs[core].fetch_add((uint64_t)gap, std::memory_order_relaxed);
+    }
+    _lastIdleUs[core] = now;
+    // Keep the idle task looping so the next call measures the next gap
+    return false;
+}
+
+bool CoreLoadMonitor::_idleHook0() {
+    return _onIdle(0);
+}
+
+bool CoreLoadMonitor::_idleHook1() {
+    return _onIdle(1);
+}
+
+bool CoreLoadMonitor::start() {
+    if (_running) {
+        return true;
+    }
+
+    for (int i = 0; i < CORES; i++) {
+        _idleUs[i].store(0);
+        _lastIdleUs[i] = esp_timer_get_time();
+        _sampleIdleUs[i] = 0;
+    }
+
+    if (esp_register_freertos_idle_hook_for_cpu(_idleHook0, 0) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register idle hook on core 0");
+        return false;
+    }
+    if (CORES > 1 && esp_register_freertos_idle_hook_for_cpu(_idleHook1, 1) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register idle hook on core 1");
+        esp_deregister_freertos_idle_hook_for_cpu(_idleHook0, 0);
+        return false;
+    }
+
+    _sampleStartUs = esp_timer_get_time();
+    _running = true;
+    ESP_LOGI(TAG, "Core load monitor started (%d cores)", CORES);
+    return true;
+}
+
+void CoreLoadMonitor::stop() {
+    if (!_running) {
+        return;
+    }
+
+    esp_deregister_freertos_idle_hook_for_cpu(_idleHook0, 0);
+    if (CORES > 1) {
+        esp_deregister_freertos_idle_hook_for_cpu(_idleHook1, 1);
+    }
+    _running = false;
+}
+
+void CoreLoadMonitor::sample(uint8_t busyPercent[CORES]) {
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - _sampleStartUs;
+
+    for (int i = 0; i < CORES; i++) {
+        uint64_t idle = _idleUs[i].load(std::memory_order_relaxed);
+        uint64_t idleDelta = idle - _sampleIdleUs[i];
+        _sampleIdleUs[i] = idle;
+
+        if (!_running || elapsed <= 0) {
+            busyPercent[i] = 0;
+            continue;
+        }
+        if (idleDelta > (uint64_t)elapsed) {
+            idleDelta = elapsed;
+        }
+        busyPercent[i] = (uint8_t)(100 - idleDelta * 100 / elapsed);
+    }
+
+    _sampleStartUs = now;
+}
@@ -0,0 +1,38 @@
+#ifndef CORE_LOAD_MONITOR_H
+#define CORE_LOAD_MONITOR_H
+
+#include "Arduino.h"
+#include <atomic>
+
+// Per-core CPU utilisation for benchmarking task layouts. Registers an idle
+// hook on each core that keeps the idle task spinning instead of entering
+// WAITI and accumulates the short gaps between consecutive hook calls as
+// idle time; any longer gap means the core ran something else. Costs power,
+// so it is only enabled with StreamConfig::reportCoreLoad.
+class CoreLoadMonitor {
+public:
+    static const int CORES = portNUM_PROCESSORS;
+
+    CoreLoadMonitor();
+    ~CoreLoadMonitor();
+
+    bool start();
+    void stop();
+
+    // Busy percentage of each core since the previous call
+    void sample(uint8_t busyPercent[CORES]);
+
+private:
+    static bool _idleHook0();
+    static bool _idleHook1();
+    static bool _onIdle(int core);
+
+    static std::atomic<uint64_t> _idleUs[CORES];
+    static int64_t _lastIdleUs[CORES];
+
+    bool _running;
+    int64_t _sampleStartUs;
+    uint64_t _sampleIdleUs[CORES];
+};
+
+#endif
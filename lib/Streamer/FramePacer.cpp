@@ -0,0 +1,159 @@
+#include "FramePacer.h"
+#include "esp_log.h"
+
+static const char* TAG = "FramePacer";
+
+FramePacer::FramePacer()
+    : _timer(nullptr),
+      _mutex(nullptr),
+      _task(nullptr),
+      _fps(0),
+      _fpsMilli(0),
+      _startUs(0),
+      _tick(0),
+      _running(false),
+      _lastDeadlineUs(0),
+      _missedTicks(0)
+{
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+}
+
+FramePacer::~FramePacer() {
+    stop();
+
+    if (_timer) {
+        esp_timer_delete(_timer);
+        _timer = nullptr;
+    }
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+int64_t FramePacer::_deadline(uint64_t tick) const {
+    return _startUs + (int64_t)(tick * 1000000000ULL / _fpsMilli);
+}
+
+bool FramePacer::start(float fps, TaskHandle_t task) {
+    if (fps <= 0 || !task) {
+        return false;
+    }
+
+    if (!_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = FramePacer::_timerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "FramePacer";
+        if (esp_timer_create(&args, &_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create timer");
+            _timer = nullptr;
+            return false;
+        }
+    }
+
+    stop();
+
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _task = task;
+    _fps = fps;
+    _fpsMilli = (uint64_t)(fps * 1000.0f + 0.5f);
+    if (_fpsMilli == 0) {
+        _fpsMilli = 1;
+    }
+    _startUs = esp_timer_get_time();
+    _tick = 1;
+    _lastDeadlineUs.store(_startUs);
+
+    bool ok = esp_timer_start_once(_timer, _deadline(_tick) - _startUs) == ESP_OK;
+    _running.store(ok);
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
+    if (ok) {
+        ESP_LOGI(TAG, "Pacing at %.3f FPS (period %lld us)", fps, _deadline(1) - _startUs);
+    } else {
+        ESP_LOGE(TAG, "Failed to start timer");
+    }
+    return ok;
+}
+
+void FramePacer::stop() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _running.store(false);
+    if (_timer) {
+        esp_timer_stop(_timer);
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool FramePacer::setRate(float fps) {
+    if (fps <= 0) {
+        stop();
+        _fps = 0;
+        return true;
+    }
+    return start(fps, _task ? _task : xTaskGetCurrentTaskHandle());
+}
+
+void FramePacer::_timerCallback(void* arg) {
+    static_cast<FramePacer*>(arg)->_onTimer();
+}
+
+void FramePacer::_onTimer() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    // stop() may have raced with this callback
+    if (_running.load()) {
+        _lastDeadlineUs.store(_deadline(_tick));
+        xTaskNotifyGive(_task);
+
+        int64_t now = esp_timer_get_time();
+        _tick++;
+        int64_t next = _deadline(_tick);
+        while (next <= now) {
+            // Timer task was held up past whole periods: skip them, keep the grid
+            _tick++;
+            _missedTicks++;
+            next = _deadline(_tick);
+        }
+        esp_timer_start_once(_timer, next - now);
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool FramePacer::wait(TickType_t timeout) {
+    uint32_t ticks = ulTaskNotifyTake(pdTRUE, timeout);
+    if (ticks == 0) {
+        return false;
+    }
+
+    if (ticks > 1) {
+        _missedTicks += ticks - 1;
+    }
+
+    int64_t late = esp_timer_get_time() - _lastDeadlineUs.load();
+    _jitter.record(late > 0 ? (uint32_t)late : 0);
+    return true;
+}
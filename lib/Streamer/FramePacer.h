@@ -0,0 +1,56 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+
+// Wakes the capture task on an absolute schedule: tick n is due at
+// start + n / fps, computed from the start time rather than from the
+// previous wake-up, so processing time never stretches the period and
+// fractional rates (e.g. 7.5 FPS) hold exactly over time. An esp_timer
+// one-shot is re-armed for each deadline and delivers a task notification;
+// the capture task blocks in wait() in between instead of polling.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+
+    bool start(float fps, TaskHandle_t task);
+    void stop();
+    // Restarts the schedule at the new rate; fps <= 0 stops pacing
+    bool setRate(float fps);
+
+    bool isRunning() const { return _running.load(); }
+    float getRate() const { return _fps; }
+
+    // Blocks until the next tick. Returns false on timeout.
+    bool wait(TickType_t timeout);
+
+    // Wake-up lateness relative to the scheduled deadline
+    void getJitterSnapshot(LatencySnapshot& out) const { _jitter.snapshot(out); }
+    void resetJitter() { _jitter.reset(); }
+    // Ticks that passed while the capture stage was still busy
+    uint32_t getMissedTicks() const { return _missedTicks.load(); }
+
+private:
+    static void _timerCallback(void* arg);
+    void _onTimer();
+    int64_t _deadline(uint64_t tick) const;
+
+    esp_timer_handle_t _timer;
+    SemaphoreHandle_t _mutex;
+    TaskHandle_t _task;
+    float _fps;
+    uint64_t _fpsMilli;
+    int64_t _startUs;
+    uint64_t _tick;
+
+    std::atomic<bool> _running;
+    std::atomic<int64_t> _lastDeadlineUs;
+    std::atomic<uint32_t> _missedTicks;
+    LatencyHistogram _jitter;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include "esp_camera.h"
+
+// esp_timer microseconds; captureUs comes from fb->timestamp, which the
+// camera driver stamps from the same clock.
+struct FrameTrace {
+    int64_t captureUs;
+    int64_t enqueueUs;
+    int64_t dequeueUs;
+    int64_t writtenUs;
+};
+
+struct FrameSlot {
+    camera_fb_t* fb;
+    char header[256];
+    size_t headerLen;
+    FrameTrace trace;
+};
+
+// Single-producer/single-consumer ring of preallocated frame slots.
+// The producer fills the slot returned by acquire() in place and publishes
+// it with commit(). The consumer claims the oldest slot with pop() by
+// advancing the tail, and swaps it out of the ring for its spare slot, so
+// it sends from a slot the producer can no longer reach; done() makes that
+// slot the spare again. Because the claim is the tail advance, the
+// producer can also evict() the oldest queued frame to make room without
+// waiting for the consumer, however long a send takes. Only the indices
+// and slot pointers cross cores; slot contents are never copied.
+class FrameRing {
+public:
+    FrameRing() : _storage(nullptr), _ring(nullptr), _spare(nullptr), _capacity(0), _mask(0),
+                  _head(0), _tail(0), _pinned(NO_SLOT) {}
+    ~FrameRing() { release(); }
+
+    bool init(size_t capacity) {
+        release();
+
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+
+        // One slot beyond the ring for the frame the consumer is sending
+        _storage = new (std::nothrow) FrameSlot[rounded + 1];
+        _ring = new (std::nothrow) FrameSlot*[rounded];
+        if (!_storage || !_ring) {
+            release();
+            return false;
+        }
+        for (size_t i = 0; i < rounded; i++) {
+            _ring[i] = &_storage[i];
+        }
+        _spare = &_storage[rounded];
+
+        _capacity = rounded;
+        _mask = rounded - 1;
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+        _pinned.store(NO_SLOT, std::memory_order_relaxed);
+        return true;
+    }
+
+    void release() {
+        delete[] _storage;
+        delete[] _ring;
+        _storage = nullptr;
+        _ring = nullptr;
+        _spare = nullptr;
+        _capacity = 0;
+        _mask = 0;
+    }
+
+    // Producer side. Returns nullptr once `limit` frames are queued.
+    FrameSlot* acquire(size_t limit) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load();
+        if (!_ring || head - tail >= limit || head - tail >= _capacity) {
+            return nullptr;
+        }
+        // The consumer claimed this position but has not swapped the slot
+        // out yet; only reachable if evictions wrapped the ring meanwhile
+        if ((head & _mask) == _pinned.load()) {
+            return nullptr;
+        }
+        return _ring[head & _mask];
+    }
+
+    void commit() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Producer side: removes the oldest queued frame and hands it back.
+    // Fails if the ring is empty or the consumer claimed that frame first.
+    bool evict(camera_fb_t*& fb) {
+        uint32_t tail = _tail.load();
+        if (!_ring || _head.load(std::memory_order_relaxed) == tail) {
+            return false;
+        }
+        if (!_tail.compare_exchange_strong(tail, tail + 1)) {
+            return false;
+        }
+        FrameSlot* slot = _ring[tail & _mask];
+        fb = slot->fb;
+        slot->fb = nullptr;
+        return true;
+    }
+
+    // Consumer side: claims the oldest frame, or nullptr when empty. The
+    // slot belongs to the consumer until done(); one claim at a time.
+    FrameSlot* pop() {
+        uint32_t tail = _tail.load();
+        while (true) {
+            if (!_ring || _head.load(std::memory_order_acquire) == tail) {
+                _pinned.store(NO_SLOT);
+                return nullptr;
+            }
+
+            // Pin before claiming so the producer cannot refill the position
+            // between the claim and the swap
+            _pinned.store(tail & _mask);
+            if (_tail.compare_exchange_weak(tail, tail + 1)) {
+                FrameSlot* slot = _ring[tail & _mask];
+                _ring[tail & _mask] = _spare;
+                _spare = nullptr;
+                _pinned.store(NO_SLOT, std::memory_order_release);
+                return slot;
+            }
+        }
+    }
+
+    void done(FrameSlot* slot) {
+        _spare = slot;
+    }
+
+    size_t count() const {
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        return _head.load(std::memory_order_acquire) - tail;
+    }
+
+    size_t capacity() const { return _capacity; }
+
+private:
+    static const uint32_t NO_SLOT = 0xFFFFFFFF;
+
+    FrameSlot* _storage;
+    FrameSlot** _ring;
+    FrameSlot* _spare;      // consumer side only
+    size_t _capacity;
+    uint32_t _mask;
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+    std::atomic<uint32_t> _pinned;
+};
+
+#endif
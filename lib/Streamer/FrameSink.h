@@ -0,0 +1,22 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include "esp_camera.h"
+
+class SharedFrameSource;
+
+// Local consumer of captured frames (pull viewers, recorders, ...).
+// publish() runs on the capture task and must not block: a sink that wants
+// to keep the frame takes a reference with frames->retain() and releases it
+// later with frames->return_frame(); a busy sink simply skips the frame.
+// maxFramesHeld() is the most frames the sink keeps at once; the camera
+// frame buffer pool is sized to cover it on top of the sender queue.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    virtual bool wantsFrames() const = 0;
+    virtual size_t maxFramesHeld() const = 0;
+    virtual void publish(camera_fb_t* fb, SharedFrameSource* frames) = 0;
+};
+
+#endif
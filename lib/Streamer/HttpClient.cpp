@@ -2,8 +2,10 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "esp_heap_caps.h"
 #include <cstring>
 #include <cstdio>
+#include <algorithm>
 
 static const char* TAG = "HttpClient";
 
@@ -11,10 +13,15 @@ HttpClient::HttpClient(const StreamConfig& config)
     : _config(config),
       _client(nullptr),
       _mutex(nullptr),
+      _txStage(nullptr),
+      _txStageSize(0),
       _isConnected(false),
-      _bytesSent(0)
+      _bytesSent(0),
+      _contentLength(0),
+      _chunked(false)
 {
     memset(_lastError, 0, sizeof(_lastError));
+    memset(_url, 0, sizeof(_url));
     snprintf(_contentType, sizeof(_contentType), "%s; boundary=%s",
              _config.contentType, _config.boundary);
 
@@ -22,25 +29,44 @@ HttpClient::HttpClient(const StreamConfig& config)
     if (!_mutex) {
         ESP_LOGE(TAG, "Failed to create mutex");
     }
+
+    if (_config.chunkSize > 0) {
+        _txStage = (uint8_t*)heap_caps_malloc(_config.chunkSize, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (_txStage) {
+            _txStageSize = _config.chunkSize;
+        } else {
+            ESP_LOGW(TAG, "Failed to allocate %u byte TX staging buffer, writes will not be coalesced",
+                     _config.chunkSize);
+        }
+    }
 }
 
 HttpClient::~HttpClient() {
     stopMultipartStream();
 
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+    _releaseClientLocked();
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
     if (_mutex) {
         vSemaphoreDelete(_mutex);
         _mutex = nullptr;
     }
+
+    if (_txStage) {
+        heap_caps_free(_txStage);
+        _txStage = nullptr;
+    }
 }
 
-bool HttpClient::startMultipartStream(const char* url, uint64_t maxDataSize) {
+bool HttpClient::_initClientLocked(const char* url) {
     size_t adaptiveBufferSize = _config.bufferSize;
     size_t adaptiveTxBufferSize = _config.txBufferSize;
 
-    if (_mutex) {
-        xSemaphoreTake(_mutex, portMAX_DELAY);
-    }
-
     if (psramFound()) {
         size_t psramSize = ESP.getPsramSize();
         if (psramSize >= 4 * 1024 * 1024) {
@@ -64,25 +90,74 @@ bool HttpClient::startMultipartStream(const char* url, uint64_t maxDataSize) {
     _client = esp_http_client_init(&config);
     if (!_client) {
         snprintf(_lastError, sizeof(_lastError), "Failed to init HTTP client");
+        return false;
+    }
+
+    esp_http_client_set_header(_client, "Content-Type", _contentType);
+    esp_http_client_set_header(_client, "X-Framerate", _config.frameRate);
+    snprintf(_url, sizeof(_url), "%s", url);
+    return true;
+}
+
+void HttpClient::_releaseClientLocked() {
+    if (!_client) {
+        return;
+    }
+
+    esp_err_t err = esp_http_client_cleanup(_client);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "HTTP: Allocated resources released.");
+    } else {
+        ESP_LOGE(TAG, "HTTP: Could not release allocated resources: %s", esp_err_to_name(err));
+    }
+
+    _client = nullptr;
+    _url[0] = '\0';
+}
+
+bool HttpClient::startMultipartStream(const char* url, uint64_t maxDataSize) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    // A kept handle is only reused for the same URL
+    if (_client && strcmp(_url, url) != 0) {
+        _releaseClientLocked();
+    }
 
+    bool reused = _client != nullptr;
+    if (!reused && !_initClientLocked(url)) {
         if (_mutex) {
             xSemaphoreGive(_mutex);
         }
         return false;
     }
 
-    esp_http_client_set_header(_client, "Content-Type", _contentType);
-    esp_http_client_set_header(_client, "X-Framerate", _config.frameRate);
-
-    ESP_LOGI(TAG, "HTTP: Connecting to %s with %llu bytes buffer", url, maxDataSize);
+    // esp_http_client takes the body length as int; -1 selects chunked encoding
+    int openLength = -1;
+    _chunked = _config.uploadMode == UploadMode::CHUNKED;
+    _contentLength = 0;
+    if (!_chunked) {
+        _contentLength = maxDataSize;
+        if (_contentLength > INT32_MAX) {
+            ESP_LOGW(TAG, "HTTP: maxDataSize %llu exceeds the client limit, clamped to %d",
+                     maxDataSize, INT32_MAX);
+            _contentLength = INT32_MAX;
+        }
+        openLength = (int)_contentLength;
+        ESP_LOGI(TAG, "HTTP: Connecting to %s, Content-Length %llu%s", url, _contentLength,
+                 reused ? " (reusing client)" : "");
+    } else {
+        ESP_LOGI(TAG, "HTTP: Connecting to %s, chunked upload%s", url, reused ? " (reusing client)" : "");
+    }
     ESP_LOGI(TAG, "HTTP: Content-Type: %s", _contentType);
-    esp_err_t err = esp_http_client_open(_client, (int)maxDataSize);
+    esp_err_t err = esp_http_client_open(_client, openLength);
 
     if (err != ESP_OK) {
         snprintf(_lastError, sizeof(_lastError), "Failed to open connection: %s", esp_err_to_name(err));
         ESP_LOGE(TAG, "HTTP: Could not connect to server: %s", _lastError);
-        esp_http_client_cleanup(_client);
-        _client = nullptr;
+        // Start from a fresh handle next time in case the failure left it in a bad state
+        _releaseClientLocked();
 
         if (_mutex) {
             xSemaphoreGive(_mutex);
@@ -113,20 +188,63 @@ void HttpClient::stopMultipartStream() {
             ESP_LOGE(TAG, "HTTP: Could not close connection: %s", esp_err_to_name(err));
         }
 
-        err = esp_http_client_cleanup(_client);
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "HTTP: Allocated resources released.");
+        if (!_config.fastReconnect) {
+            _releaseClientLocked();
+        }
+    }
+    _isConnected = false;
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool HttpClient::finishMultipartStream() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _client && _isConnected;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        char closing[80];
+        int closingLen = snprintf(closing, sizeof(closing), "\r\n--%s--\r\n", _config.boundary);
+
+        if (_chunked) {
+            StreamIovec iov = { (const uint8_t*)closing, (size_t)closingLen };
+            static const char LAST_CHUNK[] = "0\r\n\r\n";
+            ok = _writevLocked(&iov, 1) && _writeLocked((const uint8_t*)LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
         } else {
-            ESP_LOGE(TAG, "HTTP: Could not release allocated resources: %s", esp_err_to_name(err));
+            uint64_t remaining = _contentLength > _bytesSent ? _contentLength - _bytesSent : 0;
+
+            size_t n = (size_t)std::min<uint64_t>(remaining, (uint64_t)closingLen);
+            ok = n == 0 || _writeLocked((const uint8_t*)closing, n);
+            remaining -= n;
+
+            // Anything after the close delimiter is epilogue and ignored by the server
+            char pad[256];
+            memset(pad, ' ', sizeof(pad));
+            while (ok && remaining > 0) {
+                n = (size_t)std::min<uint64_t>(remaining, sizeof(pad));
+                ok = _writeLocked((const uint8_t*)pad, n);
+                remaining -= n;
+            }
         }
 
-        _client = nullptr;
+        if (ok) {
+            esp_http_client_fetch_headers(_client);
+            ESP_LOGI(TAG, "HTTP: Stream finished after %llu bytes, server status %d",
+                     _bytesSent, esp_http_client_get_status_code(_client));
+        }
     }
-    _isConnected = false;
 
     if (_mutex) {
         xSemaphoreGive(_mutex);
     }
+
+    stopMultipartStream();
+    return ok;
 }
 
 bool HttpClient::sendMultipartChunk(const uint8_t* header, size_t headerLen,
@@ -185,18 +303,119 @@ bool HttpClient::sendMultipartChunk(const uint8_t* header, size_t headerLen,
     return true;
 }
 
-bool HttpClient::isConnected() const {
+bool HttpClient::_writeLocked(const uint8_t* data, size_t len) {
+    int result = esp_http_client_write(_client, (const char*)data, len);
+    if (result != (int)len) {
+        _isConnected = false;
+        esp_http_client_close(_client);
+        snprintf(_lastError, sizeof(_lastError), "Write incomplete: %d/%u bytes", result, len);
+        ESP_LOGE(TAG, "HTTP: %s", _lastError);
+        return false;
+    }
+    return true;
+}
+
+bool HttpClient::_writevLocked(const StreamIovec* iov, size_t count) {
+    char sizeLine[12];
+    StreamIovec framed[MAX_CHUNK_IOV + 2];
+
+    if (_chunked) {
+        size_t payload = 0;
+        for (size_t i = 0; i < count; i++) {
+            payload += iov[i].len;
+        }
+        // A zero-size chunk would end the request body
+        if (payload == 0) {
+            return true;
+        }
+        if (count > MAX_CHUNK_IOV) {
+            snprintf(_lastError, sizeof(_lastError), "Too many segments for one chunk: %u", count);
+            return false;
+        }
+
+        int sizeLen = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)payload);
+        framed[0] = { (const uint8_t*)sizeLine, (size_t)sizeLen };
+        for (size_t i = 0; i < count; i++) {
+            framed[i + 1] = iov[i];
+        }
+        framed[count + 1] = { (const uint8_t*)"\r\n", 2 };
+        iov = framed;
+        count += 2;
+    }
+
+    size_t staged = 0;
+    bool ok = true;
+
+    // Small segments (chunk size line, part header, trailer, head of the
+    // payload) are packed into the staging buffer so they leave in one TCP
+    // segment; anything that still fills a whole staging buffer is written
+    // straight from the source.
+    for (size_t i = 0; ok && i < count; i++) {
+        const uint8_t* data = iov[i].data;
+        size_t len = iov[i].len;
+
+        while (ok && len > 0) {
+            if (staged == 0 && len >= _txStageSize) {
+                ok = _writeLocked(data, len);
+                break;
+            }
+
+            size_t n = std::min(len, _txStageSize - staged);
+            memcpy(_txStage + staged, data, n);
+            staged += n;
+            data += n;
+            len -= n;
+
+            if (staged == _txStageSize) {
+                ok = _writeLocked(_txStage, staged);
+                staged = 0;
+            }
+        }
+    }
+
+    if (ok && staged > 0) {
+        ok = _writeLocked(_txStage, staged);
+    }
+    return ok;
+}
+
+bool HttpClient::writev(const StreamIovec* iov, size_t count) {
     if (_mutex) {
-        xSemaphoreTake(const_cast<SemaphoreHandle_t>(_mutex), portMAX_DELAY);
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    if (!_client || !_isConnected) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+
+        if (_mutex) {
+            xSemaphoreGive(_mutex);
+        }
+        return false;
     }
 
-    bool connected = _isConnected;
+    long start_time = millis();
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += iov[i].len;
+    }
+
+    bool ok = _writevLocked(iov, count);
+    if (ok) {
+        long duration = millis() - start_time;
+        if (duration > (long)_config.slowChunkThreshold) {
+            ESP_LOGW(TAG, "HTTP: Slow chunk send: %lums for %u bytes", duration, total);
+        }
+        _bytesSent += total;
+    }
 
     if (_mutex) {
-        xSemaphoreGive(const_cast<SemaphoreHandle_t>(_mutex));
+        xSemaphoreGive(_mutex);
     }
+    return ok;
+}
 
-    return connected;
+bool HttpClient::isConnected() const {
+    return _isConnected.load();
 }
 
 uint64_t HttpClient::getBytesSent() const {
@@ -4,6 +4,8 @@
 #include "Arduino.h"
 #include "esp_http_client.h"
 #include "StreamConfig.h"
+#include "StreamTransport.h"
+#include <atomic>
 
 class HttpClient {
 public:
@@ -11,12 +13,20 @@ public:
     ~HttpClient();
     
     bool startMultipartStream(const char* url, uint64_t maxDataSize);
+    // Closes the connection. With StreamConfig::fastReconnect the client
+    // handle and its buffers are kept, so the next start only reopens the socket.
     void stopMultipartStream();
+    // Writes the closing boundary, completes the body (pads a fixed-length
+    // body with multipart epilogue, or sends the last chunk) and reads the
+    // response before closing
+    bool finishMultipartStream();
     bool sendMultipartChunk(const uint8_t* header, size_t headerLen, 
                            const uint8_t* data, size_t dataLen);
+    bool writev(const StreamIovec* iov, size_t count);
     
     bool isConnected() const;
     uint64_t getBytesSent() const;
+    uint64_t getContentLength() const { return _contentLength; }
     const char* getLastError() const;
     
     esp_http_client_handle_t getHandle() const {
@@ -34,14 +44,26 @@ public:
     }
     
  private:
+    bool _initClientLocked(const char* url);
+    void _releaseClientLocked();
+    bool _writeLocked(const uint8_t* data, size_t len);
+    bool _writevLocked(const StreamIovec* iov, size_t count);
+
     const StreamConfig& _config;
     esp_http_client_handle_t _client;
     SemaphoreHandle_t _mutex;
     char _partBuf[256];
+    uint8_t* _txStage;
+    size_t _txStageSize;
     char _lastError[256];
     char _contentType[128];
-    bool _isConnected;
+    char _url[256];
+    std::atomic<bool> _isConnected;   // written under _mutex, read without it
     uint64_t _bytesSent;
+    uint64_t _contentLength;    // 0 in chunked mode
+    bool _chunked;
+
+    static const size_t MAX_CHUNK_IOV = 8;
 };
 
 #endif
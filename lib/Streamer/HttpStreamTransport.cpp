@@ -7,7 +7,8 @@
 static const char* TAG = "HttpStreamTransport";
 
 HttpStreamTransport::HttpStreamTransport(const StreamConfig& config)
-    : _config(config)
+    : _config(config),
+      _partHeader(_config.boundary)
 {
     _httpClient = new HttpClient(config);
     memset(_lastError, 0, sizeof(_lastError));
@@ -30,30 +31,29 @@ void HttpStreamTransport::disconnect() {
     _httpClient->stopMultipartStream();
 }
 
+bool HttpStreamTransport::finish() {
+    if (_httpClient->finishMultipartStream()) {
+        return true;
+    }
+    snprintf(_lastError, sizeof(_lastError), "%s", _httpClient->getLastError());
+    return false;
+}
+
 bool HttpStreamTransport::isConnected() const {
     return _httpClient->isConnected();
 }
 
 bool HttpStreamTransport::send(const uint8_t* data, size_t len) {
-    if (!_httpClient->isConnected()) {
-        snprintf(_lastError, sizeof(_lastError), "Client not connected");
-        return false;
-    }
-
-    esp_http_client_handle_t client = _httpClient->getHandle();
-    if (!client) {
-        snprintf(_lastError, sizeof(_lastError), "HTTP client handle is null");
-        return false;
-    }
+    StreamIovec iov = { data, len };
+    return sendv(&iov, 1);
+}
 
-    int result = esp_http_client_write(client, (const char*)data, len);
-    if (result != (int)len) {
+bool HttpStreamTransport::sendv(const StreamIovec* iov, size_t count) {
+    if (!_httpClient->writev(iov, count)) {
+        snprintf(_lastError, sizeof(_lastError), "%s", _httpClient->getLastError());
         _httpClient->stopMultipartStream();
-        snprintf(_lastError, sizeof(_lastError), "Write incomplete: %d/%u bytes", result, len);
-        ESP_LOGE(TAG, "HTTP: %s", _lastError);
         return false;
     }
-
     return true;
 }
 
@@ -61,13 +61,22 @@ uint64_t HttpStreamTransport::getBytesSent() const {
     return _httpClient->getBytesSent();
 }
 
+uint64_t HttpStreamTransport::getByteBudget() const {
+    return _httpClient->getContentLength();
+}
+
 const char* HttpStreamTransport::getLastError() const {
     return _lastError;
 }
 
-void HttpStreamTransport::formatMultipartHeader(camera_fb_t* fb, char* buf, size_t bufSize, size_t* outLen) {
-    const char* PART_HEADER = "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
-    *outLen = snprintf(buf, bufSize, PART_HEADER, _config.boundary, fb->len, fb->timestamp.tv_sec, fb->timestamp.tv_usec);
+size_t HttpStreamTransport::formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) {
+    size_t len = 0;
+    formatMultipartHeader(fb, buf, bufSize, &len);
+    return len;
+}
+
+void HttpStreamTransport::formatMultipartHeader(const camera_fb_t* fb, char* buf, size_t bufSize, size_t* outLen) {
+    *outLen = _partHeader.format(fb, buf, bufSize);
 }
 
 bool HttpStreamTransport::sendFrame(camera_fb_t* fb) {
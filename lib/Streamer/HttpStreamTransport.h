@@ -5,6 +5,7 @@
 #include "StreamTransport.h"
 #include "HttpClient.h"
 #include "StreamConfig.h"
+#include "MultipartHeader.h"
 #include "esp_camera.h"
 
 class HttpStreamTransport : public StreamTransport {
@@ -14,9 +15,13 @@ public:
 
     bool connect(const char* url) override;
     void disconnect() override;
+    bool finish() override;
     bool isConnected() const override;
     bool send(const uint8_t* data, size_t len) override;
+    bool sendv(const StreamIovec* iov, size_t count) override;
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override;
     uint64_t getBytesSent() const override;
+    uint64_t getByteBudget() const override;
     const char* getLastError() const override;
 
     bool sendFrame(camera_fb_t* fb);
@@ -24,11 +29,12 @@ public:
     esp_http_client_handle_t getHttpClient() const override {
         return _httpClient ? _httpClient->getHandle() : nullptr;
     }
-    void formatMultipartHeader(camera_fb_t* fb, char* buf, size_t bufSize, size_t* outLen);
+    void formatMultipartHeader(const camera_fb_t* fb, char* buf, size_t bufSize, size_t* outLen);
 
 private:
     StreamConfig _config;
     HttpClient* _httpClient;
+    MultipartHeader _partHeader;
     char _lastError[256];
 };
 
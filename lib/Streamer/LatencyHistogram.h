@@ -0,0 +1,96 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+struct LatencySnapshot {
+    uint32_t count;
+    uint32_t p50Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+// Fixed-bucket log-scale histogram of microsecond durations: four buckets
+// per power of two (<19% relative error) up to ~67 s. Recording is one
+// count-leading-zeros and one relaxed atomic increment, so it can sit on
+// the frame path; snapshots may be taken from any task.
+class LatencyHistogram {
+public:
+    static const size_t BUCKETS = 100;
+
+    LatencyHistogram() { reset(); }
+
+    void record(uint32_t us) {
+        _buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+
+        uint32_t max = _maxUs.load(std::memory_order_relaxed);
+        while (us > max && !_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    void reset() {
+        for (size_t i = 0; i < BUCKETS; i++) {
+            _buckets[i].store(0, std::memory_order_relaxed);
+        }
+        _maxUs.store(0, std::memory_order_relaxed);
+    }
+
+    void snapshot(LatencySnapshot& out) const {
+        uint32_t counts[BUCKETS];
+        uint32_t total = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            counts[i] = _buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        out.count = total;
+        out.p50Us = _percentile(counts, total, 50);
+        out.p99Us = _percentile(counts, total, 99);
+        out.maxUs = _maxUs.load(std::memory_order_relaxed);
+    }
+
+    uint32_t bucketCount(size_t index) const {
+        return _buckets[index].load(std::memory_order_relaxed);
+    }
+
+    static size_t bucketFor(uint32_t us) {
+        if (us < 4) {
+            return us;
+        }
+        int msb = 31 - __builtin_clz(us);
+        size_t index = (size_t)(msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+        return index < BUCKETS ? index : BUCKETS - 1;
+    }
+
+    static uint32_t bucketLowerBound(size_t index) {
+        if (index < 4) {
+            return (uint32_t)index;
+        }
+        int msb = (int)(index / 4) + 1;
+        return (uint32_t)(4 + index % 4) << (msb - 2);
+    }
+
+private:
+    static uint32_t _percentile(const uint32_t* counts, uint32_t total, uint32_t pct) {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = ((uint64_t)total * pct + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                // Report the bucket's upper edge so percentiles never under-state
+                return i + 1 < BUCKETS ? bucketLowerBound(i + 1) - 1 : bucketLowerBound(i);
+            }
+        }
+        return bucketLowerBound(BUCKETS - 1);
+    }
+
+    std::atomic<uint32_t> _buckets[BUCKETS];
+    std::atomic<uint32_t> _maxUs;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "MultipartHeader.h"
+#include <cstdio>
+#include <cstring>
+
+MultipartHeader::MultipartHeader(const char* boundary)
+    : _boundary(boundary),
+      _templateLen(0),
+      _lengthEnd(0),
+      _secondsEnd(0),
+      _microsEnd(0)
+{
+    int prefix = snprintf(_template, sizeof(_template),
+                          "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length:", boundary);
+    size_t total = (size_t)prefix + LENGTH_WIDTH + strlen("\r\nX-Timestamp:") +
+                   SECONDS_WIDTH + 1 + MICROS_WIDTH + strlen("\r\n\r\n");
+    if (prefix < 0 || total >= sizeof(_template)) {
+        // Boundary too long for the template: format() falls back to snprintf
+        return;
+    }
+
+    char* p = _template + prefix;
+    memset(p, ' ', LENGTH_WIDTH);
+    p += LENGTH_WIDTH;
+    _lengthEnd = p - _template;
+
+    memcpy(p, "\r\nX-Timestamp:", strlen("\r\nX-Timestamp:"));
+    p += strlen("\r\nX-Timestamp:");
+    memset(p, ' ', SECONDS_WIDTH);
+    p += SECONDS_WIDTH;
+    _secondsEnd = p - _template;
+
+    *p++ = '.';
+    memset(p, '0', MICROS_WIDTH);
+    p += MICROS_WIDTH;
+    _microsEnd = p - _template;
+
+    memcpy(p, "\r\n\r\n", 4);
+    p += 4;
+    _templateLen = p - _template;
+}
+
+void MultipartHeader::_writeDigits(char* end, size_t width, uint32_t value, char pad) {
+    char* p = end;
+    char* start = end - width;
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0 && p > start);
+    while (p > start) {
+        *--p = pad;
+    }
+}
+
+size_t MultipartHeader::format(const camera_fb_t* fb, char* buf, size_t bufSize) const {
+    if (_templateLen == 0) {
+        const char* PART_HEADER = "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
+        int len = snprintf(buf, bufSize, PART_HEADER, _boundary, fb->len, fb->timestamp.tv_sec, fb->timestamp.tv_usec);
+        return len < 0 || (size_t)len >= bufSize ? 0 : (size_t)len;
+    }
+
+    if (bufSize < _templateLen) {
+        return 0;
+    }
+
+    memcpy(buf, _template, _templateLen);
+    _writeDigits(buf + _lengthEnd, LENGTH_WIDTH, (uint32_t)fb->len, ' ');
+    _writeDigits(buf + _secondsEnd, SECONDS_WIDTH, (uint32_t)fb->timestamp.tv_sec, ' ');
+    _writeDigits(buf + _microsEnd, MICROS_WIDTH, (uint32_t)fb->timestamp.tv_usec, '0');
+    return _templateLen;
+}
@@ -0,0 +1,36 @@
+#ifndef MULTIPART_HEADER_H
+#define MULTIPART_HEADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_camera.h"
+
+// Renders the header that opens each JPEG part of the
+// multipart/x-mixed-replace body; shared by all HTTP-framed transports.
+//
+// The constant text is rendered once into a template with fixed-width
+// numeric fields; format() copies it and writes only the length and
+// timestamp digits. Numbers are right-aligned and space-padded after the
+// header colon, which HTTP treats as optional whitespace.
+class MultipartHeader {
+public:
+    explicit MultipartHeader(const char* boundary);
+
+    size_t format(const camera_fb_t* fb, char* buf, size_t bufSize) const;
+
+private:
+    static void _writeDigits(char* end, size_t width, uint32_t value, char pad);
+
+    static const size_t LENGTH_WIDTH = 10;      // up to 4294967295
+    static const size_t SECONDS_WIDTH = 10;
+    static const size_t MICROS_WIDTH = 6;
+
+    const char* _boundary;
+    char _template[160];
+    size_t _templateLen;
+    size_t _lengthEnd;
+    size_t _secondsEnd;
+    size_t _microsEnd;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "QualityController.h"
+#include "Streamer.h"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstring>
+
+static const char* TAG = "QualityController";
+
+// 4:3 ladder the controller moves along; other sizes are left alone
+static const framesize_t FRAME_SIZE_LADDER[] = {
+    FRAMESIZE_QQVGA, FRAMESIZE_QVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA,
+    FRAMESIZE_XGA, FRAMESIZE_SXGA, FRAMESIZE_UXGA
+};
+static const size_t FRAME_SIZE_LADDER_LEN = sizeof(FRAME_SIZE_LADDER) / sizeof(FRAME_SIZE_LADDER[0]);
+
+QualityController::QualityController(CameraModule* camera, const StreamConfig& config)
+    : _camera(camera),
+      _config(config)
+{
+    reset();
+}
+
+void QualityController::reset() {
+    _baseQuality = _camera->get_quality();
+    _lastDropped = 0;
+    _dropsSeeded = false;
+    _congestedIntervals = 0;
+    _headroomIntervals = 0;
+
+    _stats.quality = _camera->get_quality();
+    _stats.frameSize = _camera->get_framesize();
+    _stats.qualityChanges = 0;
+    _stats.frameSizeChanges = 0;
+    _stats.lastDecision = "hold";
+}
+
+bool QualityController::_stepFrameSize(int direction) {
+    framesize_t current = _camera->get_framesize();
+
+    size_t index = FRAME_SIZE_LADDER_LEN;
+    for (size_t i = 0; i < FRAME_SIZE_LADDER_LEN; i++) {
+        if (FRAME_SIZE_LADDER[i] == current) {
+            index = i;
+            break;
+        }
+    }
+    if (index == FRAME_SIZE_LADDER_LEN) {
+        return false;
+    }
+
+    if (direction < 0 && index == 0) {
+        return false;
+    }
+    if (direction > 0 && (index + 1 >= FRAME_SIZE_LADDER_LEN ||
+                          FRAME_SIZE_LADDER[index + 1] > _camera->get_max_framesize())) {
+        return false;
+    }
+
+    framesize_t next = FRAME_SIZE_LADDER[direction < 0 ? index - 1 : index + 1];
+    if (!_camera->set_framesize(next)) {
+        return false;
+    }
+
+    _stats.frameSize = next;
+    _stats.frameSizeChanges++;
+    return true;
+}
+
+void QualityController::update(const StreamStats& stats, size_t queueCapacity) {
+    uint32_t targetFPS = _config.adaptiveTargetFPS ? _config.adaptiveTargetFPS : (uint32_t)_config.maxFPS;
+    uint32_t budgetUs = _config.adaptiveLatencyBudgetMs
+                            ? _config.adaptiveLatencyBudgetMs * 1000
+                            : (targetFPS ? 1000000 / targetFPS : 0);
+
+    // framesDropped counts since boot, and a settings change flushes the
+    // queue: the first interval after reset() only sets the baseline
+    uint32_t newDrops = _dropsSeeded ? stats.framesDropped - _lastDropped : 0;
+    _lastDropped = stats.framesDropped;
+    _dropsSeeded = true;
+
+    // A low rate with an idle queue and fast writes is the sensor's limit
+    // (large frame size, long exposure), not the link's
+    bool backpressure = stats.queueCount > 1 || (budgetUs && stats.sendUsPerFrame >= budgetUs / 2);
+    bool congested = newDrops > 0 ||
+                     stats.queueCount > queueCapacity / 2 ||
+                     (budgetUs && stats.sendUsPerFrame > budgetUs) ||
+                     (targetFPS && stats.framesPerSecond * 10 < targetFPS * 9 && backpressure);
+    bool headroom = newDrops == 0 &&
+                    stats.queueCount <= 1 &&
+                    (!budgetUs || stats.sendUsPerFrame < budgetUs / 2);
+
+    int quality = _camera->get_quality();
+    _stats.lastDecision = "hold";
+
+    if (congested) {
+        _headroomIntervals = 0;
+        _congestedIntervals++;
+
+        if (quality < _config.adaptiveWorstQuality) {
+            int next = std::min(quality + _config.adaptiveQualityStep, _config.adaptiveWorstQuality);
+            if (_camera->set_quality(next)) {
+                _stats.qualityChanges++;
+                _stats.lastDecision = "quality_down";
+            }
+        } else if (_congestedIntervals >= _config.adaptiveFrameSizeIntervals && _stepFrameSize(-1)) {
+            // Smaller frames at the base quality instead of large mush
+            _camera->set_quality(_baseQuality);
+            _congestedIntervals = 0;
+            _stats.lastDecision = "framesize_down";
+        }
+    } else if (headroom) {
+        _congestedIntervals = 0;
+        _headroomIntervals++;
+
+        if (_headroomIntervals >= _config.adaptiveUpgradeIntervals && quality > _baseQuality) {
+            int next = std::max(quality - _config.adaptiveQualityStep, _baseQuality);
+            if (_camera->set_quality(next)) {
+                _stats.qualityChanges++;
+                _stats.lastDecision = "quality_up";
+            }
+            _headroomIntervals = 0;
+        } else if (_headroomIntervals >= _config.adaptiveFrameSizeIntervals && _stepFrameSize(1)) {
+            // Enter the larger size a notch below base quality so the byte rate does not jump
+            _camera->set_quality(std::min(_baseQuality + _config.adaptiveQualityStep * 2,
+                                          _config.adaptiveWorstQuality));
+            _headroomIntervals = 0;
+            _stats.lastDecision = "framesize_up";
+        }
+    } else {
+        _congestedIntervals = 0;
+        _headroomIntervals = 0;
+    }
+
+    _stats.quality = _camera->get_quality();
+
+    if (strcmp(_stats.lastDecision, "hold") != 0) {
+        ESP_LOGI(TAG, "%s: quality=%d framesize=%d (fps=%u, send=%uus, queue=%u, drops=%u)",
+                 _stats.lastDecision, _stats.quality, _stats.frameSize,
+                 stats.framesPerSecond, stats.sendUsPerFrame, stats.queueCount, newDrops);
+    }
+}
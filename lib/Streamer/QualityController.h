@@ -0,0 +1,48 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <CameraModule.h>
+#include "StreamConfig.h"
+
+struct StreamStats;
+
+struct QualityControllerStats {
+    int quality;
+    framesize_t frameSize;
+    uint32_t qualityChanges;
+    uint32_t frameSizeChanges;
+    const char* lastDecision;
+};
+
+// Closed-loop JPEG quality / frame size control. Evaluated once per metrics
+// interval: congestion (deep queue, send time over the per-frame budget,
+// new drops, FPS below target while the queue or send time shows
+// backpressure) degrades quality first and frame size second; sustained
+// headroom walks back up. Hold counters provide the hysteresis.
+class QualityController {
+public:
+    QualityController(CameraModule* camera, const StreamConfig& config);
+
+    void update(const StreamStats& stats, size_t queueCapacity);
+    // New baseline; the next update() only takes the cumulative drop count
+    void reset();
+
+    const QualityControllerStats& getStats() const { return _stats; }
+
+private:
+    bool _stepFrameSize(int direction);
+
+    CameraModule* _camera;
+    const StreamConfig& _config;
+    QualityControllerStats _stats;
+
+    int _baseQuality;
+    uint32_t _lastDropped;
+    bool _dropsSeeded;
+    uint32_t _congestedIntervals;
+    uint32_t _headroomIntervals;
+};
+
+#endif
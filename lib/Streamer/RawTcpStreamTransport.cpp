@@ -0,0 +1,436 @@
+#include "RawTcpStreamTransport.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+
+static const char* TAG = "RawTcpStreamTransport";
+
+RawTcpStreamTransport::RawTcpStreamTransport(const StreamConfig& config)
+    : _config(config),
+      _partHeader(_config.boundary),
+      _mutex(nullptr),
+      _sock(-1),
+      _connected(false),
+      _bytesSent(0),
+      _addrValid(false)
+{
+    memset(_host, 0, sizeof(_host));
+    memset(_port, 0, sizeof(_port));
+    memset(_path, 0, sizeof(_path));
+    memset(_lastError, 0, sizeof(_lastError));
+    memset(&_addr, 0, sizeof(_addr));
+    memset(_addrKey, 0, sizeof(_addrKey));
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+}
+
+RawTcpStreamTransport::~RawTcpStreamTransport() {
+    disconnect();
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+bool RawTcpStreamTransport::_parseUrl(const char* url) {
+    if (strncmp(url, "http://", 7) != 0) {
+        snprintf(_lastError, sizeof(_lastError), "Unsupported URL (http:// only): %s", url);
+        return false;
+    }
+
+    const char* host = url + 7;
+    size_t hostLen = strcspn(host, ":/");
+    if (hostLen == 0 || hostLen >= sizeof(_host)) {
+        snprintf(_lastError, sizeof(_lastError), "Invalid host in URL: %s", url);
+        return false;
+    }
+    memcpy(_host, host, hostLen);
+    _host[hostLen] = '\0';
+
+    const char* rest = host + hostLen;
+    if (*rest == ':') {
+        rest++;
+        size_t portLen = strcspn(rest, "/");
+        if (portLen == 0 || portLen >= sizeof(_port)) {
+            snprintf(_lastError, sizeof(_lastError), "Invalid port in URL: %s", url);
+            return false;
+        }
+        memcpy(_port, rest, portLen);
+        _port[portLen] = '\0';
+        rest += portLen;
+    } else {
+        snprintf(_port, sizeof(_port), "80");
+    }
+
+    snprintf(_path, sizeof(_path), "%s", *rest ? rest : "/");
+    return true;
+}
+
+bool RawTcpStreamTransport::_resolve() {
+    char key[sizeof(_addrKey)];
+    snprintf(key, sizeof(key), "%s:%s", _host, _port);
+
+    if (_addrValid && _config.fastReconnect && strcmp(key, _addrKey) == 0) {
+        return true;
+    }
+    _addrValid = false;
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* res = nullptr;
+    int err = getaddrinfo(_host, _port, &hints, &res);
+    if (err != 0 || !res) {
+        snprintf(_lastError, sizeof(_lastError), "DNS lookup failed for %s: %d", _host, err);
+        return false;
+    }
+
+    memcpy(&_addr, res->ai_addr, sizeof(_addr));
+    freeaddrinfo(res);
+
+    snprintf(_addrKey, sizeof(_addrKey), "%s", key);
+    _addrValid = true;
+    return true;
+}
+
+bool RawTcpStreamTransport::_openSocket() {
+    if (!_resolve()) {
+        return false;
+    }
+
+    _sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (_sock < 0) {
+        snprintf(_lastError, sizeof(_lastError), "Failed to create socket: errno %d", errno);
+        return false;
+    }
+
+    if (_config.tcpNoDelay) {
+        int one = 1;
+        setsockopt(_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (_config.tcpSendBufferSize > 0) {
+        int size = (int)_config.tcpSendBufferSize;
+        if (setsockopt(_sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0) {
+            ESP_LOGW(TAG, "SO_SNDBUF %d not supported (errno %d), using lwIP default", size, errno);
+        }
+    }
+
+    struct timeval tv;
+    tv.tv_sec = _config.tcpTimeoutMs / 1000;
+    tv.tv_usec = (_config.tcpTimeoutMs % 1000) * 1000;
+    setsockopt(_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Non-blocking connect so an unreachable server costs tcpTimeoutMs, not the SYN retry budget
+    int flags = fcntl(_sock, F_GETFL, 0);
+    fcntl(_sock, F_SETFL, flags | O_NONBLOCK);
+
+    int result = ::connect(_sock, (struct sockaddr*)&_addr, sizeof(_addr));
+
+    if (result < 0 && errno != EINPROGRESS) {
+        snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s failed: errno %d", _host, _port, errno);
+        return false;
+    }
+
+    if (result < 0) {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(_sock, &wfds);
+
+        result = select(_sock + 1, nullptr, &wfds, nullptr, &tv);
+        if (result <= 0) {
+            snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s timed out", _host, _port);
+            return false;
+        }
+
+        int sockErr = 0;
+        socklen_t len = sizeof(sockErr);
+        getsockopt(_sock, SOL_SOCKET, SO_ERROR, &sockErr, &len);
+        if (sockErr != 0) {
+            snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s failed: errno %d", _host, _port, sockErr);
+            return false;
+        }
+    }
+
+    fcntl(_sock, F_SETFL, flags);
+    return true;
+}
+
+bool RawTcpStreamTransport::_writeRequestHead() {
+    char length[48];
+    if (_config.uploadMode == UploadMode::CHUNKED) {
+        snprintf(length, sizeof(length), "Transfer-Encoding: chunked");
+    } else {
+        snprintf(length, sizeof(length), "Content-Length: %llu", _config.maxDataSize);
+    }
+
+    char head[512];
+    int len = snprintf(head, sizeof(head),
+                       "POST %s HTTP/1.1\r\n"
+                       "Host: %s:%s\r\n"
+                       "User-Agent: wheelbot-cam\r\n"
+                       "Content-Type: %s; boundary=%s\r\n"
+                       "X-Framerate: %s\r\n"
+                       "%s\r\n"
+                       "\r\n",
+                       _path, _host, _port, _config.contentType, _config.boundary,
+                       _config.frameRate, length);
+    if (len < 0 || len >= (int)sizeof(head)) {
+        snprintf(_lastError, sizeof(_lastError), "Request head too large");
+        return false;
+    }
+
+    StreamIovec iov = { (const uint8_t*)head, (size_t)len };
+    return _sendAll(&iov, 1);
+}
+
+bool RawTcpStreamTransport::connect(const char* url) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _closeLocked();
+
+    bool ok = _parseUrl(url) && _openSocket() && _writeRequestHead();
+    if (ok) {
+        _bytesSent = 0;
+        _connected = true;
+        ESP_LOGI(TAG, "TCP: Streaming to %s:%s%s (nodelay=%d, sndbuf=%u)",
+                 _host, _port, _path, _config.tcpNoDelay, _config.tcpSendBufferSize);
+    } else {
+        ESP_LOGE(TAG, "TCP: %s", _lastError);
+        _closeLocked();
+        // The server may have moved; look it up again on the next attempt
+        _addrValid = false;
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+void RawTcpStreamTransport::_closeLocked() {
+    _connected = false;
+    if (_sock >= 0) {
+        shutdown(_sock, SHUT_RDWR);
+        close(_sock);
+        _sock = -1;
+        ESP_LOGI(TAG, "TCP: Connection closed.");
+    }
+}
+
+void RawTcpStreamTransport::disconnect() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _closeLocked();
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool RawTcpStreamTransport::finish() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _connected && _sock >= 0;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        char closing[80];
+        int closingLen = snprintf(closing, sizeof(closing), "\r\n--%s--\r\n", _config.boundary);
+
+        if (_config.uploadMode == UploadMode::CHUNKED) {
+            StreamIovec iov = { (const uint8_t*)closing, (size_t)closingLen };
+            StreamIovec last = { (const uint8_t*)"0\r\n\r\n", 5 };
+            ok = _sendChunk(&iov, 1);
+            // The last chunk is framing; keep _bytesSent at the body size
+            uint64_t body = _bytesSent;
+            ok = ok && _sendAll(&last, 1);
+            _bytesSent = body;
+        } else {
+            uint64_t remaining = _config.maxDataSize > _bytesSent ? _config.maxDataSize - _bytesSent : 0;
+
+            StreamIovec iov = { (const uint8_t*)closing, (size_t)std::min<uint64_t>(remaining, (uint64_t)closingLen) };
+            ok = _sendAll(&iov, 1);
+            remaining -= iov.len;
+
+            // Anything after the close delimiter is epilogue and ignored by the server
+            char pad[256];
+            memset(pad, ' ', sizeof(pad));
+            while (ok && remaining > 0) {
+                iov = { (const uint8_t*)pad, (size_t)std::min<uint64_t>(remaining, sizeof(pad)) };
+                ok = _sendAll(&iov, 1);
+                remaining -= iov.len;
+            }
+        }
+
+        if (ok) {
+            struct timeval tv;
+            tv.tv_sec = _config.tcpTimeoutMs / 1000;
+            tv.tv_usec = (_config.tcpTimeoutMs % 1000) * 1000;
+            setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+            char response[64] = {};
+            int status = 0;
+            if (recv(_sock, response, sizeof(response) - 1, 0) > 0) {
+                sscanf(response, "HTTP/%*s %d", &status);
+            }
+            ESP_LOGI(TAG, "TCP: Stream finished after %llu bytes, server status %d",
+                     _bytesSent, status);
+        } else {
+            ESP_LOGE(TAG, "TCP: %s", _lastError);
+        }
+    }
+
+    _closeLocked();
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+bool RawTcpStreamTransport::isConnected() const {
+    return _connected.load();
+}
+
+bool RawTcpStreamTransport::_sendAll(const StreamIovec* iov, size_t count) {
+    struct iovec vec[MAX_IOV];
+
+    for (size_t base = 0; base < count; base += MAX_IOV) {
+        // MSG_MORE holds back PSH, so it must not go with the write that ends the frame
+        int flags = _config.tcpMsgMore && base + MAX_IOV < count ? MSG_MORE : 0;
+        size_t n = 0;
+        for (size_t i = base; i < count && i < base + MAX_IOV; i++) {
+            if (iov[i].len > 0) {
+                vec[n].iov_base = (void*)iov[i].data;
+                vec[n].iov_len = iov[i].len;
+                n++;
+            }
+        }
+
+        size_t first = 0;
+        while (first < n) {
+            struct msghdr msg = {};
+            msg.msg_iov = &vec[first];
+            msg.msg_iovlen = n - first;
+
+            ssize_t written = sendmsg(_sock, &msg, flags);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                snprintf(_lastError, sizeof(_lastError), "Send failed: errno %d", errno);
+                return false;
+            }
+
+            _bytesSent += written;
+
+            size_t remaining = (size_t)written;
+            while (first < n && remaining >= vec[first].iov_len) {
+                remaining -= vec[first].iov_len;
+                first++;
+            }
+            if (first < n) {
+                vec[first].iov_base = (uint8_t*)vec[first].iov_base + remaining;
+                vec[first].iov_len -= remaining;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool RawTcpStreamTransport::_sendChunk(const StreamIovec* iov, size_t count) {
+    size_t payload = 0;
+    for (size_t i = 0; i < count; i++) {
+        payload += iov[i].len;
+    }
+    // A zero-size chunk would end the request body
+    if (payload == 0) {
+        return true;
+    }
+    if (count + 2 > MAX_IOV) {
+        snprintf(_lastError, sizeof(_lastError), "Too many segments for one chunk: %u", count);
+        return false;
+    }
+
+    char sizeLine[12];
+    int sizeLen = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)payload);
+
+    StreamIovec framed[MAX_IOV];
+    framed[0] = { (const uint8_t*)sizeLine, (size_t)sizeLen };
+    for (size_t i = 0; i < count; i++) {
+        framed[i + 1] = iov[i];
+    }
+    framed[count + 1] = { (const uint8_t*)"\r\n", 2 };
+
+    uint64_t before = _bytesSent;
+    bool ok = _sendAll(framed, count + 2);
+    // Count payload only, like the fixed-length mode
+    _bytesSent = before + (ok ? payload : 0);
+    return ok;
+}
+
+bool RawTcpStreamTransport::send(const uint8_t* data, size_t len) {
+    StreamIovec iov = { data, len };
+    return sendv(&iov, 1);
+}
+
+bool RawTcpStreamTransport::sendv(const StreamIovec* iov, size_t count) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _connected && _sock >= 0;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        long start_time = millis();
+        ok = _config.uploadMode == UploadMode::CHUNKED ? _sendChunk(iov, count) : _sendAll(iov, count);
+        if (ok) {
+            long duration = millis() - start_time;
+            if (duration > (long)_config.slowChunkThreshold) {
+                ESP_LOGW(TAG, "TCP: Slow chunk send: %lums", duration);
+            }
+        } else {
+            ESP_LOGE(TAG, "TCP: %s", _lastError);
+            _closeLocked();
+        }
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+size_t RawTcpStreamTransport::formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) {
+    return _partHeader.format(fb, buf, bufSize);
+}
+
+uint64_t RawTcpStreamTransport::getBytesSent() const {
+    return _bytesSent;
+}
+
+uint64_t RawTcpStreamTransport::getByteBudget() const {
+    return _config.uploadMode == UploadMode::CHUNKED ? 0 : _config.maxDataSize;
+}
+
+const char* RawTcpStreamTransport::getLastError() const {
+    return _lastError;
+}
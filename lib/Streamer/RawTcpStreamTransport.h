@@ -0,0 +1,64 @@
+#ifndef RAW_TCP_STREAM_TRANSPORT_H
+#define RAW_TCP_STREAM_TRANSPORT_H
+
+#include "Arduino.h"
+#include "StreamTransport.h"
+#include "StreamConfig.h"
+#include "MultipartHeader.h"
+#include "esp_camera.h"
+#include "lwip/sockets.h"
+#include <atomic>
+
+// Streams the same multipart POST as HttpStreamTransport, but writes the
+// request itself on a plain lwIP socket: no esp_http_client buffers, one
+// sendmsg() per frame and direct control over TCP socket options.
+class RawTcpStreamTransport : public StreamTransport {
+public:
+    RawTcpStreamTransport(const StreamConfig& config);
+    ~RawTcpStreamTransport();
+
+    bool connect(const char* url) override;
+    void disconnect() override;
+    bool finish() override;
+    bool isConnected() const override;
+    bool send(const uint8_t* data, size_t len) override;
+    bool sendv(const StreamIovec* iov, size_t count) override;
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override;
+    uint64_t getBytesSent() const override;
+    uint64_t getByteBudget() const override;
+    const char* getLastError() const override;
+
+    esp_http_client_handle_t getHttpClient() const override { return nullptr; }
+
+private:
+    bool _parseUrl(const char* url);
+    bool _resolve();
+    bool _openSocket();
+    bool _writeRequestHead();
+    bool _sendAll(const StreamIovec* iov, size_t count);
+    bool _sendChunk(const StreamIovec* iov, size_t count);
+    void _closeLocked();
+
+    StreamConfig _config;
+    MultipartHeader _partHeader;
+    SemaphoreHandle_t _mutex;
+
+    int _sock;
+    std::atomic<bool> _connected;
+    uint64_t _bytesSent;
+
+    char _host[64];
+    char _port[6];
+    char _path[128];
+    char _lastError[256];
+
+    // Server address from the last successful connect, reused by reconnects
+    // (StreamConfig::fastReconnect) so they skip the DNS lookup
+    struct sockaddr_in _addr;
+    bool _addrValid;
+    char _addrKey[72];
+
+    static const size_t MAX_IOV = 8;
+};
+
+#endif
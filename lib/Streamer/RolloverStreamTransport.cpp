@@ -0,0 +1,372 @@
+#include "RolloverStreamTransport.h"
+#include "esp_log.h"
+#include <cstring>
+#include <cstdio>
+
+static const char* TAG = "RolloverStreamTransport";
+
+#define WORKER_TASK_STACK 6144
+#define WORKER_TASK_PRIORITY 3
+#define STANDBY_RETRY_DELAY_MS 500
+// Longest a standby connect or the old request's response can keep the worker busy
+#define WORKER_STOP_TIMEOUT_MS 10000
+
+RolloverStreamTransport::RolloverStreamTransport(const StreamConfig& config, Factory factory)
+    : _config(config),
+      _factory(factory),
+      _mutex(nullptr),
+      _workerTask(nullptr),
+      _active(nullptr),
+      _standby(nullptr),
+      _retiring(nullptr),
+      _connected(false),
+      _stopping(false),
+      _workerStopped(false),
+      _standbyRequested(false),
+      _standbyReady(false),
+      _generation(0),
+      _rollovers(0),
+      _bytesRetired(0)
+{
+    memset(_url, 0, sizeof(_url));
+    memset(_lastError, 0, sizeof(_lastError));
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+
+    _active = _factory(_config);
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        RolloverStreamTransport::workerTaskWrapper,
+        "Rollover",
+        WORKER_TASK_STACK,
+        this,
+        WORKER_TASK_PRIORITY,
+        &_workerTask,
+        _config.taskCore < 0 ? tskNO_AFFINITY : _config.taskCore
+    );
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create rollover task, streams will reconnect at the byte limit");
+        _workerTask = nullptr;
+    }
+}
+
+RolloverStreamTransport::~RolloverStreamTransport() {
+    if (_workerTask) {
+        // Deleting the worker mid-connect or mid-finish would leak that
+        // request and its socket, or leave _mutex taken: let it park first
+        _stopping = true;
+        xTaskNotifyGive(_workerTask);
+
+        uint32_t waited = 0;
+        while (!_workerStopped && waited < WORKER_STOP_TIMEOUT_MS) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            waited += 10;
+        }
+        if (!_workerStopped) {
+            ESP_LOGW(TAG, "Rollover task did not stop in %ums, deleting it", WORKER_STOP_TIMEOUT_MS);
+        }
+        vTaskDelete(_workerTask);
+        _workerTask = nullptr;
+    }
+
+    disconnect();
+
+    delete _retiring;
+    delete _active;
+    _retiring = nullptr;
+    _active = nullptr;
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+bool RolloverStreamTransport::connect(const char* url) {
+    snprintf(_url, sizeof(_url), "%s", url);
+
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _generation++;
+    _dropStandbyLocked();
+    StreamTransport* active = _active;
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
+    if (active->connect(url)) {
+        _connected = true;
+        return true;
+    }
+    _connected = false;
+    snprintf(_lastError, sizeof(_lastError), "%s", active->getLastError());
+    return false;
+}
+
+void RolloverStreamTransport::disconnect() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _generation++;
+    _dropStandbyLocked();
+    _connected = false;
+    if (_active) {
+        _active->disconnect();
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool RolloverStreamTransport::finish() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _generation++;
+    _dropStandbyLocked();
+    StreamTransport* active = _active;
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
+    _connected = false;
+    return active ? active->finish() : true;
+}
+
+void RolloverStreamTransport::_dropStandbyLocked() {
+    if (_standby) {
+        _standby->disconnect();
+        delete _standby;
+        _standby = nullptr;
+    }
+    _standbyReady = false;
+    _standbyRequested = false;
+}
+
+bool RolloverStreamTransport::isConnected() const {
+    return _connected.load();
+}
+
+void RolloverStreamTransport::_requestStandby() {
+    if (_workerTask && !_standbyRequested.exchange(true)) {
+        ESP_LOGI(TAG, "Byte budget nearly spent, opening standby request");
+        xTaskNotifyGive(_workerTask);
+    }
+}
+
+bool RolloverStreamTransport::_switchToStandby() {
+    if (!_standbyReady) {
+        _requestStandby();
+
+        // The standby should have connected long before the budget ran out;
+        // if it is late, wait for it here rather than tearing the stream down.
+        uint32_t waited = 0;
+        while (!_standbyReady && _standbyRequested && waited < _config.rolloverWaitMs) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            waited += 10;
+        }
+        if (!_standbyReady) {
+            return false;
+        }
+    }
+
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    if (_retiring) {
+        // Previous request is still waiting for the worker: drop it rather than queue two
+        _retiring->disconnect();
+        delete _retiring;
+    }
+
+    _retiring = _active;
+    _active = _standby;
+    _standby = nullptr;
+    _bytesRetired += _retiring->getBytesSent();
+    _standbyReady = false;
+    _standbyRequested = false;
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
+    _rollovers++;
+    ESP_LOGI(TAG, "Rolled over to standby request (#%u)", _rollovers.load());
+
+    xTaskNotifyGive(_workerTask);
+    return true;
+}
+
+bool RolloverStreamTransport::send(const uint8_t* data, size_t len) {
+    StreamIovec iov = { data, len };
+    return sendv(&iov, 1);
+}
+
+bool RolloverStreamTransport::sendv(const StreamIovec* iov, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len += iov[i].len;
+    }
+
+    // Only the send task swaps _active, so it can be used without the lock
+    StreamTransport* active = _active;
+    uint64_t declared = active->getByteBudget();
+    if (declared == 0) {
+        // Chunked request: nothing to roll over
+        if (!active->sendv(iov, count)) {
+            snprintf(_lastError, sizeof(_lastError), "%s", active->getLastError());
+            _connected = active->isConnected();
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t budget = declared > CLOSE_RESERVE ? declared - CLOSE_RESERVE : 0;
+    uint64_t sent = active->getBytesSent();
+
+    if (sent + len > budget && sent > 0) {
+        if (!_switchToStandby()) {
+            snprintf(_lastError, sizeof(_lastError), "Byte budget spent and no standby request available");
+            ESP_LOGE(TAG, "%s", _lastError);
+            active->finish();
+            _connected = false;
+            return false;
+        }
+        active = _active;
+    } else if (budget - sent < _config.rolloverMarginBytes) {
+        _requestStandby();
+    }
+
+    if (!active->sendv(iov, count)) {
+        snprintf(_lastError, sizeof(_lastError), "%s", active->getLastError());
+        _connected = active->isConnected();
+        return false;
+    }
+    return true;
+}
+
+size_t RolloverStreamTransport::formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    size_t len = _active->formatFrameHeader(fb, buf, bufSize);
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return len;
+}
+
+uint64_t RolloverStreamTransport::getBytesSent() const {
+    if (_mutex) {
+        xSemaphoreTake(const_cast<SemaphoreHandle_t>(_mutex), portMAX_DELAY);
+    }
+
+    uint64_t bytes = _bytesRetired + _active->getBytesSent();
+
+    if (_mutex) {
+        xSemaphoreGive(const_cast<SemaphoreHandle_t>(_mutex));
+    }
+    return bytes;
+}
+
+const char* RolloverStreamTransport::getLastError() const {
+    return _lastError;
+}
+
+esp_http_client_handle_t RolloverStreamTransport::getHttpClient() const {
+    if (_mutex) {
+        xSemaphoreTake(const_cast<SemaphoreHandle_t>(_mutex), portMAX_DELAY);
+    }
+
+    esp_http_client_handle_t client = _active ? _active->getHttpClient() : nullptr;
+
+    if (_mutex) {
+        xSemaphoreGive(const_cast<SemaphoreHandle_t>(_mutex));
+    }
+    return client;
+}
+
+void RolloverStreamTransport::workerTaskWrapper(void* parameter) {
+    static_cast<RolloverStreamTransport*>(parameter)->workerTask();
+}
+
+void RolloverStreamTransport::workerTask() {
+    while (!_stopping) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (_stopping) {
+            break;
+        }
+
+        if (_mutex) {
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+        }
+        StreamTransport* retiring = _retiring;
+        _retiring = nullptr;
+        if (_mutex) {
+            xSemaphoreGive(_mutex);
+        }
+
+        if (retiring) {
+            long start = millis();
+            if (!retiring->finish()) {
+                ESP_LOGW(TAG, "Old request did not finish cleanly: %s", retiring->getLastError());
+            }
+            ESP_LOGI(TAG, "Old request closed in %ldms", millis() - start);
+            delete retiring;
+        }
+
+        if (!_standbyRequested || _standbyReady) {
+            continue;
+        }
+
+        uint32_t generation = _generation.load();
+        StreamTransport* standby = _factory(_config);
+        bool ok = standby->connect(_url);
+
+        if (_mutex) {
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+        }
+
+        // A reconnect or disconnect in the meantime makes this standby obsolete
+        if (ok && generation == _generation.load() && !_standby) {
+            _standby = standby;
+            standby = nullptr;
+            _standbyReady = true;
+        }
+
+        if (_mutex) {
+            xSemaphoreGive(_mutex);
+        }
+
+        if (standby) {
+            if (ok) {
+                standby->disconnect();
+            } else {
+                ESP_LOGW(TAG, "Standby connect failed: %s", standby->getLastError());
+                vTaskDelay(pdMS_TO_TICKS(STANDBY_RETRY_DELAY_MS));
+                // Let the next frame ask again
+                _standbyRequested = false;
+            }
+            delete standby;
+        } else {
+            ESP_LOGI(TAG, "Standby request ready");
+        }
+    }
+
+    // The destructor deletes the task; a FreeRTOS task must never return.
+    _workerStopped = true;
+    vTaskSuspend(nullptr);
+}
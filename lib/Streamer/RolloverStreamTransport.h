@@ -0,0 +1,73 @@
+#ifndef ROLLOVER_STREAM_TRANSPORT_H
+#define ROLLOVER_STREAM_TRANSPORT_H
+
+#include "Arduino.h"
+#include "StreamTransport.h"
+#include "StreamConfig.h"
+#include "esp_camera.h"
+#include <atomic>
+
+// Make-before-break wrapper around a request-bounded transport. Each POST
+// declares maxDataSize bytes; when less than rolloverMarginBytes is left, a
+// background task opens a second request. The sender switches to it on the
+// frame boundary that would overrun the budget, and the background task
+// finishes the old request (closing boundary, padding, response) so the
+// capture and send path never waits for a reconnect.
+class RolloverStreamTransport : public StreamTransport {
+public:
+    typedef StreamTransport* (*Factory)(const StreamConfig& config);
+
+    RolloverStreamTransport(const StreamConfig& config, Factory factory);
+    ~RolloverStreamTransport();
+
+    bool connect(const char* url) override;
+    void disconnect() override;
+    bool isConnected() const override;
+    bool finish() override;
+    bool send(const uint8_t* data, size_t len) override;
+    bool sendv(const StreamIovec* iov, size_t count) override;
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override;
+    uint64_t getBytesSent() const override;
+    const char* getLastError() const override;
+    esp_http_client_handle_t getHttpClient() const override;
+
+    uint32_t getRolloverCount() const { return _rollovers.load(); }
+
+private:
+    static void workerTaskWrapper(void* parameter);
+    void workerTask();
+
+    bool _switchToStandby();
+    void _requestStandby();
+    void _dropStandbyLocked();
+
+    StreamConfig _config;
+    Factory _factory;
+    SemaphoreHandle_t _mutex;
+    TaskHandle_t _workerTask;
+
+    StreamTransport* _active;
+    StreamTransport* _standby;
+    StreamTransport* _retiring;
+
+    // Mirrors the active request, which the worker may delete after a
+    // switch, so isConnected() never has to look at it
+    std::atomic<bool> _connected;
+    // The destructor sets _stopping; the worker sets _workerStopped once it
+    // is parked outside the lock with no request in hand
+    std::atomic<bool> _stopping;
+    std::atomic<bool> _workerStopped;
+    std::atomic<bool> _standbyRequested;
+    std::atomic<bool> _standbyReady;
+    std::atomic<uint32_t> _generation;
+    std::atomic<uint32_t> _rollovers;
+    uint64_t _bytesRetired;
+
+    char _url[256];
+    char _lastError[256];
+
+    // Room kept for the closing boundary at the end of each request
+    static const uint64_t CLOSE_RESERVE = 128;
+};
+
+#endif
@@ -0,0 +1,407 @@
+#include "RtpJpegStreamTransport.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <algorithm>
+
+static const char* TAG = "RtpJpegStreamTransport";
+
+// lwIP runs out of pbufs rather than blocking a UDP send; give it a few ticks
+#define SEND_RETRIES 3
+
+RtpJpegStreamTransport::RtpJpegStreamTransport(const StreamConfig& config)
+    : _config(config),
+      _mutex(nullptr),
+      _sock(-1),
+      _connected(false),
+      _bytesSent(0),
+      _framesDropped(0),
+      _sequence(0),
+      _ssrc(0)
+{
+    memset(_lastError, 0, sizeof(_lastError));
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+
+    _ssrc = esp_random();
+    _sequence = (uint16_t)esp_random();
+}
+
+RtpJpegStreamTransport::~RtpJpegStreamTransport() {
+    disconnect();
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+bool RtpJpegStreamTransport::connect(const char* url) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    if (_sock >= 0) {
+        close(_sock);
+        _sock = -1;
+    }
+    _connected = false;
+
+    // Only the host of the stream URL is used; RTP goes to rtpPort
+    char host[64] = {};
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    size_t hostLen = strcspn(start, ":/");
+    bool ok = hostLen > 0 && hostLen < sizeof(host);
+
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Invalid host in URL: %s", url);
+    } else {
+        memcpy(host, start, hostLen);
+
+        char port[6];
+        snprintf(port, sizeof(port), "%u", _config.rtpPort);
+
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        struct addrinfo* res = nullptr;
+        int err = getaddrinfo(host, port, &hints, &res);
+        if (err != 0 || !res) {
+            snprintf(_lastError, sizeof(_lastError), "DNS lookup failed for %s: %d", host, err);
+            ok = false;
+        } else {
+            _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            // A connected UDP socket fixes the destination for plain send()
+            ok = _sock >= 0 && ::connect(_sock, res->ai_addr, res->ai_addrlen) == 0;
+            if (!ok) {
+                snprintf(_lastError, sizeof(_lastError), "Failed to open UDP socket to %s:%s: errno %d",
+                         host, port, errno);
+            }
+            freeaddrinfo(res);
+        }
+
+        if (ok) {
+            _bytesSent = 0;
+            _connected = true;
+            ESP_LOGI(TAG, "RTP: Streaming JPEG to %s:%s (mtu=%u, ssrc=%08x)",
+                     host, port, _config.rtpMtu, _ssrc);
+        } else if (_sock >= 0) {
+            close(_sock);
+            _sock = -1;
+        }
+    }
+
+    if (!ok) {
+        ESP_LOGE(TAG, "RTP: %s", _lastError);
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+void RtpJpegStreamTransport::disconnect() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _connected = false;
+    if (_sock >= 0) {
+        close(_sock);
+        _sock = -1;
+        ESP_LOGI(TAG, "RTP: Socket closed.");
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool RtpJpegStreamTransport::isConnected() const {
+    return _connected.load();
+}
+
+size_t RtpJpegStreamTransport::formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) {
+    if (bufSize < 4) {
+        return 0;
+    }
+
+    int64_t us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    if (us <= 0) {
+        us = esp_timer_get_time();
+    }
+    // 90 kHz media clock
+    uint32_t timestamp = (uint32_t)(us * 9 / 100);
+    memcpy(buf, &timestamp, sizeof(timestamp));
+    return sizeof(timestamp);
+}
+
+bool RtpJpegStreamTransport::send(const uint8_t* data, size_t len) {
+    StreamIovec iov = { data, len };
+    return sendv(&iov, 1);
+}
+
+bool RtpJpegStreamTransport::sendv(const StreamIovec* iov, size_t count) {
+    uint32_t timestamp = (uint32_t)(esp_timer_get_time() * 9 / 100);
+    if (count == 2 && iov[0].len == sizeof(timestamp)) {
+        memcpy(&timestamp, iov[0].data, sizeof(timestamp));
+        iov++;
+        count--;
+    }
+
+    if (count != 1) {
+        snprintf(_lastError, sizeof(_lastError), "Expected one JPEG segment, got %u", count);
+        return false;
+    }
+
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _connected && _sock >= 0;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        ok = _sendFrame(iov[0].data, iov[0].len, timestamp);
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+bool RtpJpegStreamTransport::_parseJpeg(const uint8_t* data, size_t len, JpegInfo& info) {
+    memset(&info, 0, sizeof(info));
+
+    if (len < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        snprintf(_lastError, sizeof(_lastError), "Not a JPEG frame");
+        return false;
+    }
+
+    bool haveFrame = false;
+    size_t pos = 2;
+    while (pos + 4 <= len) {
+        if (data[pos] != 0xFF) {
+            snprintf(_lastError, sizeof(_lastError), "Bad JPEG marker at %u", pos);
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        size_t segLen = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        if (segLen < 2 || pos + 2 + segLen > len) {
+            snprintf(_lastError, sizeof(_lastError), "Truncated JPEG segment %02x", marker);
+            return false;
+        }
+        const uint8_t* seg = data + pos + 4;
+        size_t bodyLen = segLen - 2;
+
+        if (marker == 0xDB) {
+            // DQT: one or more tables, 8-bit precision only
+            for (size_t i = 0; i + 1 + QTABLE_LEN <= bodyLen; i += 1 + QTABLE_LEN) {
+                if (seg[i] >> 4) {
+                    snprintf(_lastError, sizeof(_lastError), "16-bit quantization tables not supported");
+                    return false;
+                }
+                uint8_t id = seg[i] & 0x0F;
+                if (id < 2) {
+                    info.qtables[id] = seg + i + 1;
+                }
+            }
+        } else if (marker == 0xC0) {
+            // SOF0: baseline, 3 components; the luma sampling factor picks the RTP type
+            if (bodyLen < 15 || seg[5] != 3) {
+                snprintf(_lastError, sizeof(_lastError), "Unsupported JPEG frame header");
+                return false;
+            }
+            uint16_t height = ((uint16_t)seg[1] << 8) | seg[2];
+            uint16_t width = ((uint16_t)seg[3] << 8) | seg[4];
+            if ((width & 7) || (height & 7) || width > 2040 || height > 2040) {
+                snprintf(_lastError, sizeof(_lastError), "Frame %ux%u not representable in RTP/JPEG", width, height);
+                return false;
+            }
+            uint8_t sampling = seg[7];
+            if (sampling == 0x21) {
+                info.type = 0;
+            } else if (sampling == 0x22) {
+                info.type = 1;
+            } else {
+                snprintf(_lastError, sizeof(_lastError), "Unsupported chroma sampling %02x", sampling);
+                return false;
+            }
+            info.width8 = width / 8;
+            info.height8 = height / 8;
+            haveFrame = true;
+        } else if (marker >= 0xC1 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            snprintf(_lastError, sizeof(_lastError), "Only baseline JPEG is supported");
+            return false;
+        } else if (marker == 0xDD && bodyLen >= 2) {
+            info.restartInterval = ((uint16_t)seg[0] << 8) | seg[1];
+        } else if (marker == 0xDA) {
+            if (!haveFrame || !info.qtables[0] || !info.qtables[1]) {
+                snprintf(_lastError, sizeof(_lastError), "JPEG without frame header or quantization tables");
+                return false;
+            }
+
+            // Entropy-coded data runs to EOI; anything after it is padding
+            size_t begin = pos + 2 + segLen;
+            size_t end = len;
+            while (end >= begin + 2 && !(data[end - 2] == 0xFF && data[end - 1] == 0xD9)) {
+                end--;
+            }
+            if (end >= begin + 2) {
+                end -= 2;
+            } else {
+                end = len;
+            }
+
+            info.scan = data + begin;
+            info.scanLen = end - begin;
+            if (info.restartInterval) {
+                info.type |= 64;
+            }
+            return info.scanLen > 0;
+        }
+
+        pos += 2 + segLen;
+    }
+
+    snprintf(_lastError, sizeof(_lastError), "JPEG without scan data");
+    return false;
+}
+
+bool RtpJpegStreamTransport::_sendFrame(const uint8_t* data, size_t len, uint32_t timestamp) {
+    JpegInfo info;
+    if (!_parseJpeg(data, len, info)) {
+        // A frame the sensor got wrong is not a transport failure
+        ESP_LOGW(TAG, "RTP: Skipping frame: %s", _lastError);
+        _framesDropped++;
+        return true;
+    }
+
+    uint8_t head[RTP_HEADER_LEN + JPEG_HEADER_LEN + RESTART_HEADER_LEN + QTABLE_HEADER_LEN + 2 * QTABLE_LEN];
+    size_t offset = 0;
+
+    while (offset < info.scanLen) {
+        size_t p = 0;
+
+        // RTP header; the marker bit and payload type are completed below
+        head[p++] = 0x80;
+        head[p++] = _config.rtpPayloadType & 0x7F;
+        head[p++] = _sequence >> 8;
+        head[p++] = _sequence & 0xFF;
+        head[p++] = timestamp >> 24;
+        head[p++] = (timestamp >> 16) & 0xFF;
+        head[p++] = (timestamp >> 8) & 0xFF;
+        head[p++] = timestamp & 0xFF;
+        head[p++] = _ssrc >> 24;
+        head[p++] = (_ssrc >> 16) & 0xFF;
+        head[p++] = (_ssrc >> 8) & 0xFF;
+        head[p++] = _ssrc & 0xFF;
+
+        // JPEG header: type-specific, 24-bit fragment offset, type, Q, size
+        head[p++] = 0;
+        head[p++] = (offset >> 16) & 0xFF;
+        head[p++] = (offset >> 8) & 0xFF;
+        head[p++] = offset & 0xFF;
+        head[p++] = info.type;
+        head[p++] = 255;
+        head[p++] = info.width8;
+        head[p++] = info.height8;
+
+        if (info.restartInterval) {
+            // Packets are not aligned to restart intervals: F = L = 1, count 0x3FFF
+            head[p++] = info.restartInterval >> 8;
+            head[p++] = info.restartInterval & 0xFF;
+            head[p++] = 0xFF;
+            head[p++] = 0xFF;
+        }
+
+        if (offset == 0) {
+            head[p++] = 0;
+            head[p++] = 0;
+            head[p++] = 0;
+            head[p++] = 2 * QTABLE_LEN;
+            memcpy(head + p, info.qtables[0], QTABLE_LEN);
+            memcpy(head + p + QTABLE_LEN, info.qtables[1], QTABLE_LEN);
+            p += 2 * QTABLE_LEN;
+        }
+
+        size_t room = _config.rtpMtu > p ? _config.rtpMtu - p : 0;
+        if (room == 0) {
+            snprintf(_lastError, sizeof(_lastError), "rtpMtu %u too small", _config.rtpMtu);
+            return false;
+        }
+        size_t n = std::min(room, info.scanLen - offset);
+        if (offset + n == info.scanLen) {
+            head[1] |= 0x80;
+        }
+
+        if (!_sendPacket(head, p, info.scan + offset, n)) {
+            if (errno == ENOMEM || errno == EAGAIN || errno == EWOULDBLOCK) {
+                // The rest of this frame is lost. Skip the sequence numbers its
+                // packets would have used, so the receiver sees the gap and
+                // counts the loss instead of taking the next frame as a
+                // continuation of this one.
+                size_t left = info.scanLen - offset - n;
+                size_t tailRoom = _config.rtpMtu - (offset == 0 ? p - QTABLE_HEADER_LEN - 2 * QTABLE_LEN : p);
+                _sequence += 1 + (left + tailRoom - 1) / tailRoom;
+                _framesDropped++;
+                return true;
+            }
+            snprintf(_lastError, sizeof(_lastError), "UDP send failed: errno %d", errno);
+            _connected = false;
+            return false;
+        }
+
+        _sequence++;
+        offset += n;
+        _bytesSent += p + n;
+    }
+    return true;
+}
+
+bool RtpJpegStreamTransport::_sendPacket(const uint8_t* head, size_t headLen, const uint8_t* payload, size_t payloadLen) {
+    struct iovec vec[2];
+    vec[0].iov_base = (void*)head;
+    vec[0].iov_len = headLen;
+    vec[1].iov_base = (void*)payload;
+    vec[1].iov_len = payloadLen;
+
+    struct msghdr msg = {};
+    msg.msg_iov = vec;
+    msg.msg_iovlen = 2;
+
+    for (int attempt = 0; attempt <= SEND_RETRIES; attempt++) {
+        if (sendmsg(_sock, &msg, 0) >= 0) {
+            return true;
+        }
+        if (errno != ENOMEM && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return false;
+}
+
+uint64_t RtpJpegStreamTransport::getBytesSent() const {
+    return _bytesSent;
+}
+
+const char* RtpJpegStreamTransport::getLastError() const {
+    return _lastError;
+}
@@ -0,0 +1,72 @@
+#ifndef RTP_JPEG_STREAM_TRANSPORT_H
+#define RTP_JPEG_STREAM_TRANSPORT_H
+
+#include "Arduino.h"
+#include "StreamTransport.h"
+#include "StreamConfig.h"
+#include "esp_camera.h"
+#include "lwip/sockets.h"
+#include <atomic>
+
+// RTP/JPEG (RFC 2435) over UDP to the stream server's host on rtpPort.
+// Each frame's JFIF headers are stripped; the scan data is split into
+// packets of at most rtpMtu bytes, the first one carrying the quantization
+// tables in-band (Q = 255). A lost packet loses its frame only, never
+// delays the next one. Width and height must be multiples of 8 up to 2040
+// and the sensor must produce baseline 4:2:2 or 4:2:0 JPEG with the
+// standard Huffman tables, which the OV2640 does.
+class RtpJpegStreamTransport : public StreamTransport {
+public:
+    RtpJpegStreamTransport(const StreamConfig& config);
+    ~RtpJpegStreamTransport();
+
+    bool connect(const char* url) override;
+    void disconnect() override;
+    bool isConnected() const override;
+    bool send(const uint8_t* data, size_t len) override;
+    bool sendv(const StreamIovec* iov, size_t count) override;
+    // Not sent: carries the frame's 90 kHz RTP timestamp from capture to sendv()
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override;
+    uint64_t getBytesSent() const override;
+    const char* getLastError() const override;
+
+    esp_http_client_handle_t getHttpClient() const override { return nullptr; }
+
+    uint32_t getFramesDropped() const { return _framesDropped.load(); }
+
+private:
+    struct JpegInfo {
+        uint8_t type;
+        uint8_t width8;
+        uint8_t height8;
+        uint16_t restartInterval;
+        const uint8_t* qtables[2];
+        const uint8_t* scan;
+        size_t scanLen;
+    };
+
+    bool _parseJpeg(const uint8_t* data, size_t len, JpegInfo& info);
+    bool _sendFrame(const uint8_t* data, size_t len, uint32_t timestamp);
+    bool _sendPacket(const uint8_t* head, size_t headLen, const uint8_t* payload, size_t payloadLen);
+
+    StreamConfig _config;
+    SemaphoreHandle_t _mutex;
+
+    int _sock;
+    std::atomic<bool> _connected;
+    uint64_t _bytesSent;
+    std::atomic<uint32_t> _framesDropped;
+
+    uint16_t _sequence;
+    uint32_t _ssrc;
+
+    char _lastError[256];
+
+    static const size_t RTP_HEADER_LEN = 12;
+    static const size_t JPEG_HEADER_LEN = 8;
+    static const size_t RESTART_HEADER_LEN = 4;
+    static const size_t QTABLE_HEADER_LEN = 4;
+    static const size_t QTABLE_LEN = 64;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "SceneChangeDetector.h"
+#include "Arduino.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "img_converters.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG = "SceneChangeDetector";
+
+SceneChangeDetector::SceneChangeDetector(const StreamConfig& config)
+    : _config(config),
+      _stats(),
+      _haveReference(false),
+      _refLen(0),
+      _refWidth(0),
+      _refHeight(0),
+      _lastSentMs(0),
+      _refThumb(nullptr),
+      _thumb(nullptr),
+      _rgb565(nullptr),
+      _thumbPixels(0),
+      _refThumbValid(false),
+      _similarFrames(0)
+{
+}
+
+SceneChangeDetector::~SceneChangeDetector() {
+    _free();
+}
+
+void SceneChangeDetector::reset() {
+    _haveReference = false;
+    _refThumbValid = false;
+    _similarFrames = 0;
+}
+
+void SceneChangeDetector::_free() {
+    heap_caps_free(_refThumb);
+    heap_caps_free(_thumb);
+    heap_caps_free(_rgb565);
+    _refThumb = nullptr;
+    _thumb = nullptr;
+    _rgb565 = nullptr;
+    _thumbPixels = 0;
+}
+
+bool SceneChangeDetector::_allocate(size_t width, size_t height) {
+    size_t pixels = ((width + 7) / 8) * ((height + 7) / 8);
+    if (pixels == _thumbPixels && _rgb565) {
+        return true;
+    }
+    _free();
+
+    uint32_t caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    _refThumb = (uint8_t*)heap_caps_malloc(pixels, caps);
+    _thumb = (uint8_t*)heap_caps_malloc(pixels, caps);
+    _rgb565 = (uint8_t*)heap_caps_malloc(pixels * 2, caps);
+    if (!_refThumb || !_thumb || !_rgb565) {
+        ESP_LOGE(TAG, "No memory for %ux%u thumbnails, DC check disabled", width / 8, height / 8);
+        _free();
+        return false;
+    }
+    _thumbPixels = pixels;
+    return true;
+}
+
+bool SceneChangeDetector::_decodeThumbnail(const camera_fb_t* fb, uint8_t* luma) {
+    // 1/8 scale saves the IDCT and most of the output, not the entropy decoding
+    int64_t start = esp_timer_get_time();
+    if (!jpg2rgb565(fb->buf, fb->len, _rgb565, JPG_SCALE_8X)) {
+        return false;
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    _stats.decodeUs = _stats.thumbnailsDecoded == 0 ? us : (_stats.decodeUs * 15 + us) / 16;
+    _stats.thumbnailsDecoded++;
+
+    const uint8_t* p = _rgb565;
+    for (size_t i = 0; i < _thumbPixels; i++, p += 2) {
+        uint16_t v = (uint16_t)(p[0] << 8) | p[1];
+        uint32_t r = (v >> 8) & 0xF8;
+        uint32_t g = (v >> 3) & 0xFC;
+        uint32_t b = (v << 3) & 0xF8;
+        luma[i] = (uint8_t)((77 * r + 150 * g + 29 * b) >> 8);
+    }
+    return true;
+}
+
+void SceneChangeDetector::_refreshThumbnail(const camera_fb_t* fb) {
+    _similarFrames = 0;
+    _refThumbValid = _config.sceneDcCheck && _allocate(fb->width, fb->height) && _decodeThumbnail(fb, _thumb);
+    if (_refThumbValid) {
+        std::swap(_thumb, _refThumb);
+    }
+}
+
+bool SceneChangeDetector::_decide(const camera_fb_t* fb, uint32_t now) {
+    _stats.lastSizeScore = 0;
+    _stats.lastDcScore = 0;
+
+    if (!_haveReference || fb->width != _refWidth || fb->height != _refHeight) {
+        _refThumbValid = false;
+        return true;
+    }
+
+    if (_config.sceneKeepAliveMs > 0 && now - _lastSentMs >= _config.sceneKeepAliveMs) {
+        // The server now shows this frame, so later frames are compared with
+        // it rather than with an older one slow drift has moved away from
+        _stats.keepAlives++;
+        _refreshThumbnail(fb);
+        return true;
+    }
+
+    float sizeScore = _refLen > 0 ? (float)abs((int)fb->len - (int)_refLen) / _refLen : 1.0f;
+    _stats.lastSizeScore = sizeScore;
+    if (sizeScore > _config.sceneSizeThreshold) {
+        // Content changed: the reference thumbnail is rebuilt from a later, similar-sized frame
+        _refThumbValid = false;
+        return true;
+    }
+
+    if (!_config.sceneDcCheck || !_allocate(fb->width, fb->height)) {
+        return false;
+    }
+
+    // A decode is expensive: between decodes, similar-sized frames count as unchanged
+    if (_refThumbValid && ++_similarFrames < _config.sceneDcEvery) {
+        return false;
+    }
+    _similarFrames = 0;
+
+    if (!_decodeThumbnail(fb, _thumb)) {
+        // Not decodable here: let it through rather than risk hiding a change
+        return true;
+    }
+
+    if (!_refThumbValid) {
+        // First similar frame after a change: nothing to compare against yet
+        std::swap(_thumb, _refThumb);
+        _refThumbValid = true;
+        return true;
+    }
+
+    uint32_t diff = 0;
+    for (size_t i = 0; i < _thumbPixels; i++) {
+        diff += (uint32_t)abs((int)_thumb[i] - (int)_refThumb[i]);
+    }
+    float dcScore = (float)diff / (_thumbPixels * 255.0f);
+    _stats.lastDcScore = dcScore;
+
+    if (dcScore > _config.sceneDcThreshold) {
+        std::swap(_thumb, _refThumb);
+        return true;
+    }
+    return false;
+}
+
+bool SceneChangeDetector::shouldSend(const camera_fb_t* fb) {
+    int64_t start = esp_timer_get_time();
+    uint32_t now = millis();
+
+    bool send = _decide(fb, now);
+    if (send) {
+        _haveReference = true;
+        _refLen = fb->len;
+        _refWidth = fb->width;
+        _refHeight = fb->height;
+        _lastSentMs = now;
+    } else {
+        _stats.framesSkipped++;
+        _stats.bytesSaved += fb->len;
+    }
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    _stats.usPerFrame = _stats.framesChecked == 0 ? us : (_stats.usPerFrame * 15 + us) / 16;
+    _stats.framesChecked++;
+    return send;
+}
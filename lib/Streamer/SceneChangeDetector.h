@@ -0,0 +1,74 @@
+#ifndef SCENE_CHANGE_DETECTOR_H
+#define SCENE_CHANGE_DETECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_camera.h"
+#include "StreamConfig.h"
+
+struct SceneChangeStats {
+    uint32_t framesChecked;
+    uint32_t framesSkipped;
+    uint32_t keepAlives;          // frames sent only because sceneKeepAliveMs ran out
+    uint64_t bytesSaved;          // JPEG bytes of skipped frames
+    uint32_t thumbnailsDecoded;
+    uint32_t usPerFrame;          // detector cost, moving average
+    uint32_t decodeUs;            // cost of one thumbnail decode, moving average
+    float lastSizeScore;
+    float lastDcScore;
+};
+
+// Decides on the compressed frame whether it differs enough from the last
+// frame sent to be worth uploading. Two tests, cheapest first:
+//  - JPEG size: relative change against the reference frame. Any real
+//    change in content changes the entropy-coded size; a static scene only
+//    moves it by sensor noise.
+//  - DC thumbnail (sceneDcCheck): frames whose size stayed within
+//    sceneSizeThreshold are decoded at 1/8 scale and compared by mean luma
+//    difference. This catches motion that happens to keep the size, e.g.
+//    an object moving across a uniform background. JPG_SCALE_8X only skips
+//    the IDCT: every AC coefficient is still Huffman-decoded, so a decode
+//    costs a good part of a full one (see decodeUs). Only every
+//    sceneDcEvery-th similar frame is decoded; the others go by size alone.
+// The reference is the last frame sent, so slow drift adds up until it
+// crosses a threshold. A frame is always sent after sceneKeepAliveMs, and
+// that frame becomes the reference for both tests.
+class SceneChangeDetector {
+public:
+    SceneChangeDetector(const StreamConfig& config);
+    ~SceneChangeDetector();
+
+    // True if fb should be sent; it then becomes the reference
+    bool shouldSend(const camera_fb_t* fb);
+
+    // Forgets the reference so the next frame is sent (reconnect, new frame size)
+    void reset();
+
+    const SceneChangeStats& getStats() const { return _stats; }
+
+private:
+    bool _decide(const camera_fb_t* fb, uint32_t now);
+    bool _decodeThumbnail(const camera_fb_t* fb, uint8_t* luma);
+    void _refreshThumbnail(const camera_fb_t* fb);
+    bool _allocate(size_t width, size_t height);
+    void _free();
+
+    const StreamConfig& _config;
+    SceneChangeStats _stats;
+
+    bool _haveReference;
+    size_t _refLen;
+    size_t _refWidth;
+    size_t _refHeight;
+    uint32_t _lastSentMs;
+
+    // 1/8-scale luma of the reference and of the frame being checked
+    uint8_t* _refThumb;
+    uint8_t* _thumb;
+    uint8_t* _rgb565;
+    size_t _thumbPixels;
+    bool _refThumbValid;
+    uint32_t _similarFrames;      // similar-sized frames since the last decode
+};
+
+#endif
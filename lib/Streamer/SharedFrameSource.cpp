@@ -0,0 +1,96 @@
+#include "SharedFrameSource.h"
+#include "esp_log.h"
+
+static const char* TAG = "SharedFrameSource";
+
+SharedFrameSource::SharedFrameSource(FrameSource* upstream)
+    : _upstream(upstream)
+{
+    for (size_t i = 0; i < MAX_FRAMES; i++) {
+        _entries[i].fb.store(nullptr);
+        _entries[i].refs.store(0);
+        _entries[i].owner = nullptr;
+    }
+}
+
+SharedFrameSource::Entry* SharedFrameSource::_find(camera_fb_t* frame) {
+    for (size_t i = 0; i < MAX_FRAMES; i++) {
+        if (_entries[i].fb.load(std::memory_order_acquire) == frame) {
+            return &_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+camera_fb_t* SharedFrameSource::get_frame() {
+    camera_fb_t* fb = _upstream->get_frame();
+    if (!fb) {
+        return nullptr;
+    }
+
+    if (!_insert(fb, _upstream)) {
+        ESP_LOGE(TAG, "More than %u frames in flight, dropping frame", MAX_FRAMES);
+        _upstream->return_frame(fb);
+        return nullptr;
+    }
+    return fb;
+}
+
+bool SharedFrameSource::adopt(camera_fb_t* frame, FrameSource* owner) {
+    return frame && owner && _insert(frame, owner);
+}
+
+bool SharedFrameSource::_insert(camera_fb_t* frame, FrameSource* owner) {
+    for (size_t i = 0; i < MAX_FRAMES; i++) {
+        camera_fb_t* expected = nullptr;
+        if (_entries[i].fb.load(std::memory_order_relaxed) == nullptr) {
+            _entries[i].refs.store(1, std::memory_order_relaxed);
+            _entries[i].owner = owner;
+            if (_entries[i].fb.compare_exchange_strong(expected, frame, std::memory_order_release)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t SharedFrameSource::inFlight() const {
+    size_t count = 0;
+    for (size_t i = 0; i < MAX_FRAMES; i++) {
+        if (_entries[i].fb.load(std::memory_order_acquire) != nullptr) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void SharedFrameSource::retain(camera_fb_t* frame) {
+    Entry* entry = _find(frame);
+    if (entry) {
+        entry->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SharedFrameSource::return_frame(camera_fb_t* frame) {
+    if (!frame) {
+        return;
+    }
+
+    Entry* entry = _find(frame);
+    if (!entry) {
+        _upstream->return_frame(frame);
+        return;
+    }
+
+    if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        FrameSource* owner = entry->owner;
+        entry->fb.store(nullptr, std::memory_order_release);
+        owner->return_frame(frame);
+    }
+}
+
+void SharedFrameSource::frame_sent(camera_fb_t* frame) {
+    Entry* entry = _find(frame);
+    FrameSource* owner = entry ? entry->owner : _upstream;
+    owner->frame_sent(frame);
+}
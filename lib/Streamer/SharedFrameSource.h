@@ -0,0 +1,51 @@
+#ifndef SHARED_FRAME_SOURCE_H
+#define SHARED_FRAME_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include "FrameSource.h"
+
+// Reference-counted view of another FrameSource so one captured frame can
+// be handed to the push stream and any number of local consumers without a
+// copy. get_frame() returns a frame holding one reference; every retain()
+// must be matched by a return_frame(), and the frame goes back upstream
+// when the last reference is dropped.
+class SharedFrameSource : public FrameSource {
+public:
+    explicit SharedFrameSource(FrameSource* upstream);
+
+    void setUpstream(FrameSource* upstream) { _upstream = upstream; }
+
+    camera_fb_t* get_frame() override;
+    void return_frame(camera_fb_t* frame) override;
+
+    void frame_sent(camera_fb_t* frame) override;
+
+    // Only valid while the caller itself holds a reference to frame
+    void retain(camera_fb_t* frame);
+
+    // Tracks a frame that did not come from upstream (e.g. the backlog)
+    // with one reference; the last return_frame() hands it back to owner.
+    bool adopt(camera_fb_t* frame, FrameSource* owner);
+
+    // Frames currently handed out and not yet returned upstream
+    size_t inFlight() const;
+
+    static const size_t MAX_FRAMES = 16;
+
+private:
+    struct Entry {
+        std::atomic<camera_fb_t*> fb;
+        std::atomic<uint32_t> refs;
+        FrameSource* owner;
+    };
+
+    Entry* _find(camera_fb_t* frame);
+    bool _insert(camera_fb_t* frame, FrameSource* owner);
+
+    FrameSource* _upstream;
+    Entry _entries[MAX_FRAMES];
+};
+
+#endif
@@ -4,6 +4,24 @@
 #include <cstddef>
 #include <cstdint>
 
+enum class StreamTransportType {
+    HTTP_CLIENT,    // esp_http_client
+    RAW_TCP,        // hand-written HTTP/1.1 request on a plain lwIP socket
+    RTP_UDP,        // RTP/JPEG (RFC 2435) datagrams, lost frames are skipped instead of retransmitted
+    WEBSOCKET       // binary WebSocket messages, server text messages control the stream
+};
+
+enum class FrameDropPolicy {
+    DROP_NEWEST,    // queue full: discard the frame just captured
+    DROP_OLDEST,    // queue full: evict the oldest queued frame
+    KEEP_LATEST     // never queue more than keepLatestCount frames, evicting the oldest
+};
+
+enum class UploadMode {
+    CONTENT_LENGTH, // fixed Content-Length of maxDataSize per request
+    CHUNKED         // Transfer-Encoding: chunked, one chunk per multipart part, no length limit
+};
+
 struct StreamConfig {
     const char* boundary = "wheelbot";
     const char* contentType = "multipart/x-mixed-replace";
@@ -13,23 +31,83 @@ struct StreamConfig {
     size_t txBufferSize = 32768;
 
     uint64_t maxDataSize = 100000000LL;
+    UploadMode uploadMode = UploadMode::CONTENT_LENGTH;
+    bool streamRollover = true;                 // switch to a pre-opened request before maxDataSize is spent
+    uint64_t rolloverMarginBytes = 4000000;     // budget left when the standby request is opened
+    uint32_t rolloverWaitMs = 2000;             // how long the sender waits for a standby that is still connecting
 
+    bool fastReconnect = true;                  // keep the HTTP client handle (raw TCP: the resolved address), retry a dropped stream at once
     uint32_t reconnectInterval = 5000;
     uint32_t maxReconnectInterval = 60000;
     float reconnectMultiplier = 2.0f;
 
     uint32_t metricsUpdateInterval = 1000;
+    uint32_t latencyLogInterval = 10000;    // 0 = keep histograms cumulative, no log line
     uint32_t slowChunkThreshold = 50;
 
-    uint32_t maxFPS = 30;
+    float maxFPS = 30;                  // fractional rates allowed, 0 = unpaced
     size_t taskQueueSize = 16;
+    FrameDropPolicy dropPolicy = FrameDropPolicy::DROP_OLDEST;
+    size_t keepLatestCount = 2;
+    uint32_t maxFrameAgeMs = 0;        // discard frames older than this at dequeue, 0 = off
       size_t taskStackDepth = 8192;
       uint32_t taskPriority = 5;
+
+    // Task placement, core -1 = no affinity. The WiFi driver, lwIP and the
+    // camera driver task run on core 0, so by default both pipeline stages
+    // share core 1 and the sender never competes with the network stack.
+    int taskCore = 1;                       // send stage (TaskSender)
+    bool captureTask = true;                // run Streamer::loop() in its own task instead of Arduino loop()
+    int captureTaskCore = 1;
+    uint32_t captureTaskPriority = 4;
+    size_t captureTaskStackDepth = 8192;
+    bool reportCoreLoad = false;            // benchmark: log per-core utilisation with the metrics
     uint32_t taskDelayMs = 1;
     const char* defaultJpegQuality = "10";
     size_t chunkSize = 4096;
     uint32_t sendErrorDelayMs = 100;
     uint32_t maxSendFailures = 3;
+
+    StreamTransportType transport = StreamTransportType::HTTP_CLIENT;
+    bool tcpNoDelay = true;
+    bool tcpMsgMore = false;           // MSG_MORE on every write of a frame but the last
+    size_t tcpSendBufferSize = 0;      // 0 = lwIP default
+    uint32_t tcpTimeoutMs = 5000;
+
+    uint16_t rtpPort = 5004;           // UDP port on the stream server's host
+    size_t rtpMtu = 1400;              // max RTP packet size (headers + payload), below the WiFi MTU
+    uint8_t rtpPayloadType = 26;       // static JPEG payload type
+
+    const char* wsPath = "/ws";        // WebSocket endpoint on the stream server's host and port
+    int snapshotQuality = 4;           // JPEG quality for a frame requested with {"snapshot":true}
+
+    // Scene-change gating: skip uploading frames that barely differ from the last one sent
+    bool sceneGating = false;
+    float sceneSizeThreshold = 0.04f;        // relative JPEG size change that counts as a new scene
+    bool sceneDcCheck = true;                // compare 1/8-scale DC thumbnails of similar-sized frames
+    float sceneDcThreshold = 0.03f;          // mean luma change of the thumbnail, 0-1
+    uint32_t sceneDcEvery = 4;               // decode a thumbnail for every Nth similar-sized frame, 1 = all
+    uint32_t sceneKeepAliveMs = 1000;        // send a frame at least this often, 0 = never force
+
+    // Store-and-forward: while the server is unreachable, keep frames on the
+    // data partition and upload them after reconnecting. Not for RTP_UDP.
+    bool backlog = false;
+    float backlogFPS = 0.5f;                 // frames stored per second during an outage
+    int backlogQuality = 30;                 // JPEG quality during an outage, -1 = unchanged
+    const char* backlogFrameSize = "QVGA";   // frame size during an outage, "" = unchanged
+    size_t backlogMaxBytes = 512 * 1024;     // flash budget, oldest segments are dropped beyond it
+    size_t backlogSegmentBytes = 64 * 1024;  // file size; the unit of eviction and deletion
+    size_t backlogBatchBytes = 32 * 1024;    // RAM batch per flash write, also the largest frame kept
+    uint32_t backlogFlushMs = 30000;         // write a partial batch after this long
+    float backlogUploadFPS = 2;              // upload rate cap, 0 = whenever the sender is idle
+
+    bool adaptiveQuality = false;
+    uint32_t adaptiveTargetFPS = 0;          // 0 = maxFPS
+    uint32_t adaptiveLatencyBudgetMs = 0;    // per-frame send budget, 0 = 1000 / target FPS
+    int adaptiveQualityStep = 2;
+    int adaptiveWorstQuality = 40;
+    uint32_t adaptiveUpgradeIntervals = 3;
+    uint32_t adaptiveFrameSizeIntervals = 5;
 };
 
 #endif
@@ -4,6 +4,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <esp_http_client.h>
+#include "esp_camera.h"
+#include "StreamerEvents.h"
+
+struct StreamIovec {
+    const uint8_t* data;
+    size_t len;
+};
 
 class StreamTransport {
 public:
@@ -11,14 +18,46 @@ public:
     
     virtual bool connect(const char* url) = 0;
     virtual void disconnect() = 0;
+    // Checked for every frame by both the capture and the send task:
+    // answer from an atomic flag, never by taking the transport's lock
     virtual bool isConnected() const = 0;
+
+    // Ends the current request cleanly (closing boundary, remaining declared
+    // body, server response) and closes the connection. Transports without a
+    // framed ending just disconnect.
+    virtual bool finish() {
+        disconnect();
+        return true;
+    }
     
     virtual bool send(const uint8_t* data, size_t len) = 0;
 
+    // Scatter-gather write of one logical unit (e.g. part header + JPEG).
+    // Transports that can coalesce segments should override this.
+    virtual bool sendv(const StreamIovec* iov, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (iov[i].len > 0 && !send(iov[i].data, iov[i].len)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Writes the per-frame framing that precedes fb's payload into buf and
+    // returns its length (0 if the transport needs none).
+    virtual size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) = 0;
+
     virtual uint64_t getBytesSent() const = 0;
 
+    // Declared body length of the current request, 0 = unbounded (chunked)
+    virtual uint64_t getByteBudget() const { return 0; }
+
     virtual const char* getLastError() const = 0;
 
+    // Receives messages the server sends back (onControlMessage). Only
+    // transports with a return channel use it.
+    virtual void setEventsHandler(StreamerEvents* handler) {}
+
     virtual esp_http_client_handle_t getHttpClient() const = 0;
 };
 
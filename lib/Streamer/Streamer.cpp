@@ -1,23 +1,45 @@
 #include "Streamer.h"
 #include "HttpStreamTransport.h"
+#include "RawTcpStreamTransport.h"
+#include "RolloverStreamTransport.h"
+#include "RtpJpegStreamTransport.h"
+#include "WebSocketStreamTransport.h"
 #include "TaskSender.h"
 #include "../ConfigManager/ConfigManager.h"
+#include <BootProfiler.h>
+#include <ArduinoJson.h>
 #include <algorithm>
 #include "esp_log.h"
+#include "esp_timer.h"
 
 static const char *TAG = "Streamer";
 
-Streamer::Streamer(const char* stream_url, const char* frame_size_str, const char* jpeg_quality_str)
-    : _cameraModule(nullptr),
+static StreamTransport* createTransport(const StreamConfig& config) {
+    if (config.transport == StreamTransportType::RAW_TCP) {
+        return new RawTcpStreamTransport(config);
+    }
+    if (config.transport == StreamTransportType::RTP_UDP) {
+        return new RtpJpegStreamTransport(config);
+    }
+    if (config.transport == StreamTransportType::WEBSOCKET) {
+        return new WebSocketStreamTransport(config);
+    }
+    return new HttpStreamTransport(config);
+}
+
+Streamer::Streamer(const char* stream_url, const char* frame_size_str, const char* jpeg_quality_str,
+                   const StreamConfig& config)
+    : _config(config),
+      _cameraModule(nullptr),
+      _frames(nullptr),
       _transport(nullptr),
       _taskSender(nullptr),
+      _qualityController(nullptr),
       _eventsHandler(nullptr),
       _state(State::IDLE),
       _lastReconnectAttempt(0),
       _currentReconnectInterval(5000),
       _lastMetricsUpdate(0),
-      _lastFrameTime(0),
-      _frameDelayMs(0),
       _currentFPS(0),
       _totalBytesSent(0),
       _totalFramesSent(0)
@@ -39,19 +61,53 @@ Streamer::Streamer(const char* stream_url, const char* frame_size_str, const cha
     ESP_LOGI(TAG, "Streamer initialized - URL: %s, Size: %s, Quality: %s",
              _stream_url, _frame_size_str, _jpeg_quality_str);
 
-    if (_config.maxFPS > 0) {
-        _frameDelayMs = 1000 / _config.maxFPS;
-    } else {
-        _frameDelayMs = 0;
+    _cameraModule = new CameraModule(_frame_size_str, _jpeg_quality_str);
+    _cameraModule->setPipelineDepth(_senderDepth());
+    _frames.setUpstream(_cameraModule);
+
+    if (_config.adaptiveQuality) {
+        _qualityController = new QualityController(_cameraModule, _config);
     }
 
-    _cameraModule = new CameraModule(_frame_size_str, _jpeg_quality_str);
-    _initializeTransport();
+    if (_config.sceneGating) {
+        _sceneDetector = new SceneChangeDetector(_config);
+    }
+
+    if (_config.reportCoreLoad) {
+        _coreLoad = new CoreLoadMonitor();
+    }
 }
 
 Streamer::~Streamer() {
+    _pacer.stop();
+
+    if (_captureTask) {
+        vTaskDelete(_captureTask);
+        _captureTask = nullptr;
+    }
+
     _cleanupTransport();
 
+    if (_coreLoad) {
+        delete _coreLoad;
+        _coreLoad = nullptr;
+    }
+
+    if (_qualityController) {
+        delete _qualityController;
+        _qualityController = nullptr;
+    }
+
+    if (_sceneDetector) {
+        delete _sceneDetector;
+        _sceneDetector = nullptr;
+    }
+
+    if (_backlog) {
+        delete _backlog;
+        _backlog = nullptr;
+    }
+
     if (_cameraModule) {
         delete _cameraModule;
         _cameraModule = nullptr;
@@ -61,8 +117,15 @@ Streamer::~Streamer() {
 void Streamer::_initializeTransport() {
     _cleanupTransport();
 
-    _transport = new HttpStreamTransport(_config);
-    _taskSender = new TaskSender(_transport, _config);
+    // Datagrams and WebSocket messages have no request byte budget to roll over
+    if (_config.streamRollover && _config.transport != StreamTransportType::RTP_UDP &&
+        _config.transport != StreamTransportType::WEBSOCKET) {
+        _transport = new RolloverStreamTransport(_config, createTransport);
+    } else {
+        _transport = createTransport(_config);
+    }
+    _transport->setEventsHandler(this);
+    _taskSender = new TaskSender(_transport, &_frames, _config);
     _taskSender->setEventsHandler(this);
     _taskSender->start();
 }
@@ -82,11 +145,575 @@ void Streamer::_cleanupTransport() {
     }
 }
 
+void Streamer::setFrameSource(FrameSource* source) {
+    _frames.setUpstream(source ? source : _cameraModule);
+}
+
+bool Streamer::addFrameSink(FrameSink* sink) {
+    if (!sink || _sinkCount >= sizeof(_sinks) / sizeof(_sinks[0])) {
+        return false;
+    }
+    _sinks[_sinkCount++] = sink;
+
+    // Frames pinned by sinks are not available to the capture driver
+    _sinkFrames += sink->maxFramesHeld();
+    _cameraModule->setPipelineDepth(_senderDepth() + _sinkFrames);
+    return true;
+}
+
+size_t Streamer::_senderDepth() const {
+    return _config.dropPolicy == FrameDropPolicy::KEEP_LATEST ? _config.keepLatestCount : _config.taskQueueSize;
+}
+
+void Streamer::_applyFrameBudget() {
+    if (!_taskSender) {
+        return;
+    }
+    // What the planned pool leaves for the pipeline, less what sinks may pin
+    size_t depth = _cameraModule->get_plan().pipelineDepth;
+    _taskSender->setFrameBudget(depth > _sinkFrames ? depth - _sinkFrames : 1);
+}
+
+bool Streamer::_sinksWantFrames() const {
+    for (size_t i = 0; i < _sinkCount; i++) {
+        if (_sinks[i]->wantsFrames()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Streamer::_publishToSinks(camera_fb_t* fb) {
+    for (size_t i = 0; i < _sinkCount; i++) {
+        if (_sinks[i]->wantsFrames()) {
+            _sinks[i]->publish(fb, &_frames);
+        }
+    }
+}
+
+void Streamer::setTransportType(StreamTransportType type) {
+    _config.transport = type;
+}
+
+void Streamer::setUploadMode(UploadMode mode) {
+    _config.uploadMode = mode;
+}
+
+bool Streamer::beginCameraInit(int core) {
+    _cameraReady = xSemaphoreCreateBinary();
+    if (!_cameraReady) {
+        return false;
+    }
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        Streamer::_cameraInitTaskWrapper,
+        "CameraInit",
+        4096,
+        this,
+        _config.captureTaskPriority,
+        nullptr,
+        core < 0 ? tskNO_AFFINITY : core
+    );
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create camera init task, initialising in setup()");
+        vSemaphoreDelete(_cameraReady);
+        _cameraReady = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Streamer::_cameraInitTaskWrapper(void* parameter) {
+    Streamer* streamer = static_cast<Streamer*>(parameter);
+    streamer->_initCamera();
+    xSemaphoreGive(streamer->_cameraReady);
+    vTaskDelete(nullptr);
+}
+
+void Streamer::_initCamera() {
+    BootProfiler::mark("camera init");
+    _cameraModule->setup();
+    BootProfiler::mark("camera ready");
+
+    // Let auto exposure and white balance settle before frames go out
+    for (uint32_t i = 0; i < CAMERA_WARMUP_FRAMES; i++) {
+        camera_fb_t* fb = _cameraModule->get_frame();
+        if (fb) {
+            _cameraModule->return_frame(fb);
+        }
+    }
+    BootProfiler::mark("camera warmed up");
+}
+
+bool Streamer::setFrameSize(framesize_t frameSize) {
+    if (frameSize <= _cameraModule->get_max_framesize()) {
+        return _cameraModule->set_framesize(frameSize);
+    }
+    _pendingFrameSize = (int)frameSize;
+    _persistPendingFrameSize = -1;
+    ESP_LOGI(TAG, "Frame size %d needs a larger frame buffer pool, re-planning once frames drain", frameSize);
+    return true;
+}
+
+bool Streamer::_applyPendingFrameSize() {
+    int frameSize = _pendingFrameSize.load();
+    if (frameSize < 0) {
+        return false;
+    }
+    // esp_camera_deinit() frees the pool: wait until no sink or queued frame holds a buffer
+    if (_frames.inFlight() > 0) {
+        return true;
+    }
+
+    _pendingFrameSize = -1;
+    bool ok = _cameraModule->reconfigure((framesize_t)frameSize);
+    // Re-planned even when the old size was restored
+    _applyFrameBudget();
+    if (ok && _persistPendingFrameSize == frameSize) {
+        _saveStreamSettings(frameSize, -1, -1.0f);
+    }
+    _persistPendingFrameSize = -1;
+    if (_qualityController) {
+        _qualityController->reset();
+    }
+    return false;
+}
+
+bool Streamer::applyControl(const char* json, size_t len, char* error, size_t errorSize) {
+    char scratch[96];
+    if (!error) {
+        error = scratch;
+        errorSize = sizeof(scratch);
+    }
+
+    StaticJsonDocument<256> doc;
+    DeserializationError err = deserializeJson(doc, json, len);
+    if (err) {
+        snprintf(error, errorSize, "Invalid control JSON: %s", err.c_str());
+        ESP_LOGW(TAG, "%s", error);
+        return false;
+    }
+
+    // Validate everything before queueing anything
+    int quality = -1;
+    if (doc.containsKey("quality")) {
+        quality = doc["quality"] | -1;
+        if (quality < 0 || quality > 63) {
+            snprintf(error, errorSize, "quality must be 0-63");
+            ESP_LOGW(TAG, "Control: %s", error);
+            return false;
+        }
+    }
+
+    framesize_t frameSize = FRAMESIZE_INVALID;
+    if (doc.containsKey("framesize")) {
+        const char* name = doc["framesize"] | "";
+        if (!CameraModule::parseFrameSize(name, frameSize)) {
+            snprintf(error, errorSize, "Unknown framesize: %s", name);
+            ESP_LOGW(TAG, "Control: %s", error);
+            return false;
+        }
+    }
+
+    float fps = -1.0f;
+    if (doc.containsKey("fps")) {
+        fps = doc["fps"] | -1.0f;
+        if (fps < 0 || fps > 60) {
+            snprintf(error, errorSize, "fps must be 0-60");
+            ESP_LOGW(TAG, "Control: %s", error);
+            return false;
+        }
+    }
+
+    if (quality >= 0) {
+        _requestedQuality = quality;
+    }
+    if (frameSize != FRAMESIZE_INVALID) {
+        _requestedFrameSize = (int)frameSize;
+    }
+    if (fps >= 0) {
+        _requestedFPS = fps;
+    }
+    if (doc.containsKey("pause")) {
+        bool pause = doc["pause"] | false;
+        if (_paused.exchange(pause) != pause) {
+            ESP_LOGI(TAG, "Control: upload %s", pause ? "paused" : "resumed");
+        }
+    }
+    if (doc["snapshot"] | false) {
+        _snapshotRequested = true;
+    }
+    // After the requests: _applyControl() reads these first, so it never sees
+    // a persist value without its request
+    if (doc["persist"] | false) {
+        if (quality >= 0) {
+            _persistQuality = quality;
+        }
+        if (frameSize != FRAMESIZE_INVALID) {
+            _persistFrameSize = (int)frameSize;
+        }
+        if (fps >= 0) {
+            _persistFPS = fps;
+        }
+    }
+
+    // Counted after queueing: once loop() has seen this count, it has seen the changes
+    _controlRequested++;
+    if (_captureTask) {
+        // Cut the pacer wait short rather than waiting out a slow frame period
+        xTaskNotifyGive(_captureTask);
+    }
+    return true;
+}
+
+bool Streamer::waitControlApplied(uint32_t timeoutMs) {
+    uint32_t target = _controlRequested.load();
+    uint32_t start = millis();
+    while ((int32_t)(_controlApplied.load() - target) < 0) {
+        if (millis() - start >= timeoutMs) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONTROL_POLL_MS));
+    }
+    return true;
+}
+
+void Streamer::setMaxFPS(float fps) {
+    _config.maxFPS = fps;
+}
+
+size_t Streamer::formatControlJson(char* buf, size_t bufSize) const {
+    int frameSize = _pendingFrameSize.load();
+    if (frameSize < 0) {
+        frameSize = (int)_cameraModule->get_framesize();
+    }
+    const char* name = CameraModule::frameSizeName((framesize_t)frameSize);
+
+    int len = snprintf(buf, bufSize, "{\"quality\":%d,\"framesize\":\"%s\",\"fps\":%g,\"paused\":%s}",
+                       _cameraModule->get_quality(), name ? name : "", _config.maxFPS,
+                       _paused ? "true" : "false");
+    if (len < 0) {
+        return 0;
+    }
+    return std::min((size_t)len, bufSize - 1);
+}
+
+void Streamer::onControlMessage(const char* message, size_t len) {
+    ESP_LOGI(TAG, "Control message: %.*s", (int)len, message);
+    applyControl(message, len);
+}
+
+void Streamer::_applyControl() {
+    bool changed = false;
+
+    // Taken before the requests: a value to persist is then either applied
+    // below or, if its request was queued meanwhile, in effect next time
+    int persistFrameSize = _persistFrameSize.exchange(-1);
+    int persistQuality = _persistQuality.exchange(-1);
+    float persistFPS = _persistFPS.exchange(-1.0f);
+
+    int frameSize = _requestedFrameSize.exchange(-1);
+    if (frameSize >= 0 && _outage) {
+        // Takes effect when the outage ends
+        _outageRestoreFrameSize = frameSize;
+    } else if (frameSize >= 0 && !setFrameSize((framesize_t)frameSize)) {
+        ESP_LOGW(TAG, "Control: frame size %d not applied", frameSize);
+    } else if (frameSize >= 0) {
+        changed = true;
+    }
+
+    int quality = _requestedQuality.exchange(-1);
+    if (quality >= 0) {
+        if (_snapshotFramesLeft > 0) {
+            // Takes effect when the snapshot ends
+            _snapshotRestoreQuality = quality;
+        } else if (_outage) {
+            _outageRestoreQuality = quality;
+        } else if (_cameraModule->set_quality(quality)) {
+            ESP_LOGI(TAG, "Control: JPEG quality %d", quality);
+            changed = true;
+            if (_qualityController) {
+                _qualityController->reset();
+            }
+        } else {
+            ESP_LOGW(TAG, "Control: JPEG quality %d not applied", quality);
+        }
+    }
+
+    float fps = _requestedFPS.exchange(-1.0f);
+    if (fps >= 0) {
+        _config.maxFPS = fps;
+        // Also keeps loop() from starting the pacer again at the old rate
+        _pacerStarted = true;
+        if (!_pacer.setRate(fps)) {
+            ESP_LOGE(TAG, "Control: frame pacer unavailable, capturing at sensor rate");
+        } else {
+            ESP_LOGI(TAG, "Control: %g fps%s", fps, fps > 0 ? "" : " (unpaced)");
+        }
+    }
+
+    if (changed && _taskSender) {
+        // Frames queued at the old settings would only delay the first new one
+        size_t flushed = _taskSender->flush();
+        if (flushed > 0) {
+            ESP_LOGI(TAG, "Control: flushed %u queued frames", (unsigned)flushed);
+        }
+    }
+
+    if (_snapshotRequested.exchange(false) && _snapshotFramesLeft == 0) {
+        int current = _cameraModule->get_quality();
+        if (_cameraModule->set_quality(_config.snapshotQuality)) {
+            _snapshotRestoreQuality = current;
+            // Buffers already filled at the old quality come out first
+            _snapshotFramesLeft = _cameraModule->get_plan().fbCount + 1;
+            ESP_LOGI(TAG, "Control: snapshot at quality %d", _config.snapshotQuality);
+        }
+    }
+
+    _persistControl(persistFrameSize, persistQuality, persistFPS);
+}
+
+void Streamer::_persistControl(int frameSize, int quality, float fps) {
+    if (frameSize < 0 && quality < 0 && fps < 0) {
+        return;
+    }
+
+    // Only what is now in effect (or waits for a snapshot or outage to end) is saved
+    if (frameSize >= 0 && frameSize == _pendingFrameSize.load()) {
+        // Saved once the camera has been re-initialised for it
+        _persistPendingFrameSize = frameSize;
+        frameSize = -1;
+    } else if (frameSize >= 0) {
+        int current = _outage && _outageRestoreFrameSize >= 0 ? _outageRestoreFrameSize
+                                                              : (int)_cameraModule->get_framesize();
+        if (frameSize != current) {
+            ESP_LOGW(TAG, "Control: frame size %d not in effect, not persisted", frameSize);
+            frameSize = -1;
+        }
+    }
+
+    if (quality >= 0) {
+        int current = _outage ? _outageRestoreQuality
+                              : _snapshotFramesLeft > 0 ? _snapshotRestoreQuality : _cameraModule->get_quality();
+        if (quality != current) {
+            ESP_LOGW(TAG, "Control: JPEG quality %d not in effect, not persisted", quality);
+            quality = -1;
+        }
+    }
+
+    if (fps >= 0 && fps != _config.maxFPS) {
+        ESP_LOGW(TAG, "Control: %g fps not in effect, not persisted", fps);
+        fps = -1.0f;
+    }
+
+    _saveStreamSettings(frameSize, quality, fps);
+}
+
+void Streamer::_saveStreamSettings(int frameSize, int quality, float fps) {
+    if (frameSize < 0 && quality < 0 && fps < 0) {
+        return;
+    }
+
+    char qualityStr[4];
+    char fpsStr[16];        // "%g" of any float, e.g. 0.333333
+    snprintf(qualityStr, sizeof(qualityStr), "%d", quality);
+    snprintf(fpsStr, sizeof(fpsStr), "%g", fps);
+
+    extern ConfigManager configManager;
+    configManager.save_stream_settings(frameSize >= 0 ? CameraModule::frameSizeName((framesize_t)frameSize) : nullptr,
+                                       quality >= 0 ? qualityStr : nullptr,
+                                       fps >= 0 ? fpsStr : nullptr);
+}
+
+void Streamer::_countSnapshotFrame() {
+    if (_snapshotFramesLeft == 0 || --_snapshotFramesLeft > 0) {
+        return;
+    }
+    _cameraModule->set_quality(_snapshotRestoreQuality);
+    _snapshotRestoreQuality = -1;
+    if (_qualityController) {
+        _qualityController->reset();
+    }
+}
+
+void Streamer::_startBacklog() {
+    if (!_config.backlog) {
+        return;
+    }
+    // RTP receivers play frames out in timestamp order and would discard late ones
+    if (_config.transport == StreamTransportType::RTP_UDP) {
+        ESP_LOGW(TAG, "Backlog is not supported over RTP, disabled");
+        return;
+    }
+
+    _backlog = new BacklogStore(_config);
+    if (!_backlog->begin()) {
+        ESP_LOGE(TAG, "Backlog unavailable, outages will not be recorded");
+        delete _backlog;
+        _backlog = nullptr;
+        return;
+    }
+    _backlogIntervalMs = _config.backlogUploadFPS > 0 ? (uint32_t)(1000.0f / _config.backlogUploadFPS) : 0;
+}
+
+void Streamer::_beginOutage() {
+    if (_outage) {
+        return;
+    }
+    _outage = true;
+
+    // A snapshot cut short by the drop is not finished later
+    _outageRestoreQuality = _snapshotFramesLeft > 0 ? _snapshotRestoreQuality : _cameraModule->get_quality();
+    _snapshotFramesLeft = 0;
+    _snapshotRestoreQuality = -1;
+    _outageRestoreFrameSize = -1;
+
+    if (_config.backlogQuality >= 0) {
+        _cameraModule->set_quality(_config.backlogQuality);
+    }
+
+    framesize_t frameSize;
+    if (_config.backlogFrameSize[0] && CameraModule::parseFrameSize(_config.backlogFrameSize, frameSize) &&
+        frameSize != _cameraModule->get_framesize()) {
+        // Only sizes within the current pool: re-planning it would stall the sinks
+        framesize_t current = _cameraModule->get_framesize();
+        if (_cameraModule->set_framesize(frameSize)) {
+            _outageRestoreFrameSize = (int)current;
+        }
+    }
+
+    ESP_LOGI(TAG, "Outage: recording to the backlog at %.1f FPS, quality %d",
+             _config.backlogFPS, _cameraModule->get_quality());
+}
+
+void Streamer::_endOutage() {
+    if (!_outage) {
+        return;
+    }
+    _outage = false;
+
+    if (_outageRestoreQuality >= 0) {
+        _cameraModule->set_quality(_outageRestoreQuality);
+    }
+    if (_outageRestoreFrameSize >= 0) {
+        setFrameSize((framesize_t)_outageRestoreFrameSize);
+    }
+    _outageRestoreQuality = -1;
+    _outageRestoreFrameSize = -1;
+    if (_qualityController) {
+        _qualityController->reset();
+    }
+
+    // Make the last frames of the outage available for upload
+    _backlog->flush();
+}
+
+void Streamer::_feedBacklog() {
+    if (!_backlog) {
+        return;
+    }
+    // The writer may have been busy when the outage ended
+    _backlog->flush();
+
+    // Live frames come first: the backlog only gets a sender that has
+    // drained its queue, and at most backlogUploadFPS of it
+    uint32_t now = millis();
+    if (_paused || _taskSender->getQueueCount() > 0 ||
+        (_backlogIntervalMs > 0 && now - _lastBacklogSentMs < _backlogIntervalMs)) {
+        return;
+    }
+
+    camera_fb_t* fb = _backlog->get_frame();
+    if (!fb) {
+        return;
+    }
+    if (!_frames.adopt(fb, _backlog)) {
+        _backlog->return_frame(fb);
+        return;
+    }
+
+    FrameSlot* slot = _taskSender->acquireSlot();
+    if (!slot) {
+        _frames.return_frame(fb);
+        return;
+    }
+
+    slot->headerLen = _transport->formatFrameHeader(fb, slot->header, sizeof(slot->header));
+    // The header carries the original capture time; the sender's age check
+    // and latency stats count from now
+    int64_t us = esp_timer_get_time();
+    fb->timestamp.tv_sec = us / 1000000;
+    fb->timestamp.tv_usec = us % 1000000;
+
+    if (_taskSender->commitFrame(slot, fb)) {
+        _lastBacklogSentMs = now;
+    }
+}
+
 void Streamer::setup() {
     pinMode(LED_PIN, OUTPUT);
-    _cameraModule->setup();
     _state = State::IDLE;
-    _attemptReconnect();
+
+    // Built once the transport type and upload mode are final, so the
+    // setters never tear down a running sender
+    _initializeTransport();
+
+    if (_cameraReady) {
+        // The camera is coming up on the other core: open the stream meanwhile
+        _attemptReconnect();
+        xSemaphoreTake(_cameraReady, portMAX_DELAY);
+        vSemaphoreDelete(_cameraReady);
+        _cameraReady = nullptr;
+    } else {
+        _cameraModule->setup();
+        _attemptReconnect();
+    }
+    _applyFrameBudget();
+    BootProfiler::mark(_state == State::STREAMING ? "stream connected" : "stream connect failed");
+
+    if (_qualityController) {
+        _qualityController->reset();
+    }
+
+    if (_coreLoad) {
+        _coreLoad->start();
+    }
+
+    _startBacklog();
+
+    if (_config.captureTask) {
+        _startCaptureTask();
+    }
+}
+
+void Streamer::_captureTaskWrapper(void* parameter) {
+    Streamer* streamer = static_cast<Streamer*>(parameter);
+    while (true) {
+        streamer->loop();
+    }
+}
+
+bool Streamer::_startCaptureTask() {
+    BaseType_t result = xTaskCreatePinnedToCore(
+        Streamer::_captureTaskWrapper,
+        "Capture",
+        _config.captureTaskStackDepth,
+        this,
+        _config.captureTaskPriority,
+        &_captureTask,
+        _config.captureTaskCore < 0 ? tskNO_AFFINITY : _config.captureTaskCore
+    );
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create capture task, falling back to loop()");
+        _captureTask = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Capture task started (stack: %u, priority: %u, core: %d)",
+             _config.captureTaskStackDepth, _config.captureTaskPriority, _config.captureTaskCore);
+    return true;
 }
 
 void Streamer::_attemptReconnect() {
@@ -102,77 +729,171 @@ void Streamer::_attemptReconnect() {
         _state = State::STREAMING;
         _currentReconnectInterval = _config.reconnectInterval;
         _reconnectFailureCount = 0;
-        ESP_LOGI(TAG, "Streamer connected successfully");
+        _reconnectedAt = millis();
+        _framesAtReconnect = _taskSender ? _taskSender->getFramesSent() : 0;
+        if (_everConnected) {
+            _reconnects++;
+        }
+        _everConnected = true;
+        _endOutage();
+        if (_sceneDetector) {
+            // The server has no picture yet
+            _sceneDetector->reset();
+        }
+        if (_recovering.load()) {
+            ESP_LOGI(TAG, "Streamer reconnected %ums after the connection dropped",
+                     _reconnectedAt - _disconnectedAt.load());
+        } else {
+            ESP_LOGI(TAG, "Streamer connected successfully");
+        }
         _notifyConnected();
         _updateLED();
     } else {
         _state = State::ERROR;
+        _connectFailures++;
         _handleStreamError(_transport->getLastError());
     }
 
     _lastReconnectAttempt = millis();
 }
 
+void Streamer::_markDisconnected() {
+    if (_recovering.load()) {
+        return;
+    }
+    _disconnectedAt = millis();
+    _recovering = true;
+
+    // A drop after a working stream is usually a short WiFi hiccup: try
+    // again right away and only back off if that attempt fails
+    if (_config.fastReconnect) {
+        _retryNow = true;
+    }
+}
+
+void Streamer::_checkRecovered() {
+    if (!_recovering.load() || !_taskSender || _taskSender->getFramesSent() == _framesAtReconnect) {
+        return;
+    }
+
+    uint32_t now = millis();
+    uint32_t disconnectedAt = _disconnectedAt.load();
+    _stats.lastRecoveryMs = now - disconnectedAt;
+    _recovering = false;
+
+    ESP_LOGI(TAG, "Stream recovered: first frame sent %ums after disconnect (reconnected after %ums)",
+             _stats.lastRecoveryMs, _reconnectedAt - disconnectedAt);
+}
+
 void Streamer::loop() {
     _updateLED();
     
-    uint32_t now = millis();
-    if (_frameDelayMs > 0 && (now - _lastFrameTime < _frameDelayMs)) {
-        vTaskDelay(pdMS_TO_TICKS(1));
+    if (_config.maxFPS > 0 && !_pacerStarted) {
+        // Bound to whichever task drives loop(): the capture task or Arduino loop()
+        _pacerStarted = true;
+        if (!_pacer.start(_config.maxFPS, xTaskGetCurrentTaskHandle())) {
+            ESP_LOGE(TAG, "Frame pacer unavailable, capturing at sensor rate");
+        }
+    }
+
+    if (_pacer.isRunning() && !_pacer.wait(pdMS_TO_TICKS(PACER_WAIT_MS))) {
+        return;
+    }
+
+    uint32_t controlRequested = _controlRequested.load();
+    _applyControl();
+
+    if (_applyPendingFrameSize()) {
+        vTaskDelay(pdMS_TO_TICKS(IDLE_POLL_MS));
         return;
     }
+    _controlApplied = controlRequested;
+
+    uint32_t now = millis();
 
     if (_state ==     State::IDLE || _state == State::ERROR) {
-        if (now - _lastReconnectAttempt >= (long)_currentReconnectInterval) {
+        if (_retryNow.exchange(false) || now - _lastReconnectAttempt >= (long)_currentReconnectInterval) {
             _attemptReconnect();
-            _currentReconnectInterval = std::min(_config.maxReconnectInterval,
-                                            (uint32_t)(_currentReconnectInterval * _config.reconnectMultiplier));
+            if (_state != State::STREAMING) {
+                _currentReconnectInterval = std::min(_config.maxReconnectInterval,
+                                                (uint32_t)(_currentReconnectInterval * _config.reconnectMultiplier));
+            }
+        } else if (_sinksWantFrames() || (_backlog && _backlog->isDue())) {
+            // Keep local viewers fed and the backlog recording while the push stream is down
+            if (_backlog) {
+                _beginOutage();
+            }
+            camera_fb_t* fb = _frames.get_frame();
+            if (fb) {
+                _framesCaptured++;
+                _publishToSinks(fb);
+                if (_backlog) {
+                    _backlog->record(fb);
+                }
+                _frames.return_frame(fb);
+            }
+        } else if (!_pacer.isRunning()) {
+            vTaskDelay(pdMS_TO_TICKS(IDLE_POLL_MS));
         }
         return;
     }
 
     if (!_transport->isConnected()) {
+        _markDisconnected();
         _state =     State::IDLE;
         _updateLED();
         _notifyDisconnected();
         return;
     }
 
-    camera_fb_t* fb = _cameraModule->get_frame();
+    _feedBacklog();
+
+    camera_fb_t* fb = _frames.get_frame();
     if (fb) {
-        char headerBuf[256];
-        size_t headerLen = 0;
+        int64_t captureStart = esp_timer_get_time();
+        _framesCaptured++;
 
         if (!_transport) {
             ESP_LOGW(TAG, "Transport not available");
-            _cameraModule->return_frame(fb);
+            _frames.return_frame(fb);
             return;
         }
 
-        esp_http_client_handle_t client = _transport->getHttpClient();
-        if (!client) {
-            ESP_LOGW(TAG, "HTTP client not available");
-            _cameraModule->return_frame(fb);
-            return;
-        }
+        _publishToSinks(fb);
+        bool snapshot = _snapshotFramesLeft > 0;
+        _countSnapshotFrame();
 
-        HttpStreamTransport* httpTransport = static_cast<HttpStreamTransport*>(_transport);
-        httpTransport->formatMultipartHeader(fb, headerBuf, sizeof(headerBuf), &headerLen);
+        FrameSlot* slot = nullptr;
+        if (_paused) {
+            // The connection stays open so the server can resume
+            _frames.return_frame(fb);
+        } else if (_sceneDetector && !_sceneDetector->shouldSend(fb) && !snapshot) {
+            // Local viewers above still got it
+            _frames.return_frame(fb);
+        } else if ((slot = _taskSender->acquireSlot()) != nullptr) {
+            slot->headerLen = _transport->formatFrameHeader(fb, slot->header, sizeof(slot->header));
 
-        if (_taskSender->sendFrame(fb, headerBuf, headerLen)) {
-            _totalBytesSent += fb->len;
-            _totalFramesSent++;
-            _currentFPS++;
-            _notifyFrameSent(fb->len);
-            _lastFrameTime = millis();
+            if (_taskSender->commitFrame(slot, fb)) {
+                _totalBytesSent += fb->len;
+                _totalFramesSent++;
+                _currentFPS++;
+                _captureTimeUs += (uint64_t)(esp_timer_get_time() - captureStart);
+                _notifyFrameSent(fb->len);
+            }
         } else {
             ESP_LOGW(TAG, "Queue full, dropping frame");
-            _cameraModule->return_frame(fb);
+            _frames.return_frame(fb);
         }
     } else {
         ESP_LOGE(TAG, "Failed to get frame for streaming.");
     }
 
+    if (!_firstFrameSent && _taskSender && _taskSender->getFramesSent() > 0) {
+        _firstFrameSent = true;
+        BootProfiler::finish("first frame sent");
+    }
+
+    _checkRecovered();
     _updateMetrics();
 }
 
@@ -192,12 +913,250 @@ void Streamer::_updateMetrics() {
     if (elapsed >= (long)_config.metricsUpdateInterval) {
         uint32_t fps = _currentFPS;
         ESP_LOGI(TAG, "FPS: %u, Bytes: %llu", fps, _totalBytesSent);
+        _updateStats(elapsed);
+        if (_config.latencyLogInterval > 0 && now - _lastLatencyLog >= (long)_config.latencyLogInterval) {
+            _logLatency();
+            _logScene();
+            _lastLatencyLog = now;
+        }
         _notifyMetricsUpdate();
         _currentFPS = 0;
         _lastMetricsUpdate = now;
     }
 }
 
+void Streamer::_updateStats(long elapsedMs) {
+    uint32_t framesSent = _taskSender ? _taskSender->getFramesSent() : 0;
+    uint64_t bytesSent = _taskSender ? _taskSender->getBytesSent() : 0;
+    uint64_t sendTimeUs = _taskSender ? _taskSender->getSendTimeUs() : 0;
+
+    // The sender is recreated with fresh counters on transport re-init
+    if (framesSent < _statsFramesSent) {
+        _statsFramesSent = 0;
+        _statsBytesSent = 0;
+        _statsSendTimeUs = 0;
+    }
+
+    uint32_t sentDelta = framesSent - _statsFramesSent;
+    uint32_t queuedDelta = _totalFramesSent - _statsFramesQueued;
+
+    _stats.framesPerSecond = (uint32_t)((uint64_t)sentDelta * 1000 / elapsedMs);
+    _stats.bytesPerSecond = (uint32_t)((bytesSent - _statsBytesSent) * 1000 / elapsedMs);
+    _stats.sendUsPerFrame = sentDelta ? (uint32_t)((sendTimeUs - _statsSendTimeUs) / sentDelta) : 0;
+    _stats.captureUsPerFrame = queuedDelta ? (uint32_t)((_captureTimeUs - _statsCaptureTimeUs) / queuedDelta) : 0;
+    _stats.framesDropped = 0;
+    for (size_t i = 0; i < (size_t)DropReason::COUNT; i++) {
+        uint32_t drops = _taskSender ? _taskSender->getDropCount((DropReason)i) : 0;
+        if (drops < _statsDrops[i]) {
+            _statsDrops[i] = 0;
+        }
+        _framesDropped[i] += drops - _statsDrops[i];
+        _statsDrops[i] = drops;
+
+        _stats.framesDroppedBy[i] = _framesDropped[i];
+        _stats.framesDropped += _framesDropped[i];
+    }
+    _stats.queueCount = getQueueCount();
+
+    _statsFramesSent = framesSent;
+    _statsBytesSent = bytesSent;
+    _statsSendTimeUs = sendTimeUs;
+    _statsFramesQueued = _totalFramesSent;
+    _statsCaptureTimeUs = _captureTimeUs;
+
+    if (_coreLoad) {
+        _coreLoad->sample(_stats.coreLoad);
+        _logCoreLoad();
+    }
+
+    if (_qualityController && _state == State::STREAMING) {
+        _qualityController->update(_stats, _taskSender ? _taskSender->getQueueLimit() : _config.taskQueueSize);
+    }
+
+#if CORE_DEBUG_LEVEL >= 4
+    // Only worth formatting when debug logging is compiled in
+    char json[1024];
+    formatStatsJson(json, sizeof(json));
+    ESP_LOGD(TAG, "%s", json);
+#endif
+}
+
+void Streamer::_logLatency() {
+    if (!_taskSender) {
+        return;
+    }
+
+    LatencySnapshot capture, queue, write, total;
+    _taskSender->getLatencySnapshot(LatencyStage::CAPTURE, capture);
+    _taskSender->getLatencySnapshot(LatencyStage::QUEUE, queue);
+    _taskSender->getLatencySnapshot(LatencyStage::WRITE, write);
+    _taskSender->getLatencySnapshot(LatencyStage::TOTAL, total);
+
+    ESP_LOGI(TAG, "Latency p50/p99 us (n=%u): capture %u/%u, queue %u/%u, write %u/%u, total %u/%u (max %u)",
+             write.count, capture.p50Us, capture.p99Us, queue.p50Us, queue.p99Us,
+             write.p50Us, write.p99Us, total.p50Us, total.p99Us, total.maxUs);
+
+    _taskSender->resetLatency();
+
+    if (_pacer.isRunning()) {
+        LatencySnapshot jitter;
+        _pacer.getJitterSnapshot(jitter);
+        ESP_LOGI(TAG, "Pacing %.3f FPS, wake-up jitter p50/p99 us: %u/%u (max %u), missed ticks: %u",
+                 _pacer.getRate(), jitter.p50Us, jitter.p99Us, jitter.maxUs, _pacer.getMissedTicks());
+        _pacer.resetJitter();
+    }
+}
+
+void Streamer::_logScene() {
+    if (!_sceneDetector) {
+        return;
+    }
+
+    const SceneChangeStats& s = _sceneDetector->getStats();
+    ESP_LOGI(TAG, "Scene gating: %u of %u frames skipped, %u keep-alives, %u thumbnails decoded, "
+             "check %u us/frame, decode %u us",
+             s.framesSkipped, s.framesChecked, s.keepAlives, s.thumbnailsDecoded, s.usPerFrame, s.decodeUs);
+}
+
+void Streamer::_logCoreLoad() {
+    ESP_LOGI(TAG, "Core load: core0 %u%%, core1 %u%% at %u FPS (send: core %d prio %u, capture: core %d prio %u)",
+             _stats.coreLoad[0], _stats.coreLoad[CoreLoadMonitor::CORES - 1],
+             _stats.framesPerSecond, _config.taskCore, _config.taskPriority,
+             _config.captureTask ? _config.captureTaskCore : -1, _config.captureTaskPriority);
+}
+
+bool Streamer::getLatencySnapshot(LatencyStage stage, LatencySnapshot& out) const {
+    if (!_taskSender) {
+        return false;
+    }
+    _taskSender->getLatencySnapshot(stage, out);
+    return true;
+}
+
+void Streamer::getCounters(StreamCounters& out) const {
+    out = {};
+    out.framesCaptured = _framesCaptured.load();
+    out.framesQueued = _totalFramesSent;
+    out.reconnects = _reconnects.load();
+    out.connectFailures = _connectFailures.load();
+    out.sendErrors = _sendErrors.load();
+    out.connected = _state == State::STREAMING;
+    out.paused = _paused.load();
+
+    if (_taskSender) {
+        out.framesSent = _taskSender->getFramesSent();
+        out.bytesSent = _taskSender->getBytesSent();
+        out.sendTimeUs = _taskSender->getSendTimeUs();
+        for (size_t i = 0; i < (size_t)DropReason::COUNT; i++) {
+            out.framesDroppedBy[i] = _taskSender->getDropCount((DropReason)i);
+        }
+        out.queueDepth = _taskSender->getQueueCount();
+        out.queueLimit = _taskSender->getQueueLimit();
+    }
+}
+
+const LatencyHistogram* Streamer::getSendHistogram() const {
+    return _taskSender ? &_taskSender->getSendHistogram() : nullptr;
+}
+
+const QualityControllerStats* Streamer::getQualityStats() const {
+    return _qualityController ? &_qualityController->getStats() : nullptr;
+}
+
+const SceneChangeStats* Streamer::getSceneStats() const {
+    return _sceneDetector ? &_sceneDetector->getStats() : nullptr;
+}
+
+bool Streamer::getBacklogStats(BacklogStats& out) const {
+    if (!_backlog) {
+        return false;
+    }
+    out = _backlog->getStats();
+    return true;
+}
+
+bool Streamer::getCoreLoad(uint8_t out[CoreLoadMonitor::CORES]) const {
+    if (!_coreLoad) {
+        return false;
+    }
+    memcpy(out, _stats.coreLoad, sizeof(_stats.coreLoad));
+    return true;
+}
+
+size_t Streamer::formatStatsJson(char* buf, size_t bufSize) const {
+    int len = snprintf(buf, bufSize,
+                       "{\"fps\":%u,\"bytes_per_s\":%u,\"capture_us\":%u,\"send_us\":%u,"
+                       "\"dropped\":%u,\"dropped_full\":%u,\"dropped_evicted\":%u,\"dropped_stale\":%u,"
+                       "\"dropped_offline\":%u,\"queue\":%u,\"recovery_ms\":%u,\"paused\":%s",
+                       _stats.framesPerSecond, _stats.bytesPerSecond, _stats.captureUsPerFrame,
+                       _stats.sendUsPerFrame, _stats.framesDropped,
+                       _stats.framesDroppedBy[(size_t)DropReason::QUEUE_FULL],
+                       _stats.framesDroppedBy[(size_t)DropReason::EVICTED],
+                       _stats.framesDroppedBy[(size_t)DropReason::STALE],
+                       _stats.framesDroppedBy[(size_t)DropReason::DISCONNECTED],
+                       _stats.queueCount, _stats.lastRecoveryMs, _paused ? "true" : "false");
+    if (len < 0) {
+        return 0;
+    }
+
+    if (_qualityController && (size_t)len < bufSize) {
+        const QualityControllerStats& q = _qualityController->getStats();
+        int extra = snprintf(buf + len, bufSize - len,
+                             ",\"quality\":%d,\"framesize\":%d,\"decision\":\"%s\"",
+                             q.quality, q.frameSize, q.lastDecision);
+        if (extra > 0) {
+            len += extra;
+        }
+    }
+
+    if (_sceneDetector && (size_t)len < bufSize) {
+        const SceneChangeStats& s = _sceneDetector->getStats();
+        int extra = snprintf(buf + len, bufSize - len,
+                             ",\"scene_skipped\":%u,\"scene_keepalive\":%u,\"scene_saved_bytes\":%llu,\"scene_us\":%u,"
+                             "\"scene_decode_us\":%u",
+                             s.framesSkipped, s.keepAlives, s.bytesSaved, s.usPerFrame, s.decodeUs);
+        if (extra > 0) {
+            len += extra;
+        }
+    }
+
+    if (_backlog && (size_t)len < bufSize) {
+        BacklogStats b = _backlog->getStats();
+        int extra = snprintf(buf + len, bufSize - len,
+                             ",\"backlog_bytes\":%u,\"backlog_recorded\":%u,\"backlog_uploaded\":%u,"
+                             "\"backlog_skipped\":%u,\"backlog_evicted_segments\":%u",
+                             b.pendingBytes, b.recorded, b.uploaded, b.skipped, b.evictedSegments);
+        if (extra > 0) {
+            len += extra;
+        }
+    }
+
+    if (_cameraModule && (size_t)len < bufSize) {
+        const FrameBufferPlan& fb = _cameraModule->get_plan();
+        int extra = snprintf(buf + len, bufSize - len,
+                             ",\"fb_count\":%u,\"fb_depth\":%u,\"fb_bytes\":%u,\"fb_psram\":%s,\"fb_headroom\":%u,\"fb_plan\":\"%s\"",
+                             fb.fbCount, fb.pipelineDepth, fb.fbBytes, fb.location == CAMERA_FB_IN_PSRAM ? "true" : "false",
+                             fb.headroomBytes, fb.reason ? fb.reason : "");
+        if (extra > 0) {
+            len += extra;
+        }
+    }
+
+    if (_coreLoad && (size_t)len < bufSize) {
+        int extra = snprintf(buf + len, bufSize - len, ",\"cpu\":[%u,%u]",
+                             _stats.coreLoad[0], _stats.coreLoad[CoreLoadMonitor::CORES - 1]);
+        if (extra > 0) {
+            len += extra;
+        }
+    }
+
+    if ((size_t)len < bufSize - 1) {
+        buf[len++] = '}';
+        buf[len] = '\0';
+    }
+    return std::min((size_t)len, bufSize - 1);
+}
+
 void Streamer::_handleStreamError(const char* error) {
     ESP_LOGE(TAG, "STREAM: %s", error);
     _state = State::ERROR;
@@ -212,7 +1171,11 @@ void Streamer::_handleStreamError(const char* error) {
     
     _updateLED();
     
-    if (_reconnectFailureCount >= _config.maxSendFailures) {
+    if (_reconnectFailureCount >= _config.maxSendFailures && _backlog && _everConnected) {
+        // The settings worked before: this is an outage, not a misconfiguration
+        ESP_LOGW(TAG, "Server still unreachable, staying online and recording to the backlog");
+        _reconnectFailureCount = 0;
+    } else if (_reconnectFailureCount >= _config.maxSendFailures) {
         ESP_LOGW(TAG, "Maximum reconnect failures reached (%u). Setting force captive portal flag and restarting...",
                  _reconnectFailureCount);
 
@@ -230,6 +1193,10 @@ void Streamer::_handleStreamError(const char* error) {
 
 void Streamer::_handleSendError(const char* error) {
     ESP_LOGE(TAG, "STREAM: Send error - %s", error);
+    _sendErrors++;
+    if (_state == State::STREAMING) {
+        _markDisconnected();
+    }
     _state = State::ERROR;
     _transport->disconnect();
     _notifyError(error);
@@ -9,6 +9,45 @@
 #include "StreamConfig.h"
 #include "StreamerEvents.h"
 #include "TaskSender.h"
+#include "QualityController.h"
+#include "SceneChangeDetector.h"
+#include "BacklogStore.h"
+#include "SharedFrameSource.h"
+#include "FrameSink.h"
+#include "CoreLoadMonitor.h"
+#include "FramePacer.h"
+
+struct StreamStats {
+    uint32_t framesPerSecond;     // frames written to the transport
+    uint32_t bytesPerSecond;
+    uint32_t captureUsPerFrame;   // capture-side work: header + enqueue
+    uint32_t sendUsPerFrame;      // sender-side transport write
+    uint32_t framesDropped;       // all reasons, cumulative
+    uint32_t framesDroppedBy[(size_t)DropReason::COUNT];
+    uint32_t queueCount;
+    uint32_t lastRecoveryMs;      // last connection drop -> first frame sent on the new connection
+    uint8_t coreLoad[CoreLoadMonitor::CORES];   // percent busy, only with reportCoreLoad
+};
+
+// Cumulative counters for scraping (see MetricsExporter). Filled from
+// atomics and word-sized fields only, so reading them never blocks the
+// capture or send task. Sender counters restart when the transport is
+// re-created.
+struct StreamCounters {
+    uint32_t framesCaptured;      // taken from the frame source, streaming or not
+    uint32_t framesQueued;
+    uint32_t framesSent;
+    uint64_t bytesSent;
+    uint64_t sendTimeUs;          // sum of transport write time of the frames sent
+    uint32_t framesDroppedBy[(size_t)DropReason::COUNT];
+    uint32_t queueDepth;
+    uint32_t queueLimit;
+    uint32_t reconnects;          // successful connects after the first
+    uint32_t connectFailures;
+    uint32_t sendErrors;
+    bool connected;
+    bool paused;
+};
 
 class Streamer : public StreamerEvents {
 public:
@@ -19,20 +58,99 @@ public:
         ERROR
     };
 
-    Streamer(const char* stream_url, const char* frame_size_str, const char* jpeg_quality_str);
+    // config replaces the built-in defaults, e.g. for the host benchmark
+    Streamer(const char* stream_url, const char* frame_size_str, const char* jpeg_quality_str,
+             const StreamConfig& config = StreamConfig());
     ~Streamer();
     
+    // Starts camera init and sensor warm-up in a task pinned to core, so it
+    // overlaps WiFi association and the first server connect. setup() then
+    // connects first and waits for the camera afterwards.
+    bool beginCameraInit(int core);
+
     void setup();
     void loop();
+    // True when setup() started the capture task (StreamConfig::captureTask);
+    // loop() must not be called from elsewhere then.
+    bool hasCaptureTask() const { return _captureTask != nullptr; }
     esp_http_client_handle_t get_stream_client();
     
     void setEventsHandler(StreamerEvents* handler);
+
+    // Replaces the camera as the frame producer (e.g. a replayed JPEG
+    // sequence). Must be called before setup().
+    void setFrameSource(FrameSource* source);
+
+    // Local consumers that receive every captured frame by reference
+    // (see FrameSink). Frames keep flowing to sinks while the push stream
+    // is disconnected. Must be called before setup(): the capture task
+    // reads the sink list without a lock, so a sink that is not ready yet
+    // is registered anyway and returns false from wantsFrames() until it is.
+    // The frames a sink may hold are added to the frame buffer pool, so
+    // sinks must also be added before beginCameraInit().
+    bool addFrameSink(FrameSink* sink);
+
+    // Selects the transport implementation. Must be called before setup().
+    void setTransportType(StreamTransportType type);
+    // Selects fixed-length or chunked uploads. Must be called before setup().
+    void setUploadMode(UploadMode mode);
+    bool isStreaming() const { return _state == State::STREAMING; }
+
+    // Changes the capture frame size. Sizes within the current frame buffer
+    // pool apply at once; larger ones re-plan the pool, which happens on the
+    // capture task once every frame in flight has been returned.
+    bool setFrameSize(framesize_t frameSize);
+
+    // Applies a JSON control message, e.g. from the WebSocket return channel
+    // or POST /control:
+    //   {"quality":12}         JPEG quality 0-63
+    //   {"framesize":"SVGA"}   frame size by name, as in the settings
+    //   {"fps":15}             capture rate limit 0-60, 0 = unpaced
+    //   {"pause":true}         stop uploading, keep the connection and sinks
+    //   {"snapshot":true}      next frames at snapshotQuality, then back
+    //   {"persist":true}       also save quality, framesize and fps to NVS
+    // Keys may be combined. Safe from any task: changes are queued and made
+    // on the capture task, which also persists them once they are in effect
+    // (a re-planned frame size after the camera re-init succeeded). On
+    // failure error (if given) says why.
+    bool applyControl(const char* json, size_t len, char* error = nullptr, size_t errorSize = 0);
+    // Blocks until the capture task has made every change queued so far,
+    // including a frame buffer pool re-plan. False on timeout.
+    bool waitControlApplied(uint32_t timeoutMs);
+    bool isPaused() const { return _paused.load(); }
+    // Capture rate limit, e.g. one saved by a control message. Must be called before setup().
+    void setMaxFPS(float fps);
+    // Current settings as {"quality":..,"framesize":..,"fps":..,"paused":..}
+    size_t formatControlJson(char* buf, size_t bufSize) const;
+
+    const StreamStats& getStats() const { return _stats; }
+    size_t formatStatsJson(char* buf, size_t bufSize) const;
+
+    // nullptr unless StreamConfig::adaptiveQuality is enabled
+    const QualityControllerStats* getQualityStats() const;
+    // nullptr unless StreamConfig::sceneGating is enabled
+    const SceneChangeStats* getSceneStats() const;
+    // False unless StreamConfig::backlog is enabled and the store came up
+    bool getBacklogStats(BacklogStats& out) const;
+    // Frame buffer pool of the last FrameBufferPlanner plan
+    const FrameBufferPlan& getFrameBufferPlan() const { return _cameraModule->get_plan(); }
+    // Percent busy per core over the last metrics interval; false unless
+    // StreamConfig::reportCoreLoad is enabled
+    bool getCoreLoad(uint8_t out[CoreLoadMonitor::CORES]) const;
+
+    // Per-stage latency over the current latencyLogInterval window
+    bool getLatencySnapshot(LatencyStage stage, LatencySnapshot& out) const;
+
+    void getCounters(StreamCounters& out) const;
+    // Transport write time of every frame sent, never reset; nullptr without a sender
+    const LatencyHistogram* getSendHistogram() const;
     
     uint32_t getCurrentFPS() const;
     uint64_t getBytesSent() const;
     uint32_t getFramesSent() const;
     uint32_t getQueueCount() const;
     void onSendError(const char* message) override;
+    void onControlMessage(const char* message, size_t len) override;
 
 private:
     StreamConfig _config;
@@ -41,23 +159,78 @@ private:
     char _jpeg_quality_str[4];
     
     CameraModule* _cameraModule;
+    SharedFrameSource _frames;
+    FrameSink* _sinks[4] = {};
+    size_t _sinkCount = 0;
+    size_t _sinkFrames = 0;
     StreamTransport* _transport;
     StreamerEvents* _eventsHandler;
     TaskSender* _taskSender;
+    QualityController* _qualityController;
+    SceneChangeDetector* _sceneDetector = nullptr;
+    BacklogStore* _backlog = nullptr;
+    CoreLoadMonitor* _coreLoad = nullptr;
+    TaskHandle_t _captureTask = nullptr;
+    SemaphoreHandle_t _cameraReady = nullptr;
     
     State _state;
     long _lastReconnectAttempt;
     uint32_t _currentReconnectInterval;
     long _lastMetricsUpdate;
-    uint32_t _lastFrameTime;
-    uint32_t _frameDelayMs;
+    long _lastLatencyLog = 0;
+    FramePacer _pacer;
+    bool _pacerStarted = false;
 
     uint32_t _currentFPS;
     uint64_t _totalBytesSent;
     uint32_t _totalFramesSent;
+
+    StreamStats _stats = {};
+    uint32_t _framesDropped[(size_t)DropReason::COUNT] = {};
+    uint32_t _statsDrops[(size_t)DropReason::COUNT] = {};
+    uint64_t _captureTimeUs = 0;
+    uint32_t _statsFramesQueued = 0;
+    uint64_t _statsCaptureTimeUs = 0;
+    uint32_t _statsFramesSent = 0;
+    uint64_t _statsBytesSent = 0;
+    uint64_t _statsSendTimeUs = 0;
     
     uint32_t _reconnectFailureCount = 0;
+    std::atomic<bool> _retryNow{false};
+    std::atomic<bool> _recovering{false};
+    std::atomic<uint32_t> _disconnectedAt{0};
+    uint32_t _reconnectedAt = 0;
+    uint32_t _framesAtReconnect = 0;
+    bool _firstFrameSent = false;
+    std::atomic<int> _pendingFrameSize{-1};
+    std::atomic<int> _requestedFrameSize{-1};
+    std::atomic<int> _requestedQuality{-1};
+    std::atomic<float> _requestedFPS{-1.0f};
+    // Values a {"persist":true} message asked to save, and a re-planned frame size waiting for its re-init
+    std::atomic<int> _persistFrameSize{-1};
+    std::atomic<int> _persistQuality{-1};
+    std::atomic<float> _persistFPS{-1.0f};
+    int _persistPendingFrameSize = -1;
+    // applyControl() calls so far, and how many of them loop() has finished
+    std::atomic<uint32_t> _controlRequested{0};
+    std::atomic<uint32_t> _controlApplied{0};
+    std::atomic<bool> _snapshotRequested{false};
+    std::atomic<bool> _paused{false};
+    std::atomic<uint32_t> _framesCaptured{0};
+    std::atomic<uint32_t> _reconnects{0};
+    std::atomic<uint32_t> _connectFailures{0};
+    std::atomic<uint32_t> _sendErrors{0};
+    int _snapshotRestoreQuality = -1;
+    uint32_t _snapshotFramesLeft = 0;
     bool _isInCaptivePortal = false;
+    bool _everConnected = false;
+
+    // Outage recording for the backlog, settings to restore on reconnect
+    bool _outage = false;
+    int _outageRestoreQuality = -1;
+    int _outageRestoreFrameSize = -1;
+    uint32_t _backlogIntervalMs = 0;
+    uint32_t _lastBacklogSentMs = 0;
 
     uint32_t _lastLedUpdate = 0;
     bool _ledState = false;
@@ -69,11 +242,38 @@ private:
     static const uint32_t LED_BLINK_IDLE = 1000;
     static const uint32_t LED_BLINK_ERROR = 100;
     static const uint32_t LED_BLINK_CAPTIVE = 200;
+    static const uint32_t IDLE_POLL_MS = 10;
+    static const uint32_t PACER_WAIT_MS = 1000;
+    static const uint32_t CONTROL_POLL_MS = 5;
+    static const uint32_t CAMERA_WARMUP_FRAMES = 5;
     
+    static void _cameraInitTaskWrapper(void* parameter);
+    void _initCamera();
+    bool _applyPendingFrameSize();
+    void _applyControl();
+    void _persistControl(int frameSize, int quality, float fps);
+    void _saveStreamSettings(int frameSize, int quality, float fps);
+    void _countSnapshotFrame();
+    void _startBacklog();
+    void _beginOutage();
+    void _endOutage();
+    void _feedBacklog();
+    static void _captureTaskWrapper(void* parameter);
+    bool _startCaptureTask();
+    void _logCoreLoad();
     void _initializeTransport();
     void _cleanupTransport();
     void _attemptReconnect();
+    void _markDisconnected();
+    void _checkRecovered();
     void _updateMetrics();
+    void _updateStats(long elapsedMs);
+    void _logLatency();
+    void _logScene();
+    void _publishToSinks(camera_fb_t* fb);
+    bool _sinksWantFrames() const;
+    size_t _senderDepth() const;
+    void _applyFrameBudget();
     void _handleStreamError(const char* error);
     void _handleSendError(const char* error);
     void _updateLED();
@@ -13,6 +13,8 @@ public:
     virtual void onFrameSent(size_t size) {}
     virtual void onMetricsUpdate(uint32_t fps, uint64_t bytesSent) {}
     virtual void onSendError(const char* message) {}
+    // Text message from the server; called on the transport's reader task
+    virtual void onControlMessage(const char* message, size_t len) {}
 };
 
 #endif
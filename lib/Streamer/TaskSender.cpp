@@ -1,21 +1,30 @@
 #include "TaskSender.h"
 #include "StreamerEvents.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
 #include <cstring>
 
 const char* TaskSender::TAG = "TaskSender";
 
-TaskSender::TaskSender(StreamTransport* transport, const StreamConfig& config)
+TaskSender::TaskSender(StreamTransport* transport, FrameSource* source, const StreamConfig& config)
     : _transport(transport),
+      _source(source),
       _config(config),
       _taskHandle(nullptr),
-      _queue(nullptr),
+      _queueDepth(0),
+      _queueLimit(0),
+      _frameBudget(SIZE_MAX),
       _isRunning(false),
       _taskEnded(false),
       _bytesSent(0),
       _framesSent(0),
+      _sendTimeUs(0),
       _sendFailureCount(0)
 {
+    for (size_t i = 0; i < (size_t)DropReason::COUNT; i++) {
+        _drops[i].store(0);
+    }
 }
 
 TaskSender::~TaskSender() {
@@ -23,31 +32,43 @@ TaskSender::~TaskSender() {
 }
 
 bool TaskSender::start() {
-    _queue = xQueueCreate(_config.taskQueueSize, sizeof(FrameChunk));
-    if (!_queue) {
-        ESP_LOGE(TAG, "Failed to create queue");
+    _queueDepth = _config.taskQueueSize;
+    if (_config.dropPolicy == FrameDropPolicy::KEEP_LATEST && _config.keepLatestCount < _queueDepth) {
+        _queueDepth = _config.keepLatestCount;
+    }
+    if (_queueDepth == 0) {
+        _queueDepth = 1;
+    }
+    setFrameBudget(_frameBudget);
+
+    if (!_ring.init(_queueDepth)) {
+        ESP_LOGE(TAG, "Failed to allocate frame ring");
         return false;
     }
 
-    BaseType_t result = xTaskCreate(
+    _taskEnded = false;
+    _isRunning = true;
+
+    BaseType_t result = xTaskCreatePinnedToCore(
         TaskSender::taskWrapper,
         "TaskSender",
         _config.taskStackDepth,
         this,
         _config.taskPriority,
-        &_taskHandle
+        &_taskHandle,
+        _config.taskCore < 0 ? tskNO_AFFINITY : _config.taskCore
     );
 
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create task");
-        vQueueDelete(_queue);
-        _queue = nullptr;
+        _isRunning = false;
+        _ring.release();
         return false;
     }
 
-    _isRunning = true;
-    ESP_LOGI(TAG, "TaskSender started (queue: %u, stack: %u, priority: %u)",
-             _config.taskQueueSize, _config.taskStackDepth, _config.taskPriority);
+    ESP_LOGI(TAG, "TaskSender started (queue: %u, policy: %d, max age: %ums, stack: %u, priority: %u, core: %d)",
+             _queueLimit.load(), (int)_config.dropPolicy, _config.maxFrameAgeMs,
+             _config.taskStackDepth, _config.taskPriority, _config.taskCore);
     return true;
 }
 
@@ -58,6 +79,10 @@ void TaskSender::stop() {
 
     _isRunning = false;
 
+    if (_taskHandle) {
+        xTaskNotifyGive(_taskHandle);
+    }
+
     vTaskDelay(pdMS_TO_TICKS(200));
 
     if (_taskHandle) {
@@ -78,47 +103,93 @@ void TaskSender::stop() {
         _taskHandle = nullptr;
     }
 
-    if (_queue) {
-        FrameChunk chunk;
-        while (uxQueueMessagesWaiting(_queue) > 0) {
-            if (xQueueReceive(_queue, &chunk, 0) == pdPASS) {
-                if (chunk.fb) {
-                    esp_camera_fb_return(chunk.fb);
-                }
-            }
+    FrameSlot* slot;
+    while ((slot = _ring.pop()) != nullptr) {
+        if (slot->fb) {
+            _source->return_frame(slot->fb);
+            slot->fb = nullptr;
         }
-        vQueueDelete(_queue);
-        _queue = nullptr;
+        _ring.done(slot);
     }
+    _ring.release();
 
     ESP_LOGI(TAG, "TaskSender stopped (sent: %llu bytes, %u frames)",
              _bytesSent.load(), _framesSent.load());
 }
 
-bool TaskSender::sendFrame(camera_fb_t* fb, const char* header, size_t headerLen) {
-    if (!_isRunning || !_queue || !fb) {
-        return false;
+FrameSlot* TaskSender::acquireSlot() {
+    if (!_isRunning) {
+        return nullptr;
     }
 
-    if (headerLen > 255) {
-        ESP_LOGE(TAG, "Header too large: %u", headerLen);
-        esp_camera_fb_return(fb);
-        return false;
+    size_t limit = _queueLimit.load();
+    FrameSlot* slot = _ring.acquire(limit);
+    if (!slot && _config.dropPolicy != FrameDropPolicy::DROP_NEWEST) {
+        camera_fb_t* oldest = nullptr;
+        if (_ring.evict(oldest)) {
+            if (oldest) {
+                _source->return_frame(oldest);
+            }
+            _drops[(size_t)DropReason::EVICTED]++;
+        }
+        // Retry even if the send task took the oldest frame first
+        slot = _ring.acquire(limit);
+    }
+
+    if (!slot) {
+        _drops[(size_t)DropReason::QUEUE_FULL]++;
     }
+    return slot;
+}
 
-    FrameChunk chunk;
-    chunk.fb = fb;
-    chunk.headerLen = headerLen;
-    chunk.timestamp = millis();
-    memcpy(chunk.header, header, headerLen);
+size_t TaskSender::flush() {
+    size_t flushed = 0;
+    camera_fb_t* oldest = nullptr;
+    // Stops early if the send task claims the oldest frame first; that one goes out
+    while (_ring.evict(oldest)) {
+        if (oldest) {
+            _source->return_frame(oldest);
+        }
+        _drops[(size_t)DropReason::EVICTED]++;
+        flushed++;
+    }
+    return flushed;
+}
 
-    BaseType_t result = xQueueSend(_queue, &chunk, pdMS_TO_TICKS(10));
-    if (result != pdPASS) {
-        ESP_LOGW(TAG, "Queue full, dropping frame");
-        esp_camera_fb_return(fb);
+void TaskSender::setFrameBudget(size_t frames) {
+    _frameBudget = frames;
+    if (_queueDepth == 0) {
+        // Applied by start()
+        return;
+    }
+
+    size_t limit = std::max<size_t>(std::min(_queueDepth, frames), 1);
+    if (limit != _queueLimit.load()) {
+        if (limit < _queueDepth) {
+            ESP_LOGI(TAG, "Send queue capped at %u frames by the frame buffer pool (configured %u)",
+                     limit, _queueDepth);
+        }
+        _queueLimit = limit;
+    }
+}
+
+bool TaskSender::commitFrame(FrameSlot* slot, camera_fb_t* fb) {
+    if (!_isRunning || !slot || !fb) {
         return false;
     }
 
+    if (slot->headerLen >= sizeof(slot->header)) {
+        ESP_LOGE(TAG, "Header too large: %u", slot->headerLen);
+        _source->return_frame(fb);
+        return false;
+    }
+
+    slot->fb = fb;
+    slot->trace.captureUs = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    slot->trace.enqueueUs = esp_timer_get_time();
+    _ring.commit();
+
+    xTaskNotifyGive(_taskHandle);
     return true;
 }
 
@@ -127,10 +198,7 @@ bool TaskSender::isRunning() const {
 }
 
 uint32_t TaskSender::getQueueCount() const {
-    if (!_queue) {
-        return 0;
-    }
-    return uxQueueMessagesWaiting(_queue);
+    return _ring.count();
 }
 
 uint64_t TaskSender::getBytesSent() const {
@@ -150,63 +218,118 @@ void TaskSender::taskFunction() {
     ESP_LOGI(TAG, "Send task started");
 
     while (_isRunning) {
-        FrameChunk chunk;
-
-        BaseType_t result = xQueueReceive(_queue, &chunk, pdMS_TO_TICKS(100));
-
-        if (result == pdPASS && _isRunning) {
-            bool success = true;
-
-            if (chunk.headerLen > 0) {
-                success = _transport->send((uint8_t*)chunk.header, chunk.headerLen);
-                if (!success) {
-                    uint32_t failCount = ++_sendFailureCount;
-                    uint32_t remaining = _config.maxSendFailures - failCount;
-                    if (failCount == 1) {
-                        ESP_LOGE(TAG, "Failed to send header");
-                    } else if (failCount <= _config.maxSendFailures) {
-                        ESP_LOGW(TAG, "Failed to send header (attempt %u/%u, %u remaining)",
-                                failCount, _config.maxSendFailures, remaining);
-                    }
-                    _notifySendError(_transport->getLastError());
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        FrameSlot* slot;
+        while (_isRunning && (slot = _ring.pop()) != nullptr) {
+            bool stale = _isStale(slot);
+            // Frames queued for a dropped connection would each fail and
+            // back off in turn, delaying the reconnect; release them at once
+            bool offline = !stale && !_transport->isConnected();
+            if (stale || offline) {
+                _drops[(size_t)(stale ? DropReason::STALE : DropReason::DISCONNECTED)]++;
+                if (slot->fb) {
+                    _source->return_frame(slot->fb);
+                    slot->fb = nullptr;
                 }
+            } else {
+                // Sent in place: the slot stays pinned until done()
+                _sendSlot(slot);
             }
+            _ring.done(slot);
+        }
+    }
 
-            if (success && chunk.fb) {
-                success = _transport->send(chunk.fb->buf, chunk.fb->len);
-                if (!success) {
-                    uint32_t failCount = ++_sendFailureCount;
-                    uint32_t remaining = _config.maxSendFailures - failCount;
-                    if (failCount == 1) {
-                        ESP_LOGE(TAG, "Failed to send frame data");
-                    } else if (failCount <= _config.maxSendFailures) {
-                        ESP_LOGW(TAG, "Failed to send frame data (attempt %u/%u, %u remaining)",
-                                failCount, _config.maxSendFailures, remaining);
-                    }
-                    _notifySendError(_transport->getLastError());
-                }
-            }
+    _taskEnded = true;
+    ESP_LOGI(TAG, "Send task ended");
 
-            if (success) {
-                _bytesSent += chunk.fb->len;
-                _framesSent++;
-                _sendFailureCount = 0;
-            }
+    // stop() deletes the task; a FreeRTOS task must never return.
+    vTaskSuspend(nullptr);
+}
 
-            if (chunk.fb) {
-                esp_camera_fb_return(chunk.fb);
-            }
+void TaskSender::_sendSlot(FrameSlot* slot) {
+    slot->trace.dequeueUs = esp_timer_get_time();
 
-            if (!success) {
-                vTaskDelay(pdMS_TO_TICKS(_config.sendErrorDelayMs));
-            } else if (_config.taskDelayMs > 0) {
-                vTaskDelay(pdMS_TO_TICKS(_config.taskDelayMs));
-            }
+    StreamIovec iov[2];
+    size_t iovCount = 0;
+
+    if (slot->headerLen > 0) {
+        iov[iovCount++] = { (const uint8_t*)slot->header, slot->headerLen };
+    }
+    if (slot->fb) {
+        iov[iovCount++] = { slot->fb->buf, slot->fb->len };
+    }
+
+    bool success = _transport->sendv(iov, iovCount);
+    slot->trace.writtenUs = esp_timer_get_time();
+    if (!success) {
+        uint32_t failCount = ++_sendFailureCount;
+        uint32_t remaining = _config.maxSendFailures - failCount;
+        if (failCount == 1) {
+            ESP_LOGE(TAG, "Failed to send frame");
+        } else if (failCount <= _config.maxSendFailures) {
+            ESP_LOGW(TAG, "Failed to send frame (attempt %u/%u, %u remaining)",
+                    failCount, _config.maxSendFailures, remaining);
         }
+        _notifySendError(_transport->getLastError());
     }
 
-    _taskEnded = true;
-    ESP_LOGI(TAG, "Send task ended");
+    if (success) {
+        _sendTimeUs += (uint64_t)(slot->trace.writtenUs - slot->trace.dequeueUs);
+        _recordLatency(slot->trace);
+        _framesSent++;
+        _sendFailureCount = 0;
+        if (slot->fb) {
+            _bytesSent += slot->fb->len;
+            _source->frame_sent(slot->fb);
+        }
+    }
+
+    if (slot->fb) {
+        _source->return_frame(slot->fb);
+        slot->fb = nullptr;
+    }
+
+    if (!success) {
+        vTaskDelay(pdMS_TO_TICKS(_config.sendErrorDelayMs));
+    } else if (_config.taskDelayMs > 0) {
+        vTaskDelay(pdMS_TO_TICKS(_config.taskDelayMs));
+    }
+}
+
+bool TaskSender::_isStale(const FrameSlot* slot) const {
+    if (_config.maxFrameAgeMs == 0) {
+        return false;
+    }
+
+    int64_t now = esp_timer_get_time();
+    // Fall back to the enqueue time for sources that do not stamp frames from esp_timer
+    int64_t born = (slot->trace.captureUs > 0 && slot->trace.captureUs <= now)
+                       ? slot->trace.captureUs
+                       : slot->trace.enqueueUs;
+    return now - born > (int64_t)_config.maxFrameAgeMs * 1000;
+}
+
+void TaskSender::_recordLatency(const FrameTrace& trace) {
+    _latency[(size_t)LatencyStage::QUEUE].record((uint32_t)(trace.dequeueUs - trace.enqueueUs));
+    _latency[(size_t)LatencyStage::WRITE].record((uint32_t)(trace.writtenUs - trace.dequeueUs));
+    _sendHistogram.record((uint32_t)(trace.writtenUs - trace.dequeueUs));
+
+    // Sources that do not stamp frames from esp_timer (e.g. replayed files) get no capture stages
+    if (trace.captureUs > 0 && trace.captureUs <= trace.enqueueUs) {
+        _latency[(size_t)LatencyStage::CAPTURE].record((uint32_t)(trace.enqueueUs - trace.captureUs));
+        _latency[(size_t)LatencyStage::TOTAL].record((uint32_t)(trace.writtenUs - trace.captureUs));
+    }
+}
+
+void TaskSender::getLatencySnapshot(LatencyStage stage, LatencySnapshot& out) const {
+    _latency[(size_t)stage].snapshot(out);
+}
+
+void TaskSender::resetLatency() {
+    for (size_t i = 0; i < (size_t)LatencyStage::COUNT; i++) {
+        _latency[i].reset();
+    }
 }
 
 void TaskSender::_notifySendError(const char* message) {
@@ -4,26 +4,50 @@
 #include "Arduino.h"
 #include "StreamTransport.h"
 #include "StreamConfig.h"
+#include "FrameRing.h"
+#include "FrameSource.h"
+#include "LatencyHistogram.h"
 #include "esp_camera.h"
 #include <atomic>
 
 class StreamerEvents;
 
-struct FrameChunk {
-    camera_fb_t* fb;
-    char header[256];
-    size_t headerLen;
-    uint32_t timestamp;
+enum class LatencyStage {
+    CAPTURE,    // sensor timestamp -> enqueued (capture-side work)
+    QUEUE,      // enqueued -> picked up by the send task
+    WRITE,      // picked up -> header and payload written to the transport
+    TOTAL,      // sensor timestamp -> on the wire
+    COUNT
+};
+
+enum class DropReason {
+    QUEUE_FULL,     // newest frame discarded, no free slot
+    EVICTED,        // oldest queued frame replaced by a newer one
+    STALE,          // older than maxFrameAgeMs when the send task reached it
+    DISCONNECTED,   // still queued when the connection dropped
+    COUNT
 };
 
 class TaskSender {
 public:
-    TaskSender(StreamTransport* transport, const StreamConfig& config);
+    TaskSender(StreamTransport* transport, FrameSource* source, const StreamConfig& config);
     ~TaskSender();
 
     bool start();
     void stop();
-    bool sendFrame(camera_fb_t* fb, const char* header, size_t headerLen);
+
+    // Returns the next free slot for the caller to format the part header
+    // into, applying the configured drop policy; nullptr means the new frame
+    // must be dropped. Never blocks. Must be followed by commitFrame().
+    FrameSlot* acquireSlot();
+    bool commitFrame(FrameSlot* slot, camera_fb_t* fb);
+    // Producer side: drops every queued frame (counted as EVICTED), e.g.
+    // frames captured before a settings change. Returns how many.
+    size_t flush();
+    // Caps the queue at the frame buffers the pipeline can hold, so the
+    // drop policy acts before the camera driver runs out of buffers.
+    // Never raises it above the configured depth; at least 1.
+    void setFrameBudget(size_t frames);
 
     void setEventsHandler(StreamerEvents* handler) { _eventsHandler = handler; }
 
@@ -31,25 +55,44 @@ public:
     uint32_t getQueueCount() const;
     uint64_t getBytesSent() const;
     uint32_t getFramesSent() const;
+    uint64_t getSendTimeUs() const { return _sendTimeUs.load(); }
+
+    void getLatencySnapshot(LatencyStage stage, LatencySnapshot& out) const;
+    void resetLatency();
+    // WRITE stage since start, not cleared by resetLatency()
+    const LatencyHistogram& getSendHistogram() const { return _sendHistogram; }
     uint32_t getSendFailureCount() const { return _sendFailureCount.load(); }
+    uint32_t getDropCount(DropReason reason) const { return _drops[(size_t)reason].load(); }
+    size_t getQueueLimit() const { return _queueLimit.load(); }
 
 private:
     static void taskWrapper(void* parameter);
     void taskFunction();
     void _notifySendError(const char* message);
+    void _sendSlot(FrameSlot* slot);
+    bool _isStale(const FrameSlot* slot) const;
+    void _recordLatency(const FrameTrace& trace);
 
     StreamTransport* _transport;
+    FrameSource* _source;
     const StreamConfig& _config;
     StreamerEvents* _eventsHandler = nullptr;
 
     TaskHandle_t _taskHandle;
-    QueueHandle_t _queue;
+    FrameRing _ring;
+    size_t _queueDepth;                 // configured, the ring is sized for it
+    std::atomic<size_t> _queueLimit;    // _queueDepth capped by the frame budget
+    size_t _frameBudget;
 
     volatile bool _isRunning;
     volatile bool _taskEnded;
     std::atomic<uint64_t> _bytesSent;
     std::atomic<uint32_t> _framesSent;
+    std::atomic<uint64_t> _sendTimeUs;
+    LatencyHistogram _latency[(size_t)LatencyStage::COUNT];
+    LatencyHistogram _sendHistogram;
     std::atomic<uint32_t> _sendFailureCount;
+    std::atomic<uint32_t> _drops[(size_t)DropReason::COUNT];
 
     static const char* TAG;
 };
@@ -0,0 +1,753 @@
+#include "WebSocketStreamTransport.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <strings.h>
+#include <algorithm>
+
+static const char* TAG = "WebSocketStreamTransport";
+
+#define READER_TASK_STACK 4096
+#define READER_TASK_PRIORITY 3
+#define READER_POLL_MS 200
+// A poll plus a socket receive timeout while the reader is inside a message
+#define READER_STOP_TIMEOUT_MS 10000
+#define HANDSHAKE_RESPONSE_MAX 512
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+WebSocketStreamTransport::WebSocketStreamTransport(const StreamConfig& config)
+    : _config(config),
+      _eventsHandler(nullptr),
+      _mutex(nullptr),
+      _readerTask(nullptr),
+      _stopping(false),
+      _readerStopped(false),
+      _sock(-1),
+      _connected(false),
+      _bytesSent(0),
+      _frameSequence(0),
+      _messageLen(0),
+      _messageTooLarge(false),
+      _messageText(false)
+{
+    memset(_host, 0, sizeof(_host));
+    memset(_port, 0, sizeof(_port));
+    memset(_message, 0, sizeof(_message));
+    memset(_lastError, 0, sizeof(_lastError));
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+    }
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        WebSocketStreamTransport::readerTaskWrapper,
+        "WsReader",
+        READER_TASK_STACK,
+        this,
+        READER_TASK_PRIORITY,
+        &_readerTask,
+        _config.taskCore < 0 ? tskNO_AFFINITY : _config.taskCore
+    );
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create reader task, server messages will be ignored");
+        _readerTask = nullptr;
+    }
+}
+
+WebSocketStreamTransport::~WebSocketStreamTransport() {
+    if (_readerTask) {
+        // Deleting the reader inside _readerSocket() or a pong would leave
+        // _mutex taken for disconnect(): let it park first
+        _stopping = true;
+        xTaskNotifyGive(_readerTask);
+
+        uint32_t waited = 0;
+        while (!_readerStopped && waited < READER_STOP_TIMEOUT_MS) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            waited += 10;
+        }
+        if (!_readerStopped) {
+            ESP_LOGW(TAG, "Reader task did not stop in %ums, deleting it", READER_STOP_TIMEOUT_MS);
+        }
+        vTaskDelete(_readerTask);
+        _readerTask = nullptr;
+    }
+
+    disconnect();
+
+    if (_mutex) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+    }
+}
+
+bool WebSocketStreamTransport::_parseUrl(const char* url) {
+    // The stream URL names the server; the WebSocket lives at wsPath on the same host and port
+    const char* host = strstr(url, "://");
+    host = host ? host + 3 : url;
+
+    size_t hostLen = strcspn(host, ":/");
+    if (hostLen == 0 || hostLen >= sizeof(_host)) {
+        snprintf(_lastError, sizeof(_lastError), "Invalid host in URL: %s", url);
+        return false;
+    }
+    memcpy(_host, host, hostLen);
+    _host[hostLen] = '\0';
+
+    const char* rest = host + hostLen;
+    if (*rest == ':') {
+        rest++;
+        size_t portLen = strcspn(rest, "/");
+        if (portLen == 0 || portLen >= sizeof(_port)) {
+            snprintf(_lastError, sizeof(_lastError), "Invalid port in URL: %s", url);
+            return false;
+        }
+        memcpy(_port, rest, portLen);
+        _port[portLen] = '\0';
+    } else {
+        snprintf(_port, sizeof(_port), "80");
+    }
+    return true;
+}
+
+bool WebSocketStreamTransport::_openSocket() {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* res = nullptr;
+    int err = getaddrinfo(_host, _port, &hints, &res);
+    if (err != 0 || !res) {
+        snprintf(_lastError, sizeof(_lastError), "DNS lookup failed for %s: %d", _host, err);
+        return false;
+    }
+
+    _sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (_sock < 0) {
+        freeaddrinfo(res);
+        snprintf(_lastError, sizeof(_lastError), "Failed to create socket: errno %d", errno);
+        return false;
+    }
+
+    if (_config.tcpNoDelay) {
+        int one = 1;
+        setsockopt(_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (_config.tcpSendBufferSize > 0) {
+        int size = (int)_config.tcpSendBufferSize;
+        if (setsockopt(_sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0) {
+            ESP_LOGW(TAG, "SO_SNDBUF %d not supported (errno %d), using lwIP default", size, errno);
+        }
+    }
+
+    struct timeval tv;
+    tv.tv_sec = _config.tcpTimeoutMs / 1000;
+    tv.tv_usec = (_config.tcpTimeoutMs % 1000) * 1000;
+    setsockopt(_sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    int flags = fcntl(_sock, F_GETFL, 0);
+    fcntl(_sock, F_SETFL, flags | O_NONBLOCK);
+
+    int result = ::connect(_sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    if (result < 0 && errno != EINPROGRESS) {
+        snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s failed: errno %d", _host, _port, errno);
+        return false;
+    }
+
+    if (result < 0) {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(_sock, &wfds);
+
+        result = select(_sock + 1, nullptr, &wfds, nullptr, &tv);
+        if (result <= 0) {
+            snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s timed out", _host, _port);
+            return false;
+        }
+
+        int sockErr = 0;
+        socklen_t len = sizeof(sockErr);
+        getsockopt(_sock, SOL_SOCKET, SO_ERROR, &sockErr, &len);
+        if (sockErr != 0) {
+            snprintf(_lastError, sizeof(_lastError), "Connect to %s:%s failed: errno %d", _host, _port, sockErr);
+            return false;
+        }
+    }
+
+    fcntl(_sock, F_SETFL, flags);
+    return true;
+}
+
+bool WebSocketStreamTransport::_handshake() {
+    uint8_t nonce[16];
+    for (size_t i = 0; i < sizeof(nonce); i += 4) {
+        uint32_t r = esp_random();
+        memcpy(nonce + i, &r, 4);
+    }
+
+    unsigned char key[32];
+    size_t keyLen = 0;
+    mbedtls_base64_encode(key, sizeof(key), &keyLen, nonce, sizeof(nonce));
+    key[keyLen] = '\0';
+
+    char request[384];
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\n"
+                       "Host: %s:%s\r\n"
+                       "User-Agent: wheelbot-cam\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Key: %s\r\n"
+                       "Sec-WebSocket-Version: 13\r\n"
+                       "X-Framerate: %s\r\n"
+                       "\r\n",
+                       _config.wsPath, _host, _port, key, _config.frameRate);
+    if (len < 0 || len >= (int)sizeof(request)) {
+        snprintf(_lastError, sizeof(_lastError), "Handshake request too large");
+        return false;
+    }
+
+    StreamIovec iov = { (const uint8_t*)request, (size_t)len };
+    if (!_sendAllLocked(&iov, 1)) {
+        return false;
+    }
+
+    // Byte by byte so nothing after the header block is consumed here
+    char response[HANDSHAKE_RESPONSE_MAX];
+    size_t received = 0;
+    while (true) {
+        if (received + 1 >= sizeof(response)) {
+            snprintf(_lastError, sizeof(_lastError), "Handshake response too large");
+            return false;
+        }
+        if (!_recvExact(_sock, (uint8_t*)response + received, 1)) {
+            snprintf(_lastError, sizeof(_lastError), "No handshake response from %s:%s", _host, _port);
+            return false;
+        }
+        received++;
+        if (received >= 4 && memcmp(response + received - 4, "\r\n\r\n", 4) == 0) {
+            break;
+        }
+    }
+    response[received] = '\0';
+
+    int status = 0;
+    sscanf(response, "HTTP/%*s %d", &status);
+    if (status != 101) {
+        snprintf(_lastError, sizeof(_lastError), "Upgrade to %s refused, server status %d", _config.wsPath, status);
+        return false;
+    }
+
+    char expected[64];
+    snprintf(expected, sizeof(expected), "%s" WS_GUID, (const char*)key);
+    unsigned char digest[20];
+    mbedtls_sha1_ret((const unsigned char*)expected, strlen(expected), digest);
+    unsigned char accept[32];
+    size_t acceptLen = 0;
+    mbedtls_base64_encode(accept, sizeof(accept), &acceptLen, digest, sizeof(digest));
+    accept[acceptLen] = '\0';
+
+    const char* header = strcasestr(response, "\r\nSec-WebSocket-Accept:");
+    if (!header) {
+        snprintf(_lastError, sizeof(_lastError), "Handshake response has no Sec-WebSocket-Accept");
+        return false;
+    }
+    header += strlen("\r\nSec-WebSocket-Accept:");
+    header += strspn(header, " \t");
+    if (strncmp(header, (const char*)accept, acceptLen) != 0) {
+        snprintf(_lastError, sizeof(_lastError), "Sec-WebSocket-Accept mismatch");
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketStreamTransport::connect(const char* url) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _closeLocked();
+
+    bool ok = _parseUrl(url) && _openSocket() && _handshake();
+    if (ok) {
+        _bytesSent = 0;
+        _connected = true;
+        ESP_LOGI(TAG, "WS: Streaming to ws://%s:%s%s", _host, _port, _config.wsPath);
+    } else {
+        ESP_LOGE(TAG, "WS: %s", _lastError);
+        _closeLocked();
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+
+    if (ok && _readerTask) {
+        xTaskNotifyGive(_readerTask);
+    }
+    return ok;
+}
+
+void WebSocketStreamTransport::_closeLocked() {
+    _connected = false;
+    if (_sock >= 0) {
+        shutdown(_sock, SHUT_RDWR);
+        close(_sock);
+        _sock = -1;
+        ESP_LOGI(TAG, "WS: Connection closed.");
+    }
+}
+
+void WebSocketStreamTransport::disconnect() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    _closeLocked();
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+bool WebSocketStreamTransport::finish() {
+    // Status 1000, normal closure
+    const uint8_t status[2] = { 0x03, 0xE8 };
+    bool ok = _sendControlFrame(OP_CLOSE, status, sizeof(status));
+    disconnect();
+    return ok;
+}
+
+bool WebSocketStreamTransport::isConnected() const {
+    return _connected.load();
+}
+
+size_t WebSocketStreamTransport::_writeFrameHeader(uint8_t* buf, Opcode opcode, uint64_t payloadLen, uint32_t maskKey) {
+    size_t pos = 0;
+    buf[pos++] = 0x80 | opcode;
+
+    if (payloadLen < 126) {
+        buf[pos++] = 0x80 | (uint8_t)payloadLen;
+    } else if (payloadLen <= 0xFFFF) {
+        buf[pos++] = 0x80 | 126;
+        buf[pos++] = (uint8_t)(payloadLen >> 8);
+        buf[pos++] = (uint8_t)payloadLen;
+    } else {
+        buf[pos++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            buf[pos++] = (uint8_t)(payloadLen >> shift);
+        }
+    }
+
+    memcpy(buf + pos, &maskKey, 4);
+    return pos + 4;
+}
+
+void WebSocketStreamTransport::_mask(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* key, size_t pos) {
+    uint8_t rotated[4];
+    for (size_t i = 0; i < 4; i++) {
+        rotated[i] = key[(pos + i) & 3];
+    }
+
+    // A word at a time; the key repeats every 4 bytes
+    uint32_t word;
+    memcpy(&word, rotated, 4);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint32_t v;
+        memcpy(&v, src + i, 4);
+        v ^= word;
+        memcpy(dst + i, &v, 4);
+    }
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ rotated[i & 3];
+    }
+}
+
+size_t WebSocketStreamTransport::formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) {
+    if (bufSize < MAX_FRAME_HEADER + META_LEN) {
+        return 0;
+    }
+
+    uint8_t* out = (uint8_t*)buf;
+    size_t pos = _writeFrameHeader(out, OP_BINARY, META_LEN + fb->len, esp_random());
+
+    int64_t us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    if (us <= 0) {
+        us = esp_timer_get_time();
+    }
+    uint16_t width = (uint16_t)fb->width;
+    uint16_t height = (uint16_t)fb->height;
+    uint16_t reserved = 0;
+    uint32_t sequence = _frameSequence++;
+    uint64_t captureUs = (uint64_t)us;
+
+    // The ESP32 is little-endian, so the fields are copied as they are
+    uint8_t* meta = out + pos;
+    meta[0] = META_VERSION;
+    meta[1] = 0;
+    memcpy(meta + 2, &width, 2);
+    memcpy(meta + 4, &height, 2);
+    memcpy(meta + 6, &reserved, 2);
+    memcpy(meta + 8, &sequence, 4);
+    memcpy(meta + 12, &captureUs, 8);
+
+    // The prefix is the start of the payload, so it is masked here; sendv()
+    // continues the mask from the JPEG's first byte
+    _mask(meta, meta, META_LEN, out + pos - 4, 0);
+    return pos + META_LEN;
+}
+
+bool WebSocketStreamTransport::_sendAllLocked(const StreamIovec* iov, size_t count) {
+    struct iovec vec[MAX_IOV];
+
+    for (size_t base = 0; base < count; base += MAX_IOV) {
+        size_t n = 0;
+        for (size_t i = base; i < count && i < base + MAX_IOV; i++) {
+            if (iov[i].len > 0) {
+                vec[n].iov_base = (void*)iov[i].data;
+                vec[n].iov_len = iov[i].len;
+                n++;
+            }
+        }
+
+        size_t first = 0;
+        while (first < n) {
+            struct msghdr msg = {};
+            msg.msg_iov = &vec[first];
+            msg.msg_iovlen = n - first;
+
+            ssize_t written = sendmsg(_sock, &msg, 0);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                snprintf(_lastError, sizeof(_lastError), "Send failed: errno %d", errno);
+                return false;
+            }
+
+            _bytesSent += written;
+
+            size_t remaining = (size_t)written;
+            while (first < n && remaining >= vec[first].iov_len) {
+                remaining -= vec[first].iov_len;
+                first++;
+            }
+            if (first < n) {
+                vec[first].iov_base = (uint8_t*)vec[first].iov_base + remaining;
+                vec[first].iov_len -= remaining;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool WebSocketStreamTransport::_sendMaskedLocked(const StreamIovec* iov, size_t count) {
+    // iov[0] is a frame header followed by any payload bytes already masked
+    // with its key; the rest of the payload is masked chunk by chunk
+    const uint8_t* head = iov[0].data;
+    uint8_t lenCode = head[1] & 0x7F;
+    size_t headerLen = 2 + (lenCode == 126 ? 2 : lenCode == 127 ? 8 : 0) + 4;
+    const uint8_t* key = head + headerLen - 4;
+    size_t pos = iov[0].len - headerLen;
+
+    // The header goes out together with the first chunk
+    StreamIovec out[2] = { iov[0], { _maskBuf, 0 } };
+    bool headerSent = false;
+
+    for (size_t i = 1; i < count; i++) {
+        const uint8_t* src = iov[i].data;
+        size_t left = iov[i].len;
+        while (left > 0) {
+            size_t n = std::min(left, MASK_CHUNK - out[1].len);
+            _mask(_maskBuf + out[1].len, src, n, key, pos);
+            out[1].len += n;
+            pos += n;
+            src += n;
+            left -= n;
+
+            if (out[1].len == MASK_CHUNK) {
+                if (!(headerSent ? _sendAllLocked(&out[1], 1) : _sendAllLocked(out, 2))) {
+                    return false;
+                }
+                headerSent = true;
+                out[1].len = 0;
+            }
+        }
+    }
+
+    if (headerSent && out[1].len == 0) {
+        return true;
+    }
+    return headerSent ? _sendAllLocked(&out[1], 1) : _sendAllLocked(out, 2);
+}
+
+bool WebSocketStreamTransport::send(const uint8_t* data, size_t len) {
+    // Unframed data goes out as a binary message of its own
+    uint8_t header[MAX_FRAME_HEADER];
+    size_t headerLen = _writeFrameHeader(header, OP_BINARY, len, esp_random());
+    StreamIovec iov[2] = { { header, headerLen }, { data, len } };
+    return sendv(iov, 2);
+}
+
+bool WebSocketStreamTransport::sendv(const StreamIovec* iov, size_t count) {
+    // iov[0] is the frame header from formatFrameHeader(), which already
+    // declares the length of the segments that follow and holds the mask key
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _connected && _sock >= 0;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        long start_time = millis();
+        ok = _sendMaskedLocked(iov, count);
+        if (ok) {
+            long duration = millis() - start_time;
+            if (duration > (long)_config.slowChunkThreshold) {
+                ESP_LOGW(TAG, "WS: Slow frame send: %lums", duration);
+            }
+        } else {
+            ESP_LOGE(TAG, "WS: %s", _lastError);
+            _closeLocked();
+        }
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+bool WebSocketStreamTransport::_sendControlFrame(Opcode opcode, const uint8_t* payload, size_t len) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    bool ok = _connected && _sock >= 0;
+    if (!ok) {
+        snprintf(_lastError, sizeof(_lastError), "Client not connected");
+    } else {
+        uint8_t header[MAX_FRAME_HEADER];
+        size_t headerLen = _writeFrameHeader(header, opcode, len, esp_random());
+        StreamIovec iov[2] = { { header, headerLen }, { payload, len } };
+        ok = _sendMaskedLocked(iov, 2);
+    }
+
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return ok;
+}
+
+bool WebSocketStreamTransport::_recvExact(int sock, uint8_t* buf, size_t len) {
+    size_t received = 0;
+    while (received < len) {
+        ssize_t n = recv(sock, buf + received, len - received, 0);
+        if (n > 0) {
+            received += n;
+            continue;
+        }
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) && _connected && !_stopping) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketStreamTransport::_readMessage(int sock) {
+    uint8_t head[2];
+    if (!_recvExact(sock, head, 2)) {
+        return false;
+    }
+
+    bool fin = head[0] & 0x80;
+    Opcode opcode = (Opcode)(head[0] & 0x0F);
+    bool masked = head[1] & 0x80;
+    uint64_t len = head[1] & 0x7F;
+
+    if (len == 126) {
+        uint8_t ext[2];
+        if (!_recvExact(sock, ext, 2)) {
+            return false;
+        }
+        len = ((uint64_t)ext[0] << 8) | ext[1];
+    } else if (len == 127) {
+        uint8_t ext[8];
+        if (!_recvExact(sock, ext, 8)) {
+            return false;
+        }
+        len = 0;
+        for (int i = 0; i < 8; i++) {
+            len = (len << 8) | ext[i];
+        }
+    }
+
+    uint8_t mask[4] = {};
+    if (masked && !_recvExact(sock, mask, 4)) {
+        return false;
+    }
+
+    bool control = opcode & 0x08;
+    if (control && len > 125) {
+        ESP_LOGW(TAG, "WS: Oversized control frame from server");
+        return false;
+    }
+
+    uint8_t controlPayload[125];
+    uint8_t discard[64];
+    for (uint64_t i = 0; i < len; ) {
+        uint8_t* dst;
+        size_t n;
+        if (control) {
+            dst = controlPayload + i;
+            n = (size_t)len;
+        } else if (!_messageTooLarge && _messageLen + (len - i) <= MAX_CONTROL_MESSAGE) {
+            dst = (uint8_t*)_message + _messageLen;
+            n = (size_t)(len - i);
+        } else {
+            _messageTooLarge = true;
+            dst = discard;
+            n = (size_t)std::min<uint64_t>(len - i, sizeof(discard));
+        }
+
+        if (!_recvExact(sock, dst, n)) {
+            return false;
+        }
+        for (size_t j = 0; masked && j < n; j++) {
+            dst[j] ^= mask[(i + j) & 3];
+        }
+        if (!control && dst != discard) {
+            _messageLen += n;
+        }
+        i += n;
+    }
+
+    switch (opcode) {
+        case OP_PING:
+            _sendControlFrame(OP_PONG, controlPayload, (size_t)len);
+            break;
+        case OP_PONG:
+            break;
+        case OP_CLOSE:
+            _sendControlFrame(OP_CLOSE, controlPayload, len >= 2 ? 2 : 0);
+            _readerLost(sock, "Server closed the connection");
+            return false;
+        case OP_TEXT:
+        case OP_BINARY:
+        case OP_CONTINUATION:
+            if (opcode != OP_CONTINUATION) {
+                _messageText = opcode == OP_TEXT;
+            }
+            if (!fin) {
+                break;
+            }
+            if (_messageTooLarge) {
+                ESP_LOGW(TAG, "WS: Server message longer than %u bytes ignored", MAX_CONTROL_MESSAGE);
+            } else if (!_messageText) {
+                ESP_LOGW(TAG, "WS: Binary message from server ignored");
+            } else if (_eventsHandler && _messageLen > 0) {
+                _message[_messageLen] = '\0';
+                _eventsHandler->onControlMessage(_message, _messageLen);
+            }
+            _messageLen = 0;
+            _messageTooLarge = false;
+            break;
+        default:
+            ESP_LOGW(TAG, "WS: Unknown opcode %u from server", opcode);
+            return false;
+    }
+    return true;
+}
+
+void WebSocketStreamTransport::readerTaskWrapper(void* parameter) {
+    static_cast<WebSocketStreamTransport*>(parameter)->readerTask();
+}
+
+// The socket and connected flag change under _mutex on the send path, so
+// the reader looks at them under the same lock. It never holds the lock
+// while blocked in select() or recv(): pongs and sends need it meanwhile.
+int WebSocketStreamTransport::_readerSocket() {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+    int sock = _connected ? _sock : -1;
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+    return sock;
+}
+
+bool WebSocketStreamTransport::_readerOwns(int sock) {
+    return sock >= 0 && _readerSocket() == sock;
+}
+
+void WebSocketStreamTransport::_readerLost(int sock, const char* why) {
+    if (_mutex) {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+    // A reconnect may already have replaced the socket this reader was on
+    if (_connected && sock == _sock) {
+        ESP_LOGW(TAG, "WS: %s", why);
+        _connected = false;
+    }
+    if (_mutex) {
+        xSemaphoreGive(_mutex);
+    }
+}
+
+void WebSocketStreamTransport::readerTask() {
+    while (!_stopping) {
+        // Parked until connect() succeeds or the destructor stops the task
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (_stopping) {
+            break;
+        }
+
+        int sock = _readerSocket();
+        _messageLen = 0;
+        _messageTooLarge = false;
+
+        while (!_stopping && _readerOwns(sock)) {
+            fd_set rfds;
+            FD_ZERO(&rfds);
+            FD_SET(sock, &rfds);
+            struct timeval tv = { 0, READER_POLL_MS * 1000 };
+
+            int ready = select(sock + 1, &rfds, nullptr, nullptr, &tv);
+            if (ready == 0) {
+                continue;
+            }
+            if (ready < 0 || !_readMessage(sock)) {
+                _readerLost(sock, "Connection lost while reading");
+                break;
+            }
+        }
+    }
+
+    // The destructor deletes the task; a FreeRTOS task must never return.
+    _readerStopped = true;
+    vTaskSuspend(nullptr);
+}
+
+uint64_t WebSocketStreamTransport::getBytesSent() const {
+    return _bytesSent;
+}
+
+const char* WebSocketStreamTransport::getLastError() const {
+    return _lastError;
+}
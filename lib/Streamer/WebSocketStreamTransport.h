@@ -0,0 +1,105 @@
+#ifndef WEBSOCKET_STREAM_TRANSPORT_H
+#define WEBSOCKET_STREAM_TRANSPORT_H
+
+#include "Arduino.h"
+#include "StreamTransport.h"
+#include "StreamConfig.h"
+#include "StreamerEvents.h"
+#include "esp_camera.h"
+#include <atomic>
+
+// WebSocket client (RFC 6455) toward the ingest server at wsPath. Every
+// JPEG goes out as one binary message: the frame header and a META_LEN
+// metadata prefix are built by formatFrameHeader(). Client frames must be
+// masked with a fresh random key (RFC 6455 section 5.3); the frame buffer is
+// shared with local sinks, so the payload is masked into a MASK_CHUNK
+// scratch buffer on its way to the socket instead of in place. A reader task
+// answers pings and close frames and hands text messages to the events
+// handler as control commands (see Streamer::applyControl).
+//
+// Metadata prefix, little-endian:
+//   u8 version (1), u8 flags (0), u16 width, u16 height, u16 reserved,
+//   u32 frame sequence, u64 capture time in microseconds
+class WebSocketStreamTransport : public StreamTransport {
+public:
+    WebSocketStreamTransport(const StreamConfig& config);
+    ~WebSocketStreamTransport();
+
+    bool connect(const char* url) override;
+    void disconnect() override;
+    bool finish() override;
+    bool isConnected() const override;
+    bool send(const uint8_t* data, size_t len) override;
+    bool sendv(const StreamIovec* iov, size_t count) override;
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override;
+    uint64_t getBytesSent() const override;
+    const char* getLastError() const override;
+    void setEventsHandler(StreamerEvents* handler) override { _eventsHandler = handler; }
+
+    esp_http_client_handle_t getHttpClient() const override { return nullptr; }
+
+    static const size_t META_LEN = 20;
+    static const uint8_t META_VERSION = 1;
+
+private:
+    enum Opcode : uint8_t {
+        OP_CONTINUATION = 0x0,
+        OP_TEXT = 0x1,
+        OP_BINARY = 0x2,
+        OP_CLOSE = 0x8,
+        OP_PING = 0x9,
+        OP_PONG = 0xA
+    };
+
+    static void readerTaskWrapper(void* parameter);
+    void readerTask();
+
+    bool _parseUrl(const char* url);
+    bool _openSocket();
+    bool _handshake();
+    bool _recvExact(int sock, uint8_t* buf, size_t len);
+    bool _readMessage(int sock);
+    bool _sendControlFrame(Opcode opcode, const uint8_t* payload, size_t len);
+    bool _sendAllLocked(const StreamIovec* iov, size_t count);
+    bool _sendMaskedLocked(const StreamIovec* iov, size_t count);
+    void _closeLocked();
+    int _readerSocket();
+    bool _readerOwns(int sock);
+    void _readerLost(int sock, const char* why);
+    static size_t _writeFrameHeader(uint8_t* buf, Opcode opcode, uint64_t payloadLen, uint32_t maskKey);
+    static void _mask(uint8_t* dst, const uint8_t* src, size_t len, const uint8_t* key, size_t pos);
+
+    StreamConfig _config;
+    StreamerEvents* _eventsHandler;
+    SemaphoreHandle_t _mutex;
+    TaskHandle_t _readerTask;
+    // The destructor sets _stopping; the reader sets _readerStopped once it
+    // is parked outside the lock
+    std::atomic<bool> _stopping;
+    std::atomic<bool> _readerStopped;
+
+    int _sock;
+    std::atomic<bool> _connected;
+    uint64_t _bytesSent;
+    uint32_t _frameSequence;
+
+    static const size_t MAX_IOV = 8;
+    static const size_t MAX_FRAME_HEADER = 14;
+    static const size_t MAX_CONTROL_MESSAGE = 512;
+    static const size_t MASK_CHUNK = 2048;
+
+    // Masked payload on its way to the socket; only used under _mutex
+    uint8_t _maskBuf[MASK_CHUNK];
+
+    // Server message being reassembled; owned by the reader task
+    char _message[MAX_CONTROL_MESSAGE + 1];
+    size_t _messageLen;
+    bool _messageTooLarge;
+    bool _messageText;
+
+    char _host[64];
+    char _port[6];
+    char _lastError[256];
+};
+
+#endif
@@ -262,6 +262,8 @@ void WiFiPortal::handle_root() {
     String server_port = _preferences.getString("server_port", "8080");
     String frame_size = _preferences.getString("frame_size", "VGA");
     String jpeg_quality = _preferences.getString("jpeg_quality", "10");
+    String transport = _preferences.getString("transport", "http");
+    String upload_mode = _preferences.getString("upload_mode", "length");
     String password = _preferences.getString("password", "");
     String ssid = _preferences.getString("ssid", "");
     _preferences.end();
@@ -275,6 +277,16 @@ void WiFiPortal::handle_root() {
     frame_size_options += makeOption("XGA", frame_size);
     frame_size_options += makeOption("SXGA", frame_size);
 
+    String transport_options = "";
+    transport_options += makeOption("http", transport);
+    transport_options += makeOption("tcp", transport);
+    transport_options += makeOption("rtp", transport);
+    transport_options += makeOption("ws", transport);
+
+    String upload_mode_options = "";
+    upload_mode_options += makeOption("length", upload_mode);
+    upload_mode_options += makeOption("chunked", upload_mode);
+
     // Replace placeholders
     portalContent.replace("{ssid_val}", ssid);
     portalContent.replace("{wifi-password}", password);
@@ -282,6 +294,8 @@ void WiFiPortal::handle_root() {
     portalContent.replace("{server_port_val}", server_port);
     portalContent.replace("{frame_size_options}", frame_size_options);
     portalContent.replace("{jpeg_quality_val}", jpeg_quality);
+    portalContent.replace("{transport_options}", transport_options);
+    portalContent.replace("{upload_mode_options}", upload_mode_options);
 
     ESP_LOGI(TAG, "Serving portal page.");
 
@@ -304,6 +318,8 @@ void WiFiPortal::handle_save() {
     String server_port = _server.arg("server_port");
     String frame_size = _server.arg("frame_size");
     String jpeg_quality = _server.arg("jpeg_quality");
+    String transport = _server.arg("transport");
+    String upload_mode = _server.arg("upload_mode");
 
     // Validate SSID
     if (ssid.length() == 0) {
@@ -352,6 +368,14 @@ void WiFiPortal::handle_save() {
         return;
     }
 
+    if (transport != "http" && transport != "tcp" && transport != "rtp" && transport != "ws") {
+        transport = "http";
+    }
+
+    if (upload_mode != "length" && upload_mode != "chunked") {
+        upload_mode = "length";
+    }
+
     // Save to preferences
     _preferences.begin("wheelbot-cam", false);
     _preferences.putString("ssid", ssid);
@@ -360,12 +384,15 @@ void WiFiPortal::handle_save() {
     _preferences.putString("server_port", server_port);
     _preferences.putString("frame_size", frame_size);
     _preferences.putString("jpeg_quality", jpeg_quality);
+    _preferences.putString("transport", transport);
+    _preferences.putString("upload_mode", upload_mode);
     _preferences.end();
 
     ESP_LOGI(TAG, "Credentials saved - SSID: '%s', Password length: %u",
              ssid.c_str(), password.length());
-    ESP_LOGI(TAG, "Server settings - IP: %s:%s, Frame size: %s, Quality: %s",
-             server_ip.c_str(), server_port.c_str(), frame_size.c_str(), jpeg_quality.c_str());
+    ESP_LOGI(TAG, "Server settings - IP: %s:%s, Frame size: %s, Quality: %s, Transport: %s, Upload: %s",
+             server_ip.c_str(), server_port.c_str(), frame_size.c_str(), jpeg_quality.c_str(), transport.c_str(),
+             upload_mode.c_str());
     // Set flag that settings were saved
     _settingsSaved = true;
     _settingsSavedTime = millis();
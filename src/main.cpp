@@ -8,11 +8,35 @@
 #include <Streamer.h>
 #include <ESPmDNS.h>
 #include <WiFiPortal.h>
+#include <BootProfiler.h>
+#ifdef MJPEG_SERVER_PORT
+#include <MjpegServer.h>
+#include <MetricsExporter.h>
+// How long POST /control waits for the capture task to apply a change
+#define CONTROL_TIMEOUT_MS 1000
+#endif
+#if defined(MJPEG_SERVER_PORT) && defined(PRE_EVENT_SECONDS)
+#include <FrameRecorder.h>
+#ifndef PRE_EVENT_FPS
+#define PRE_EVENT_FPS 5
+#endif
+#ifndef PRE_EVENT_ARENA_KB
+#define PRE_EVENT_ARENA_KB 1024
+#endif
+#endif
 
 static const char *TAG = "MAIN";
 
 ConfigManager configManager;
 Streamer* streamer;
+char url_stream[128];
+#ifdef MJPEG_SERVER_PORT
+MjpegServer* mjpegServer;
+MetricsExporter* metrics;
+#endif
+#if defined(MJPEG_SERVER_PORT) && defined(PRE_EVENT_SECONDS)
+FrameRecorder* recorder;
+#endif
 
 #define ERROR_LED_GPIO 33
 
@@ -31,8 +55,43 @@ void handleCriticalError(const char* message) {
   ESP.restart();
 }
 
+Streamer* createStreamer() {
+  snprintf(url_stream, sizeof(url_stream), "http://%s:%s/input", configManager.get_server_ip(), configManager.get_server_port());
+
+  Streamer* s = new Streamer(url_stream, configManager.get_frame_size(), configManager.get_jpeg_quality());
+  if (strcmp(configManager.get_transport(), "tcp") == 0) {
+    s->setTransportType(StreamTransportType::RAW_TCP);
+  } else if (strcmp(configManager.get_transport(), "rtp") == 0) {
+    s->setTransportType(StreamTransportType::RTP_UDP);
+  } else if (strcmp(configManager.get_transport(), "ws") == 0) {
+    s->setTransportType(StreamTransportType::WEBSOCKET);
+  }
+  if (strcmp(configManager.get_upload_mode(), "chunked") == 0) {
+    s->setUploadMode(UploadMode::CHUNKED);
+  }
+  if (configManager.get_max_fps()[0]) {
+    s->setMaxFPS(atof(configManager.get_max_fps()));
+  }
+
+  // Sinks are registered before the camera is planned (their frames enlarge the
+  // buffer pool) and before setup() starts the capture task, which walks the list unlocked
+#ifdef MJPEG_SERVER_PORT
+  mjpegServer = new MjpegServer(MJPEG_SERVER_PORT);
+  s->addFrameSink(mjpegServer);
+#endif
+#if defined(MJPEG_SERVER_PORT) && defined(PRE_EVENT_SECONDS)
+  recorder = new FrameRecorder(PRE_EVENT_SECONDS, PRE_EVENT_FPS, PRE_EVENT_ARENA_KB * 1024);
+  s->addFrameSink(recorder);
+#endif
+  return s;
+}
+
 void setup() {
+  BootProfiler::mark("setup");
+
+#ifndef FAST_BOOT
   delay(5000); // Stabilization delay at startup
+#endif
 
   Serial.begin(115200);
   Serial.flush();
@@ -53,8 +112,10 @@ void setup() {
     Serial.println("PSRAM NOT detected!");
   }
   Serial.flush();
-  
+
+#ifndef FAST_BOOT
   delay(1000); // Give time for serial monitor to connect
+#endif
 
   // Check force captive portal flag FIRST
   if (configManager.get_force_captive_portal()) {
@@ -73,8 +134,21 @@ void setup() {
     ESP.restart();
   }
 
+#ifdef FAST_BOOT
+  // Fast boot - camera init and sensor warm-up run on core 0 while this
+  // task (core 1) associates with WiFi and opens the stream
+  configManager.loadServerConfig();
+  BootProfiler::mark("config loaded");
+
+  streamer = createStreamer();
+  streamer->beginCameraInit(0);
+
+  configManager.connectToWiFi();
+#else
   // Normal boot - connect to WiFi
   configManager.setup();
+#endif
+  BootProfiler::mark("wifi connected");
 
   Serial.println("WiFi setup complete.");
   Serial.flush();
@@ -86,14 +160,71 @@ void setup() {
   Serial.println("WiFi connected.");
   Serial.flush();
 
-  char url_stream[128];
-  snprintf(url_stream, sizeof(url_stream), "http://%s:%s/input", configManager.get_server_ip(), configManager.get_server_port());
+#ifndef FAST_BOOT
+  streamer = createStreamer();
+#endif
 
-  streamer = new Streamer(url_stream, configManager.get_frame_size(), configManager.get_jpeg_quality());
   streamer->setup();
 
+#ifdef MJPEG_SERVER_PORT
+  if (mjpegServer->begin()) {
+    metrics = new MetricsExporter(streamer, mjpegServer);
+    mjpegServer->on("/metrics", [](int sock, const HttpRequest& request) {
+      metrics->serve(sock);
+    });
+    mjpegServer->on("/control", [](int sock, const HttpRequest& request) {
+      char json[256];
+      if (strcmp(request.method, "POST") == 0) {
+        uint32_t start = millis();
+        char error[96];
+        if (!streamer->applyControl(request.body, request.bodyLen, error, sizeof(error))) {
+          MjpegServer::sendResponse(sock, 400, "text/plain", error, strlen(error));
+          return;
+        }
+        // 202 when the change is still pending, e.g. a pool re-plan waiting for frames to drain
+        bool applied = streamer->waitControlApplied(CONTROL_TIMEOUT_MS);
+        int len = snprintf(json, sizeof(json), "{\"applied\":%s,\"ms\":%u,\"state\":",
+                           applied ? "true" : "false", (unsigned)(millis() - start));
+        len += streamer->formatControlJson(json + len, sizeof(json) - len - 1);
+        json[len++] = '}';
+        MjpegServer::sendResponse(sock, applied ? 200 : 202, "application/json", json, len);
+      } else if (strcmp(request.method, "GET") == 0) {
+        size_t len = streamer->formatControlJson(json, sizeof(json));
+        MjpegServer::sendResponse(sock, 200, "application/json", json, len);
+      } else {
+        MjpegServer::sendResponse(sock, 405, "text/plain", "Method Not Allowed", 18);
+      }
+    });
+  } else {
+    ESP_LOGE(TAG, "MJPEG server failed to start");
+  }
+#endif
+
+#if defined(MJPEG_SERVER_PORT) && defined(PRE_EVENT_SECONDS)
+  // After streamer->setup(): the camera's frame buffers are planned before the arena takes PSRAM.
+  // The recorder wants no frames until then.
+  if (recorder->begin()) {
+    mjpegServer->on("/recording", [](int sock, const HttpRequest& request) {
+      bool mjpeg = strstr(request.query, "format=mjpeg") != nullptr;
+      recorder->dump(sock, mjpeg ? RecordingFormat::MJPEG : RecordingFormat::MULTIPART);
+    });
+    mjpegServer->on("/recording/status", [](int sock, const HttpRequest& request) {
+      FrameRecorderStats s = recorder->getStats();
+      char json[256];
+      int len = snprintf(json, sizeof(json),
+                         "{\"frames\":%u,\"bytes\":%u,\"arena\":%u,\"oldest_ms\":%u,"
+                         "\"stored\":%u,\"evicted\":%u,\"skipped\":%u,\"dumps\":%u}",
+                         s.frames, s.bytesUsed, s.arenaBytes, s.oldestAgeMs,
+                         s.stored, s.evicted, s.skipped, s.dumps);
+      MjpegServer::sendResponse(sock, 200, "application/json", json, len);
+    });
+  } else {
+    ESP_LOGE(TAG, "Pre-event recorder failed to start");
+  }
+#endif
+
   // Log initial connection state (non-blocking)
-  if (streamer->get_stream_client() == NULL) {
+  if (!streamer->isStreaming()) {
     ESP_LOGW(TAG, "Streamer not connected initially. Will attempt to reconnect...");
   } else {
     digitalWrite(ERROR_LED_GPIO, LOW);
@@ -105,13 +236,28 @@ void setup() {
     ESP_LOGE(TAG, "Error setting up MDNS responder!");
   } else {
     ESP_LOGI(TAG, "mDNS responder started");
+#ifdef MJPEG_SERVER_PORT
+    MDNS.addService("http", "tcp", MJPEG_SERVER_PORT);
+#endif
   }
 
   ESP_LOGI(TAG, "Camera Ready! IP -> %s", WiFi.localIP().toString().c_str());
 
   ESP_LOGI(TAG, "Streaming to: %s", url_stream);
+#ifdef MJPEG_SERVER_PORT
+  ESP_LOGI(TAG, "Local viewer: http://%s:%d/stream", WiFi.localIP().toString().c_str(), MJPEG_SERVER_PORT);
+#endif
+
+  BootProfiler::mark("setup done");
 }
 
 void loop() {
+  configManager.loop();
+
+  // Capture normally runs in its own pinned task (StreamConfig::captureTask)
+  if (streamer->hasCaptureTask()) {
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return;
+  }
   streamer->loop();
 }
\ No newline at end of file
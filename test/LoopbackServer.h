@@ -0,0 +1,179 @@
+#ifndef LOOPBACK_SERVER_H
+#define LOOPBACK_SERVER_H
+
+// One-connection TCP server on 127.0.0.1 for the native tests. It skips
+// the request head and keeps or counts the body, decoding
+// Transfer-Encoding: chunked when the head asks for it and answering
+// 200 OK after the last chunk.
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+class LoopbackServer {
+public:
+    ~LoopbackServer() {
+        if (_thread.joinable()) {
+            shutdown(_listener, SHUT_RDWR);
+            _thread.join();
+        }
+        if (_listener >= 0) {
+            close(_listener);
+        }
+    }
+
+    // keepBody false only counts, for bodies too large to hold
+    bool start(bool keepBody = true) {
+        _keepBody = keepBody;
+        _listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(_listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listener, 1) != 0 ||
+            getsockname(_listener, (sockaddr*)&addr, &len) != 0) {
+            return false;
+        }
+        _port = ntohs(addr.sin_port);
+        _thread = std::thread(&LoopbackServer::_serve, this);
+        return true;
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(_port) + "/input";
+    }
+
+    // Blocks until the client has closed the connection
+    void waitClosed() {
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    const std::string& head() const { return _head; }
+    const std::string& body() const { return _body; }
+    uint64_t bodyBytes() const { return _bodyBytes; }
+    uint64_t chunks() const { return _chunks; }
+    bool chunked() const { return _chunked; }
+    bool terminated() const { return _terminated; }    // zero-size last chunk seen
+    bool framingError() const { return _framingError; }
+
+private:
+    void _serve() {
+        int sock = accept(_listener, nullptr, nullptr);
+        if (sock < 0) {
+            return;
+        }
+        _sock = sock;
+
+        while (_head.size() < 4 || _head.compare(_head.size() - 4, 4, "\r\n\r\n") != 0) {
+            int c = _readByte();
+            if (c < 0) {
+                close(sock);
+                return;
+            }
+            _head += (char)c;
+        }
+        _chunked = strcasestr(_head.c_str(), "Transfer-Encoding: chunked") != nullptr;
+
+        if (!_chunked) {
+            _copy(UINT64_MAX);
+        } else {
+            while (true) {
+                std::string line;
+                int c;
+                while ((c = _readByte()) >= 0 && c != '\n') {
+                    line += (char)c;
+                }
+                if (c < 0) {
+                    break;
+                }
+                char* end = nullptr;
+                uint64_t size = strtoull(line.c_str(), &end, 16);
+                if (end == line.c_str() || *end != '\r') {
+                    _framingError = true;
+                    break;
+                }
+                if (size == 0) {
+                    _terminated = _readByte() == '\r' && _readByte() == '\n';
+                    if (_terminated) {
+                        static const char OK[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+                        send(sock, OK, sizeof(OK) - 1, MSG_NOSIGNAL);
+                    }
+                    break;
+                }
+                _chunks++;
+                if (!_copy(size) || _readByte() != '\r' || _readByte() != '\n') {
+                    _framingError = true;
+                    break;
+                }
+            }
+        }
+        close(sock);
+    }
+
+    int _readByte() {
+        if (_pos == _len) {
+            ssize_t n = recv(_sock, _buf, sizeof(_buf), 0);
+            if (n <= 0) {
+                return -1;
+            }
+            _pos = 0;
+            _len = (size_t)n;
+        }
+        return _buf[_pos++];
+    }
+
+    // Body bytes until n are read or the connection ends; false on an early end
+    bool _copy(uint64_t n) {
+        while (n > 0) {
+            if (_pos == _len) {
+                ssize_t got = recv(_sock, _buf, sizeof(_buf), 0);
+                if (got <= 0) {
+                    return n == UINT64_MAX;
+                }
+                _pos = 0;
+                _len = (size_t)got;
+            }
+            size_t take = _len - _pos < n ? _len - _pos : (size_t)n;
+            if (_keepBody) {
+                _body.append((const char*)_buf + _pos, take);
+            }
+            _bodyBytes += take;
+            _pos += take;
+            if (n != UINT64_MAX) {
+                n -= take;
+            }
+        }
+        return true;
+    }
+
+    int _listener = -1;
+    int _sock = -1;
+    uint16_t _port = 0;
+    bool _keepBody = true;
+    std::thread _thread;
+
+    uint8_t _buf[65536];
+    size_t _pos = 0;
+    size_t _len = 0;
+
+    std::string _head;
+    std::string _body;
+    uint64_t _bodyBytes = 0;
+    uint64_t _chunks = 0;
+    bool _chunked = false;
+    bool _terminated = false;
+    bool _framingError = false;
+};
+
+#endif
@@ -0,0 +1,111 @@
+// Chunked uploads past 2^31 bytes, the volume a stream reaches after
+// about half an hour of VGA at 25 fps. Byte counts on the client and the
+// chunk framing on the server must not wrap or truncate at 32 bits.
+
+#include <unity.h>
+#include "../LoopbackServer.h"
+#include "HttpStreamTransport.h"
+#include "RawTcpStreamTransport.h"
+#include <string>
+#include <vector>
+
+#define FRAME_BYTES (256 * 1024)
+#define TARGET_BYTES ((1ULL << 31) + (64ULL << 20))
+
+void setUp() {}
+void tearDown() {}
+
+template <typename Transport>
+static void streamPast2GiB() {
+    StreamConfig config;
+    config.uploadMode = UploadMode::CHUNKED;
+
+    LoopbackServer server;
+    TEST_ASSERT_TRUE(server.start(false));
+    Transport transport(config);
+    TEST_ASSERT_TRUE(transport.connect(server.url().c_str()));
+
+    std::vector<uint8_t> jpeg(FRAME_BYTES, 0x55);
+    jpeg[0] = 0xFF;
+    jpeg[1] = 0xD8;
+    jpeg[FRAME_BYTES - 2] = 0xFF;
+    jpeg[FRAME_BYTES - 1] = 0xD9;
+    camera_fb_t fb = {};
+    fb.buf = jpeg.data();
+    fb.len = jpeg.size();
+
+    uint64_t expected = 0;
+    uint64_t frames = 0;
+    while (expected < TARGET_BYTES) {
+        char header[256];
+        size_t headerLen = transport.formatFrameHeader(&fb, header, sizeof(header));
+        StreamIovec iov[2] = { { (const uint8_t*)header, headerLen }, { fb.buf, fb.len } };
+        if (!transport.sendv(iov, 2)) {
+            TEST_FAIL_MESSAGE(transport.getLastError());
+        }
+        expected += headerLen + fb.len;
+        frames++;
+    }
+    TEST_ASSERT_EQUAL_UINT64(expected, transport.getBytesSent());
+    TEST_ASSERT_TRUE(transport.finish());
+    server.waitClosed();
+
+    std::string closing = std::string("\r\n--") + config.boundary + "--\r\n";
+    TEST_ASSERT_TRUE(server.chunked());
+    TEST_ASSERT_FALSE(server.framingError());
+    TEST_ASSERT_TRUE(server.terminated());
+    TEST_ASSERT_EQUAL_UINT64(expected + closing.size(), server.bodyBytes());
+    // One chunk per frame and one for the closing boundary
+    TEST_ASSERT_EQUAL_UINT64(frames + 1, server.chunks());
+}
+
+void test_raw_tcp_chunked_past_2gib() {
+    streamPast2GiB<RawTcpStreamTransport>();
+}
+
+void test_http_chunked_past_2gib() {
+    streamPast2GiB<HttpStreamTransport>();
+}
+
+// esp_http_client takes the declared length as an int
+void test_http_content_length_clamped() {
+    StreamConfig config;
+    config.uploadMode = UploadMode::CONTENT_LENGTH;
+    config.maxDataSize = 3ULL << 30;
+
+    LoopbackServer server;
+    TEST_ASSERT_TRUE(server.start(false));
+    HttpStreamTransport transport(config);
+    TEST_ASSERT_TRUE(transport.connect(server.url().c_str()));
+    TEST_ASSERT_EQUAL_UINT64(INT32_MAX, transport.getByteBudget());
+    transport.disconnect();
+    server.waitClosed();
+
+    TEST_ASSERT_NOT_NULL(strcasestr(server.head().c_str(), "\r\nContent-Length: 2147483647\r\n"));
+}
+
+// The raw TCP transport writes its own request head with the full length
+void test_raw_tcp_content_length_not_clamped() {
+    StreamConfig config;
+    config.uploadMode = UploadMode::CONTENT_LENGTH;
+    config.maxDataSize = 3ULL << 30;
+
+    LoopbackServer server;
+    TEST_ASSERT_TRUE(server.start(false));
+    RawTcpStreamTransport transport(config);
+    TEST_ASSERT_TRUE(transport.connect(server.url().c_str()));
+    TEST_ASSERT_EQUAL_UINT64(3ULL << 30, transport.getByteBudget());
+    transport.disconnect();
+    server.waitClosed();
+
+    TEST_ASSERT_NOT_NULL(strcasestr(server.head().c_str(), "\r\nContent-Length: 3221225472\r\n"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_tcp_chunked_past_2gib);
+    RUN_TEST(test_http_chunked_past_2gib);
+    RUN_TEST(test_http_content_length_clamped);
+    RUN_TEST(test_raw_tcp_content_length_not_clamped);
+    return UNITY_END();
+}
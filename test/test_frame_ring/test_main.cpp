@@ -0,0 +1,387 @@
+// FrameRing on its own (order, limits, eviction, the slot being sent, one
+// producer and one consumer thread), then TaskSender's drop policies on
+// top of it with a transport that holds the send task in sendv().
+
+#include <unity.h>
+#include "FrameRing.h"
+#include "TaskSender.h"
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Frames are told apart by len
+static camera_fb_t* makeFrames(size_t count) {
+    camera_fb_t* frames = new camera_fb_t[count]();
+    for (size_t i = 0; i < count; i++) {
+        frames[i].len = i;
+    }
+    return frames;
+}
+
+static bool push(FrameRing& ring, size_t limit, camera_fb_t* fb) {
+    FrameSlot* slot = ring.acquire(limit);
+    if (!slot) {
+        return false;
+    }
+    slot->fb = fb;
+    slot->headerLen = 0;
+    ring.commit();
+    return true;
+}
+
+static camera_fb_t* popOne(FrameRing& ring) {
+    FrameSlot* slot = ring.pop();
+    if (!slot) {
+        return nullptr;
+    }
+    camera_fb_t* fb = slot->fb;
+    ring.done(slot);
+    return fb;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_capacity_rounds_up() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(1));
+    TEST_ASSERT_EQUAL(1, ring.capacity());
+    TEST_ASSERT_TRUE(ring.init(3));
+    TEST_ASSERT_EQUAL(4, ring.capacity());
+    TEST_ASSERT_TRUE(ring.init(16));
+    TEST_ASSERT_EQUAL(16, ring.capacity());
+}
+
+void test_empty_ring() {
+    FrameRing ring;
+    camera_fb_t* fb = nullptr;
+    TEST_ASSERT_NULL(ring.pop());
+    TEST_ASSERT_FALSE(ring.evict(fb));
+
+    TEST_ASSERT_TRUE(ring.init(4));
+    TEST_ASSERT_EQUAL(0, ring.count());
+    TEST_ASSERT_NULL(ring.pop());
+    TEST_ASSERT_FALSE(ring.evict(fb));
+}
+
+void test_fifo_order_across_wraparound() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(3));
+    camera_fb_t* frames = makeFrames(3000);
+
+    size_t pushed = 0;
+    size_t popped = 0;
+    while (pushed < 3000) {
+        // 1, 2 or 3 frames per round, so the indices wrap at every offset
+        size_t batch = 1 + pushed % 3;
+        for (size_t i = 0; i < batch && pushed < 3000; i++) {
+            TEST_ASSERT_TRUE(push(ring, 3, &frames[pushed++]));
+        }
+        TEST_ASSERT_EQUAL(pushed - popped, ring.count());
+        camera_fb_t* fb;
+        while ((fb = popOne(ring)) != nullptr) {
+            TEST_ASSERT_EQUAL(popped++, fb->len);
+        }
+    }
+    TEST_ASSERT_EQUAL(3000, popped);
+    delete[] frames;
+}
+
+void test_acquire_stops_at_limit() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(8));
+    camera_fb_t* frames = makeFrames(4);
+
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(push(ring, 3, &frames[i]));
+    }
+    TEST_ASSERT_NULL(ring.acquire(3));
+    TEST_ASSERT_NOT_NULL(ring.acquire(4));
+
+    TEST_ASSERT_EQUAL_PTR(&frames[0], popOne(ring));
+    TEST_ASSERT_TRUE(push(ring, 3, &frames[3]));
+    TEST_ASSERT_EQUAL(3, ring.count());
+    delete[] frames;
+}
+
+void test_evict_takes_the_oldest() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(4));
+    camera_fb_t* frames = makeFrames(4);
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(push(ring, 3, &frames[i]));
+    }
+
+    camera_fb_t* fb = nullptr;
+    TEST_ASSERT_TRUE(ring.evict(fb));
+    TEST_ASSERT_EQUAL_PTR(&frames[0], fb);
+    TEST_ASSERT_TRUE(push(ring, 3, &frames[3]));
+
+    TEST_ASSERT_EQUAL_PTR(&frames[1], popOne(ring));
+    TEST_ASSERT_EQUAL_PTR(&frames[2], popOne(ring));
+    TEST_ASSERT_EQUAL_PTR(&frames[3], popOne(ring));
+    TEST_ASSERT_NULL(popOne(ring));
+    delete[] frames;
+}
+
+void test_claimed_frame_cannot_be_evicted() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(2));
+    camera_fb_t* frames = makeFrames(1);
+    TEST_ASSERT_TRUE(push(ring, 2, &frames[0]));
+
+    FrameSlot* slot = ring.pop();
+    TEST_ASSERT_NOT_NULL(slot);
+    camera_fb_t* fb = nullptr;
+    TEST_ASSERT_FALSE(ring.evict(fb));
+    TEST_ASSERT_EQUAL_PTR(&frames[0], slot->fb);
+    ring.done(slot);
+    delete[] frames;
+}
+
+void test_sending_slot_survives_evictions() {
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(2));
+    camera_fb_t* frames = makeFrames(20);
+    TEST_ASSERT_TRUE(push(ring, 2, &frames[0]));
+
+    // A long send: the producer keeps replacing the oldest queued frame,
+    // wrapping the ring several times, and never touches the slot being sent
+    FrameSlot* sending = ring.pop();
+    TEST_ASSERT_NOT_NULL(sending);
+    for (size_t i = 1; i < 20; i++) {
+        camera_fb_t* oldest = nullptr;
+        if (!push(ring, 2, &frames[i])) {
+            TEST_ASSERT_TRUE(ring.evict(oldest));
+            TEST_ASSERT_EQUAL_PTR(&frames[i - 2], oldest);
+            TEST_ASSERT_TRUE(push(ring, 2, &frames[i]));
+        }
+    }
+    TEST_ASSERT_EQUAL_PTR(&frames[0], sending->fb);
+    ring.done(sending);
+
+    TEST_ASSERT_EQUAL_PTR(&frames[18], popOne(ring));
+    TEST_ASSERT_EQUAL_PTR(&frames[19], popOne(ring));
+    TEST_ASSERT_NULL(popOne(ring));
+    delete[] frames;
+}
+
+void test_producer_and_consumer_threads() {
+    const size_t FRAMES = 200000;
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.init(4));
+    camera_fb_t* frames = makeFrames(FRAMES);
+
+    std::atomic<bool> producing(true);
+    size_t evicted = 0;
+    std::thread producer([&] {
+        for (size_t i = 0; i < FRAMES; i++) {
+            // DROP_OLDEST, as TaskSender::acquireSlot() does it
+            FrameSlot* slot = ring.acquire(4);
+            camera_fb_t* oldest = nullptr;
+            while (!slot) {
+                if (ring.evict(oldest)) {
+                    evicted++;
+                }
+                slot = ring.acquire(4);
+            }
+            slot->fb = &frames[i];
+            slot->headerLen = 0;
+            ring.commit();
+        }
+        producing = false;
+    });
+
+    size_t popped = 0;
+    size_t last = 0;
+    bool ordered = true;
+    while (true) {
+        bool more = producing.load();
+        FrameSlot* slot;
+        while ((slot = ring.pop()) != nullptr) {
+            size_t id = slot->fb->len;
+            ordered = ordered && (popped == 0 || id > last);
+            last = id;
+            popped++;
+            ring.done(slot);
+        }
+        if (!more) {
+            break;
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL(FRAMES - 1, last);
+    TEST_ASSERT_EQUAL(FRAMES, popped + evicted);
+    delete[] frames;
+}
+
+// TaskSender
+
+class ListSource : public FrameSource {
+public:
+    camera_fb_t* get_frame() override { return nullptr; }
+    void return_frame(camera_fb_t* frame) override { returned++; }
+    void frame_sent(camera_fb_t* frame) override { sent.push_back(frame->len); }
+
+    std::atomic<int> returned{0};
+    std::vector<size_t> sent;
+};
+
+// Holds the send task in sendv() until opened
+class GateTransport : public StreamTransport {
+public:
+    bool connect(const char* url) override { return true; }
+    void disconnect() override {}
+    bool isConnected() const override { return true; }
+    bool send(const uint8_t* data, size_t len) override { return true; }
+    bool sendv(const StreamIovec* iov, size_t count) override {
+        entered++;
+        while (!open) {
+            vTaskDelay(1);
+        }
+        return true;
+    }
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override { return 0; }
+    uint64_t getBytesSent() const override { return 0; }
+    const char* getLastError() const override { return ""; }
+    esp_http_client_handle_t getHttpClient() const override { return nullptr; }
+
+    std::atomic<int> entered{0};
+    std::atomic<bool> open{false};
+};
+
+static bool waitFor(const std::atomic<int>& value, int target) {
+    for (int i = 0; i < 2000 && value.load() < target; i++) {
+        usleep(1000);
+    }
+    return value.load() >= target;
+}
+
+struct PolicyRun {
+    StreamConfig config;
+    GateTransport transport;
+    ListSource source;
+    camera_fb_t* frames = makeFrames(11);
+    TaskSender* sender = nullptr;
+
+    ~PolicyRun() {
+        delete sender;
+        delete[] frames;
+    }
+
+    bool enqueue(camera_fb_t* fb) {
+        FrameSlot* slot = sender->acquireSlot();
+        if (!slot) {
+            source.return_frame(fb);
+            return false;
+        }
+        slot->headerLen = 0;
+        return sender->commitFrame(slot, fb);
+    }
+
+    // Frame 0 is held in sendv() while 1..4 arrive for a queue of 2
+    void run(FrameDropPolicy policy) {
+        config.taskQueueSize = 2;
+        config.dropPolicy = policy;
+        config.taskDelayMs = 0;
+        config.maxFrameAgeMs = 0;
+        sender = new TaskSender(&transport, &source, config);
+        TEST_ASSERT_TRUE(sender->start());
+
+        TEST_ASSERT_TRUE(enqueue(&frames[0]));
+        TEST_ASSERT_TRUE(waitFor(transport.entered, 1));
+        for (int i = 1; i < 5; i++) {
+            enqueue(&frames[i]);
+        }
+        TEST_ASSERT_EQUAL(2, sender->getQueueCount());
+
+        transport.open = true;
+        for (int i = 0; i < 2000 && sender->getFramesSent() < 3; i++) {
+            usleep(1000);
+        }
+        TEST_ASSERT_EQUAL(3, sender->getFramesSent());
+    }
+};
+
+void test_sender_drop_newest() {
+    PolicyRun run;
+    run.run(FrameDropPolicy::DROP_NEWEST);
+
+    TEST_ASSERT_EQUAL(2, run.sender->getDropCount(DropReason::QUEUE_FULL));
+    TEST_ASSERT_EQUAL(0, run.sender->getDropCount(DropReason::EVICTED));
+    TEST_ASSERT_EQUAL(3, run.source.sent.size());
+    TEST_ASSERT_EQUAL(0, run.source.sent[0]);
+    TEST_ASSERT_EQUAL(1, run.source.sent[1]);
+    TEST_ASSERT_EQUAL(2, run.source.sent[2]);
+    // Every frame handed back exactly once
+    TEST_ASSERT_EQUAL(5, run.source.returned.load());
+}
+
+void test_sender_drop_oldest() {
+    PolicyRun run;
+    run.run(FrameDropPolicy::DROP_OLDEST);
+
+    TEST_ASSERT_EQUAL(0, run.sender->getDropCount(DropReason::QUEUE_FULL));
+    TEST_ASSERT_EQUAL(2, run.sender->getDropCount(DropReason::EVICTED));
+    TEST_ASSERT_EQUAL(3, run.source.sent.size());
+    TEST_ASSERT_EQUAL(0, run.source.sent[0]);
+    TEST_ASSERT_EQUAL(3, run.source.sent[1]);
+    TEST_ASSERT_EQUAL(4, run.source.sent[2]);
+    TEST_ASSERT_EQUAL(5, run.source.returned.load());
+}
+
+// The default 16-frame DROP_OLDEST queue on the default pool of 8 camera
+// buffers: one is captured into and one is sent, so 6 can queue. Frame 0
+// is held in sendv() while 1..10 arrive; without the cap none would be
+// evicted and the camera would run out of buffers instead.
+void test_sender_frame_budget_caps_queue() {
+    PolicyRun run;
+    run.config.taskDelayMs = 0;
+    run.config.maxFrameAgeMs = 0;
+    run.sender = new TaskSender(&run.transport, &run.source, run.config);
+    TEST_ASSERT_TRUE(run.sender->start());
+    run.sender->setFrameBudget(8 - 2);
+    TEST_ASSERT_EQUAL(6, run.sender->getQueueLimit());
+
+    TEST_ASSERT_TRUE(run.enqueue(&run.frames[0]));
+    TEST_ASSERT_TRUE(waitFor(run.transport.entered, 1));
+    for (int i = 1; i < 11; i++) {
+        TEST_ASSERT_TRUE(run.enqueue(&run.frames[i]));
+    }
+    TEST_ASSERT_EQUAL(6, run.sender->getQueueCount());
+    TEST_ASSERT_EQUAL(4, run.sender->getDropCount(DropReason::EVICTED));
+    TEST_ASSERT_EQUAL(0, run.sender->getDropCount(DropReason::QUEUE_FULL));
+
+    run.transport.open = true;
+    for (int i = 0; i < 2000 && run.sender->getFramesSent() < 7; i++) {
+        usleep(1000);
+    }
+    TEST_ASSERT_EQUAL(7, run.source.sent.size());
+    TEST_ASSERT_EQUAL(0, run.source.sent[0]);
+    TEST_ASSERT_EQUAL(5, run.source.sent[1]);
+    TEST_ASSERT_EQUAL(10, run.source.sent[6]);
+    TEST_ASSERT_EQUAL(11, run.source.returned.load());
+
+    // A budget above the configured depth does not raise it
+    run.sender->setFrameBudget(64);
+    TEST_ASSERT_EQUAL(16, run.sender->getQueueLimit());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_capacity_rounds_up);
+    RUN_TEST(test_empty_ring);
+    RUN_TEST(test_fifo_order_across_wraparound);
+    RUN_TEST(test_acquire_stops_at_limit);
+    RUN_TEST(test_evict_takes_the_oldest);
+    RUN_TEST(test_claimed_frame_cannot_be_evicted);
+    RUN_TEST(test_sending_slot_survives_evictions);
+    RUN_TEST(test_producer_and_consumer_threads);
+    RUN_TEST(test_sender_drop_newest);
+    RUN_TEST(test_sender_drop_oldest);
+    RUN_TEST(test_sender_frame_budget_caps_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+// MultipartHeader::format(): the template renders the same values as the
+// snprintf it replaced, only padded, and falls back to snprintf for a
+// boundary too long for the template.
+
+#include <unity.h>
+#include "MultipartHeader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+struct Parsed {
+    std::string boundary;
+    unsigned long length;
+    long seconds;
+    std::string micros;
+};
+
+// Splits a part header into its values, allowing whitespace after each colon
+static bool parse(const std::string& header, Parsed& out) {
+    const std::string start = "\r\n--";
+    const std::string end = "\r\n\r\n";
+    if (header.compare(0, start.size(), start) != 0 || header.size() < end.size() ||
+        header.compare(header.size() - end.size(), end.size(), end) != 0) {
+        return false;
+    }
+
+    size_t eol = header.find("\r\n", start.size());
+    out.boundary = header.substr(start.size(), eol - start.size());
+
+    const char* type = strstr(header.c_str(), "\r\nContent-Type: image/jpeg\r\n");
+    const char* length = strstr(header.c_str(), "\r\nContent-Length:");
+    const char* timestamp = strstr(header.c_str(), "\r\nX-Timestamp:");
+    if (!type || !length || !timestamp) {
+        return false;
+    }
+
+    char* after = nullptr;
+    out.length = strtoul(length + strlen("\r\nContent-Length:"), &after, 10);
+    if (strncmp(after, "\r\n", 2) != 0) {
+        return false;
+    }
+    out.seconds = strtol(timestamp + strlen("\r\nX-Timestamp:"), &after, 10);
+    if (*after != '.') {
+        return false;
+    }
+    out.micros = std::string(after + 1, strcspn(after + 1, "\r"));
+    return true;
+}
+
+static std::string viaSnprintf(const char* boundary, const camera_fb_t& fb) {
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf), "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n",
+                       boundary, (unsigned)fb.len, (int)fb.timestamp.tv_sec, (int)fb.timestamp.tv_usec);
+    return std::string(buf, len);
+}
+
+static std::string viaTemplate(const MultipartHeader& header, const camera_fb_t& fb) {
+    char buf[256];
+    size_t len = header.format(&fb, buf, sizeof(buf));
+    return std::string(buf, len);
+}
+
+static camera_fb_t frame(size_t len, long seconds, long micros) {
+    camera_fb_t fb = {};
+    fb.len = len;
+    fb.timestamp.tv_sec = seconds;
+    fb.timestamp.tv_usec = micros;
+    return fb;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_same_values_as_snprintf() {
+    MultipartHeader header("wheelbot");
+    const camera_fb_t frames[] = {
+        frame(0, 0, 0),
+        frame(1, 1, 1),
+        frame(23456, 1234, 567890),
+        frame(4294967295UL, 2147483647L, 999999),
+        frame(99999, 1700000000L, 40),
+    };
+
+    for (const camera_fb_t& fb : frames) {
+        Parsed expected;
+        Parsed actual;
+        TEST_ASSERT_TRUE(parse(viaSnprintf("wheelbot", fb), expected));
+        TEST_ASSERT_TRUE(parse(viaTemplate(header, fb), actual));
+        TEST_ASSERT_EQUAL_STRING(expected.boundary.c_str(), actual.boundary.c_str());
+        TEST_ASSERT_EQUAL_UINT32(expected.length, actual.length);
+        TEST_ASSERT_EQUAL(expected.seconds, actual.seconds);
+        TEST_ASSERT_EQUAL_STRING(expected.micros.c_str(), actual.micros.c_str());
+    }
+}
+
+void test_length_does_not_depend_on_values() {
+    MultipartHeader header("wheelbot");
+    size_t small = viaTemplate(header, frame(1, 1, 1)).size();
+    size_t large = viaTemplate(header, frame(4294967295UL, 2147483647L, 999999)).size();
+    TEST_ASSERT_GREATER_THAN(0, small);
+    TEST_ASSERT_EQUAL(small, large);
+}
+
+void test_buffer_too_small() {
+    MultipartHeader header("wheelbot");
+    camera_fb_t fb = frame(23456, 1234, 567890);
+    size_t needed = viaTemplate(header, fb).size();
+
+    char buf[256];
+    TEST_ASSERT_EQUAL(0, header.format(&fb, buf, needed - 1));
+    TEST_ASSERT_EQUAL(needed, header.format(&fb, buf, needed));
+}
+
+void test_long_boundary_falls_back_to_snprintf() {
+    std::string boundary(120, 'b');
+    MultipartHeader header(boundary.c_str());
+    camera_fb_t fb = frame(23456, 1234, 567890);
+
+    TEST_ASSERT_EQUAL_STRING(viaSnprintf(boundary.c_str(), fb).c_str(), viaTemplate(header, fb).c_str());
+
+    char small[64];
+    TEST_ASSERT_EQUAL(0, header.format(&fb, small, sizeof(small)));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_same_values_as_snprintf);
+    RUN_TEST(test_length_does_not_depend_on_values);
+    RUN_TEST(test_buffer_too_small);
+    RUN_TEST(test_long_boundary_falls_back_to_snprintf);
+    return UNITY_END();
+}
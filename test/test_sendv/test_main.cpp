@@ -0,0 +1,179 @@
+// StreamTransport::sendv(): the default loop over send(), and the vectored
+// overrides of the HTTP transports against a loopback server. A frame sent
+// with one sendv() must reach the server byte for byte like the header and
+// payload sent with two send() calls, as TaskSender did before.
+
+#include <unity.h>
+#include "../LoopbackServer.h"
+#include "HttpStreamTransport.h"
+#include "RawTcpStreamTransport.h"
+#include <string>
+#include <vector>
+
+#define FRAMES 200
+
+class RecordingTransport : public StreamTransport {
+public:
+    bool connect(const char* url) override { return true; }
+    void disconnect() override {}
+    bool isConnected() const override { return true; }
+    bool send(const uint8_t* data, size_t len) override {
+        if (sends.size() == failAt) {
+            return false;
+        }
+        sends.emplace_back((const char*)data, len);
+        return true;
+    }
+    size_t formatFrameHeader(const camera_fb_t* fb, char* buf, size_t bufSize) override { return 0; }
+    uint64_t getBytesSent() const override { return 0; }
+    const char* getLastError() const override { return ""; }
+    esp_http_client_handle_t getHttpClient() const override { return nullptr; }
+
+    std::vector<std::string> sends;
+    size_t failAt = SIZE_MAX;
+};
+
+static std::vector<uint8_t> makeJpeg(size_t len, uint8_t seed) {
+    std::vector<uint8_t> jpeg(len);
+    for (size_t i = 0; i < len; i++) {
+        jpeg[i] = (uint8_t)(i * 7 + seed);
+    }
+    jpeg[0] = 0xFF;
+    jpeg[1] = 0xD8;
+    jpeg[len - 2] = 0xFF;
+    jpeg[len - 1] = 0xD9;
+    return jpeg;
+}
+
+// Streams FRAMES frames of varying size; returns the bytes the transport was given
+static std::string streamFrames(StreamTransport& transport, bool vectored) {
+    std::string expected;
+    for (int i = 0; i < FRAMES; i++) {
+        std::vector<uint8_t> jpeg = makeJpeg(1000 + i * 37, (uint8_t)i);
+        camera_fb_t fb = {};
+        fb.buf = jpeg.data();
+        fb.len = jpeg.size();
+        fb.timestamp.tv_sec = 100 + i;
+        fb.timestamp.tv_usec = i * 1000;
+
+        char header[256];
+        size_t headerLen = transport.formatFrameHeader(&fb, header, sizeof(header));
+        TEST_ASSERT_GREATER_THAN(0, headerLen);
+
+        if (vectored) {
+            StreamIovec iov[2] = { { (const uint8_t*)header, headerLen }, { fb.buf, fb.len } };
+            TEST_ASSERT_TRUE(transport.sendv(iov, 2));
+        } else {
+            TEST_ASSERT_TRUE(transport.send((const uint8_t*)header, headerLen));
+            TEST_ASSERT_TRUE(transport.send(fb.buf, fb.len));
+        }
+        expected.append(header, headerLen);
+        expected.append((const char*)fb.buf, fb.len);
+    }
+    return expected;
+}
+
+template <typename Transport>
+static void checkSameBytes(UploadMode mode) {
+    StreamConfig config;
+    config.uploadMode = mode;
+
+    std::string bodies[2];
+    for (int vectored = 0; vectored < 2; vectored++) {
+        LoopbackServer server;
+        TEST_ASSERT_TRUE(server.start());
+        Transport transport(config);
+        TEST_ASSERT_TRUE(transport.connect(server.url().c_str()));
+
+        std::string expected = streamFrames(transport, vectored);
+        TEST_ASSERT_EQUAL_UINT64(expected.size(), transport.getBytesSent());
+        transport.disconnect();
+        server.waitClosed();
+
+        TEST_ASSERT_FALSE(server.framingError());
+        TEST_ASSERT_EQUAL_UINT64(expected.size(), server.body().size());
+        TEST_ASSERT_TRUE(server.body() == expected);
+        if (mode == UploadMode::CHUNKED) {
+            // One chunk per call: a frame sent with sendv() is one chunk
+            TEST_ASSERT_EQUAL_UINT64(vectored ? FRAMES : 2 * FRAMES, server.chunks());
+        }
+        bodies[vectored] = server.body();
+    }
+    TEST_ASSERT_TRUE(bodies[0] == bodies[1]);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_default_sendv_skips_empty_segments() {
+    RecordingTransport transport;
+    StreamIovec iov[3] = { { (const uint8_t*)"head", 4 }, { nullptr, 0 }, { (const uint8_t*)"jpeg", 4 } };
+    TEST_ASSERT_TRUE(transport.sendv(iov, 3));
+    TEST_ASSERT_EQUAL(2, transport.sends.size());
+    TEST_ASSERT_EQUAL_STRING("head", transport.sends[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("jpeg", transport.sends[1].c_str());
+}
+
+void test_default_sendv_stops_at_first_failure() {
+    RecordingTransport transport;
+    transport.failAt = 1;
+    StreamIovec iov[3] = { { (const uint8_t*)"a", 1 }, { (const uint8_t*)"b", 1 }, { (const uint8_t*)"c", 1 } };
+    TEST_ASSERT_FALSE(transport.sendv(iov, 3));
+    TEST_ASSERT_EQUAL(1, transport.sends.size());
+}
+
+void test_raw_tcp_sendv_matches_separate_sends() {
+    checkSameBytes<RawTcpStreamTransport>(UploadMode::CONTENT_LENGTH);
+}
+
+void test_raw_tcp_chunked_sendv_is_one_chunk_per_frame() {
+    checkSameBytes<RawTcpStreamTransport>(UploadMode::CHUNKED);
+}
+
+// More segments than one sendmsg() takes: MSG_MORE goes on every batch but
+// the last, and the frame must still arrive whole and in order
+void test_raw_tcp_msg_more_across_batches() {
+    StreamConfig config;
+    config.tcpMsgMore = true;
+
+    LoopbackServer server;
+    TEST_ASSERT_TRUE(server.start());
+    RawTcpStreamTransport transport(config);
+    TEST_ASSERT_TRUE(transport.connect(server.url().c_str()));
+
+    std::vector<uint8_t> jpeg = makeJpeg(20000, 3);
+    StreamIovec iov[20];
+    std::string expected;
+    for (size_t i = 0; i < 20; i++) {
+        iov[i] = { jpeg.data() + i * 1000, 1000 };
+    }
+    expected.append((const char*)jpeg.data(), jpeg.size());
+    TEST_ASSERT_TRUE(transport.sendv(iov, 20));
+    TEST_ASSERT_TRUE(transport.sendv(iov, 3));
+    expected.append((const char*)jpeg.data(), 3000);
+
+    TEST_ASSERT_EQUAL_UINT64(expected.size(), transport.getBytesSent());
+    transport.disconnect();
+    server.waitClosed();
+    TEST_ASSERT_TRUE(server.body() == expected);
+}
+
+void test_http_sendv_matches_separate_sends() {
+    checkSameBytes<HttpStreamTransport>(UploadMode::CONTENT_LENGTH);
+}
+
+void test_http_chunked_sendv_is_one_chunk_per_frame() {
+    checkSameBytes<HttpStreamTransport>(UploadMode::CHUNKED);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_default_sendv_skips_empty_segments);
+    RUN_TEST(test_default_sendv_stops_at_first_failure);
+    RUN_TEST(test_raw_tcp_sendv_matches_separate_sends);
+    RUN_TEST(test_raw_tcp_chunked_sendv_is_one_chunk_per_frame);
+    RUN_TEST(test_raw_tcp_msg_more_across_batches);
+    RUN_TEST(test_http_sendv_matches_separate_sends);
+    RUN_TEST(test_http_chunked_sendv_is_one_chunk_per_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,49 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Subcommands of the native benchmark. Each parses its own options and
+// prints one JSON object to stdout; logs go to stderr.
+int runPipeline(int argc, char** argv);
+int runSendv(int argc, char** argv);
+int runRing(int argc, char** argv);
+int runHeader(int argc, char** argv);
+
+// User + system CPU time of this process, all threads
+uint64_t cpuTimeUs();
+// CPU time of the calling thread only
+uint64_t threadCpuTimeUs();
+uint64_t wallTimeUs();
+
+// Option values; exit with a message on a malformed number
+double parseNumber(const char* option, const char* value);
+
+// Flat JSON object on one line, fields in the order written
+class JsonWriter {
+public:
+    explicit JsonWriter(FILE* out = stdout);
+    ~JsonWriter();
+
+    JsonWriter& field(const char* name, const char* value);
+    JsonWriter& field(const char* name, const std::string& value) { return field(name, value.c_str()); }
+    JsonWriter& field(const char* name, uint64_t value);
+    JsonWriter& field(const char* name, uint32_t value) { return field(name, (uint64_t)value); }
+    JsonWriter& field(const char* name, int value);
+    JsonWriter& field(const char* name, double value);
+    JsonWriter& field(const char* name, bool value);
+    // Nested object; close with end()
+    JsonWriter& object(const char* name);
+    JsonWriter& end();
+
+private:
+    void _key(const char* name);
+
+    FILE* _out;
+    int _depth = 0;
+    bool _first = true;
+};
+
+#endif
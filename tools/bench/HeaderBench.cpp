@@ -0,0 +1,128 @@
+// header: formatting the multipart part header in front of every frame.
+// "snprintf" is MultipartHeader::format() before the template, "template"
+// is the current one. Lengths and timestamps change on every call, as they
+// do from frame to frame.
+
+#include "Bench.h"
+#include "MultipartHeader.h"
+#include <cstdio>
+#include <string>
+
+namespace {
+
+struct HeaderOptions {
+    uint32_t iterations = 2000000;
+    std::string boundary = "wheelbot";
+    uint32_t rounds = 5;
+};
+
+// MultipartHeader::format() before the template
+size_t formatSnprintf(const char* boundary, const camera_fb_t* fb, char* buf, size_t bufSize) {
+    const char* PART_HEADER = "\r\n--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
+    int len = snprintf(buf, bufSize, PART_HEADER, boundary, (unsigned)fb->len, (int)fb->timestamp.tv_sec,
+                       (int)fb->timestamp.tv_usec);
+    return len < 0 ? 0 : (size_t)len;
+}
+
+void usage() {
+    fprintf(stderr,
+            "Usage: program header [options]\n"
+            "  --iterations N       headers per round (2000000)\n"
+            "  --rounds N           rounds per mode, the fastest is reported (5)\n"
+            "  --boundary S         multipart boundary (wheelbot)\n");
+}
+
+bool parseArgs(int argc, char** argv, HeaderOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h" || !value) {
+            return false;
+        }
+        i++;
+
+        if (arg == "--iterations") {
+            options.iterations = (uint32_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--rounds") {
+            options.rounds = (uint32_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--boundary") {
+            options.boundary = value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.iterations > 0 && options.rounds > 0;
+}
+
+// Nanoseconds per header; bytes and checksum keep the output live
+template <typename Format>
+double timeRound(uint32_t iterations, Format format, uint64_t& bytes, uint32_t& checksum) {
+    camera_fb_t fb = {};
+    char buf[256];
+    uint64_t start = threadCpuTimeUs();
+    for (uint32_t i = 0; i < iterations; i++) {
+        // 8-40 KB frames, 25 fps timestamps
+        fb.len = 8000 + (i * 7919) % 32000;
+        fb.timestamp.tv_sec = 1700000000 + i / 25;
+        fb.timestamp.tv_usec = (i % 25) * 40000 + i % 1000;
+        size_t len = format(&fb, buf, sizeof(buf));
+        bytes += len;
+        checksum += (uint8_t)buf[len / 2];
+    }
+    return (threadCpuTimeUs() - start) * 1000.0 / iterations;
+}
+
+}
+
+int runHeader(int argc, char** argv) {
+    HeaderOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    const char* boundary = options.boundary.c_str();
+    MultipartHeader header(boundary);
+    auto viaSnprintf = [boundary](const camera_fb_t* fb, char* buf, size_t size) {
+        return formatSnprintf(boundary, fb, buf, size);
+    };
+    auto viaTemplate = [&header](const camera_fb_t* fb, char* buf, size_t size) {
+        return header.format(fb, buf, size);
+    };
+
+    double snprintfNs = 0;
+    double templateNs = 0;
+    uint64_t snprintfBytes = 0;
+    uint64_t templateBytes = 0;
+    uint32_t checksum = 0;
+    // Alternate so that neither mode always runs first
+    for (uint32_t round = 0; round < options.rounds; round++) {
+        for (int i = 0; i < 2; i++) {
+            bool useTemplate = (round + i) % 2 == 1;
+            uint64_t bytes = 0;
+            double ns = useTemplate ? timeRound(options.iterations, viaTemplate, bytes, checksum)
+                                    : timeRound(options.iterations, viaSnprintf, bytes, checksum);
+            double& best = useTemplate ? templateNs : snprintfNs;
+            (useTemplate ? templateBytes : snprintfBytes) = bytes;
+            best = round == 0 || ns < best ? ns : best;
+        }
+    }
+
+    JsonWriter json;
+    json.field("bench", "header")
+        .field("boundary", options.boundary)
+        .field("iterations", options.iterations)
+        .field("rounds", options.rounds);
+    json.object("snprintf")
+        .field("ns_per_header", snprintfNs)
+        .field("bytes_per_header", (double)snprintfBytes / options.iterations)
+        .end();
+    json.object("template")
+        .field("ns_per_header", templateNs)
+        .field("bytes_per_header", (double)templateBytes / options.iterations)
+        .end();
+    json.field("ratio", snprintfNs > 0 ? templateNs / snprintfNs : 0.0)
+        .field("checksum", checksum);
+    return 0;
+}
@@ -0,0 +1,313 @@
+// pipeline: the capture side of Streamer::loop() driven on the main thread
+// against the esp_camera shim, the send task and transport on top of the
+// FreeRTOS shim, and a StreamSink on loopback as the server.
+
+#include "Bench.h"
+#include "StreamSink.h"
+#include "Streamer.h"
+#include "native_camera.h"
+#include "esp_log.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+// Socket buffers when the link is throttled, so the kernels do not soak up
+// seconds of stream ahead of the read rate: the sink's receive buffer, and
+// the send buffer of the raw TCP and WebSocket transports at lwIP's default
+// TCP_SND_BUF (esp_http_client keeps the host's)
+#define LINK_RCVBUF 16384
+#define LINK_SNDBUF 5744
+
+namespace {
+
+struct PipelineOptions {
+    std::string framesDir;          // empty = synthetic frames
+    size_t frameBytes = 20000;
+    float cameraFps = 25;           // sensor rate, 0 = a frame whenever one is asked for
+    float maxFps = 0;               // StreamConfig::maxFPS, 0 = unpaced
+    std::string transport = "http";
+    std::string upload = "length";
+    std::string frameSize = "VGA";
+    std::string quality = "10";
+    size_t queue = 16;
+    std::string dropPolicy = "oldest";
+    bool adaptive = false;          // StreamConfig::adaptiveQuality
+    double duration = 10;
+    double warmup = 2;
+    std::string url;                // empty = the local sink
+    uint64_t linkRate = 0;          // bytes/s the local sink reads, 0 = unthrottled
+    esp_log_level_t logLevel = ESP_LOG_WARN;
+};
+
+void usage() {
+    fprintf(stderr,
+            "Usage: program pipeline [options]\n"
+            "  --frames DIR         replay the .jpg files in DIR (default: synthetic frames)\n"
+            "  --frame-bytes N      size of a synthetic frame (20000)\n"
+            "  --fps N              camera frame rate, 0 = as fast as frames are taken (25)\n"
+            "  --max-fps N          StreamConfig::maxFPS, 0 = unpaced (0)\n"
+            "  --transport T        http | tcp | ws | rtp (http)\n"
+            "  --upload M           length | chunked (length)\n"
+            "  --frame-size S       camera frame size by name (VGA)\n"
+            "  --quality N          JPEG quality passed to the camera (10)\n"
+            "  --queue N            send queue depth, StreamConfig::taskQueueSize (16)\n"
+            "  --drop-policy P      newest | oldest | latest (oldest)\n"
+            "  --adaptive 0|1       StreamConfig::adaptiveQuality, targeting --max-fps or else --fps (0)\n"
+            "  --duration S         measured seconds (10)\n"
+            "  --warmup S           seconds run before measuring (2)\n"
+            "  --url URL            stream to this server instead of the local sink\n"
+            "  --link-rate N        local sink reads at most N bytes/s per connection, 0 = unthrottled (0)\n"
+            "  --log-level L        none | error | warn | info | debug (warn)\n");
+}
+
+bool parseArgs(int argc, char** argv, PipelineOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        }
+        if (!value) {
+            fprintf(stderr, "%s needs a value\n", arg.c_str());
+            return false;
+        }
+        i++;
+
+        if (arg == "--frames") {
+            options.framesDir = value;
+        } else if (arg == "--frame-bytes") {
+            options.frameBytes = (size_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--fps") {
+            options.cameraFps = (float)parseNumber(argv[i - 1], value);
+        } else if (arg == "--max-fps") {
+            options.maxFps = (float)parseNumber(argv[i - 1], value);
+        } else if (arg == "--transport") {
+            options.transport = value;
+        } else if (arg == "--upload") {
+            options.upload = value;
+        } else if (arg == "--frame-size") {
+            options.frameSize = value;
+        } else if (arg == "--quality") {
+            options.quality = value;
+        } else if (arg == "--queue") {
+            options.queue = (size_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--drop-policy") {
+            options.dropPolicy = value;
+        } else if (arg == "--adaptive") {
+            options.adaptive = parseNumber(argv[i - 1], value) != 0;
+        } else if (arg == "--duration") {
+            options.duration = parseNumber(argv[i - 1], value);
+        } else if (arg == "--warmup") {
+            options.warmup = parseNumber(argv[i - 1], value);
+        } else if (arg == "--url") {
+            options.url = value;
+        } else if (arg == "--link-rate") {
+            options.linkRate = (uint64_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--log-level") {
+            static const char* LEVELS[] = { "none", "error", "warn", "info", "debug" };
+            bool found = false;
+            for (int level = 0; level < 5; level++) {
+                if (strcmp(value, LEVELS[level]) == 0) {
+                    options.logLevel = (esp_log_level_t)level;
+                    found = true;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown log level: %s\n", value);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool buildConfig(const PipelineOptions& options, StreamConfig& config) {
+    if (options.transport == "http") {
+        config.transport = StreamTransportType::HTTP_CLIENT;
+    } else if (options.transport == "tcp") {
+        config.transport = StreamTransportType::RAW_TCP;
+    } else if (options.transport == "ws") {
+        config.transport = StreamTransportType::WEBSOCKET;
+    } else if (options.transport == "rtp") {
+        config.transport = StreamTransportType::RTP_UDP;
+    } else {
+        fprintf(stderr, "Unknown transport: %s\n", options.transport.c_str());
+        return false;
+    }
+
+    if (options.upload == "length") {
+        config.uploadMode = UploadMode::CONTENT_LENGTH;
+    } else if (options.upload == "chunked") {
+        config.uploadMode = UploadMode::CHUNKED;
+    } else {
+        fprintf(stderr, "Unknown upload mode: %s\n", options.upload.c_str());
+        return false;
+    }
+
+    if (options.dropPolicy == "newest") {
+        config.dropPolicy = FrameDropPolicy::DROP_NEWEST;
+    } else if (options.dropPolicy == "oldest") {
+        config.dropPolicy = FrameDropPolicy::DROP_OLDEST;
+    } else if (options.dropPolicy == "latest") {
+        config.dropPolicy = FrameDropPolicy::KEEP_LATEST;
+    } else {
+        fprintf(stderr, "Unknown drop policy: %s\n", options.dropPolicy.c_str());
+        return false;
+    }
+
+    // The benchmark thread is the capture task
+    config.captureTask = false;
+    config.maxFPS = options.maxFps;
+    config.taskQueueSize = options.queue;
+    if (options.linkRate > 0) {
+        config.tcpSendBufferSize = LINK_SNDBUF;
+    }
+    config.adaptiveQuality = options.adaptive;
+    config.adaptiveTargetFPS = (uint32_t)(options.maxFps > 0 ? options.maxFps : options.cameraFps);
+    config.latencyLogInterval = 0;
+    return true;
+}
+
+struct Snapshot {
+    uint64_t wallUs;
+    uint64_t cpuUs;
+    StreamCounters counters;
+    NativeCameraStats camera;
+    SinkTotals sink;
+};
+
+void takeSnapshot(const Streamer& streamer, const StreamSink& sink, Snapshot& out) {
+    out.wallUs = wallTimeUs();
+    out.cpuUs = cpuTimeUs();
+    streamer.getCounters(out.counters);
+    native_camera_get_stats(out.camera);
+    sink.read(out.sink);
+}
+
+void runFor(Streamer& streamer, double seconds) {
+    uint64_t end = wallTimeUs() + (uint64_t)(seconds * 1000000);
+    while (wallTimeUs() < end) {
+        streamer.loop();
+    }
+}
+
+}
+
+int runPipeline(int argc, char** argv) {
+    PipelineOptions options;
+    StreamConfig config;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    if (!buildConfig(options, config)) {
+        return 2;
+    }
+    esp_log_level_set("*", options.logLevel);
+
+    // Forked before the streamer starts any thread
+    StreamSink sink;
+    std::string url = options.url;
+    if (url.empty()) {
+        if (!sink.start(0, options.linkRate ? LINK_RCVBUF : 0, 0, options.linkRate)) {
+            return 1;
+        }
+        url = "http://127.0.0.1:" + std::to_string(sink.port()) + "/input";
+        config.rtpPort = sink.port();
+    }
+
+    if (!options.framesDir.empty()) {
+        if (!native_camera_replay_dir(options.framesDir.c_str())) {
+            return 1;
+        }
+    } else {
+        native_camera_synthetic(options.frameBytes);
+    }
+    native_camera_set_fps(options.cameraFps);
+
+    Streamer streamer(url.c_str(), options.frameSize.c_str(), options.quality.c_str(), config);
+    streamer.setup();
+    if (!streamer.isStreaming()) {
+        fprintf(stderr, "Could not connect to %s\n", url.c_str());
+        return 1;
+    }
+
+    runFor(streamer, options.warmup);
+    Snapshot begin;
+    takeSnapshot(streamer, sink, begin);
+    runFor(streamer, options.duration);
+    Snapshot end;
+    takeSnapshot(streamer, sink, end);
+
+    double seconds = (end.wallUs - begin.wallUs) / 1e6;
+    uint64_t framesSent = end.counters.framesSent - begin.counters.framesSent;
+    uint64_t bytesSent = end.counters.bytesSent - begin.counters.bytesSent;
+    uint64_t cpuUs = end.cpuUs - begin.cpuUs;
+    uint64_t sendUs = end.counters.sendTimeUs - begin.counters.sendTimeUs;
+    auto drops = [&](DropReason reason) {
+        return (uint64_t)(end.counters.framesDroppedBy[(size_t)reason] - begin.counters.framesDroppedBy[(size_t)reason]);
+    };
+
+    {
+        JsonWriter json;
+        json.field("bench", "pipeline")
+            .field("transport", options.transport)
+            .field("upload", options.upload)
+            .field("frame_size", options.frameSize)
+            .field("frame_bytes", (uint64_t)native_camera_average_bytes())
+            .field("camera_fps", (double)options.cameraFps)
+            .field("max_fps", (double)options.maxFps)
+            .field("link_rate", options.linkRate)
+            .field("queue_limit", (uint64_t)end.counters.queueLimit)
+            .field("seconds", seconds)
+            .field("frames_per_s", framesSent / seconds)
+            .field("bytes_per_s", bytesSent / seconds)
+            .field("cpu_percent", cpuUs / seconds / 1e4)
+            .field("cpu_us_per_frame", framesSent ? (double)cpuUs / framesSent : 0.0)
+            .field("capture_us_per_frame", streamer.getStats().captureUsPerFrame)
+            .field("send_us_per_frame", framesSent ? (double)sendUs / framesSent : 0.0)
+            .field("frames_captured", (uint64_t)(end.counters.framesCaptured - begin.counters.framesCaptured))
+            .field("frames_sent", framesSent)
+            .field("bytes_sent", bytesSent);
+        json.object("dropped")
+            .field("full", drops(DropReason::QUEUE_FULL))
+            .field("evicted", drops(DropReason::EVICTED))
+            .field("stale", drops(DropReason::STALE))
+            .field("offline", drops(DropReason::DISCONNECTED))
+            .end();
+        json.field("camera_overruns", (uint64_t)(end.camera.overruns - begin.camera.overruns))
+            .field("camera_timeouts", (uint64_t)(end.camera.timeouts - begin.camera.timeouts))
+            .field("reconnects", (uint64_t)(end.counters.reconnects - begin.counters.reconnects))
+            .field("send_errors", (uint64_t)(end.counters.sendErrors - begin.counters.sendErrors));
+        if (const QualityControllerStats* q = streamer.getQualityStats()) {
+            const char* frameSize = CameraModule::frameSizeName(q->frameSize);
+            json.object("adaptive")
+                .field("quality", q->quality)
+                .field("frame_size", frameSize ? frameSize : "")
+                .field("quality_changes", q->qualityChanges)
+                .field("frame_size_changes", q->frameSizeChanges)
+                .field("decision", q->lastDecision)
+                .end();
+        }
+        if (options.url.empty()) {
+            json.object("sink")
+                .field("frames", end.sink.frames - begin.sink.frames)
+                .field("bytes", end.sink.bytes - begin.sink.bytes)
+                .field("requests", end.sink.requests - begin.sink.requests)
+                .field("connections", end.sink.connections)
+                .field("errors", end.sink.errors)
+                .end();
+        }
+    }
+
+    // The send task and esp_timer thread run until exit; skip the teardown
+    // and the send errors the sink going away would log
+    esp_log_level_set("*", ESP_LOG_NONE);
+    fflush(stdout);
+    sink.stop();
+    _exit(0);
+}
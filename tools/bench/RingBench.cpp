@@ -0,0 +1,276 @@
+// ring: handing a frame from the capture side to the send task. "queue" is
+// the path TaskSender had before FrameRing: the header formatted into a
+// local buffer, copied into a FrameChunk with its 256-byte header array,
+// copied again by xQueueSend() and once more by xQueueReceive(), which the
+// send task polls with a 100 ms timeout. "ring" is the current one: the
+// header formatted straight into a FrameRing slot, the head index
+// published, and the send task woken by a task notification.
+//
+// The main thread is the producer, paced at --rate; the consumer is a task
+// on the FreeRTOS shim. On the host, queues and notifications both come
+// down to a mutex and condition variable, so the difference measured is the
+// copies and the locking, not the FreeRTOS scheduler.
+
+#include "Bench.h"
+#include "FrameRing.h"
+#include "LatencyHistogram.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+struct RingOptions {
+    uint32_t frames = 20000;
+    double rate = 1000;             // frames/s, 0 = back to back
+    size_t queue = 16;              // StreamConfig::taskQueueSize
+};
+
+// TaskSender's queue element before FrameRing, timestamp in esp_timer
+// microseconds (low 32 bits) instead of millis() so the latency can be
+// measured; same size
+struct FrameChunk {
+    camera_fb_t* fb;
+    char header[256];
+    size_t headerLen;
+    uint32_t timestamp;
+};
+
+// About what HttpStreamTransport puts in front of a VGA frame
+const char HEADER[] =
+    "\r\n--wheelbot\r\nContent-Type: image/jpeg\r\nContent-Length: 23456\r\n"
+    "X-Timestamp: 1234.567890\r\n\r\n";
+
+struct ModeResult {
+    uint64_t wallUs;
+    uint64_t producerCpuUs;
+    uint64_t consumerCpuUs;
+    uint32_t received;
+    uint32_t dropped;
+    LatencySnapshot latency;
+};
+
+// State shared with the consumer task
+struct Consumer {
+    bool ring;
+    FrameRing* frames;
+    QueueHandle_t queue;
+    LatencyHistogram latency;
+    std::atomic<uint32_t> received{0};
+    std::atomic<bool> running{true};
+    std::atomic<bool> ended{false};
+    uint64_t cpuUs = 0;
+    // Read from every header so the copies cannot be optimized away
+    uint32_t checksum = 0;
+};
+
+void consumerTask(void* parameter) {
+    Consumer* consumer = static_cast<Consumer*>(parameter);
+    uint64_t cpuStart = threadCpuTimeUs();
+
+    while (consumer->running) {
+        if (consumer->ring) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            FrameSlot* slot;
+            while ((slot = consumer->frames->pop()) != nullptr) {
+                consumer->latency.record((uint32_t)(esp_timer_get_time() - slot->trace.enqueueUs));
+                consumer->checksum += (uint8_t)slot->header[slot->headerLen - 1];
+                consumer->received++;
+                consumer->frames->done(slot);
+            }
+        } else {
+            FrameChunk chunk;
+            if (xQueueReceive(consumer->queue, &chunk, pdMS_TO_TICKS(100)) == pdPASS) {
+                consumer->latency.record((uint32_t)esp_timer_get_time() - chunk.timestamp);
+                consumer->checksum += (uint8_t)chunk.header[chunk.headerLen - 1];
+                consumer->received++;
+            }
+        }
+    }
+
+    consumer->cpuUs = threadCpuTimeUs() - cpuStart;
+    consumer->ended = true;
+    vTaskSuspend(nullptr);
+}
+
+void usage() {
+    fprintf(stderr,
+            "Usage: program ring [options]\n"
+            "  --frames N           frames per mode (20000)\n"
+            "  --rate N             frames/s offered, 0 = back to back (1000)\n"
+            "  --queue N            queue depth, StreamConfig::taskQueueSize (16)\n");
+}
+
+bool parseArgs(int argc, char** argv, RingOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h" || !value) {
+            return false;
+        }
+        i++;
+
+        if (arg == "--frames") {
+            options.frames = (uint32_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--rate") {
+            options.rate = parseNumber(argv[i - 1], value);
+        } else if (arg == "--queue") {
+            options.queue = (size_t)parseNumber(argv[i - 1], value);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.frames > 0 && options.queue > 0 && options.rate >= 0;
+}
+
+// Producer side of the old path: Streamer formatted into a stack buffer and
+// TaskSender::sendFrame() copied it into a FrameChunk for xQueueSend()
+bool enqueueChunk(QueueHandle_t queue, camera_fb_t* fb) {
+    char header[256];
+    size_t headerLen = sizeof(HEADER) - 1;
+    memcpy(header, HEADER, headerLen);
+
+    FrameChunk chunk;
+    chunk.fb = fb;
+    chunk.headerLen = headerLen;
+    memcpy(chunk.header, header, headerLen);
+    chunk.timestamp = (uint32_t)esp_timer_get_time();
+    return xQueueSend(queue, &chunk, pdMS_TO_TICKS(10)) == pdPASS;
+}
+
+// Producer side of TaskSender::acquireSlot() and commitFrame() with DROP_OLDEST
+bool enqueueSlot(FrameRing& ring, size_t limit, TaskHandle_t consumer, camera_fb_t* fb, uint32_t& evicted) {
+    FrameSlot* slot = ring.acquire(limit);
+    if (!slot) {
+        camera_fb_t* oldest = nullptr;
+        if (ring.evict(oldest)) {
+            evicted++;
+        }
+        slot = ring.acquire(limit);
+    }
+    if (!slot) {
+        return false;
+    }
+
+    slot->headerLen = sizeof(HEADER) - 1;
+    memcpy(slot->header, HEADER, slot->headerLen);
+    slot->fb = fb;
+    slot->trace.enqueueUs = esp_timer_get_time();
+    ring.commit();
+    xTaskNotifyGive(consumer);
+    return true;
+}
+
+bool runMode(const RingOptions& options, bool ring, ModeResult& result) {
+    Consumer consumer;
+    FrameRing frames;
+    consumer.ring = ring;
+    consumer.frames = &frames;
+    consumer.queue = nullptr;
+    if (ring ? !frames.init(options.queue)
+             : (consumer.queue = xQueueCreate(options.queue, sizeof(FrameChunk))) == nullptr) {
+        fprintf(stderr, "Could not allocate the %s\n", ring ? "ring" : "queue");
+        return false;
+    }
+
+    TaskHandle_t task = nullptr;
+    if (xTaskCreatePinnedToCore(consumerTask, "RingBench", 4096, &consumer, 5, &task, 1) != pdPASS) {
+        return false;
+    }
+
+    camera_fb_t fb = {};
+    uint32_t dropped = 0;
+    uint64_t period = options.rate > 0 ? (uint64_t)(1e6 / options.rate) : 0;
+    uint64_t cpuUs = 0;
+    uint64_t wallStart = wallTimeUs();
+    uint64_t due = wallStart;
+    for (uint32_t i = 0; i < options.frames; i++) {
+        if (period) {
+            // Like a sensor, no burst to catch up after the producer was preempted
+            uint64_t now = wallTimeUs();
+            if (due > now) {
+                usleep(due - now);
+            } else {
+                due = now;
+            }
+            due += period;
+        }
+
+        uint64_t cpuStart = threadCpuTimeUs();
+        bool queued = ring ? enqueueSlot(frames, options.queue, task, &fb, dropped)
+                           : enqueueChunk(consumer.queue, &fb);
+        if (!queued) {
+            dropped++;
+        }
+        cpuUs += threadCpuTimeUs() - cpuStart;
+    }
+
+    // Wait for the consumer to drain what was queued
+    for (int i = 0; i < 1000 && consumer.received + dropped < options.frames; i++) {
+        usleep(1000);
+    }
+    result.wallUs = wallTimeUs() - wallStart;
+
+    consumer.running = false;
+    xTaskNotifyGive(task);
+    for (int i = 0; i < 500 && !consumer.ended; i++) {
+        usleep(1000);
+    }
+    vTaskDelete(task);
+    if (consumer.queue) {
+        vQueueDelete(consumer.queue);
+    }
+
+    result.producerCpuUs = cpuUs;
+    result.consumerCpuUs = consumer.cpuUs;
+    result.received = consumer.received;
+    result.dropped = dropped;
+    consumer.latency.snapshot(result.latency);
+    return consumer.ended && result.received + dropped == options.frames;
+}
+
+void writeMode(JsonWriter& json, const char* name, const ModeResult& result, uint32_t frames) {
+    json.object(name)
+        .field("producer_cpu_us_per_frame", (double)result.producerCpuUs / frames)
+        .field("consumer_cpu_us_per_frame", result.received ? (double)result.consumerCpuUs / result.received : 0.0)
+        .field("latency_p50_us", result.latency.p50Us)
+        .field("latency_p99_us", result.latency.p99Us)
+        .field("latency_max_us", result.latency.maxUs)
+        .field("frames_per_s", frames / (result.wallUs / 1e6))
+        .field("received", result.received)
+        .field("dropped", result.dropped)
+        .end();
+}
+
+}
+
+int runRing(int argc, char** argv) {
+    RingOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    ModeResult queue = {};
+    ModeResult ring = {};
+    if (!runMode(options, false, queue) || !runMode(options, true, ring)) {
+        fprintf(stderr, "Consumer did not receive every frame\n");
+        return 1;
+    }
+
+    JsonWriter json;
+    json.field("bench", "ring")
+        .field("frames", options.frames)
+        .field("rate", options.rate)
+        .field("queue_depth", (uint64_t)options.queue)
+        .field("header_bytes", (uint64_t)(sizeof(HEADER) - 1));
+    writeMode(json, "queue", queue, options.frames);
+    writeMode(json, "ring", ring, options.frames);
+    return 0;
+}
@@ -0,0 +1,219 @@
+// sendv: the cost of handing one frame to a transport. "send" is the path
+// TaskSender took before StreamTransport::sendv(): the part header and the
+// JPEG as two send() calls, each taking the transport's lock and writing on
+// its own. "sendv" is one call with both segments. Only the sending thread's
+// CPU time is counted; the sink runs in its own process. The two modes
+// alternate over several rounds, each on a new connection, and the fastest
+// round of each is reported, so one preempted round does not decide the ratio.
+
+#include "Bench.h"
+#include "StreamSink.h"
+#include "HttpStreamTransport.h"
+#include "RawTcpStreamTransport.h"
+#include "esp_log.h"
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct SendvOptions {
+    std::string transport = "tcp";
+    std::string upload = "length";
+    size_t frameBytes = 1500;       // about a 96x96 frame; QVGA is 4-8 KB
+    uint32_t frames = 20000;
+    uint32_t rounds = 5;
+    int mss = 1436;                 // WiFi-sized segments, 0 = loopback default
+};
+
+struct ModeResult {
+    uint64_t cpuUs;
+    uint64_t wallUs;
+    uint64_t segments;
+    uint64_t bytes;
+    uint64_t sinkFrames;
+    uint64_t sinkErrors;
+    bool ok;
+};
+
+void usage() {
+    fprintf(stderr,
+            "Usage: program sendv [options]\n"
+            "  --transport T        http | tcp (tcp)\n"
+            "  --upload M           length | chunked (length)\n"
+            "  --frame-bytes N      JPEG size (1500)\n"
+            "  --frames N           frames per round (20000)\n"
+            "  --rounds N           rounds per mode, the fastest is reported (5)\n"
+            "  --mss N              segment size the sink advertises, 0 = loopback default (1436)\n");
+}
+
+bool parseArgs(int argc, char** argv, SendvOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--help" || arg == "-h" || !value) {
+            return false;
+        }
+        i++;
+
+        if (arg == "--transport") {
+            options.transport = value;
+        } else if (arg == "--upload") {
+            options.upload = value;
+        } else if (arg == "--frame-bytes") {
+            options.frameBytes = (size_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--frames") {
+            options.frames = (uint32_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--rounds") {
+            options.rounds = (uint32_t)parseNumber(argv[i - 1], value);
+        } else if (arg == "--mss") {
+            options.mss = (int)parseNumber(argv[i - 1], value);
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return (options.transport == "tcp" || options.transport == "http") &&
+           (options.upload == "length" || options.upload == "chunked") && options.frameBytes >= 4 &&
+           options.frames > 0 && options.rounds > 0;
+}
+
+StreamTransport* createTransport(const SendvOptions& options, const StreamConfig& config) {
+    if (options.transport == "http") {
+        return new HttpStreamTransport(config);
+    }
+    return new RawTcpStreamTransport(config);
+}
+
+bool waitClosed(const StreamSink& sink, uint64_t closedBefore) {
+    for (int i = 0; i < 500; i++) {
+        SinkTotals totals;
+        sink.read(totals);
+        if (totals.closed > closedBefore) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+ModeResult runMode(const SendvOptions& options, const StreamSink& sink, bool vectored) {
+    ModeResult result = {};
+    StreamConfig config;
+    config.uploadMode = options.upload == "chunked" ? UploadMode::CHUNKED : UploadMode::CONTENT_LENGTH;
+    // One request holds the whole round; there is no rollover here
+    config.maxDataSize = (uint64_t)options.frames * (options.frameBytes + 256);
+
+    std::vector<uint8_t> jpeg(options.frameBytes, 0x55);
+    jpeg[0] = 0xFF;
+    jpeg[1] = 0xD8;
+    jpeg[jpeg.size() - 2] = 0xFF;
+    jpeg[jpeg.size() - 1] = 0xD9;
+    camera_fb_t fb = {};
+    fb.buf = jpeg.data();
+    fb.len = jpeg.size();
+
+    SinkTotals before;
+    sink.read(before);
+
+    StreamTransport* transport = createTransport(options, config);
+    std::string url = "http://127.0.0.1:" + std::to_string(sink.port()) + "/input";
+    if (!transport->connect(url.c_str())) {
+        fprintf(stderr, "Connect to %s failed: %s\n", url.c_str(), transport->getLastError());
+        delete transport;
+        return result;
+    }
+
+    result.ok = true;
+    uint64_t cpuStart = threadCpuTimeUs();
+    uint64_t wallStart = wallTimeUs();
+    for (uint32_t i = 0; i < options.frames && result.ok; i++) {
+        fb.timestamp.tv_sec = i / 30;
+        fb.timestamp.tv_usec = (i % 30) * 33333;
+        char header[256];
+        size_t headerLen = transport->formatFrameHeader(&fb, header, sizeof(header));
+
+        if (vectored) {
+            StreamIovec iov[2] = { { (const uint8_t*)header, headerLen }, { fb.buf, fb.len } };
+            result.ok = transport->sendv(iov, 2);
+        } else {
+            result.ok = transport->send((const uint8_t*)header, headerLen) && transport->send(fb.buf, fb.len);
+        }
+    }
+    result.cpuUs = threadCpuTimeUs() - cpuStart;
+    result.wallUs = wallTimeUs() - wallStart;
+    result.bytes = transport->getBytesSent();
+
+    transport->disconnect();
+    delete transport;
+    result.ok = waitClosed(sink, before.closed) && result.ok;
+
+    SinkTotals after;
+    sink.read(after);
+    result.segments = after.segments - before.segments;
+    result.sinkFrames = after.frames - before.frames;
+    result.sinkErrors = after.errors - before.errors;
+    return result;
+}
+
+void writeMode(JsonWriter& json, const char* name, const ModeResult& result, uint32_t frames) {
+    json.object(name)
+        .field("cpu_us_per_frame", (double)result.cpuUs / frames)
+        .field("wall_us_per_frame", (double)result.wallUs / frames)
+        .field("segments_per_frame", (double)result.segments / frames)
+        .field("bytes", result.bytes)
+        .field("sink_frames", result.sinkFrames)
+        .field("sink_errors", result.sinkErrors)
+        .end();
+}
+
+}
+
+int runSendv(int argc, char** argv) {
+    SendvOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    StreamSink sink;
+    if (!sink.start(0, 0, options.mss)) {
+        return 1;
+    }
+
+    ModeResult send = {};
+    ModeResult sendv = {};
+    uint64_t sinkErrors = 0;
+    for (uint32_t round = 0; round < options.rounds; round++) {
+        for (int i = 0; i < 2; i++) {
+            bool vectored = (round + i) % 2 == 1;
+            ModeResult result = runMode(options, sink, vectored);
+            if (!result.ok) {
+                return 1;
+            }
+            sinkErrors += result.sinkErrors;
+            ModeResult& best = vectored ? sendv : send;
+            if (round == 0 || result.cpuUs < best.cpuUs) {
+                best = result;
+            }
+        }
+    }
+
+    {
+        JsonWriter json;
+        json.field("bench", "sendv")
+            .field("transport", options.transport)
+            .field("upload", options.upload)
+            .field("frame_bytes", (uint64_t)options.frameBytes)
+            .field("frames", options.frames)
+            .field("rounds", options.rounds)
+            .field("mss", options.mss);
+        writeMode(json, "send", send, options.frames);
+        writeMode(json, "sendv", sendv, options.frames);
+        json.field("cpu_ratio", send.cpuUs ? (double)sendv.cpuUs / send.cpuUs : 0.0)
+            .field("segment_ratio", send.segments ? (double)sendv.segments / send.segments : 0.0)
+            .field("sink_errors", sinkErrors);
+    }
+    return sinkErrors ? 1 : 0;
+}
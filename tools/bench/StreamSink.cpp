@@ -0,0 +1,499 @@
+#include "StreamSink.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <new>
+#include <string>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+// glibc's struct tcp_info stops before the segment counters
+#include <linux/tcp.h>
+#else
+#include <netinet/tcp.h>
+#endif
+
+#define MAX_HEAD_BYTES 8192
+#define MAX_PART_HEADER_BYTES 1024
+
+namespace {
+
+// Buffered reads from a connection; bodies are handed out in place.
+// With a read rate, each read waits until the bytes so far are due.
+class Reader {
+public:
+    Reader(int sock, uint64_t readRate) : _sock(sock), _readRate(readRate) {}
+
+    bool readByte(uint8_t& c) {
+        if (_pos == _len && !_fill()) {
+            return false;
+        }
+        c = _buf[_pos++];
+        return true;
+    }
+
+    // Up to and including CRLF CRLF, or a single CRLF-terminated line
+    bool readUntil(std::string& out, const char* terminator, size_t limit) {
+        out.clear();
+        size_t termLen = strlen(terminator);
+        uint8_t c;
+        while (out.size() < limit && readByte(c)) {
+            out += (char)c;
+            if (out.size() >= termLen && out.compare(out.size() - termLen, termLen, terminator) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename F>
+    bool consume(uint64_t n, F&& fn) {
+        while (n > 0) {
+            if (_pos == _len && !_fill()) {
+                return false;
+            }
+            size_t take = (size_t)std::min<uint64_t>(n, _len - _pos);
+            fn(_buf + _pos, take);
+            _pos += take;
+            n -= take;
+        }
+        return true;
+    }
+
+private:
+    bool _fill() {
+        ssize_t n;
+        do {
+            n = recv(_sock, _buf, sizeof(_buf), 0);
+        } while (n < 0 && errno == EINTR);
+        _pos = 0;
+        _len = n > 0 ? (size_t)n : 0;
+        if (n > 0 && _readRate > 0) {
+            _throttle((size_t)n);
+        }
+        return n > 0;
+    }
+
+    void _throttle(size_t bytes) {
+        auto now = std::chrono::steady_clock::now();
+        if (_read == 0) {
+            _start = now;
+        }
+        _read += bytes;
+        auto due = _start + std::chrono::microseconds(_read * 1000000 / _readRate);
+        if (due > now) {
+            std::this_thread::sleep_for(due - now);
+        }
+    }
+
+    int _sock;
+    uint64_t _readRate;
+    uint64_t _read = 0;
+    std::chrono::steady_clock::time_point _start;
+    uint8_t _buf[65536];
+    size_t _pos = 0;
+    size_t _len = 0;
+};
+
+// multipart/x-mixed-replace body: part headers are buffered, bodies are
+// skipped by their Content-Length with only the JPEG markers checked
+class PartParser {
+public:
+    PartParser(std::atomic<uint64_t>& frames, std::atomic<uint64_t>& errors) : _frames(frames), _errors(errors) {}
+
+    void feed(const uint8_t* data, size_t len) {
+        while (len > 0) {
+            if (_closed) {
+                return;
+            }
+            if (_remaining == 0) {
+                _header += (char)*data++;
+                len--;
+                _parseHeader();
+                continue;
+            }
+
+            size_t take = (size_t)std::min<uint64_t>(len, _remaining);
+            for (size_t i = 0; i < take; i++) {
+                if (_seen < 2) {
+                    _first[_seen] = data[i];
+                }
+                _seen++;
+                _last[0] = _last[1];
+                _last[1] = data[i];
+            }
+            data += take;
+            len -= take;
+            _remaining -= take;
+            if (_remaining == 0) {
+                _endPart();
+            }
+        }
+    }
+
+private:
+    void _parseHeader() {
+        // Leading CRLFs separate the previous part from the boundary
+        if (_header == "\r" || _header == "\r\n") {
+            if (_header == "\r\n") {
+                _header.clear();
+            }
+            return;
+        }
+        if (_header.size() > MAX_PART_HEADER_BYTES) {
+            _errors++;
+            _header.clear();
+            return;
+        }
+        size_t end = _header.size();
+        if (end >= 4 && _header.compare(0, 2, "--") == 0 && _header.compare(end - 2, 2, "\r\n") == 0 &&
+            _header.find("\r\n") == end - 2 && _header.compare(end - 4, 2, "--") == 0) {
+            _closed = true;
+            return;
+        }
+        if (end < 4 || _header.compare(end - 4, 4, "\r\n\r\n") != 0) {
+            return;
+        }
+
+        const char* length = strcasestr(_header.c_str(), "\r\nContent-Length:");
+        if (_header.compare(0, 2, "--") != 0 || !length) {
+            _errors++;
+            _header.clear();
+            return;
+        }
+        _remaining = strtoull(length + strlen("\r\nContent-Length:"), nullptr, 10);
+        _jpeg = strcasestr(_header.c_str(), "image/jpeg") != nullptr;
+        _seen = 0;
+        _header.clear();
+        if (_remaining == 0) {
+            _endPart();
+        }
+    }
+
+    void _endPart() {
+        bool ok = !_jpeg || (_seen >= 4 && _first[0] == 0xFF && _first[1] == 0xD8 &&
+                             _last[0] == 0xFF && _last[1] == 0xD9);
+        if (ok) {
+            _frames++;
+        } else {
+            _errors++;
+        }
+    }
+
+    std::atomic<uint64_t>& _frames;
+    std::atomic<uint64_t>& _errors;
+    std::string _header;
+    uint64_t _remaining = 0;
+    uint64_t _seen = 0;
+    uint8_t _first[2] = {};
+    uint8_t _last[2] = {};
+    bool _jpeg = false;
+    bool _closed = false;
+};
+
+bool sendAll(int sock, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        ssize_t n = send(sock, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+std::string headerValue(const std::string& head, const char* name) {
+    std::string key = std::string("\r\n") + name + ":";
+    const char* p = strcasestr(head.c_str(), key.c_str());
+    if (!p) {
+        return "";
+    }
+    p += key.size();
+    while (*p == ' ') {
+        p++;
+    }
+    const char* end = strstr(p, "\r\n");
+    return std::string(p, end ? end - p : strlen(p));
+}
+
+}
+
+StreamSink::~StreamSink() {
+    stop();
+}
+
+bool StreamSink::start(uint16_t port, int rcvBuf, int mss, uint64_t readRate) {
+    void* mem = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("sink: mmap");
+        return false;
+    }
+    _shared = new (mem) Shared();
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (rcvBuf > 0) {
+        // Inherited by accepted connections
+        setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+    }
+    if (mss > 0) {
+        // Advertised in the SYN-ACK, so the sender's segments are at most this
+        setsockopt(listener, IPPROTO_TCP, TCP_MAXSEG, &mss, sizeof(mss));
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t addrLen = sizeof(addr);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 8) != 0 ||
+        getsockname(listener, (sockaddr*)&addr, &addrLen) != 0) {
+        perror("sink: listen");
+        close(listener);
+        return false;
+    }
+    _port = ntohs(addr.sin_port);
+
+    // RTP goes to the same port number over UDP
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    if (bind(udp, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("sink: udp bind");
+        close(udp);
+        udp = -1;
+    }
+
+    _pid = fork();
+    if (_pid < 0) {
+        perror("sink: fork");
+        close(listener);
+        if (udp >= 0) {
+            close(udp);
+        }
+        return false;
+    }
+    if (_pid == 0) {
+        signal(SIGPIPE, SIG_IGN);
+        _serve(listener, udp, _shared, readRate);
+        _exit(0);
+    }
+
+    close(listener);
+    if (udp >= 0) {
+        close(udp);
+    }
+    return true;
+}
+
+void StreamSink::stop() {
+    if (_pid > 0) {
+        kill(_pid, SIGKILL);
+        waitpid(_pid, nullptr, 0);
+        _pid = -1;
+    }
+    if (_shared) {
+        munmap(_shared, sizeof(Shared));
+        _shared = nullptr;
+    }
+}
+
+void StreamSink::read(SinkTotals& out) const {
+    out = {};
+    if (!_shared) {
+        return;
+    }
+    out.connections = _shared->connections.load();
+    out.closed = _shared->closed.load();
+    out.requests = _shared->requests.load();
+    out.frames = _shared->frames.load();
+    out.bytes = _shared->bytes.load();
+    out.chunks = _shared->chunks.load();
+    out.errors = _shared->errors.load();
+    out.segments = _shared->segments.load();
+}
+
+void StreamSink::_serve(int listener, int udp, Shared* shared, uint64_t readRate) {
+    if (udp >= 0) {
+        std::thread(_serveDatagrams, udp, shared).detach();
+    }
+    while (true) {
+        int sock = accept(listener, nullptr, nullptr);
+        if (sock < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("sink: accept");
+            return;
+        }
+        shared->connections++;
+        std::thread(_serveConnection, sock, shared, readRate).detach();
+    }
+}
+
+void StreamSink::_serveConnection(int sock, Shared* shared, uint64_t readRate) {
+    Reader reader(sock, readRate);
+    std::string head;
+
+    while (reader.readUntil(head, "\r\n\r\n", MAX_HEAD_BYTES)) {
+        auto countBody = [shared](PartParser& parts, const uint8_t* data, size_t len) {
+            shared->bytes += len;
+            parts.feed(data, len);
+        };
+
+        if (strcasecmp(headerValue(head, "Upgrade").c_str(), "websocket") == 0) {
+            std::string key = headerValue(head, "Sec-WebSocket-Key") + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+            unsigned char digest[20];
+            unsigned char accept[32];
+            size_t acceptLen = 0;
+            mbedtls_sha1_ret((const unsigned char*)key.data(), key.size(), digest);
+            mbedtls_base64_encode(accept, sizeof(accept), &acceptLen, digest, sizeof(digest));
+            std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                   "Sec-WebSocket-Accept: " + std::string((const char*)accept, acceptLen) + "\r\n\r\n";
+            if (!sendAll(sock, response.data(), response.size())) {
+                break;
+            }
+
+            uint8_t head2[2];
+            while (reader.readByte(head2[0]) && reader.readByte(head2[1])) {
+                bool fin = head2[0] & 0x80;
+                uint8_t opcode = head2[0] & 0x0F;
+                uint64_t len = head2[1] & 0x7F;
+                int extra = len == 126 ? 2 : len == 127 ? 8 : 0;
+                if (extra) {
+                    len = 0;
+                }
+                uint8_t c;
+                for (int i = 0; i < extra; i++) {
+                    if (!reader.readByte(c)) {
+                        goto done;
+                    }
+                    len = (len << 8) | c;
+                }
+                if (!(head2[1] & 0x80)) {
+                    // Client frames must be masked
+                    shared->errors++;
+                }
+                uint8_t mask[4] = {};
+                for (int i = 0; i < 4 && (head2[1] & 0x80); i++) {
+                    if (!reader.readByte(mask[i])) {
+                        goto done;
+                    }
+                }
+
+                std::string control;
+                bool ok = reader.consume(len, [&](const uint8_t* data, size_t n) {
+                    shared->bytes += n;
+                    if (opcode & 0x08) {
+                        control.append((const char*)data, n);
+                    }
+                });
+                if (!ok) {
+                    goto done;
+                }
+                if (fin && (opcode == 0x0 || opcode == 0x2)) {
+                    shared->frames++;
+                } else if (opcode == 0x8) {
+                    uint8_t close[2] = { 0x88, 0x00 };
+                    sendAll(sock, close, sizeof(close));
+                    goto done;
+                } else if (opcode == 0x9 && control.size() < 126) {
+                    for (size_t i = 0; i < control.size(); i++) {
+                        control[i] ^= mask[i % 4];
+                    }
+                    std::string pong = std::string("\x8A", 1) + (char)control.size() + control;
+                    sendAll(sock, pong.data(), pong.size());
+                }
+            }
+            goto done;
+        }
+
+        PartParser parts(shared->frames, shared->errors);
+        if (strcasecmp(headerValue(head, "Transfer-Encoding").c_str(), "chunked") == 0) {
+            std::string line;
+            while (true) {
+                if (!reader.readUntil(line, "\r\n", 256)) {
+                    goto done;
+                }
+                char* end = nullptr;
+                uint64_t size = strtoull(line.c_str(), &end, 16);
+                if (end == line.c_str()) {
+                    shared->errors++;
+                    goto done;
+                }
+                if (size == 0) {
+                    // Trailer section up to the empty line
+                    while (reader.readUntil(line, "\r\n", 256) && line != "\r\n") {
+                    }
+                    break;
+                }
+                shared->chunks++;
+                bool ok = reader.consume(size, [&](const uint8_t* data, size_t n) { countBody(parts, data, n); });
+                uint8_t cr, lf;
+                if (!ok || !reader.readByte(cr) || !reader.readByte(lf)) {
+                    goto done;
+                }
+                if (cr != '\r' || lf != '\n') {
+                    shared->errors++;
+                    goto done;
+                }
+            }
+        } else {
+            uint64_t length = strtoull(headerValue(head, "Content-Length").c_str(), nullptr, 10);
+            if (!reader.consume(length, [&](const uint8_t* data, size_t n) { countBody(parts, data, n); })) {
+                goto done;
+            }
+        }
+
+        shared->requests++;
+        static const char OK[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+        if (!sendAll(sock, OK, sizeof(OK) - 1)) {
+            break;
+        }
+    }
+
+done:
+#ifdef __linux__
+    struct tcp_info info = {};
+    socklen_t infoLen = sizeof(info);
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &infoLen) == 0) {
+        shared->segments += info.tcpi_segs_in;
+    }
+#endif
+    close(sock);
+    shared->closed++;
+}
+
+void StreamSink::_serveDatagrams(int udp, Shared* shared) {
+    static uint8_t buf[65536];
+    while (true) {
+        ssize_t n = recv(udp, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        shared->bytes += (uint64_t)n;
+        if (n < 12 || (buf[0] >> 6) != 2) {
+            shared->errors++;
+        } else if (buf[1] & 0x80) {
+            shared->frames++;
+        }
+    }
+}
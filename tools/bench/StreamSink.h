@@ -0,0 +1,64 @@
+#ifndef STREAM_SINK_H
+#define STREAM_SINK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// Stand-in for the stream server on 127.0.0.1. It accepts what every
+// transport sends to one port: HTTP POST bodies with Content-Length or
+// chunked encoding, WebSocket binary messages and RTP/JPEG datagrams.
+// Multipart parts are parsed for their length; JPEG bodies are counted,
+// not copied.
+//
+// The sink runs in a forked process, so its CPU time is not charged to
+// the pipeline under test. Start it before any thread exists.
+
+struct SinkTotals {
+    uint64_t connections;
+    uint64_t closed;
+    uint64_t requests;      // HTTP bodies completed and answered
+    uint64_t frames;        // multipart JPEG parts, WebSocket binary messages, RTP frames (marker bit)
+    uint64_t bytes;         // payload: decoded HTTP body, WebSocket payload, RTP packets
+    uint64_t chunks;        // Transfer-Encoding: chunked
+    uint64_t errors;        // bad parts, chunk framing, malformed frames
+    uint64_t segments;      // TCP segments received on closed connections (Linux only)
+};
+
+class StreamSink {
+public:
+    ~StreamSink();
+
+    // port 0 picks a free one. rcvBuf and mss 0 keep the OS defaults; an
+    // mss of 1436 makes the sender segment as over WiFi. readRate caps each
+    // TCP connection at that many bytes/s, a link slower than the stream;
+    // 0 reads as fast as data arrives.
+    bool start(uint16_t port = 0, int rcvBuf = 0, int mss = 0, uint64_t readRate = 0);
+    void stop();
+    uint16_t port() const { return _port; }
+
+    void read(SinkTotals& out) const;
+
+private:
+    struct Shared {
+        std::atomic<uint64_t> connections;
+        std::atomic<uint64_t> closed;
+        std::atomic<uint64_t> requests;
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> chunks;
+        std::atomic<uint64_t> errors;
+        std::atomic<uint64_t> segments;
+    };
+
+    static void _serve(int listener, int udp, Shared* shared, uint64_t readRate);
+    static void _serveConnection(int sock, Shared* shared, uint64_t readRate);
+    static void _serveDatagrams(int udp, Shared* shared);
+
+    Shared* _shared = nullptr;
+    pid_t _pid = -1;
+    uint16_t _port = 0;
+};
+
+#endif
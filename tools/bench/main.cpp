@@ -0,0 +1,162 @@
+// Host benchmark for the streaming pipeline, built by the native env:
+//
+//   pio run -e native
+//   .pio/build/native/program pipeline --transport tcp --duration 10
+//
+// See README.md for the subcommands and their options.
+
+#include "Bench.h"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <time.h>
+
+namespace {
+
+struct Command {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* description;
+};
+
+const Command COMMANDS[] = {
+    { "pipeline", runPipeline, "camera replay -> Streamer::loop() -> transport -> local sink" },
+    { "sendv", runSendv, "header + JPEG as two send() calls vs one sendv(), per transport" },
+    { "ring", runRing, "capture -> send task handoff: FrameRing vs the old FrameChunk queue" },
+    { "header", runHeader, "multipart part header: snprintf vs the MultipartHeader template" },
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr, "Usage: %s <command> [options]\n", argv0);
+    for (const Command& command : COMMANDS) {
+        fprintf(stderr, "  %-10s %s\n", command.name, command.description);
+    }
+    fprintf(stderr, "%s <command> --help lists the options of a command\n", argv0);
+}
+
+}
+
+uint64_t cpuTimeUs() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+           (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+uint64_t threadCpuTimeUs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+uint64_t wallTimeUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double parseNumber(const char* option, const char* value) {
+    char* end = nullptr;
+    errno = 0;
+    double number = value ? strtod(value, &end) : NAN;
+    if (!value || errno != 0 || end == value || *end != '\0' || !std::isfinite(number)) {
+        fprintf(stderr, "%s needs a number, got '%s'\n", option, value ? value : "");
+        exit(2);
+    }
+    return number;
+}
+
+JsonWriter::JsonWriter(FILE* out) : _out(out) {
+    fputc('{', _out);
+}
+
+JsonWriter::~JsonWriter() {
+    while (_depth > 0) {
+        end();
+    }
+    fputs("}\n", _out);
+    fflush(_out);
+}
+
+void JsonWriter::_key(const char* name) {
+    if (!_first) {
+        fputc(',', _out);
+    }
+    _first = false;
+    fprintf(_out, "\"%s\":", name);
+}
+
+JsonWriter& JsonWriter::field(const char* name, const char* value) {
+    _key(name);
+    fputc('"', _out);
+    for (const char* p = value; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', _out);
+        }
+        fputc(*p, _out);
+    }
+    fputc('"', _out);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* name, uint64_t value) {
+    _key(name);
+    fprintf(_out, "%llu", (unsigned long long)value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* name, int value) {
+    _key(name);
+    fprintf(_out, "%d", value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* name, double value) {
+    _key(name);
+    fprintf(_out, std::isfinite(value) ? "%.3f" : "null", value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* name, bool value) {
+    _key(name);
+    fputs(value ? "true" : "false", _out);
+    return *this;
+}
+
+JsonWriter& JsonWriter::object(const char* name) {
+    _key(name);
+    fputc('{', _out);
+    _depth++;
+    _first = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::end() {
+    if (_depth > 0) {
+        fputc('}', _out);
+        _depth--;
+        _first = false;
+    }
+    return *this;
+}
+
+int main(int argc, char** argv) {
+    // A sink that goes away must show up as a send error, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if (argc < 2 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+        usage(argv[0]);
+        return argc < 2 ? 2 : 0;
+    }
+    for (const Command& command : COMMANDS) {
+        if (strcmp(argv[1], command.name) == 0) {
+            return command.run(argc - 1, argv + 1);
+        }
+    }
+    fprintf(stderr, "Unknown command: %s\n", argv[1]);
+    usage(argv[0]);
+    return 2;
+}
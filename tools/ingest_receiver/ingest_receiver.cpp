@@ -0,0 +1,711 @@
+// Reference receiver for the wheelbot-cam push stream.
+//
+// Accepts POST <path> with multipart/x-mixed-replace, either fixed
+// Content-Length or Transfer-Encoding: chunked, checks every part and
+// reports FPS, throughput, arrival jitter and capture-to-arrival latency.
+// Reads can be throttled to act as a slow consumer. See README.md.
+//
+// Build: g++ -O2 -std=c++17 -pthread -o ingest_receiver ingest_receiver.cpp
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint16_t port = 8080;
+    std::string path = "/input";
+    std::string boundary;           // empty = take it from Content-Type
+    size_t readSize = 16384;        // bytes per recv()
+    uint64_t readRate = 0;          // bytes per second, 0 = unthrottled
+    uint32_t readDelayMs = 0;       // sleep after every recv()
+    int rcvBuf = 0;                 // SO_RCVBUF, 0 = OS default
+    double reportInterval = 1.0;
+    bool verbose = false;
+};
+
+Options g_options;
+std::atomic<bool> g_running{true};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+struct Interval {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    std::vector<double> latencyMs;
+};
+
+class Stats {
+public:
+    void connectionOpened() { _connections++; _activeConnections++; }
+    void connectionClosed() { _activeConnections--; }
+
+    void frame(size_t len, bool soiOk, bool eoiOk, bool haveTimestamp, double captureSec, Clock::time_point arrival) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _totalFrames++;
+        _totalBytes += len;
+        _interval.frames++;
+        _interval.bytes += len;
+        if (!soiOk) {
+            _badSoi++;
+        }
+        if (!eoiOk) {
+            _badEoi++;
+        }
+        if (!haveTimestamp) {
+            _noTimestamp++;
+            return;
+        }
+
+        double arrivalSec = std::chrono::duration<double>(arrival.time_since_epoch()).count();
+
+        // Device and host clocks are unrelated: latency is measured above the
+        // smallest capture-to-arrival offset seen, i.e. the queueing and
+        // transfer delay on top of the fastest frame.
+        double offset = arrivalSec - captureSec;
+        if (!_haveOffset || offset < _minOffset) {
+            _minOffset = offset;
+            _haveOffset = true;
+        }
+        _interval.latencyMs.push_back((offset - _minOffset) * 1000.0);
+
+        // RFC 3550 interarrival jitter
+        if (_havePrevious) {
+            double d = (arrivalSec - _prevArrival) - (captureSec - _prevCapture);
+            _jitterMs += (std::fabs(d) * 1000.0 - _jitterMs) / 16.0;
+        }
+        _prevArrival = arrivalSec;
+        _prevCapture = captureSec;
+        _havePrevious = true;
+    }
+
+    void framingError(const char* what) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _framingErrors++;
+        if (g_options.verbose) {
+            fprintf(stderr, "framing error: %s\n", what);
+        }
+    }
+
+    void report(double elapsed, double intervalSec) {
+        Interval interval;
+        uint64_t totalFrames, badSoi, badEoi, framingErrors, noTimestamp;
+        double jitter;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::swap(interval, _interval);
+            totalFrames = _totalFrames;
+            badSoi = _badSoi;
+            badEoi = _badEoi;
+            framingErrors = _framingErrors;
+            noTimestamp = _noTimestamp;
+            jitter = _jitterMs;
+        }
+
+        double p50 = 0, p99 = 0, max = 0;
+        if (!interval.latencyMs.empty()) {
+            std::vector<double>& v = interval.latencyMs;
+            std::sort(v.begin(), v.end());
+            p50 = v[v.size() / 2];
+            p99 = v[std::min(v.size() - 1, (size_t)std::ceil(v.size() * 0.99) - 1)];
+            max = v.back();
+        }
+
+        printf("[%7.1fs] conn %d/%u | %5.1f fps | %6.3f MB/s | frames %llu bad soi/eoi %llu/%llu framing %llu"
+               " no-ts %llu | jitter %5.1f ms | latency p50 %6.1f p99 %6.1f max %6.1f ms\n",
+               elapsed, _activeConnections.load(), _connections.load(),
+               interval.frames / intervalSec, interval.bytes / intervalSec / 1e6,
+               (unsigned long long)totalFrames, (unsigned long long)badSoi, (unsigned long long)badEoi,
+               (unsigned long long)framingErrors, (unsigned long long)noTimestamp, jitter, p50, p99, max);
+        fflush(stdout);
+    }
+
+private:
+    std::mutex _mutex;
+    std::atomic<unsigned> _connections{0};
+    std::atomic<int> _activeConnections{0};
+
+    Interval _interval;
+    uint64_t _totalFrames = 0;
+    uint64_t _totalBytes = 0;
+    uint64_t _badSoi = 0;
+    uint64_t _badEoi = 0;
+    uint64_t _framingErrors = 0;
+    uint64_t _noTimestamp = 0;
+
+    bool _haveOffset = false;
+    double _minOffset = 0;
+    bool _havePrevious = false;
+    double _prevArrival = 0;
+    double _prevCapture = 0;
+    double _jitterMs = 0;
+};
+
+Stats g_stats;
+
+// ---------------------------------------------------------------------------
+// Multipart parser
+//
+// Streaming: feed() takes whatever recv() returned. Boundary and header
+// lines are collected in a small line buffer; part bodies are never copied,
+// only their first and last two bytes are looked at.
+
+class MultipartParser {
+public:
+    explicit MultipartParser(const std::string& boundary)
+        : _delimiter("--" + boundary) {}
+
+    void feed(const uint8_t* data, size_t len) {
+        while (len > 0) {
+            if (_state == State::BODY) {
+                size_t n = (size_t)std::min<uint64_t>(len, _remaining);
+                _scanBody(data, n);
+                data += n;
+                len -= n;
+                _remaining -= n;
+                if (_remaining == 0) {
+                    _finishPart();
+                }
+                continue;
+            }
+
+            if (_state == State::EPILOGUE) {
+                return;
+            }
+
+            uint8_t c = *data++;
+            len--;
+            if (c != '\n') {
+                if (_line.size() < MAX_LINE) {
+                    _line.push_back((char)c);
+                } else {
+                    _lineTooLong = true;
+                }
+                continue;
+            }
+            if (!_line.empty() && _line.back() == '\r') {
+                _line.pop_back();
+            }
+            _handleLine();
+            _line.clear();
+            _lineTooLong = false;
+        }
+    }
+
+    // True when the body ended in the middle of a part
+    bool truncated() const { return _state == State::BODY || _state == State::HEADERS; }
+
+private:
+    enum class State { PREAMBLE, HEADERS, BODY, BETWEEN, EPILOGUE };
+
+    static const size_t MAX_LINE = 1024;
+
+    void _handleLine() {
+        if (_lineTooLong) {
+            g_stats.framingError("header line too long");
+            _state = State::BETWEEN;
+            return;
+        }
+
+        if (_state == State::HEADERS) {
+            if (_line.empty()) {
+                if (!_haveLength) {
+                    g_stats.framingError("part without Content-Length");
+                    _state = State::BETWEEN;
+                    return;
+                }
+                _state = State::BODY;
+                _bodyBytes = 0;
+                if (_remaining == 0) {
+                    _finishPart();
+                }
+                return;
+            }
+            _parseHeader();
+            return;
+        }
+
+        // PREAMBLE or BETWEEN: expecting a delimiter line
+        if (_line.empty()) {
+            return;
+        }
+        if (_line.compare(0, _delimiter.size(), _delimiter) == 0) {
+            std::string rest = _line.substr(_delimiter.size());
+            if (rest == "--") {
+                _state = State::EPILOGUE;
+                return;
+            }
+            if (rest.find_first_not_of(" \t") == std::string::npos) {
+                _state = State::HEADERS;
+                _haveLength = false;
+                _haveTimestamp = false;
+                _remaining = 0;
+                return;
+            }
+        }
+        if (_state == State::BETWEEN) {
+            g_stats.framingError("unexpected data between parts");
+        }
+    }
+
+    void _parseHeader() {
+        size_t colon = _line.find(':');
+        if (colon == std::string::npos) {
+            g_stats.framingError("malformed part header");
+            return;
+        }
+        std::string name = _line.substr(0, colon);
+        const char* value = _line.c_str() + colon + 1;
+
+        if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+            char* end = nullptr;
+            unsigned long long length = strtoull(value, &end, 10);
+            if (end == value) {
+                g_stats.framingError("bad Content-Length");
+                return;
+            }
+            _remaining = length;
+            _partLength = length;
+            _haveLength = true;
+        } else if (strcasecmp(name.c_str(), "X-Timestamp") == 0) {
+            // "<seconds>.<microseconds>", seconds may be space-padded
+            long long sec = 0, usec = 0;
+            if (sscanf(value, " %lld.%lld", &sec, &usec) == 2) {
+                _captureSec = sec + usec / 1e6;
+                _haveTimestamp = true;
+            }
+        }
+    }
+
+    void _scanBody(const uint8_t* data, size_t n) {
+        for (size_t i = 0; i < n && _bodyBytes + i < 2; i++) {
+            _head[_bodyBytes + i] = data[i];
+        }
+        if (n >= 2) {
+            _tail[0] = data[n - 2];
+            _tail[1] = data[n - 1];
+        } else if (n == 1) {
+            _tail[0] = _tail[1];
+            _tail[1] = data[0];
+        }
+        _bodyBytes += n;
+    }
+
+    void _finishPart() {
+        bool soiOk = _partLength >= 2 && _head[0] == 0xFF && _head[1] == 0xD8;
+        bool eoiOk = _partLength >= 4 && _tail[0] == 0xFF && _tail[1] == 0xD9;
+        if (g_options.verbose && (!soiOk || !eoiOk)) {
+            fprintf(stderr, "part of %llu bytes: SOI %s, EOI %s\n", (unsigned long long)_partLength,
+                    soiOk ? "ok" : "missing", eoiOk ? "ok" : "missing (Content-Length off?)");
+        }
+        g_stats.frame(_partLength, soiOk, eoiOk, _haveTimestamp, _captureSec, Clock::now());
+        _state = State::BETWEEN;
+    }
+
+    std::string _delimiter;
+    State _state = State::PREAMBLE;
+    std::string _line;
+    bool _lineTooLong = false;
+
+    bool _haveLength = false;
+    bool _haveTimestamp = false;
+    uint64_t _partLength = 0;
+    uint64_t _remaining = 0;
+    uint64_t _bodyBytes = 0;
+    double _captureSec = 0;
+    uint8_t _head[2] = {};
+    uint8_t _tail[2] = {};
+};
+
+// ---------------------------------------------------------------------------
+// Chunked transfer decoding, passing chunk data through without copying
+
+class ChunkedDecoder {
+public:
+    explicit ChunkedDecoder(MultipartParser& parser) : _parser(parser) {}
+
+    // Returns false on a malformed chunk
+    bool feed(const uint8_t* data, size_t len) {
+        while (len > 0 && _state != State::DONE) {
+            if (_state == State::DATA) {
+                size_t n = (size_t)std::min<uint64_t>(len, _remaining);
+                _parser.feed(data, n);
+                data += n;
+                len -= n;
+                _remaining -= n;
+                if (_remaining == 0) {
+                    _state = State::DATA_END;
+                }
+                continue;
+            }
+
+            uint8_t c = *data++;
+            len--;
+            if (c != '\n') {
+                if (c != '\r' && _line.size() < 64) {
+                    _line.push_back((char)c);
+                }
+                continue;
+            }
+
+            if (_state == State::SIZE) {
+                char* end = nullptr;
+                _remaining = strtoull(_line.c_str(), &end, 16);
+                if (end == _line.c_str()) {
+                    return false;
+                }
+                _state = _remaining == 0 ? State::TRAILER : State::DATA;
+            } else if (_state == State::DATA_END) {
+                if (!_line.empty()) {
+                    return false;
+                }
+                _state = State::SIZE;
+            } else if (_state == State::TRAILER && _line.empty()) {
+                _state = State::DONE;
+            }
+            _line.clear();
+        }
+        return true;
+    }
+
+    bool done() const { return _state == State::DONE; }
+
+private:
+    enum class State { SIZE, DATA, DATA_END, TRAILER, DONE };
+
+    MultipartParser& _parser;
+    State _state = State::SIZE;
+    std::string _line;
+    uint64_t _remaining = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Connection handling
+
+class Throttle {
+public:
+    void consumed(size_t bytes) {
+        if (g_options.readDelayMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(g_options.readDelayMs));
+        }
+        if (g_options.readRate == 0) {
+            return;
+        }
+        _bytes += bytes;
+        double due = (double)_bytes / g_options.readRate;
+        double ahead = due - secondsSince(_start);
+        if (ahead > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+        }
+    }
+
+private:
+    Clock::time_point _start = Clock::now();
+    uint64_t _bytes = 0;
+};
+
+void sendResponse(int sock, const char* status) {
+    char response[128];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+    send(sock, response, len, MSG_NOSIGNAL);
+}
+
+bool headerValue(const std::string& head, const char* name, std::string& value) {
+    std::string needle = std::string("\r\n") + name + ":";
+    auto it = std::search(head.begin(), head.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return tolower((unsigned char)a) == tolower((unsigned char)b); });
+    if (it == head.end()) {
+        return false;
+    }
+    size_t start = (it - head.begin()) + needle.size();
+    size_t end = head.find("\r\n", start);
+    value = head.substr(start, end - start);
+    value.erase(0, value.find_first_not_of(" \t"));
+    return true;
+}
+
+void handleConnection(int sock, std::string peer) {
+    g_stats.connectionOpened();
+    Clock::time_point opened = Clock::now();
+
+    std::vector<uint8_t> buf(g_options.readSize);
+    Throttle throttle;
+
+    // Request head
+    std::string head;
+    size_t headEnd = std::string::npos;
+    while (headEnd == std::string::npos) {
+        ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+        if (n <= 0) {
+            close(sock);
+            g_stats.connectionClosed();
+            return;
+        }
+        head.append((const char*)buf.data(), n);
+        headEnd = head.find("\r\n\r\n");
+        if (headEnd == std::string::npos && head.size() > 8192) {
+            sendResponse(sock, "431 Request Header Fields Too Large");
+            close(sock);
+            g_stats.connectionClosed();
+            return;
+        }
+    }
+    std::string rest = head.substr(headEnd + 4);
+    head.resize(headEnd + 2);
+
+    char method[16] = {}, target[256] = {};
+    sscanf(head.c_str(), "%15s %255s", method, target);
+
+    std::string contentType, transferEncoding, contentLength, frameRate;
+    headerValue(head, "Content-Type", contentType);
+    headerValue(head, "Transfer-Encoding", transferEncoding);
+    headerValue(head, "Content-Length", contentLength);
+    headerValue(head, "X-Framerate", frameRate);
+
+    std::string boundary = g_options.boundary;
+    size_t b = contentType.find("boundary=");
+    if (boundary.empty() && b != std::string::npos) {
+        boundary = contentType.substr(b + 9);
+        boundary = boundary.substr(0, boundary.find_first_of("; \t"));
+    }
+
+    if (strcmp(method, "POST") != 0 || g_options.path != target) {
+        printf("%s: %s %s -> 404\n", peer.c_str(), method, target);
+        sendResponse(sock, "404 Not Found");
+        close(sock);
+        g_stats.connectionClosed();
+        return;
+    }
+    if (boundary.empty()) {
+        printf("%s: no multipart boundary in Content-Type '%s'\n", peer.c_str(), contentType.c_str());
+        sendResponse(sock, "400 Bad Request");
+        close(sock);
+        g_stats.connectionClosed();
+        return;
+    }
+
+    bool chunked = strcasestr(transferEncoding.c_str(), "chunked") != nullptr;
+    uint64_t declared = contentLength.empty() ? 0 : strtoull(contentLength.c_str(), nullptr, 10);
+    printf("%s: POST %s, %s, boundary '%s', framerate %s\n", peer.c_str(), target,
+           chunked ? "chunked" : ("Content-Length " + contentLength).c_str(),
+           boundary.c_str(), frameRate.empty() ? "-" : frameRate.c_str());
+
+    MultipartParser parser(boundary);
+    ChunkedDecoder decoder(parser);
+    uint64_t received = 0;
+    bool complete = false;
+    bool malformed = false;
+
+    auto consume = [&](const uint8_t* data, size_t len) {
+        if (chunked) {
+            malformed = !decoder.feed(data, len);
+            complete = decoder.done();
+        } else {
+            size_t n = (size_t)std::min<uint64_t>(len, declared - received);
+            parser.feed(data, n);
+            received += n;
+            complete = received >= declared;
+        }
+    };
+
+    if (!rest.empty()) {
+        consume((const uint8_t*)rest.data(), rest.size());
+    }
+
+    while (!complete && !malformed && g_running) {
+        ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        consume(buf.data(), (size_t)n);
+        throttle.consumed((size_t)n);
+    }
+
+    if (malformed) {
+        g_stats.framingError("malformed chunk");
+        sendResponse(sock, "400 Bad Request");
+    } else if (complete) {
+        sendResponse(sock, "200 OK");
+    }
+
+    printf("%s: request %s after %.1fs%s\n", peer.c_str(),
+           complete ? "complete" : (malformed ? "rejected" : "closed by peer"),
+           secondsSince(opened), parser.truncated() ? ", last part truncated" : "");
+
+    close(sock);
+    g_stats.connectionClosed();
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --port N           listen port (8080)\n"
+            "  --path P           request path (/input)\n"
+            "  --boundary B       multipart boundary (from Content-Type)\n"
+            "  --read-size N      bytes per recv() (16384)\n"
+            "  --read-rate N      throttle reads to N bytes/s (0 = off)\n"
+            "  --read-delay-ms N  sleep N ms after every recv() (0)\n"
+            "  --rcvbuf N         socket receive buffer in bytes (OS default)\n"
+            "  --interval S       report interval in seconds (1)\n"
+            "  --verbose          log every framing problem\n",
+            argv0);
+}
+
+bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto needValue = [&]() {
+            if (!value) {
+                fprintf(stderr, "%s needs a value\n", arg.c_str());
+                return false;
+            }
+            i++;
+            return true;
+        };
+
+        if (arg == "--verbose") {
+            g_options.verbose = true;
+        } else if (arg == "--port") {
+            if (!needValue()) return false;
+            g_options.port = (uint16_t)atoi(value);
+        } else if (arg == "--path") {
+            if (!needValue()) return false;
+            g_options.path = value;
+        } else if (arg == "--boundary") {
+            if (!needValue()) return false;
+            g_options.boundary = value;
+        } else if (arg == "--read-size") {
+            if (!needValue()) return false;
+            g_options.readSize = std::max<size_t>(1, strtoull(value, nullptr, 10));
+        } else if (arg == "--read-rate") {
+            if (!needValue()) return false;
+            g_options.readRate = strtoull(value, nullptr, 10);
+        } else if (arg == "--read-delay-ms") {
+            if (!needValue()) return false;
+            g_options.readDelayMs = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (arg == "--rcvbuf") {
+            if (!needValue()) return false;
+            g_options.rcvBuf = atoi(value);
+        } else if (arg == "--interval") {
+            if (!needValue()) return false;
+            g_options.reportInterval = std::max(0.1, atof(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    // No SA_RESTART, so Ctrl-C interrupts accept()
+    struct sigaction stop = {};
+    stop.sa_handler = [](int) { g_running = false; };
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (g_options.rcvBuf > 0) {
+        // Set before listen() so accepted sockets advertise the small window from the start
+        setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &g_options.rcvBuf, sizeof(g_options.rcvBuf));
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(g_options.port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 4) != 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    printf("Listening on :%u%s", g_options.port, g_options.path.c_str());
+    if (g_options.readRate > 0 || g_options.readDelayMs > 0 || g_options.rcvBuf > 0) {
+        printf(" as a slow consumer (read-rate %llu B/s, read-delay %u ms, rcvbuf %d)",
+               (unsigned long long)g_options.readRate, g_options.readDelayMs, g_options.rcvBuf);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    Clock::time_point start = Clock::now();
+    std::thread reporter([start]() {
+        Clock::time_point last = start;
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(g_options.reportInterval));
+            Clock::time_point now = Clock::now();
+            g_stats.report(std::chrono::duration<double>(now - start).count(),
+                           std::chrono::duration<double>(now - last).count());
+            last = now;
+        }
+    });
+
+    while (g_running) {
+        sockaddr_in peerAddr = {};
+        socklen_t peerLen = sizeof(peerAddr);
+        int sock = accept(listener, (sockaddr*)&peerAddr, &peerLen);
+        if (sock < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+
+        char peer[INET_ADDRSTRLEN + 8];
+        inet_ntop(AF_INET, &peerAddr.sin_addr, peer, INET_ADDRSTRLEN);
+        snprintf(peer + strlen(peer), 8, ":%u", ntohs(peerAddr.sin_port));
+
+        // The firmware overlaps requests when it rolls over, so serve each on its own thread
+        std::thread(handleConnection, sock, std::string(peer)).detach();
+    }
+
+    g_running = false;
+    close(listener);
+    reporter.join();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "esp_err.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// The parts of the Arduino-ESP32 core the libraries use. GPIO calls do
+// nothing; millis() and micros() count from process start.
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+bool psramFound();
+long random(long max);
+long random(long min, long max);
+
+typedef enum {
+    PERIPH_I2C0_MODULE,
+    PERIPH_I2C1_MODULE
+} periph_module_t;
+
+void periph_module_disable(periph_module_t module);
+void periph_module_reset(periph_module_t module);
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(int value) : _s(std::to_string(value)) {}
+    explicit String(unsigned int value) : _s(std::to_string(value)) {}
+    explicit String(long value) : _s(std::to_string(value)) {}
+    explicit String(unsigned long value) : _s(std::to_string(value)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    char charAt(size_t i) const { return i < _s.size() ? _s[i] : '\0'; }
+    char operator[](size_t i) const { return charAt(i); }
+    int toInt() const { return atoi(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    void toCharArray(char* buf, size_t size) const { snprintf(buf, size, "%s", _s.c_str()); }
+
+    bool equals(const String& other) const { return _s == other._s; }
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+    int indexOf(char c) const {
+        size_t pos = _s.find(c);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(size_t from, size_t to = std::string::npos) const {
+        if (from >= _s.size()) {
+            return String();
+        }
+        return String(_s.substr(from, to == std::string::npos ? std::string::npos : to - from));
+    }
+    void replace(const String& from, const String& to) {
+        if (from._s.empty()) {
+            return;
+        }
+        for (size_t pos = 0; (pos = _s.find(from._s, pos)) != std::string::npos; pos += to._s.size()) {
+            _s.replace(pos, from._s.size(), to._s);
+        }
+    }
+    void trim() {
+        size_t start = _s.find_first_not_of(" \t\r\n");
+        size_t end = _s.find_last_not_of(" \t\r\n");
+        _s = start == std::string::npos ? std::string() : _s.substr(start, end - start + 1);
+    }
+
+    bool operator==(const String& other) const { return _s == other._s; }
+    bool operator!=(const String& other) const { return _s != other._s; }
+    bool operator==(const char* other) const { return _s == (other ? other : ""); }
+    bool operator!=(const char* other) const { return !(*this == other); }
+    String& operator+=(const String& other) {
+        _s += other._s;
+        return *this;
+    }
+    String& operator+=(char c) {
+        _s += c;
+        return *this;
+    }
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+
+private:
+    std::string _s;
+};
+
+class EspClass {
+public:
+    void restart();
+    uint32_t getPsramSize();
+    uint32_t getFreePsram();
+    uint32_t getFreeHeap();
+    uint32_t getCpuFreqMHz();
+};
+
+extern EspClass ESP;
+
+// Writes to stdout
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void flush() { fflush(stdout); }
+    size_t print(const char* s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <memory>
+#include "Arduino.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+struct FileImpl;
+
+// A file or directory opened through a file system shim
+class File {
+public:
+    File() = default;
+    explicit File(std::shared_ptr<FileImpl> impl) : _impl(std::move(impl)) {}
+
+    explicit operator bool() const;
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    size_t size() const;
+    size_t position() const;
+    int available();
+    bool seek(uint32_t pos);
+    size_t read(uint8_t* buf, size_t size);
+    int read();
+    size_t write(const uint8_t* buf, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    void flush();
+    void close();
+    File openNextFile(const char* mode = FILE_READ);
+
+private:
+    std::shared_ptr<FileImpl> _impl;
+};
+
+}
+
+using fs::File;
+
+#endif
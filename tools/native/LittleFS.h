@@ -0,0 +1,38 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <string>
+#include "FS.h"
+
+// The data partition as a host directory: $NATIVE_LITTLEFS_ROOT, or
+// wheelbot-littlefs under the temp directory. totalBytes() is the size of
+// the littlefs partition in partitions.csv.
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end();
+    bool format();
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+
+    size_t totalBytes();
+    size_t usedBytes();
+
+private:
+    std::string _hostPath(const char* path) const;
+
+    std::string _root;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
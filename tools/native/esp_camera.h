@@ -0,0 +1,83 @@
+#ifndef NATIVE_ESP_CAMERA_H
+#define NATIVE_ESP_CAMERA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/time.h>
+#include "esp_err.h"
+#include "sensor.h"
+
+// The camera driver as a replay source: see native_camera.h for where the
+// frames come from. esp_camera_init() sets up fb_count frame buffers; a
+// frame buffer handed out by esp_camera_fb_get() is unavailable until it
+// is returned, so a consumer that holds frames stalls capture as on the
+// board. buf points at the replayed JPEG without a copy, like a buffer the
+// DMA filled, and must be treated as read-only.
+
+typedef enum {
+    CAMERA_GRAB_WHEN_EMPTY,
+    CAMERA_GRAB_LATEST
+} camera_grab_mode_t;
+
+typedef enum {
+    CAMERA_FB_IN_PSRAM,
+    CAMERA_FB_IN_DRAM
+} camera_fb_location_t;
+
+typedef enum {
+    LEDC_CHANNEL_0,
+    LEDC_CHANNEL_1
+} ledc_channel_t;
+
+typedef enum {
+    LEDC_TIMER_0,
+    LEDC_TIMER_1
+} ledc_timer_t;
+
+typedef struct {
+    int pin_pwdn;
+    int pin_reset;
+    int pin_xclk;
+    int pin_sccb_sda;
+    int pin_sccb_scl;
+    int pin_d7;
+    int pin_d6;
+    int pin_d5;
+    int pin_d4;
+    int pin_d3;
+    int pin_d2;
+    int pin_d1;
+    int pin_d0;
+    int pin_vsync;
+    int pin_href;
+    int pin_pclk;
+
+    int xclk_freq_hz;
+    ledc_timer_t ledc_timer;
+    ledc_channel_t ledc_channel;
+
+    pixformat_t pixel_format;
+    framesize_t frame_size;
+    int jpeg_quality;
+    size_t fb_count;
+    camera_fb_location_t fb_location;
+    camera_grab_mode_t grab_mode;
+} camera_config_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;   // esp_timer clock
+} camera_fb_t;
+
+esp_err_t esp_camera_init(const camera_config_t* config);
+esp_err_t esp_camera_deinit();
+// Waits up to 4 s for a free frame buffer, then returns nullptr
+camera_fb_t* esp_camera_fb_get();
+void esp_camera_fb_return(camera_fb_t* fb);
+sensor_t* esp_camera_sensor_get();
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef NATIVE_ESP_FREERTOS_HOOKS_H
+#define NATIVE_ESP_FREERTOS_HOOKS_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// The host has no idle task, so registration fails and CoreLoadMonitor
+// stays off. The benchmark measures CPU time with getrusage() instead.
+
+typedef bool (*esp_freertos_idle_cb_t)();
+
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t callback, UBaseType_t cpu);
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t callback, UBaseType_t cpu);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef NATIVE_ESP_HEAP_CAPS_H
+#define NATIVE_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Allocations come from malloc whatever the caps. The free sizes are those
+// of an ESP32-CAM after boot (internal RAM and 4 MB PSRAM), so
+// FrameBufferPlanner picks the pool it would pick on the board.
+
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+#define NATIVE_DRAM_FREE (160 * 1024)
+#define NATIVE_DRAM_LARGEST_BLOCK (110 * 1024)
+#define NATIVE_PSRAM_SIZE (4 * 1024 * 1024)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+#endif
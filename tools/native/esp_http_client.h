@@ -0,0 +1,54 @@
+#ifndef NATIVE_ESP_HTTP_CLIENT_H
+#define NATIVE_ESP_HTTP_CLIENT_H
+
+#include <cstdint>
+#include "esp_err.h"
+
+// esp_http_client over a blocking POSIX socket, for plain http:// URLs.
+// Covers the streaming upload path: open() sends the request line and
+// headers (Content-Length, or Transfer-Encoding: chunked for a negative
+// length), write() sends body bytes as given, fetch_headers() reads the
+// response head. Like the target, it leaves Nagle's algorithm on.
+
+typedef struct esp_http_client* esp_http_client_handle_t;
+
+typedef enum {
+    HTTP_METHOD_GET,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD
+} esp_http_client_method_t;
+
+typedef struct {
+    const char* url;
+    const char* host;
+    int port;
+    const char* path;
+    int timeout_ms;
+    bool disable_auto_redirect;
+    int max_redirection_count;
+    esp_http_client_method_t method;
+    int buffer_size;
+    int buffer_size_tx;
+    void* user_data;
+    bool keep_alive_enable;
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char* url);
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char* key, const char* value);
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+// Bytes written, or -1 once the connection failed
+int esp_http_client_write(esp_http_client_handle_t client, const char* buffer, int len);
+// Content-Length of the response, -1 if chunked or unknown
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char* buffer, int len);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+
+#endif
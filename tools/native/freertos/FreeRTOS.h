@@ -0,0 +1,48 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// FreeRTOS on std::thread. Ticks are milliseconds (configTICK_RATE_HZ 1000,
+// as in Arduino-ESP32). Priorities and core affinity are recorded but the
+// host scheduler decides; xPortGetCoreID() reports the core a task was
+// pinned to.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Spinlock; not recursive
+struct portMUX_TYPE {
+    std::atomic<bool> locked;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+BaseType_t xPortGetCoreID();
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef NATIVE_IMG_CONVERTERS_H
+#define NATIVE_IMG_CONVERTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef enum {
+    JPG_SCALE_NONE,
+    JPG_SCALE_2X,
+    JPG_SCALE_4X,
+    JPG_SCALE_8X,
+    JPG_SCALE_MAX = JPG_SCALE_8X
+} jpg_scale_t;
+
+// There is no JPEG decoder on the host: always false, so the scene
+// detector falls back to its size test.
+bool jpg2rgb565(const uint8_t* src, size_t src_len, uint8_t* out, jpg_scale_t scale);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef NATIVE_LWIP_SOCKETS_H
+#define NATIVE_LWIP_SOCKETS_H
+
+// lwIP's BSD socket API is close enough to POSIX to use the host's.
+// Unlike lwIP, a send() on a connection the peer reset raises SIGPIPE:
+// programs using the shims ignore it.
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#endif
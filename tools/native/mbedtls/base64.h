@@ -0,0 +1,10 @@
+#ifndef NATIVE_MBEDTLS_BASE64_H
+#define NATIVE_MBEDTLS_BASE64_H
+
+#include <cstddef>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef NATIVE_MBEDTLS_SHA1_H
+#define NATIVE_MBEDTLS_SHA1_H
+
+#include <cstddef>
+
+int mbedtls_sha1_ret(const unsigned char* input, size_t ilen, unsigned char output[20]);
+int mbedtls_sha1(const unsigned char* input, size_t ilen, unsigned char output[20]);
+
+#endif
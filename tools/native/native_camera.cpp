@@ -0,0 +1,383 @@
+#include "esp_camera.h"
+#include "native_camera.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <dirent.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+
+static const char* TAG = "native_camera";
+
+#define FB_GET_TIMEOUT_MS 4000
+#define DEFAULT_SYNTHETIC_BYTES 20000
+
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    { 96, 96 },
+    { 160, 120 },
+    { 176, 144 },
+    { 240, 176 },
+    { 240, 240 },
+    { 320, 240 },
+    { 400, 296 },
+    { 480, 320 },
+    { 640, 480 },
+    { 800, 600 },
+    { 1024, 768 },
+    { 1280, 720 },
+    { 1280, 1024 },
+    { 1600, 1200 },
+    { 1920, 1080 },
+    { 720, 1280 },
+    { 864, 1536 },
+    { 2048, 1536 },
+    { 2560, 1440 },
+    { 2560, 1600 },
+    { 1080, 1920 },
+    { 2560, 1920 },
+};
+
+namespace {
+
+// camera_fb_t first, so a returned fb leads back to its buffer
+struct FrameBuffer {
+    camera_fb_t fb;
+    std::shared_ptr<const std::vector<uint8_t>> data;   // fb.buf points into it
+    bool held;
+    bool orphaned;      // the pool was torn down while this one was out
+};
+
+std::mutex cameraLock;
+std::condition_variable bufferReturned;
+
+// shared, so a frame handed out survives a re-generation on a frame size change
+std::vector<std::shared_ptr<const std::vector<uint8_t>>> frames;
+size_t syntheticBytes = DEFAULT_SYNTHETIC_BYTES;     // 0 while replaying files
+// Frame size and quality syntheticBytes applies to, from the first init
+framesize_t referenceFramesize = FRAMESIZE_INVALID;
+int referenceQuality = 0;
+float sensorFps = 0;
+
+bool initialised = false;
+std::vector<FrameBuffer*> pool;
+sensor_t sensor;
+int64_t startUs = 0;
+int64_t lastIndex = -1;
+uint64_t served = 0;
+NativeCameraStats stats = {};
+
+// Rough JPEG bytes per pixel at a quality, as FrameBufferPlanner estimates them
+float bytesPerPixel(int quality) {
+    return std::min(0.5f, std::max(0.04f, 1.6f / (float)std::max(quality, 1)));
+}
+
+// syntheticBytes scaled from the reference frame size and quality to these,
+// so a lower quality or a smaller frame puts fewer bytes on the link
+size_t syntheticSize(framesize_t framesize, int quality) {
+    if (referenceFramesize == FRAMESIZE_INVALID) {
+        return syntheticBytes;
+    }
+    double pixels = (double)resolution[framesize].width * resolution[framesize].height;
+    double referencePixels = (double)resolution[referenceFramesize].width * resolution[referenceFramesize].height;
+    return (size_t)(syntheticBytes * (pixels * bytesPerPixel(quality)) /
+                    (referencePixels * bytesPerPixel(referenceQuality)));
+}
+
+// Baseline JPEG headers (DQT, SOF0 4:2:2, SOS) around filler scan data, so
+// the RTP/JPEG transport can packetize it. No Huffman tables: not decodable.
+void makeSynthetic(framesize_t framesize, int quality) {
+    size_t bytes = syntheticSize(framesize, quality);
+    static const uint8_t QTABLES[2] = { 16, 17 };
+    uint16_t width = resolution[framesize].width;
+    uint16_t height = resolution[framesize].height;
+
+    std::vector<uint8_t> frame = { 0xFF, 0xD8 };
+    frame.insert(frame.end(), { 0xFF, 0xDB, 0x00, 2 + 2 * 65 });
+    for (uint8_t id = 0; id < 2; id++) {
+        frame.push_back(id);
+        frame.insert(frame.end(), 64, QTABLES[id]);
+    }
+    frame.insert(frame.end(), { 0xFF, 0xC0, 0x00, 17, 8,
+                                (uint8_t)(height >> 8), (uint8_t)height, (uint8_t)(width >> 8), (uint8_t)width,
+                                3, 1, 0x21, 0, 2, 0x11, 1, 3, 0x11, 1 });
+    frame.insert(frame.end(), { 0xFF, 0xDA, 0x00, 12, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 });
+
+    size_t scanEnd = std::max(bytes, frame.size() + 3) - 2;
+    for (size_t i = frame.size(); i < scanEnd; i++) {
+        // No 0xFF, so nothing in the scan reads as a marker
+        frame.push_back((uint8_t)((i * 31) % 0xFF));
+    }
+    frame.insert(frame.end(), { 0xFF, 0xD9 });
+
+    frames.clear();
+    frames.push_back(std::make_shared<const std::vector<uint8_t>>(std::move(frame)));
+}
+
+int setFramesize(sensor_t* s, framesize_t framesize) {
+    if (framesize >= FRAMESIZE_INVALID) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(cameraLock);
+    s->status.framesize = framesize;
+    if (syntheticBytes) {
+        makeSynthetic(framesize, s->status.quality);
+    }
+    return 0;
+}
+
+int setQuality(sensor_t* s, int quality) {
+    if (quality < 0 || quality > 63) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(cameraLock);
+    s->status.quality = (uint8_t)quality;
+    if (syntheticBytes) {
+        makeSynthetic(s->status.framesize, quality);
+    }
+    return 0;
+}
+
+int setPixformat(sensor_t* s, pixformat_t pixformat) {
+    s->pixformat = pixformat;
+    return 0;
+}
+
+int setFlag(sensor_t* s, int enable) {
+    (void)s;
+    (void)enable;
+    return 0;
+}
+
+bool isJpegName(const char* name) {
+    const char* dot = strrchr(name, '.');
+    return dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0);
+}
+
+}
+
+bool native_camera_replay_dir(const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        ESP_LOGE(TAG, "Cannot open %s", dir);
+        return false;
+    }
+
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(d)) {
+        if (isJpegName(entry->d_name)) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    std::lock_guard<std::mutex> lock(cameraLock);
+    frames.clear();
+    syntheticBytes = 0;
+    for (const std::string& name : names) {
+        std::string path = std::string(dir) + "/" + name;
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) {
+            continue;
+        }
+        std::vector<uint8_t> data;
+        uint8_t chunk[65536];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            data.insert(data.end(), chunk, chunk + n);
+        }
+        fclose(f);
+
+        if (data.size() < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+            ESP_LOGW(TAG, "Skipping %s: not a JPEG", path.c_str());
+            continue;
+        }
+        frames.push_back(std::make_shared<const std::vector<uint8_t>>(std::move(data)));
+    }
+
+    ESP_LOGI(TAG, "Loaded %u JPEG frames from %s", (unsigned)frames.size(), dir);
+    return !frames.empty();
+}
+
+void native_camera_synthetic(size_t bytes) {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    syntheticBytes = bytes;
+    referenceFramesize = FRAMESIZE_INVALID;
+    frames.clear();
+}
+
+void native_camera_set_fps(float fps) {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    sensorFps = std::max(fps, 0.0f);
+    startUs = esp_timer_get_time();
+    lastIndex = -1;
+}
+
+size_t native_camera_frame_count() {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    return frames.size();
+}
+
+size_t native_camera_average_bytes() {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (frames.empty()) {
+        return 0;
+    }
+    size_t total = 0;
+    for (const auto& frame : frames) {
+        total += frame->size();
+    }
+    return total / frames.size();
+}
+
+void native_camera_get_stats(NativeCameraStats& out) {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    out = stats;
+}
+
+esp_err_t esp_camera_init(const camera_config_t* config) {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config || config->frame_size >= FRAMESIZE_INVALID || config->fb_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (syntheticBytes) {
+        if (referenceFramesize == FRAMESIZE_INVALID) {
+            referenceFramesize = config->frame_size;
+            referenceQuality = config->jpeg_quality;
+        }
+        makeSynthetic(config->frame_size, config->jpeg_quality);
+    } else if (frames.empty()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (size_t i = 0; i < config->fb_count; i++) {
+        FrameBuffer* buffer = new FrameBuffer();
+        buffer->fb.format = PIXFORMAT_JPEG;
+        pool.push_back(buffer);
+    }
+
+    sensor = {};
+    sensor.status.framesize = config->frame_size;
+    sensor.status.quality = (uint8_t)config->jpeg_quality;
+    sensor.pixformat = config->pixel_format;
+    sensor.set_pixformat = setPixformat;
+    sensor.set_framesize = setFramesize;
+    sensor.set_quality = setQuality;
+    sensor.set_vflip = setFlag;
+    sensor.set_hmirror = setFlag;
+
+    startUs = esp_timer_get_time();
+    lastIndex = -1;
+    initialised = true;
+
+    ESP_LOGI(TAG, "Replaying %u frames at %.1f FPS into %u frame buffers",
+             (unsigned)frames.size(), sensorFps, (unsigned)config->fb_count);
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit() {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    if (!initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    initialised = false;
+
+    for (FrameBuffer* buffer : pool) {
+        if (buffer->held) {
+            buffer->orphaned = true;
+        } else {
+            delete buffer;
+        }
+    }
+    pool.clear();
+    return ESP_OK;
+}
+
+camera_fb_t* esp_camera_fb_get() {
+    std::unique_lock<std::mutex> lock(cameraLock);
+
+    FrameBuffer* buffer = nullptr;
+    auto freeBuffer = [&buffer] {
+        for (FrameBuffer* candidate : pool) {
+            if (!candidate->held) {
+                buffer = candidate;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    if (!initialised) {
+        ESP_LOGE(TAG, "Camera not initialised");
+        return nullptr;
+    }
+    if (!bufferReturned.wait_for(lock, std::chrono::milliseconds(FB_GET_TIMEOUT_MS), freeBuffer)) {
+        stats.timeouts++;
+        ESP_LOGW(TAG, "Failed to get the frame on time!");
+        return nullptr;
+    }
+    buffer->held = true;
+
+    int64_t now = esp_timer_get_time();
+    int64_t captureUs = now;
+    if (sensorFps > 0) {
+        // Frame n is complete at startUs + n * period
+        int64_t periodUs = (int64_t)(1000000.0f / sensorFps);
+        int64_t index = (now - startUs) / periodUs;
+        if (index <= lastIndex) {
+            index = lastIndex + 1;
+        } else if (index > lastIndex + 1 && lastIndex >= 0) {
+            stats.overruns += (uint32_t)(index - lastIndex - 1);
+        }
+        lastIndex = index;
+        captureUs = startUs + index * periodUs;
+
+        if (captureUs > now) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::microseconds(captureUs - now));
+            lock.lock();
+        }
+    }
+
+    buffer->data = frames[served++ % frames.size()];
+    camera_fb_t* fb = &buffer->fb;
+    fb->buf = const_cast<uint8_t*>(buffer->data->data());
+    fb->len = buffer->data->size();
+    fb->width = resolution[sensor.status.framesize].width;
+    fb->height = resolution[sensor.status.framesize].height;
+    fb->timestamp.tv_sec = captureUs / 1000000;
+    fb->timestamp.tv_usec = captureUs % 1000000;
+    stats.frames++;
+    return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t* fb) {
+    if (!fb) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cameraLock);
+    FrameBuffer* buffer = reinterpret_cast<FrameBuffer*>(fb);
+    if (buffer->orphaned) {
+        delete buffer;
+        return;
+    }
+    buffer->held = false;
+    buffer->data.reset();
+    bufferReturned.notify_one();
+}
+
+sensor_t* esp_camera_sensor_get() {
+    std::lock_guard<std::mutex> lock(cameraLock);
+    return initialised ? &sensor : nullptr;
+}
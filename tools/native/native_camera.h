@@ -0,0 +1,32 @@
+#ifndef NATIVE_CAMERA_H
+#define NATIVE_CAMERA_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Frame source behind the esp_camera shim. Configure it before
+// esp_camera_init(); without a directory every frame is synthetic.
+
+struct NativeCameraStats {
+    uint32_t frames;        // handed out by esp_camera_fb_get()
+    uint32_t overruns;      // sensor frames nobody took in time (GRAB_LATEST skips them)
+    uint32_t timeouts;      // esp_camera_fb_get() found no free buffer for 4 s
+};
+
+// Replays the .jpg/.jpeg files in dir in name order, looping. Files are
+// read into memory once. False if there are none.
+bool native_camera_replay_dir(const char* dir);
+// Frames of this many bytes (the default, 20000) at the frame size and
+// quality of the first esp_camera_init(): baseline JPEG headers for the
+// current frame size around filler scan data. Enough for framing and
+// RTP/JPEG packetization, not decodable. The size follows the pixel count
+// and the JPEG quality set later, as the encoder's output would.
+void native_camera_synthetic(size_t bytes);
+// Sensor frame rate. At 0 a frame is ready whenever one is asked for.
+void native_camera_set_fps(float fps);
+
+size_t native_camera_frame_count();
+size_t native_camera_average_bytes();
+void native_camera_get_stats(NativeCameraStats& out);
+
+#endif
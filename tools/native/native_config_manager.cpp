@@ -0,0 +1,129 @@
+// The NVS half of lib/ConfigManager for host builds. WiFi and the captive
+// portal have no host equivalent; the host is always "connected".
+#include <ConfigManager.h>
+#include "esp_log.h"
+#include <cstdio>
+#include <cstring>
+
+static const char *TAG = "ConfigManager";
+
+ConfigManager* ConfigManager::_instance = nullptr;
+
+// src/main.cpp defines it in the firmware; Streamer saves settings through it
+ConfigManager configManager;
+
+ConfigManager::ConfigManager() : _wifi_connected(true), _leaseRenewAt(0), _renewingLease(false) {
+    _instance = this;
+    _ssid[0] = '\0';
+    strcpy(_server_ip, "127.0.0.1");
+    strcpy(_server_port, "8080");
+    strcpy(_frame_size, "VGA");
+    strcpy(_jpeg_quality, "10");
+    strcpy(_transport, "http");
+    strcpy(_upload_mode, "length");
+    _max_fps[0] = '\0';
+}
+
+void ConfigManager::loadServerConfig() {
+    _preferences.begin("wheelbot-cam", true);
+    String server_ip_pref = _preferences.getString("server_ip", _server_ip);
+    String server_port_pref = _preferences.getString("server_port", _server_port);
+    String frame_size_pref = _preferences.getString("frame_size", _frame_size);
+    String jpeg_quality_pref = _preferences.getString("jpeg_quality", _jpeg_quality);
+    String transport_pref = _preferences.getString("transport", _transport);
+    String upload_mode_pref = _preferences.getString("upload_mode", _upload_mode);
+    String max_fps_pref = _preferences.getString("max_fps", _max_fps);
+    server_ip_pref.toCharArray(_server_ip, sizeof(_server_ip));
+    server_port_pref.toCharArray(_server_port, sizeof(_server_port));
+    frame_size_pref.toCharArray(_frame_size, sizeof(_frame_size));
+    jpeg_quality_pref.toCharArray(_jpeg_quality, sizeof(_jpeg_quality));
+    transport_pref.toCharArray(_transport, sizeof(_transport));
+    upload_mode_pref.toCharArray(_upload_mode, sizeof(_upload_mode));
+    max_fps_pref.toCharArray(_max_fps, sizeof(_max_fps));
+    _preferences.end();
+}
+
+const char* ConfigManager::get_server_ip() {
+    return _server_ip;
+}
+
+const char* ConfigManager::get_server_port() {
+    return _server_port;
+}
+
+const char* ConfigManager::get_frame_size() {
+    return _frame_size;
+}
+
+const char* ConfigManager::get_jpeg_quality() {
+    return _jpeg_quality;
+}
+
+const char* ConfigManager::get_transport() {
+    return _transport;
+}
+
+const char* ConfigManager::get_upload_mode() {
+    return _upload_mode;
+}
+
+const char* ConfigManager::get_max_fps() {
+    return _max_fps;
+}
+
+void ConfigManager::save_stream_settings(const char* frame_size, const char* jpeg_quality, const char* max_fps) {
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace 'wheelbot-cam' for writing");
+        return;
+    }
+
+    if (frame_size) {
+        _preferences.putString("frame_size", frame_size);
+        snprintf(_frame_size, sizeof(_frame_size), "%s", frame_size);
+    }
+    if (jpeg_quality) {
+        _preferences.putString("jpeg_quality", jpeg_quality);
+        snprintf(_jpeg_quality, sizeof(_jpeg_quality), "%s", jpeg_quality);
+    }
+    if (max_fps) {
+        _preferences.putString("max_fps", max_fps);
+        snprintf(_max_fps, sizeof(_max_fps), "%s", max_fps);
+    }
+    _preferences.end();
+
+    ESP_LOGI(TAG, "Stream settings saved - Frame size: %s, Quality: %s, FPS: %s",
+             _frame_size, _jpeg_quality, _max_fps[0] ? _max_fps : "default");
+}
+
+bool ConfigManager::get_wifi_connected() {
+    return _wifi_connected;
+}
+
+bool ConfigManager::get_force_captive_portal() {
+    if (!_preferences.begin("wheelbot-cam", true)) {
+        return false;
+    }
+
+    bool force = _preferences.getBool("force_captive", false);
+    _preferences.end();
+    return force;
+}
+
+void ConfigManager::set_force_captive_portal(bool force) {
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        return;
+    }
+
+    _preferences.putBool("force_captive", force);
+    _preferences.end();
+    ESP_LOGI(TAG, "Force captive portal flag set to: %s", force ? "true" : "false");
+}
+
+void ConfigManager::clear_force_captive_portal() {
+    if (!_preferences.begin("wheelbot-cam", false)) {
+        return;
+    }
+
+    _preferences.remove("force_captive");
+    _preferences.end();
+}
@@ -0,0 +1,491 @@
+#include "Arduino.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// esp_timer
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::string name;
+    bool armed = false;
+    int64_t dueUs = 0;
+    uint64_t periodUs = 0;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+Clock::time_point processStart() {
+    static const Clock::time_point start = Clock::now();
+    return start;
+}
+
+std::mutex timerLock;
+std::condition_variable timerWake;
+std::vector<esp_timer*> timers;
+bool dispatcherStarted = false;
+
+void timerDispatcher(void*) {
+    std::unique_lock<std::mutex> lock(timerLock);
+    while (true) {
+        esp_timer* next = nullptr;
+        for (esp_timer* timer : timers) {
+            if (timer->armed && (!next || timer->dueUs < next->dueUs)) {
+                next = timer;
+            }
+        }
+
+        if (!next) {
+            timerWake.wait(lock);
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (next->dueUs > now) {
+            timerWake.wait_until(lock, processStart() + std::chrono::microseconds(next->dueUs));
+            continue;
+        }
+
+        if (next->periodUs > 0) {
+            next->dueUs += next->periodUs;
+        } else {
+            next->armed = false;
+        }
+
+        // Unlocked, so the callback can re-arm or stop timers
+        esp_timer_cb_t callback = next->callback;
+        void* arg = next->arg;
+        lock.unlock();
+        callback(arg);
+        lock.lock();
+    }
+}
+
+esp_err_t startTimer(esp_timer_handle_t timer, uint64_t timeoutUs, uint64_t periodUs) {
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(timerLock);
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!dispatcherStarted) {
+        if (xTaskCreatePinnedToCore(timerDispatcher, "esp_timer", 4096, nullptr, 22, nullptr, 0) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+        dispatcherStarted = true;
+    }
+
+    timer->armed = true;
+    timer->dueUs = esp_timer_get_time() + (int64_t)timeoutUs;
+    timer->periodUs = periodUs;
+    timerWake.notify_one();
+    return ESP_OK;
+}
+
+}
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - processStart()).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+    if (!args || !args->callback || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_timer* timer = new esp_timer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name ? args->name : "";
+
+    std::lock_guard<std::mutex> lock(timerLock);
+    timers.push_back(timer);
+    *out = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return startTimer(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return startTimer(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(timerLock);
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    timerWake.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(timerLock);
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (timers[i] == timer) {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// esp_log
+
+namespace {
+
+std::atomic<int> logDefaultLevel(ESP_LOG_INFO);
+std::atomic<bool> logHasTagLevels(false);
+std::mutex logLock;
+std::map<std::string, esp_log_level_t> logTagLevels;
+
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    if (!tag || strcmp(tag, "*") == 0) {
+        logDefaultLevel = level;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(logLock);
+    logTagLevels[tag] = level;
+    logHasTagLevels = true;
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    int enabled = logDefaultLevel.load();
+    if (logHasTagLevels.load()) {
+        std::lock_guard<std::mutex> lock(logLock);
+        auto it = logTagLevels.find(tag);
+        if (it != logTagLevels.end()) {
+            enabled = it->second;
+        }
+    }
+    if (level > enabled) {
+        return;
+    }
+
+    static const char LETTERS[] = "NEWIDV";
+    char line[1024];
+    int len = snprintf(line, sizeof(line), "%c (%lu) %s: ", LETTERS[level], millis(), tag);
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + len, sizeof(line) - len - 1, format, args);
+    va_end(args);
+    len = std::min<int>(len + std::max(n, 0), sizeof(line) - 2);
+
+    line[len++] = '\n';
+    line[len] = '\0';
+    fputs(line, stderr);
+}
+
+// ---------------------------------------------------------------------------
+// esp_err, esp_system, heap
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_HTTP_CONNECT: return "ESP_ERR_HTTP_CONNECT";
+        case ESP_ERR_HTTP_WRITE_DATA: return "ESP_ERR_HTTP_WRITE_DATA";
+        case ESP_ERR_HTTP_FETCH_HEADER: return "ESP_ERR_HTTP_FETCH_HEADER";
+        case ESP_ERR_HTTP_INVALID_TRANSPORT: return "ESP_ERR_HTTP_INVALID_TRANSPORT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+uint32_t esp_random() {
+    static std::mutex lock;
+    static std::mt19937 generator{std::random_device{}()};
+    std::lock_guard<std::mutex> guard(lock);
+    return generator();
+}
+
+void esp_restart() {
+    ESP_LOGE("native", "esp_restart() called, exiting");
+    fflush(stdout);
+    fflush(stderr);
+    _Exit(3);
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    return ESP_RST_POWERON;
+}
+
+uint32_t esp_get_free_heap_size() {
+    return NATIVE_DRAM_FREE;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return NATIVE_PSRAM_SIZE;
+    }
+    if (caps & (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA)) {
+        return NATIVE_DRAM_FREE;
+    }
+    return NATIVE_DRAM_FREE + NATIVE_PSRAM_SIZE;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return NATIVE_PSRAM_SIZE;
+    }
+    return NATIVE_DRAM_LARGEST_BLOCK;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+// ---------------------------------------------------------------------------
+// Arduino core
+
+EspClass ESP;
+HardwareSerial Serial;
+
+unsigned long millis() {
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)esp_timer_get_time();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+bool psramFound() {
+    return true;
+}
+
+long random(long max) {
+    return max > 0 ? (long)(esp_random() % (uint32_t)max) : 0;
+}
+
+long random(long min, long max) {
+    return max > min ? min + random(max - min) : min;
+}
+
+void periph_module_disable(periph_module_t module) {
+    (void)module;
+}
+
+void periph_module_reset(periph_module_t module) {
+    (void)module;
+}
+
+void EspClass::restart() {
+    esp_restart();
+}
+
+uint32_t EspClass::getPsramSize() {
+    return NATIVE_PSRAM_SIZE;
+}
+
+uint32_t EspClass::getFreePsram() {
+    return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return esp_get_free_heap_size();
+}
+
+uint32_t EspClass::getCpuFreqMHz() {
+    return 240;
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// img_converters, mbedtls
+
+bool jpg2rgb565(const uint8_t* src, size_t src_len, uint8_t* out, jpg_scale_t scale) {
+    (void)src;
+    (void)src_len;
+    (void)out;
+    (void)scale;
+    return false;
+}
+
+int mbedtls_sha1_ret(const unsigned char* input, size_t ilen, unsigned char output[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::vector<uint8_t> msg(input, input + ilen);
+    uint64_t bits = (uint64_t)ilen * 8;
+    msg.push_back(0x80);
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        msg.push_back((uint8_t)(bits >> shift));
+    }
+
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = msg.data() + block + i * 4;
+            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        output[i * 4] = (uint8_t)(h[i] >> 24);
+        output[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+        output[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+        output[i * 4 + 3] = (uint8_t)h[i];
+    }
+    return 0;
+}
+
+int mbedtls_sha1(const unsigned char* input, size_t ilen, unsigned char output[20]) {
+    return mbedtls_sha1_ret(input, ilen, output);
+}
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    size_t needed = (slen + 2) / 3 * 4;
+    // Like mbedTLS: room for the terminating NUL, *olen = the size needed on failure
+    if (!dst || dlen < needed + 1) {
+        *olen = needed + 1;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+
+    unsigned char* p = dst;
+    size_t i = 0;
+    for (; i + 3 <= slen; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+        *p++ = ALPHABET[v >> 18];
+        *p++ = ALPHABET[(v >> 12) & 63];
+        *p++ = ALPHABET[(v >> 6) & 63];
+        *p++ = ALPHABET[v & 63];
+    }
+    if (i < slen) {
+        uint32_t v = (uint32_t)src[i] << 16 | (i + 1 < slen ? (uint32_t)src[i + 1] << 8 : 0);
+        *p++ = ALPHABET[v >> 18];
+        *p++ = ALPHABET[(v >> 12) & 63];
+        *p++ = i + 1 < slen ? ALPHABET[(v >> 6) & 63] : '=';
+        *p++ = '=';
+    }
+    *p = '\0';
+    *olen = (size_t)(p - dst);
+    return 0;
+}
@@ -0,0 +1,445 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_freertos_hooks.h"
+#include "esp_timer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+struct NativeTask {
+    std::string name;
+    BaseType_t core = tskNO_AFFINITY;
+    uint32_t stackDepth = 0;
+    bool spawned = false;           // created by xTaskCreate*, so it can be unwound
+    std::atomic<bool> deleted{false};
+
+    std::mutex lock;
+    std::condition_variable wake;
+    uint32_t notifyValue = 0;
+};
+
+struct NativeSemaphore {
+    enum class Type { MUTEX, RECURSIVE_MUTEX, COUNTING };
+
+    Type type;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    NativeTask* owner = nullptr;
+    UBaseType_t depth = 0;
+
+    std::mutex lock;
+    std::condition_variable available;
+};
+
+struct NativeQueue {
+    size_t length;
+    size_t itemSize;
+    std::vector<uint8_t> storage;
+    size_t head = 0;
+    size_t count = 0;
+
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Thrown into a task's own thread to end it after vTaskDelete()
+struct TaskDeleted {};
+
+// Longest a blocked call sleeps between checks for vTaskDelete()
+const std::chrono::milliseconds DELETE_POLL(20);
+
+thread_local NativeTask* tCurrent = nullptr;
+
+NativeTask* current() {
+    if (!tCurrent) {
+        tCurrent = new NativeTask();
+        tCurrent->name = "main";
+    }
+    return tCurrent;
+}
+
+void checkDeleted() {
+    if (tCurrent && tCurrent->spawned && tCurrent->deleted.load()) {
+        throw TaskDeleted();
+    }
+}
+
+// Waits until ready() or ticks have passed; false on timeout
+template <typename Ready>
+bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Ready ready) {
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(ticks);
+    while (!ready()) {
+        checkDeleted();
+        Clock::time_point now = Clock::now();
+        if (ticks != portMAX_DELAY && now >= deadline) {
+            return false;
+        }
+        Clock::time_point until = now + DELETE_POLL;
+        if (ticks != portMAX_DELAY && deadline < until) {
+            until = deadline;
+        }
+        cv.wait_until(lock, until);
+    }
+    return true;
+}
+
+void taskEntry(NativeTask* task, TaskFunction_t function, void* parameter) {
+    tCurrent = task;
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+    try {
+        function(parameter);
+    } catch (const TaskDeleted&) {
+    }
+}
+
+NativeSemaphore* createSemaphore(NativeSemaphore::Type type, UBaseType_t maxCount, UBaseType_t initialCount) {
+    NativeSemaphore* semaphore = new NativeSemaphore();
+    semaphore->type = type;
+    semaphore->maxCount = maxCount;
+    semaphore->count = initialCount;
+    return semaphore;
+}
+
+BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait, bool front) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitFor(queue->notFull, lock, ticksToWait, [queue] { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+
+    size_t index;
+    if (front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        index = queue->head;
+    } else {
+        index = (queue->head + queue->count) % queue->length;
+    }
+    memcpy(queue->storage.data() + index * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    queue->notEmpty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t queueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait, bool remove) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitFor(queue->notEmpty, lock, ticksToWait, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+
+    memcpy(item, queue->storage.data() + queue->head * queue->itemSize, queue->itemSize);
+    if (remove) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        queue->notFull.notify_one();
+    }
+    return pdTRUE;
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core) {
+    (void)priority;
+
+    NativeTask* task = new NativeTask();
+    task->name = name ? name : "";
+    task->core = core;
+    task->stackDepth = stackDepth;
+    task->spawned = true;
+
+    // Set before the task runs; some tasks read their own handle at once
+    if (created) {
+        *created = task;
+    }
+
+    try {
+        std::thread(taskEntry, task, function, parameter).detach();
+    } catch (const std::system_error&) {
+        if (created) {
+            *created = nullptr;
+        }
+        delete task;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == tCurrent) {
+        NativeTask* self = current();
+        if (self->spawned) {
+            throw TaskDeleted();
+        }
+        return;
+    }
+
+    task->deleted = true;
+    std::lock_guard<std::mutex> lock(task->lock);
+    task->wake.notify_all();
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    // Only self-suspension, which lasts until the task is deleted
+    if (task && task != tCurrent) {
+        return;
+    }
+
+    NativeTask* self = current();
+    std::unique_lock<std::mutex> lock(self->lock);
+    waitFor(self->wake, lock, portMAX_DELAY, [] { return false; });
+}
+
+void vTaskDelay(TickType_t ticks) {
+    checkDeleted();
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(ticks);
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, DELETE_POLL));
+        checkDeleted();
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current();
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : current())->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    // Host threads have megabytes of stack; report the requested depth as unused
+    return (task ? task : current())->stackDepth;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) {
+        return pdFAIL;
+    }
+    std::lock_guard<std::mutex> lock(task->lock);
+    task->notifyValue++;
+    task->wake.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask* self = current();
+    std::unique_lock<std::mutex> lock(self->lock);
+    waitFor(self->wake, lock, ticksToWait, [self] { return self->notifyValue > 0; });
+
+    uint32_t value = self->notifyValue;
+    if (value > 0) {
+        self->notifyValue = clearCountOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// Semaphores
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createSemaphore(NativeSemaphore::Type::MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return createSemaphore(NativeSemaphore::Type::RECURSIVE_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return createSemaphore(NativeSemaphore::Type::COUNTING, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createSemaphore(NativeSemaphore::Type::COUNTING, maxCount, initialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (!waitFor(semaphore->available, lock, ticksToWait, [semaphore] { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    if (semaphore->type != NativeSemaphore::Type::COUNTING) {
+        semaphore->owner = current();
+        semaphore->depth = 1;
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    if (semaphore->count >= semaphore->maxCount) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->owner = nullptr;
+    semaphore->depth = 0;
+    semaphore->available.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    {
+        std::lock_guard<std::mutex> lock(semaphore->lock);
+        if (semaphore->owner == current()) {
+            semaphore->depth++;
+            return pdTRUE;
+        }
+    }
+    return xSemaphoreTake(semaphore, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> lock(semaphore->lock);
+        if (semaphore->owner != current()) {
+            return pdFALSE;
+        }
+        if (semaphore->depth > 1) {
+            semaphore->depth--;
+            return pdTRUE;
+        }
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    return semaphore->count;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0 || itemSize == 0) {
+        return nullptr;
+    }
+    NativeQueue* queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->storage.resize((size_t)length * itemSize);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    return queueReceive(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    return queueReceive(queue, item, ticksToWait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    queue->notFull.notify_all();
+    return pdPASS;
+}
+
+// ---------------------------------------------------------------------------
+// Port
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    while (mux->locked.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    mux->locked.store(false, std::memory_order_release);
+}
+
+BaseType_t xPortGetCoreID() {
+    BaseType_t core = current()->core;
+    return core >= 0 && core < portNUM_PROCESSORS ? core : 0;
+}
+
+esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t callback, UBaseType_t cpu) {
+    (void)callback;
+    (void)cpu;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t callback, UBaseType_t cpu) {
+    (void)callback;
+    (void)cpu;
+}
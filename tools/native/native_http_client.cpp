@@ -0,0 +1,252 @@
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+static const char* TAG = "native_http_client";
+
+struct esp_http_client {
+    std::string host;
+    int port = 80;
+    std::string path;
+    esp_http_client_method_t method = HTTP_METHOD_GET;
+    int timeoutMs = 5000;
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    int sock = -1;
+    int statusCode = -1;
+    int64_t contentLength = -1;
+};
+
+namespace {
+
+bool parseUrl(esp_http_client* client, const char* url) {
+    if (strncmp(url, "http://", 7) != 0) {
+        ESP_LOGE(TAG, "Only http:// URLs are supported: %s", url);
+        return false;
+    }
+
+    const char* host = url + 7;
+    const char* pathStart = strchr(host, '/');
+    std::string authority = pathStart ? std::string(host, pathStart - host) : std::string(host);
+    client->path = pathStart ? pathStart : "/";
+
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        client->host = authority.substr(0, colon);
+        client->port = atoi(authority.c_str() + colon + 1);
+    } else {
+        client->host = authority;
+        client->port = 80;
+    }
+    return !client->host.empty() && client->port > 0;
+}
+
+bool sendAll(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+const char* methodName(esp_http_client_method_t method) {
+    switch (method) {
+        case HTTP_METHOD_POST: return "POST";
+        case HTTP_METHOD_PUT: return "PUT";
+        case HTTP_METHOD_PATCH: return "PATCH";
+        case HTTP_METHOD_DELETE: return "DELETE";
+        case HTTP_METHOD_HEAD: return "HEAD";
+        default: return "GET";
+    }
+}
+
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config) {
+    if (!config || !config->url) {
+        return nullptr;
+    }
+
+    esp_http_client* client = new esp_http_client();
+    if (!parseUrl(client, config->url)) {
+        delete client;
+        return nullptr;
+    }
+    client->method = config->method;
+    if (config->timeout_ms > 0) {
+        client->timeoutMs = config->timeout_ms;
+    }
+    return client;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    if (!client) {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    delete client;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char* url) {
+    return client && url && parseUrl(client, url) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char* key, const char* value) {
+    if (!client || !key || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (auto& header : client->headers) {
+        if (strcasecmp(header.first.c_str(), key) == 0) {
+            header.second = value;
+            return ESP_OK;
+        }
+    }
+    client->headers.emplace_back(key, value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_http_client_close(client);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    char port[8];
+    snprintf(port, sizeof(port), "%d", client->port);
+    if (getaddrinfo(client->host.c_str(), port, &hints, &res) != 0 || !res) {
+        ESP_LOGE(TAG, "Cannot resolve %s", client->host.c_str());
+        return ESP_ERR_HTTP_CONNECT;
+    }
+
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    timeval tv = { client->timeoutMs / 1000, (client->timeoutMs % 1000) * 1000 };
+    if (sock >= 0) {
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    bool connected = sock >= 0 && connect(sock, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!connected) {
+        ESP_LOGE(TAG, "Connect to %s:%d failed: %s", client->host.c_str(), client->port, strerror(errno));
+        if (sock >= 0) {
+            close(sock);
+        }
+        return ESP_ERR_HTTP_CONNECT;
+    }
+
+    std::string request = std::string(methodName(client->method)) + " " + client->path + " HTTP/1.1\r\n";
+    request += "Host: " + client->host + ":" + std::to_string(client->port) + "\r\n";
+    request += "User-Agent: ESP32 HTTP Client/1.0\r\n";
+    if (write_len < 0) {
+        request += "Transfer-Encoding: chunked\r\n";
+    } else if (write_len > 0 || client->method == HTTP_METHOD_POST) {
+        request += "Content-Length: " + std::to_string(write_len) + "\r\n";
+    }
+    for (const auto& header : client->headers) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    request += "\r\n";
+
+    if (!sendAll(sock, request.data(), request.size())) {
+        close(sock);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    client->sock = sock;
+    client->statusCode = -1;
+    client->contentLength = -1;
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char* buffer, int len) {
+    if (!client || client->sock < 0 || len < 0) {
+        return -1;
+    }
+    return sendAll(client->sock, buffer, (size_t)len) ? len : -1;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+    if (!client || client->sock < 0) {
+        return ESP_FAIL;
+    }
+
+    // Byte by byte, so nothing of the body is consumed
+    std::string head;
+    char c;
+    while (head.size() < 8192 && (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0)) {
+        ssize_t n = recv(client->sock, &c, 1, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        head += c;
+    }
+
+    int major, minor, status;
+    if (sscanf(head.c_str(), "HTTP/%d.%d %d", &major, &minor, &status) == 3) {
+        client->statusCode = status;
+    }
+    const char* length = strcasestr(head.c_str(), "\r\nContent-Length:");
+    client->contentLength = length ? atoll(length + 17) : -1;
+    return client->contentLength;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    return client ? client->statusCode : -1;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client) {
+    return client ? client->contentLength : -1;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char* buffer, int len) {
+    if (!client || client->sock < 0) {
+        return -1;
+    }
+    ssize_t n = recv(client->sock, buffer, (size_t)len, 0);
+    return n < 0 ? -1 : (int)n;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+    if (!client) {
+        return ESP_FAIL;
+    }
+    if (client->sock >= 0) {
+        close(client->sock);
+        client->sock = -1;
+    }
+    return ESP_OK;
+}
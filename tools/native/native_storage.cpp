@@ -0,0 +1,335 @@
+#include "Preferences.h"
+#include "FS.h"
+#include "LittleFS.h"
+#include "esp_log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* TAG = "native_storage";
+
+// Size of the littlefs data partition in partitions.csv
+#define LITTLEFS_PARTITION_BYTES 0xE0000
+
+// ---------------------------------------------------------------------------
+// Preferences
+
+namespace {
+
+std::mutex nvsLock;
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+    if (!name || strlen(name) > 15) {
+        return false;
+    }
+    _namespace = name;
+    _readOnly = readOnly;
+    _open = true;
+    return true;
+}
+
+void Preferences::end() {
+    _open = false;
+}
+
+bool Preferences::isKey(const char* key) {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    return _open && nvs[_namespace].count(key) > 0;
+}
+
+bool Preferences::remove(const char* key) {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    return _open && !_readOnly && nvs[_namespace].erase(key) > 0;
+}
+
+bool Preferences::clear() {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    if (!_open || _readOnly) {
+        return false;
+    }
+    nvs[_namespace].clear();
+    return true;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    if (!_open || _readOnly || !key) {
+        return 0;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    nvs[_namespace][key].assign(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    if (!_open || !key) {
+        return 0;
+    }
+    auto& entries = nvs[_namespace];
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.size() > maxLen) {
+        return 0;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    std::lock_guard<std::mutex> lock(nvsLock);
+    if (!_open || !key) {
+        return 0;
+    }
+    auto& entries = nvs[_namespace];
+    auto it = entries.find(key);
+    return it == entries.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return putBytes(key, value, strlen(value) + 1) ? strlen(value) : 0;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    size_t len = getBytesLength(key);
+    if (len == 0) {
+        return defaultValue;
+    }
+    std::vector<char> buf(len);
+    getBytes(key, buf.data(), len);
+    return String(buf.data());
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    uint8_t v = value ? 1 : 0;
+    return putBytes(key, &v, sizeof(v));
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    uint8_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v != 0 : defaultValue;
+}
+
+size_t Preferences::putInt(const char* key, int32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+    int32_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+// ---------------------------------------------------------------------------
+// File
+
+namespace fs {
+
+struct FileImpl {
+    std::string path;       // as the firmware sees it, "/backlog/0001.seg"
+    std::string hostPath;
+    std::string name;
+    FILE* file = nullptr;
+    DIR* dir = nullptr;
+
+    ~FileImpl() {
+        if (file) {
+            fclose(file);
+        }
+        if (dir) {
+            closedir(dir);
+        }
+    }
+};
+
+File::operator bool() const {
+    return _impl && (_impl->file || _impl->dir);
+}
+
+const char* File::name() const {
+    return _impl ? _impl->name.c_str() : "";
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return _impl && _impl->dir;
+}
+
+size_t File::size() const {
+    struct stat st;
+    if (!_impl || !_impl->file || fstat(fileno(_impl->file), &st) != 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+size_t File::position() const {
+    if (!_impl || !_impl->file) {
+        return 0;
+    }
+    long pos = ftell(_impl->file);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+int File::available() {
+    size_t total = size();
+    size_t pos = position();
+    return total > pos ? (int)(total - pos) : 0;
+}
+
+bool File::seek(uint32_t pos) {
+    return _impl && _impl->file && fseek(_impl->file, (long)pos, SEEK_SET) == 0;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    return _impl && _impl->file ? fread(buf, 1, size, _impl->file) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    return _impl && _impl->file ? fwrite(buf, 1, size, _impl->file) : 0;
+}
+
+void File::flush() {
+    if (_impl && _impl->file) {
+        fflush(_impl->file);
+    }
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+File File::openNextFile(const char* mode) {
+    if (!_impl || !_impl->dir) {
+        return File();
+    }
+    while (struct dirent* entry = readdir(_impl->dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        std::string child = _impl->path == "/" ? "/" + std::string(entry->d_name)
+                                               : _impl->path + "/" + entry->d_name;
+        return LittleFS.open(child.c_str(), mode);
+    }
+    return File();
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// LittleFS
+
+LittleFSFS LittleFS;
+
+std::string LittleFSFS::_hostPath(const char* path) const {
+    return _root + (path && path[0] == '/' ? "" : "/") + (path ? path : "");
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+
+    const char* root = getenv("NATIVE_LITTLEFS_ROOT");
+    _root = root && root[0] ? root : (std::filesystem::temp_directory_path() / "wheelbot-littlefs").string();
+
+    std::error_code err;
+    std::filesystem::create_directories(_root, err);
+    if (err) {
+        ESP_LOGE(TAG, "Cannot create %s: %s", _root.c_str(), err.message().c_str());
+        return false;
+    }
+    ESP_LOGI(TAG, "LittleFS at %s", _root.c_str());
+    return true;
+}
+
+void LittleFSFS::end() {
+}
+
+bool LittleFSFS::format() {
+    std::error_code err;
+    std::filesystem::remove_all(_root, err);
+    std::filesystem::create_directories(_root, err);
+    return !err;
+}
+
+File LittleFSFS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    auto impl = std::make_shared<fs::FileImpl>();
+    impl->path = path;
+    impl->hostPath = _hostPath(path);
+    const char* slash = strrchr(path, '/');
+    impl->name = slash ? slash + 1 : path;
+
+    struct stat st;
+    bool exists = stat(impl->hostPath.c_str(), &st) == 0;
+    if (exists && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(impl->hostPath.c_str());
+    } else {
+        const char* hostMode = strcmp(mode, FILE_WRITE) == 0 ? "wb" : strcmp(mode, FILE_APPEND) == 0 ? "ab" : "rb";
+        impl->file = fopen(impl->hostPath.c_str(), hostMode);
+    }
+    return File(impl);
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat st;
+    return stat(_hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return unlink(_hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    return ::rename(_hostPath(from).c_str(), _hostPath(to).c_str()) == 0;
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+    return ::mkdir(_hostPath(path).c_str(), 0755) == 0;
+}
+
+bool LittleFSFS::rmdir(const char* path) {
+    return ::rmdir(_hostPath(path).c_str()) == 0;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return LITTLEFS_PARTITION_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    std::error_code err;
+    for (auto it = std::filesystem::recursive_directory_iterator(_root, err);
+         !err && it != std::filesystem::recursive_directory_iterator(); it.increment(err)) {
+        if (it->is_regular_file(err)) {
+            used += (size_t)it->file_size(err);
+        }
+    }
+    return used;
+}
@@ -0,0 +1,70 @@
+#ifndef NATIVE_SENSOR_H
+#define NATIVE_SENSOR_H
+
+#include <cstdint>
+
+typedef enum {
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_YUV420,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555
+} pixformat_t;
+
+typedef enum {
+    FRAMESIZE_96X96,    // 96x96
+    FRAMESIZE_QQVGA,    // 160x120
+    FRAMESIZE_QCIF,     // 176x144
+    FRAMESIZE_HQVGA,    // 240x176
+    FRAMESIZE_240X240,  // 240x240
+    FRAMESIZE_QVGA,     // 320x240
+    FRAMESIZE_CIF,      // 400x296
+    FRAMESIZE_HVGA,     // 480x320
+    FRAMESIZE_VGA,      // 640x480
+    FRAMESIZE_SVGA,     // 800x600
+    FRAMESIZE_XGA,      // 1024x768
+    FRAMESIZE_HD,       // 1280x720
+    FRAMESIZE_SXGA,     // 1280x1024
+    FRAMESIZE_UXGA,     // 1600x1200
+    FRAMESIZE_FHD,      // 1920x1080
+    FRAMESIZE_P_HD,     // 720x1280
+    FRAMESIZE_P_3MP,    // 864x1536
+    FRAMESIZE_QXGA,     // 2048x1536
+    FRAMESIZE_QHD,      // 2560x1440
+    FRAMESIZE_WQXGA,    // 2560x1600
+    FRAMESIZE_P_FHD,    // 1080x1920
+    FRAMESIZE_QSXGA,    // 2560x1920
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef struct {
+    const uint16_t width;
+    const uint16_t height;
+} resolution_info_t;
+
+extern const resolution_info_t resolution[];
+
+typedef struct {
+    framesize_t framesize;
+    uint8_t quality;
+} camera_status_t;
+
+typedef struct _sensor sensor_t;
+
+// Setters return 0 on success. Quality and frame size are recorded in
+// status; they do not change the replayed frames.
+struct _sensor {
+    camera_status_t status;
+    pixformat_t pixformat;
+    int (*set_pixformat)(sensor_t* sensor, pixformat_t pixformat);
+    int (*set_framesize)(sensor_t* sensor, framesize_t framesize);
+    int (*set_quality)(sensor_t* sensor, int quality);
+    int (*set_vflip)(sensor_t* sensor, int enable);
+    int (*set_hmirror)(sensor_t* sensor, int enable);
+};
+
+#endif
@@ -0,0 +1,732 @@
+// Reference receiver for the wheelbot-cam RTP/JPEG stream (RFC 2435).
+//
+// Listens on a UDP port, reassembles JPEG frames from their fragments,
+// rebuilds the JPEG headers the payload format strips and reports packet
+// and frame loss, arrival jitter and capture-to-arrival latency. Complete
+// frames can be written to a directory for inspection. See README.md.
+//
+// Build: g++ -O2 -std=c++17 -pthread -o rtp_receiver rtp_receiver.cpp
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint16_t port = 5004;
+    int payloadType = 26;           // -1 = accept any
+    std::string saveDir;            // empty = do not write frames
+    uint32_t saveEvery = 1;         // write every Nth complete frame
+    int rcvBuf = 1 << 20;           // SO_RCVBUF
+    double reportInterval = 1.0;
+    bool verbose = false;
+};
+
+Options g_options;
+std::atomic<bool> g_running{true};
+
+using Clock = std::chrono::steady_clock;
+
+const double RTP_CLOCK_HZ = 90000.0;
+
+// ---------------------------------------------------------------------------
+// JPEG header reconstruction (RFC 2435, appendices A and B)
+
+const uint8_t ZIGZAG_LUMA_QUANTIZER[64] = {
+    16, 11, 12, 14, 12, 10, 16, 14, 13, 14, 18, 17, 16, 19, 24, 40,
+    26, 24, 22, 22, 24, 49, 35, 37, 29, 40, 58, 51, 61, 60, 57, 51,
+    56, 55, 64, 72, 92, 78, 64, 68, 87, 69, 55, 56, 80, 109, 81, 87,
+    95, 98, 103, 104, 103, 62, 77, 113, 121, 112, 100, 120, 92, 101, 103, 99
+};
+
+const uint8_t ZIGZAG_CHROMA_QUANTIZER[64] = {
+    17, 18, 18, 24, 21, 24, 47, 26, 26, 47, 99, 66, 56, 66, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+};
+
+const uint8_t LUMA_DC_CODELENS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t LUMA_DC_SYMBOLS[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t LUMA_AC_CODELENS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t LUMA_AC_SYMBOLS[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+const uint8_t CHROMA_DC_CODELENS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+const uint8_t CHROMA_DC_SYMBOLS[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t CHROMA_AC_CODELENS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+const uint8_t CHROMA_AC_SYMBOLS[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+// Tables for Q 1..99 (Q 100..127 is reserved and treated as 99)
+void makeTables(int q, uint8_t* luma, uint8_t* chroma) {
+    int factor = std::min(std::max(q, 1), 99);
+    int scale = factor < 50 ? 5000 / factor : 200 - factor * 2;
+    for (int i = 0; i < 64; i++) {
+        luma[i] = (uint8_t)std::min(std::max((ZIGZAG_LUMA_QUANTIZER[i] * scale + 50) / 100, 1), 255);
+        chroma[i] = (uint8_t)std::min(std::max((ZIGZAG_CHROMA_QUANTIZER[i] * scale + 50) / 100, 1), 255);
+    }
+}
+
+void putMarker(std::vector<uint8_t>& out, uint8_t marker, size_t bodyLen) {
+    out.push_back(0xFF);
+    out.push_back(marker);
+    out.push_back((uint8_t)((bodyLen + 2) >> 8));
+    out.push_back((uint8_t)((bodyLen + 2) & 0xFF));
+}
+
+void putHuffman(std::vector<uint8_t>& out, uint8_t tableClassId, const uint8_t* codelens, const uint8_t* symbols, size_t symbolCount) {
+    putMarker(out, 0xC4, 1 + 16 + symbolCount);
+    out.push_back(tableClassId);
+    out.insert(out.end(), codelens, codelens + 16);
+    out.insert(out.end(), symbols, symbols + symbolCount);
+}
+
+// Everything up to and including SOS for a baseline, three-component frame.
+// Type 0 is 4:2:2 (luma 2x1), type 1 is 4:2:0 (luma 2x2); +64 adds DRI.
+void makeHeaders(std::vector<uint8_t>& out, uint8_t type, uint16_t width, uint16_t height,
+                 const uint8_t* luma, const uint8_t* chroma, uint16_t restartInterval) {
+    out.push_back(0xFF);
+    out.push_back(0xD8);
+
+    putMarker(out, 0xDB, 65);
+    out.push_back(0);
+    out.insert(out.end(), luma, luma + 64);
+    putMarker(out, 0xDB, 65);
+    out.push_back(1);
+    out.insert(out.end(), chroma, chroma + 64);
+
+    if (restartInterval) {
+        putMarker(out, 0xDD, 2);
+        out.push_back(restartInterval >> 8);
+        out.push_back(restartInterval & 0xFF);
+    }
+
+    putMarker(out, 0xC0, 15);
+    out.push_back(8);
+    out.push_back(height >> 8);
+    out.push_back(height & 0xFF);
+    out.push_back(width >> 8);
+    out.push_back(width & 0xFF);
+    out.push_back(3);
+    out.push_back(0);
+    out.push_back((type & 63) == 0 ? 0x21 : 0x22);
+    out.push_back(0);
+    out.push_back(1);
+    out.push_back(0x11);
+    out.push_back(1);
+    out.push_back(2);
+    out.push_back(0x11);
+    out.push_back(1);
+
+    putHuffman(out, 0x00, LUMA_DC_CODELENS, LUMA_DC_SYMBOLS, sizeof(LUMA_DC_SYMBOLS));
+    putHuffman(out, 0x10, LUMA_AC_CODELENS, LUMA_AC_SYMBOLS, sizeof(LUMA_AC_SYMBOLS));
+    putHuffman(out, 0x01, CHROMA_DC_CODELENS, CHROMA_DC_SYMBOLS, sizeof(CHROMA_DC_SYMBOLS));
+    putHuffman(out, 0x11, CHROMA_AC_CODELENS, CHROMA_AC_SYMBOLS, sizeof(CHROMA_AC_SYMBOLS));
+
+    putMarker(out, 0xDA, 10);
+    out.push_back(3);
+    out.push_back(0);
+    out.push_back(0x00);
+    out.push_back(1);
+    out.push_back(0x11);
+    out.push_back(2);
+    out.push_back(0x11);
+    out.push_back(0);
+    out.push_back(63);
+    out.push_back(0);
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+struct Interval {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t framesLost = 0;
+    std::vector<double> latencyMs;
+};
+
+class Stats {
+public:
+    void packet(size_t len) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _interval.packets++;
+        _interval.bytes += len;
+        _totalPackets++;
+    }
+
+    void sequence(uint64_t expected, uint64_t received, uint64_t reordered, uint64_t duplicates) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _expected = expected;
+        _received = received;
+        _reordered = reordered;
+        _duplicates = duplicates;
+    }
+
+    void frame(uint32_t rtpTimestamp, Clock::time_point arrival) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _interval.frames++;
+        _totalFrames++;
+
+        // Unwrap the 32-bit 90 kHz clock so the offset below stays continuous
+        if (_haveTimestamp) {
+            _captureTicks += (int32_t)(rtpTimestamp - _lastTimestamp);
+        }
+        _lastTimestamp = rtpTimestamp;
+        _haveTimestamp = true;
+
+        double captureSec = _captureTicks / RTP_CLOCK_HZ;
+        double arrivalSec = std::chrono::duration<double>(arrival.time_since_epoch()).count();
+
+        // Device and host clocks are unrelated: latency is measured above the
+        // smallest capture-to-arrival offset seen, i.e. the queueing and
+        // transfer delay on top of the fastest frame.
+        double offset = arrivalSec - captureSec;
+        if (!_haveOffset || offset < _minOffset) {
+            _minOffset = offset;
+            _haveOffset = true;
+        }
+        _interval.latencyMs.push_back((offset - _minOffset) * 1000.0);
+
+        // RFC 3550 interarrival jitter, per frame rather than per packet
+        if (_havePrevious) {
+            double d = (arrivalSec - _prevArrival) - (captureSec - _prevCapture);
+            _jitterMs += (std::fabs(d) * 1000.0 - _jitterMs) / 16.0;
+        }
+        _prevArrival = arrivalSec;
+        _prevCapture = captureSec;
+        _havePrevious = true;
+    }
+
+    void frameLost(const char* why) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _interval.framesLost++;
+        _totalFramesLost++;
+        if (g_options.verbose) {
+            fprintf(stderr, "frame lost: %s\n", why);
+        }
+    }
+
+    void malformed(const char* what) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _malformed++;
+        if (g_options.verbose) {
+            fprintf(stderr, "malformed packet: %s\n", what);
+        }
+    }
+
+    void sourceChanged() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _sources++;
+        // A new SSRC is a new stream with its own timestamp origin
+        _haveTimestamp = false;
+        _captureTicks = 0;
+        _haveOffset = false;
+        _havePrevious = false;
+    }
+
+    void report(double elapsed, double intervalSec) {
+        Interval interval;
+        uint64_t totalFrames, totalLost, expected, received, reordered, duplicates, malformed;
+        unsigned sources;
+        double jitter;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::swap(interval, _interval);
+            totalFrames = _totalFrames;
+            totalLost = _totalFramesLost;
+            expected = _expected;
+            received = _received;
+            reordered = _reordered;
+            duplicates = _duplicates;
+            malformed = _malformed;
+            sources = _sources;
+            jitter = _jitterMs;
+        }
+
+        double p50 = 0, p99 = 0, max = 0;
+        if (!interval.latencyMs.empty()) {
+            std::vector<double>& v = interval.latencyMs;
+            std::sort(v.begin(), v.end());
+            p50 = v[v.size() / 2];
+            p99 = v[std::min(v.size() - 1, (size_t)std::ceil(v.size() * 0.99) - 1)];
+            max = v.back();
+        }
+
+        uint64_t lost = expected > received ? expected - received : 0;
+        double lossPct = expected ? 100.0 * lost / expected : 0;
+
+        printf("[%7.1fs] ssrc %u | %5.1f fps | %6.3f MB/s | %5.0f pkt/s | frames %llu lost %llu (+%llu)"
+               " | packets lost %llu (%.2f%%) reordered %llu dup %llu bad %llu"
+               " | jitter %5.1f ms | latency p50 %6.1f p99 %6.1f max %6.1f ms\n",
+               elapsed, sources, interval.frames / intervalSec, interval.bytes / intervalSec / 1e6,
+               interval.packets / intervalSec, (unsigned long long)totalFrames, (unsigned long long)totalLost,
+               (unsigned long long)interval.framesLost, (unsigned long long)lost, lossPct,
+               (unsigned long long)reordered, (unsigned long long)duplicates, (unsigned long long)malformed,
+               jitter, p50, p99, max);
+        fflush(stdout);
+    }
+
+private:
+    std::mutex _mutex;
+
+    Interval _interval;
+    uint64_t _totalPackets = 0;
+    uint64_t _totalFrames = 0;
+    uint64_t _totalFramesLost = 0;
+    uint64_t _expected = 0;
+    uint64_t _received = 0;
+    uint64_t _reordered = 0;
+    uint64_t _duplicates = 0;
+    uint64_t _malformed = 0;
+    unsigned _sources = 0;
+
+    bool _haveTimestamp = false;
+    uint32_t _lastTimestamp = 0;
+    int64_t _captureTicks = 0;
+    bool _haveOffset = false;
+    double _minOffset = 0;
+    bool _havePrevious = false;
+    double _prevArrival = 0;
+    double _prevCapture = 0;
+    double _jitterMs = 0;
+};
+
+Stats g_stats;
+
+// ---------------------------------------------------------------------------
+// Sequence tracking (RFC 3550 appendix A.1, without probation)
+
+class SequenceTracker {
+public:
+    void reset(uint16_t seq) {
+        _base = seq;
+        _maxSeq = seq;
+        _cycles = 0;
+        _received = 0;
+        _reordered = 0;
+        _duplicates = 0;
+        _started = true;
+    }
+
+    bool started() const { return _started; }
+
+    void update(uint16_t seq) {
+        int16_t delta = (int16_t)(seq - _maxSeq);
+        if (delta > 0) {
+            if (seq < _maxSeq) {
+                _cycles += 65536;
+            }
+            _maxSeq = seq;
+        } else if (delta == 0 && _received > 0) {
+            _duplicates++;
+            return;
+        } else if (delta < 0) {
+            _reordered++;
+        }
+        _received++;
+    }
+
+    uint64_t expected() const { return _cycles + _maxSeq - _base + 1; }
+    uint64_t received() const { return _received; }
+    uint64_t reordered() const { return _reordered; }
+    uint64_t duplicates() const { return _duplicates; }
+
+private:
+    bool _started = false;
+    uint16_t _base = 0;
+    uint16_t _maxSeq = 0;
+    uint64_t _cycles = 0;
+    uint64_t _received = 0;
+    uint64_t _reordered = 0;
+    uint64_t _duplicates = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Frame reassembly
+//
+// Fragments of one frame share the RTP timestamp and are placed by their
+// fragment offset, so reordering within a frame is harmless. The frame is
+// complete when the marker packet has arrived and the fragments cover every
+// byte up to its end. A frame still incomplete when a newer timestamp shows
+// up is counted as lost.
+
+class FrameAssembler {
+public:
+    void packet(uint32_t timestamp, bool marker, uint32_t offset, uint8_t type, uint8_t q,
+                uint16_t width, uint16_t height, uint16_t restartInterval,
+                const uint8_t* qtables, size_t qtablesLen, const uint8_t* data, size_t len) {
+        if (_active && timestamp != _timestamp) {
+            if ((int32_t)(timestamp - _timestamp) < 0) {
+                // A straggler from a frame already completed or given up on
+                return;
+            }
+            _abandon("incomplete when the next frame started");
+        }
+
+        if (!_active) {
+            _active = true;
+            _timestamp = timestamp;
+            _scan.clear();
+            _covered = 0;
+            _end = 0;
+            _haveTables = false;
+        }
+
+        if (offset == 0) {
+            _type = type;
+            _q = q;
+            _width = width;
+            _height = height;
+            _restartInterval = restartInterval;
+            if (q >= 128 && qtablesLen >= 128) {
+                memcpy(_luma, qtables, 64);
+                memcpy(_chroma, qtables + 64, 64);
+                _haveTables = true;
+            } else if (q < 128) {
+                makeTables(q, _luma, _chroma);
+                _haveTables = true;
+            }
+        }
+
+        if (_scan.size() < offset + len) {
+            _scan.resize(offset + len);
+        }
+        memcpy(_scan.data() + offset, data, len);
+        // Fragments do not overlap, so their lengths add up to the frame size
+        _covered += len;
+        if (marker) {
+            _end = offset + len;
+        }
+
+        if (_end && _covered >= _end) {
+            _complete(Clock::now());
+        }
+    }
+
+private:
+    void _abandon(const char* why) {
+        g_stats.frameLost(why);
+        _active = false;
+    }
+
+    void _complete(Clock::time_point arrival) {
+        _active = false;
+        if (!_haveTables) {
+            g_stats.frameLost("first fragment without usable quantization tables");
+            return;
+        }
+        if ((_type & 63) > 1) {
+            g_stats.frameLost("unsupported JPEG type");
+            return;
+        }
+
+        g_stats.frame(_timestamp, arrival);
+
+        _frameNumber++;
+        if (g_options.saveDir.empty() || _frameNumber % g_options.saveEvery != 0) {
+            return;
+        }
+
+        std::vector<uint8_t> jpeg;
+        makeHeaders(jpeg, _type, _width, _height, _luma, _chroma, _type >= 64 ? _restartInterval : 0);
+        jpeg.insert(jpeg.end(), _scan.begin(), _scan.begin() + _end);
+        jpeg.push_back(0xFF);
+        jpeg.push_back(0xD9);
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%06llu_%010u.jpg", g_options.saveDir.c_str(),
+                 (unsigned long long)_frameNumber, _timestamp);
+        FILE* f = fopen(path, "wb");
+        if (!f || fwrite(jpeg.data(), 1, jpeg.size(), f) != jpeg.size()) {
+            fprintf(stderr, "failed to write %s: %s\n", path, strerror(errno));
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+
+    bool _active = false;
+    uint32_t _timestamp = 0;
+    std::vector<uint8_t> _scan;
+    size_t _covered = 0;
+    size_t _end = 0;
+
+    uint8_t _type = 0;
+    uint8_t _q = 0;
+    uint16_t _width = 0;
+    uint16_t _height = 0;
+    uint16_t _restartInterval = 0;
+    bool _haveTables = false;
+    uint8_t _luma[64];
+    uint8_t _chroma[64];
+
+    uint64_t _frameNumber = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Packet parsing
+
+struct Receiver {
+    bool haveSource = false;
+    uint32_t ssrc = 0;
+    SequenceTracker sequence;
+    FrameAssembler frames;
+
+    void datagram(const uint8_t* p, size_t len) {
+        g_stats.packet(len);
+
+        // RTP fixed header
+        if (len < 12 || (p[0] >> 6) != 2) {
+            g_stats.malformed("not RTP version 2");
+            return;
+        }
+        bool padding = p[0] & 0x20;
+        bool extension = p[0] & 0x10;
+        size_t csrcCount = p[0] & 0x0F;
+        bool marker = p[1] & 0x80;
+        int payloadType = p[1] & 0x7F;
+        uint16_t seq = (uint16_t)(p[2] << 8 | p[3]);
+        uint32_t timestamp = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+        uint32_t source = (uint32_t)p[8] << 24 | (uint32_t)p[9] << 16 | (uint32_t)p[10] << 8 | p[11];
+
+        if (g_options.payloadType >= 0 && payloadType != g_options.payloadType) {
+            g_stats.malformed("unexpected payload type");
+            return;
+        }
+
+        size_t pos = 12 + 4 * csrcCount;
+        if (extension) {
+            if (len < pos + 4) {
+                g_stats.malformed("truncated header extension");
+                return;
+            }
+            pos += 4 + 4 * (size_t)(p[pos + 2] << 8 | p[pos + 3]);
+        }
+        if (padding && len > pos) {
+            len -= std::min<size_t>(p[len - 1], len - pos);
+        }
+        if (len < pos + 8) {
+            g_stats.malformed("truncated JPEG header");
+            return;
+        }
+
+        // The camera picks a new SSRC and sequence on every connect
+        if (!haveSource || source != ssrc) {
+            printf("New RTP source ssrc=%08x, seq %u\n", source, seq);
+            fflush(stdout);
+            haveSource = true;
+            ssrc = source;
+            sequence.reset(seq);
+            frames = FrameAssembler();
+            g_stats.sourceChanged();
+        }
+        sequence.update(seq);
+        g_stats.sequence(sequence.expected(), sequence.received(), sequence.reordered(), sequence.duplicates());
+
+        // JPEG header: type-specific, 24-bit fragment offset, type, Q, width/8, height/8
+        const uint8_t* jh = p + pos;
+        uint32_t offset = (uint32_t)jh[1] << 16 | (uint32_t)jh[2] << 8 | jh[3];
+        uint8_t type = jh[4];
+        uint8_t q = jh[5];
+        uint16_t width = jh[6] * 8;
+        uint16_t height = jh[7] * 8;
+        pos += 8;
+
+        uint16_t restartInterval = 0;
+        if (type >= 64 && type < 128) {
+            if (len < pos + 4) {
+                g_stats.malformed("truncated restart marker header");
+                return;
+            }
+            restartInterval = (uint16_t)(p[pos] << 8 | p[pos + 1]);
+            pos += 4;
+        }
+
+        const uint8_t* qtables = nullptr;
+        size_t qtablesLen = 0;
+        if (q >= 128 && offset == 0) {
+            if (len < pos + 4) {
+                g_stats.malformed("truncated quantization table header");
+                return;
+            }
+            uint8_t precision = p[pos + 1];
+            qtablesLen = (size_t)(p[pos + 2] << 8 | p[pos + 3]);
+            pos += 4;
+            if (precision != 0 || len < pos + qtablesLen) {
+                g_stats.malformed("unsupported or truncated quantization tables");
+                return;
+            }
+            qtables = p + pos;
+            pos += qtablesLen;
+        }
+
+        frames.packet(timestamp, marker, offset, type, q, width, height, restartInterval,
+                      qtables, qtablesLen, p + pos, len - pos);
+    }
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --port N           UDP port (5004)\n"
+            "  --payload-type N   RTP payload type to accept, -1 for any (26)\n"
+            "  --save DIR         write complete frames as JPEG files to DIR\n"
+            "  --save-every N     only write every Nth complete frame (1)\n"
+            "  --rcvbuf N         socket receive buffer in bytes (1048576)\n"
+            "  --interval S       report interval in seconds (1)\n"
+            "  --verbose          log every lost frame and malformed packet\n",
+            argv0);
+}
+
+bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto needValue = [&]() {
+            if (!value) {
+                fprintf(stderr, "%s needs a value\n", arg.c_str());
+                return false;
+            }
+            i++;
+            return true;
+        };
+
+        if (arg == "--verbose") {
+            g_options.verbose = true;
+        } else if (arg == "--port") {
+            if (!needValue()) return false;
+            g_options.port = (uint16_t)atoi(value);
+        } else if (arg == "--payload-type") {
+            if (!needValue()) return false;
+            g_options.payloadType = atoi(value);
+        } else if (arg == "--save") {
+            if (!needValue()) return false;
+            g_options.saveDir = value;
+        } else if (arg == "--save-every") {
+            if (!needValue()) return false;
+            g_options.saveEvery = std::max<uint32_t>(1, (uint32_t)strtoul(value, nullptr, 10));
+        } else if (arg == "--rcvbuf") {
+            if (!needValue()) return false;
+            g_options.rcvBuf = atoi(value);
+        } else if (arg == "--interval") {
+            if (!needValue()) return false;
+            g_options.reportInterval = std::max(0.1, atof(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // No SA_RESTART, so Ctrl-C interrupts recv()
+    struct sigaction stop = {};
+    stop.sa_handler = [](int) { g_running = false; };
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (g_options.rcvBuf > 0) {
+        // Bursts of a whole frame arrive back to back; a small buffer drops them here, not on the air
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &g_options.rcvBuf, sizeof(g_options.rcvBuf));
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(g_options.port);
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("bind");
+        return 1;
+    }
+
+    printf("Listening for RTP/JPEG on udp :%u%s%s\n", g_options.port,
+           g_options.saveDir.empty() ? "" : ", saving frames to ", g_options.saveDir.c_str());
+    fflush(stdout);
+
+    Clock::time_point start = Clock::now();
+    std::thread reporter([start]() {
+        Clock::time_point last = start;
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(g_options.reportInterval));
+            Clock::time_point now = Clock::now();
+            g_stats.report(std::chrono::duration<double>(now - start).count(),
+                           std::chrono::duration<double>(now - last).count());
+            last = now;
+        }
+    });
+
+    Receiver receiver;
+    std::vector<uint8_t> buf(65536);
+    while (g_running) {
+        ssize_t n = recv(sock, buf.data(), buf.size(), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("recv");
+            break;
+        }
+        receiver.datagram(buf.data(), (size_t)n);
+    }
+
+    g_running = false;
+    close(sock);
+    reporter.join();
+    return 0;
+}
@@ -0,0 +1,788 @@
+// Stand-in WebSocket server for the wheelbot-cam `ws` transport.
+//
+// Accepts the upgrade at <path>, checks every client frame (masking,
+// framing, the 20-byte metadata prefix, JPEG SOI/EOI) and reports FPS,
+// throughput, sequence gaps, jitter and capture-to-arrival latency. Lines
+// typed on stdin go to every connected camera as text messages, so the
+// control channel can be exercised by hand. See README.md.
+//
+// Build: g++ -O2 -std=c++17 -pthread -o ws_server ws_server.cpp
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <set>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    uint16_t port = 8080;
+    std::string path = "/ws";
+    double pingInterval = 5.0;      // 0 = never ping
+    uint64_t closeAfter = 0;        // close after N frames, 0 = never
+    double reportInterval = 1.0;
+    bool verbose = false;
+};
+
+Options g_options;
+std::atomic<bool> g_running{true};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const size_t META_LEN = 20;
+const uint8_t META_VERSION = 1;
+const size_t MAX_MESSAGE = 4 * 1024 * 1024;
+
+// ---------------------------------------------------------------------------
+// SHA-1 and base64 for Sec-WebSocket-Accept
+
+std::string sha1(const std::string& input) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string msg = input;
+    uint64_t bits = (uint64_t)input.size() * 8;
+    msg += (char)0x80;
+    while (msg.size() % 64 != 56) {
+        msg += (char)0;
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        msg += (char)(bits >> shift);
+    }
+
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = (const uint8_t*)msg.data() + block + i * 4;
+            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t v : h) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            digest += (char)(v >> shift);
+        }
+    }
+    return digest;
+}
+
+std::string base64(const std::string& input) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t i = 0;
+    for (; i + 3 <= input.size(); i += 3) {
+        uint32_t v = (uint8_t)input[i] << 16 | (uint8_t)input[i + 1] << 8 | (uint8_t)input[i + 2];
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += alphabet[v & 63];
+    }
+    if (i + 1 == input.size()) {
+        uint32_t v = (uint8_t)input[i] << 16;
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += "==";
+    } else if (i + 2 == input.size()) {
+        uint32_t v = (uint8_t)input[i] << 16 | (uint8_t)input[i + 1] << 8;
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += '=';
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+struct Interval {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    std::vector<double> latencyMs;
+};
+
+class Stats {
+public:
+    void connectionOpened() { _connections++; _activeConnections++; }
+    void connectionClosed() { _activeConnections--; }
+
+    void frame(size_t len, bool soiOk, bool eoiOk, uint32_t sequence, uint64_t captureUs, Clock::time_point arrival) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _totalFrames++;
+        _interval.frames++;
+        _interval.bytes += len;
+        if (!soiOk) {
+            _badSoi++;
+        }
+        if (!eoiOk) {
+            _badEoi++;
+        }
+
+        // Backlog frames replay older sequence numbers; only forward gaps count
+        if (_haveSequence && (int32_t)(sequence - _lastSequence) > 1) {
+            _sequenceGaps += sequence - _lastSequence - 1;
+        }
+        if (!_haveSequence || (int32_t)(sequence - _lastSequence) > 0) {
+            _lastSequence = sequence;
+            _haveSequence = true;
+        }
+
+        double captureSec = captureUs / 1e6;
+        double arrivalSec = std::chrono::duration<double>(arrival.time_since_epoch()).count();
+
+        // Device and host clocks are unrelated: latency is measured above the
+        // smallest capture-to-arrival offset seen, i.e. the queueing and
+        // transfer delay on top of the fastest frame.
+        double offset = arrivalSec - captureSec;
+        if (!_haveOffset || offset < _minOffset) {
+            _minOffset = offset;
+            _haveOffset = true;
+        }
+        _interval.latencyMs.push_back((offset - _minOffset) * 1000.0);
+
+        // RFC 3550 interarrival jitter
+        if (_havePrevious) {
+            double d = (arrivalSec - _prevArrival) - (captureSec - _prevCapture);
+            _jitterMs += (std::fabs(d) * 1000.0 - _jitterMs) / 16.0;
+        }
+        _prevArrival = arrivalSec;
+        _prevCapture = captureSec;
+        _havePrevious = true;
+    }
+
+    void maskKey(uint32_t key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (key == 0 || (_haveMaskKey && key == _lastMaskKey)) {
+            _weakMasks++;
+        }
+        _lastMaskKey = key;
+        _haveMaskKey = true;
+    }
+
+    void protocolError(const char* what) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _protocolErrors++;
+        if (g_options.verbose) {
+            fprintf(stderr, "protocol error: %s\n", what);
+        }
+    }
+
+    void pong(double rttMs) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pingRttMs = rttMs;
+    }
+
+    void newStream() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // The frame sequence restarts on every connection
+        _haveSequence = false;
+    }
+
+    void report(double elapsed, double intervalSec) {
+        Interval interval;
+        uint64_t totalFrames, badSoi, badEoi, gaps, weakMasks, protocolErrors;
+        double jitter, rtt;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::swap(interval, _interval);
+            totalFrames = _totalFrames;
+            badSoi = _badSoi;
+            badEoi = _badEoi;
+            gaps = _sequenceGaps;
+            weakMasks = _weakMasks;
+            protocolErrors = _protocolErrors;
+            jitter = _jitterMs;
+            rtt = _pingRttMs;
+        }
+
+        double p50 = 0, p99 = 0, max = 0;
+        if (!interval.latencyMs.empty()) {
+            std::vector<double>& v = interval.latencyMs;
+            std::sort(v.begin(), v.end());
+            p50 = v[v.size() / 2];
+            p99 = v[std::min(v.size() - 1, (size_t)std::ceil(v.size() * 0.99) - 1)];
+            max = v.back();
+        }
+
+        printf("[%7.1fs] conn %d/%u | %5.1f fps | %6.3f MB/s | frames %llu bad soi/eoi %llu/%llu seq gaps %llu"
+               " | weak masks %llu errors %llu | ping %5.1f ms | jitter %5.1f ms"
+               " | latency p50 %6.1f p99 %6.1f max %6.1f ms\n",
+               elapsed, _activeConnections.load(), _connections.load(),
+               interval.frames / intervalSec, interval.bytes / intervalSec / 1e6,
+               (unsigned long long)totalFrames, (unsigned long long)badSoi, (unsigned long long)badEoi,
+               (unsigned long long)gaps, (unsigned long long)weakMasks, (unsigned long long)protocolErrors,
+               rtt, jitter, p50, p99, max);
+        fflush(stdout);
+    }
+
+private:
+    std::mutex _mutex;
+    std::atomic<unsigned> _connections{0};
+    std::atomic<int> _activeConnections{0};
+
+    Interval _interval;
+    uint64_t _totalFrames = 0;
+    uint64_t _badSoi = 0;
+    uint64_t _badEoi = 0;
+    uint64_t _sequenceGaps = 0;
+    uint64_t _weakMasks = 0;
+    uint64_t _protocolErrors = 0;
+    double _pingRttMs = 0;
+
+    bool _haveSequence = false;
+    uint32_t _lastSequence = 0;
+    bool _haveMaskKey = false;
+    uint32_t _lastMaskKey = 0;
+
+    bool _haveOffset = false;
+    double _minOffset = 0;
+    bool _havePrevious = false;
+    double _prevArrival = 0;
+    double _prevCapture = 0;
+    double _jitterMs = 0;
+};
+
+Stats g_stats;
+
+// ---------------------------------------------------------------------------
+// Connections
+
+bool sendAll(int sock, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = send(sock, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool recvExact(int sock, uint8_t* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(sock, buf, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+class Connection {
+public:
+    Connection(int sock, std::string peer) : _sock(sock), _peer(std::move(peer)) {}
+
+    const std::string& peer() const { return _peer; }
+
+    // Server frames are never masked
+    bool sendFrame(uint8_t opcode, const void* payload, size_t len) {
+        uint8_t head[10];
+        size_t headLen = 0;
+        head[headLen++] = 0x80 | opcode;
+        if (len < 126) {
+            head[headLen++] = (uint8_t)len;
+        } else if (len <= 0xFFFF) {
+            head[headLen++] = 126;
+            head[headLen++] = (uint8_t)(len >> 8);
+            head[headLen++] = (uint8_t)len;
+        } else {
+            head[headLen++] = 127;
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                head[headLen++] = (uint8_t)((uint64_t)len >> shift);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_sendMutex);
+        return sendAll(_sock, head, headLen) && sendAll(_sock, payload, len);
+    }
+
+    void close(uint16_t status) {
+        uint8_t body[2] = { (uint8_t)(status >> 8), (uint8_t)status };
+        sendFrame(0x8, body, sizeof(body));
+        shutdown(_sock, SHUT_RDWR);
+    }
+
+    int sock() const { return _sock; }
+
+private:
+    int _sock;
+    std::string _peer;
+    std::mutex _sendMutex;
+};
+
+std::mutex g_connectionsMutex;
+std::set<std::shared_ptr<Connection>> g_connections;
+
+void broadcastText(const std::string& text) {
+    std::lock_guard<std::mutex> lock(g_connectionsMutex);
+    if (g_connections.empty()) {
+        printf("no camera connected, '%s' not sent\n", text.c_str());
+        fflush(stdout);
+        return;
+    }
+    for (const auto& conn : g_connections) {
+        if (conn->sendFrame(0x1, text.data(), text.size())) {
+            printf("%s: sent %s\n", conn->peer().c_str(), text.c_str());
+        }
+    }
+    fflush(stdout);
+}
+
+void handleBinary(const std::vector<uint8_t>& message, Clock::time_point arrival) {
+    if (message.size() < META_LEN) {
+        g_stats.protocolError("binary message shorter than the metadata prefix");
+        return;
+    }
+    if (message[0] != META_VERSION) {
+        g_stats.protocolError("unknown metadata version");
+        return;
+    }
+
+    uint32_t sequence;
+    uint64_t captureUs;
+    memcpy(&sequence, message.data() + 8, 4);
+    memcpy(&captureUs, message.data() + 12, 8);
+
+    const uint8_t* jpeg = message.data() + META_LEN;
+    size_t len = message.size() - META_LEN;
+    bool soiOk = len >= 2 && jpeg[0] == 0xFF && jpeg[1] == 0xD8;
+    bool eoiOk = len >= 2 && jpeg[len - 2] == 0xFF && jpeg[len - 1] == 0xD9;
+    if (g_options.verbose && (!soiOk || !eoiOk)) {
+        fprintf(stderr, "frame %u: %zu bytes, bad %s\n", sequence, len, !soiOk ? "SOI" : "EOI");
+    }
+    g_stats.frame(len, soiOk, eoiOk, sequence, captureUs, arrival);
+}
+
+// Returns false when the connection should end
+bool readFrames(Connection& conn, const std::atomic<Clock::rep>& pingSent) {
+    std::vector<uint8_t> message;
+    bool messageBinary = false;
+    bool inMessage = false;
+    uint64_t frames = 0;
+
+    while (g_running) {
+        uint8_t head[2];
+        if (!recvExact(conn.sock(), head, 2)) {
+            return false;
+        }
+
+        bool fin = head[0] & 0x80;
+        uint8_t opcode = head[0] & 0x0F;
+        bool masked = head[1] & 0x80;
+        uint64_t len = head[1] & 0x7F;
+
+        if (head[0] & 0x70) {
+            g_stats.protocolError("reserved bits set");
+            conn.close(1002);
+            return false;
+        }
+
+        if (len == 126) {
+            uint8_t ext[2];
+            if (!recvExact(conn.sock(), ext, 2)) {
+                return false;
+            }
+            len = (uint64_t)ext[0] << 8 | ext[1];
+        } else if (len == 127) {
+            uint8_t ext[8];
+            if (!recvExact(conn.sock(), ext, 8)) {
+                return false;
+            }
+            len = 0;
+            for (int i = 0; i < 8; i++) {
+                len = len << 8 | ext[i];
+            }
+        }
+
+        // RFC 6455 5.1: a server must close on an unmasked client frame
+        if (!masked) {
+            g_stats.protocolError("unmasked client frame");
+            conn.close(1002);
+            return false;
+        }
+        uint8_t key[4];
+        if (!recvExact(conn.sock(), key, 4)) {
+            return false;
+        }
+        uint32_t keyWord;
+        memcpy(&keyWord, key, 4);
+        g_stats.maskKey(keyWord);
+
+        bool control = opcode & 0x08;
+        if ((control && (len > 125 || !fin)) || message.size() + len > MAX_MESSAGE) {
+            g_stats.protocolError(control ? "bad control frame" : "message too large");
+            conn.close(control ? 1002 : 1009);
+            return false;
+        }
+
+        std::vector<uint8_t> payload((size_t)len);
+        if (!recvExact(conn.sock(), payload.data(), payload.size())) {
+            return false;
+        }
+        for (size_t i = 0; i < payload.size(); i++) {
+            payload[i] ^= key[i & 3];
+        }
+        Clock::time_point arrival = Clock::now();
+
+        switch (opcode) {
+            case 0x0:
+            case 0x1:
+            case 0x2:
+                if (opcode == 0x0 && !inMessage) {
+                    g_stats.protocolError("continuation without a message");
+                    conn.close(1002);
+                    return false;
+                }
+                if (opcode != 0x0) {
+                    if (inMessage) {
+                        g_stats.protocolError("new message inside a fragmented one");
+                        conn.close(1002);
+                        return false;
+                    }
+                    messageBinary = opcode == 0x2;
+                    inMessage = true;
+                    message.clear();
+                }
+                message.insert(message.end(), payload.begin(), payload.end());
+                if (!fin) {
+                    break;
+                }
+                inMessage = false;
+                if (messageBinary) {
+                    handleBinary(message, arrival);
+                    frames++;
+                    if (g_options.closeAfter && frames >= g_options.closeAfter) {
+                        printf("%s: closing after %llu frames\n", conn.peer().c_str(), (unsigned long long)frames);
+                        conn.close(1000);
+                        return false;
+                    }
+                } else {
+                    printf("%s: text %.*s\n", conn.peer().c_str(), (int)message.size(), (const char*)message.data());
+                    fflush(stdout);
+                }
+                break;
+            case 0x8:
+                printf("%s: close from camera%s\n", conn.peer().c_str(),
+                       payload.size() >= 2 ? (" (" + std::to_string(payload[0] << 8 | payload[1]) + ")").c_str() : "");
+                conn.sendFrame(0x8, payload.data(), std::min<size_t>(payload.size(), 2));
+                return false;
+            case 0x9:
+                conn.sendFrame(0xA, payload.data(), payload.size());
+                break;
+            case 0xA:
+                g_stats.pong(secondsSince(Clock::time_point(Clock::duration(pingSent.load()))) * 1000.0);
+                break;
+            default:
+                g_stats.protocolError("unknown opcode");
+                conn.close(1002);
+                return false;
+        }
+    }
+    return false;
+}
+
+bool handshake(int sock, const std::string& peer) {
+    // Read up to the end of the header block, nothing more: frames may follow at once
+    std::string request;
+    char c;
+    while (request.size() < 8192) {
+        ssize_t n = recv(sock, &c, 1, 0);
+        if (n <= 0) {
+            return false;
+        }
+        request += c;
+        if (request.size() >= 4 && request.compare(request.size() - 4, 4, "\r\n\r\n") == 0) {
+            break;
+        }
+    }
+
+    char method[16] = {}, target[256] = {};
+    sscanf(request.c_str(), "%15s %255s", method, target);
+
+    auto header = [&](const char* name) -> std::string {
+        std::string needle = std::string("\r\n") + name + ":";
+        const char* p = strcasestr(request.c_str(), needle.c_str());
+        if (!p) {
+            return "";
+        }
+        p += needle.size();
+        p += strspn(p, " \t");
+        return std::string(p, strcspn(p, "\r\n"));
+    };
+
+    std::string key = header("Sec-WebSocket-Key");
+    bool upgrade = strcasestr(header("Upgrade").c_str(), "websocket") != nullptr;
+    if (strcmp(method, "GET") != 0 || g_options.path != target || !upgrade || key.empty() ||
+        header("Sec-WebSocket-Version") != "13") {
+        printf("%s: %s %s is not a WebSocket upgrade to %s -> 400\n", peer.c_str(), method, target,
+               g_options.path.c_str());
+        const char* response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(sock, response, strlen(response));
+        return false;
+    }
+
+    std::string accept = base64(sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " + accept + "\r\n\r\n";
+    if (!sendAll(sock, response.data(), response.size())) {
+        return false;
+    }
+
+    std::string frameRate = header("X-Framerate");
+    printf("%s: upgraded %s, framerate %s\n", peer.c_str(), target, frameRate.empty() ? "-" : frameRate.c_str());
+    fflush(stdout);
+    return true;
+}
+
+void handleConnection(int sock, std::string peer) {
+    g_stats.connectionOpened();
+    Clock::time_point opened = Clock::now();
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (!handshake(sock, peer)) {
+        close(sock);
+        g_stats.connectionClosed();
+        return;
+    }
+
+    g_stats.newStream();
+    auto conn = std::make_shared<Connection>(sock, peer);
+    {
+        std::lock_guard<std::mutex> lock(g_connectionsMutex);
+        g_connections.insert(conn);
+    }
+
+    // Pings from a side thread; the reader answers the pong
+    std::atomic<bool> open{true};
+    std::atomic<Clock::rep> pingSent{Clock::now().time_since_epoch().count()};
+    std::thread pinger([&]() {
+        while (open && g_options.pingInterval > 0) {
+            for (double slept = 0; open && slept < g_options.pingInterval; slept += 0.1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            if (!open) {
+                break;
+            }
+            pingSent = Clock::now().time_since_epoch().count();
+            conn->sendFrame(0x9, "ws_server", 9);
+        }
+    });
+
+    readFrames(*conn, pingSent);
+
+    open = false;
+    pinger.join();
+    {
+        std::lock_guard<std::mutex> lock(g_connectionsMutex);
+        g_connections.erase(conn);
+    }
+
+    printf("%s: closed after %.1fs\n", peer.c_str(), secondsSince(opened));
+    fflush(stdout);
+    close(sock);
+    g_stats.connectionClosed();
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --port N           listen port (8080)\n"
+            "  --path P           WebSocket path (/ws)\n"
+            "  --ping-interval S  ping the camera every S seconds, 0 = never (5)\n"
+            "  --close-after N    close each connection after N frames (0 = never)\n"
+            "  --interval S       report interval in seconds (1)\n"
+            "  --verbose          log every bad frame and protocol error\n"
+            "Lines on stdin are sent to every connected camera as text messages.\n",
+            argv0);
+}
+
+bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto needValue = [&]() {
+            if (!value) {
+                fprintf(stderr, "%s needs a value\n", arg.c_str());
+                return false;
+            }
+            i++;
+            return true;
+        };
+
+        if (arg == "--verbose") {
+            g_options.verbose = true;
+        } else if (arg == "--port") {
+            if (!needValue()) return false;
+            g_options.port = (uint16_t)atoi(value);
+        } else if (arg == "--path") {
+            if (!needValue()) return false;
+            g_options.path = value;
+        } else if (arg == "--ping-interval") {
+            if (!needValue()) return false;
+            g_options.pingInterval = std::max(0.0, atof(value));
+        } else if (arg == "--close-after") {
+            if (!needValue()) return false;
+            g_options.closeAfter = strtoull(value, nullptr, 10);
+        } else if (arg == "--interval") {
+            if (!needValue()) return false;
+            g_options.reportInterval = std::max(0.1, atof(value));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    // No SA_RESTART, so Ctrl-C interrupts accept()
+    struct sigaction stop = {};
+    stop.sa_handler = [](int) { g_running = false; };
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(g_options.port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 4) != 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    printf("Listening on ws://:%u%s\n", g_options.port, g_options.path.c_str());
+    fflush(stdout);
+
+    Clock::time_point start = Clock::now();
+    std::thread reporter([start]() {
+        Clock::time_point last = start;
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(g_options.reportInterval));
+            Clock::time_point now = Clock::now();
+            g_stats.report(std::chrono::duration<double>(now - start).count(),
+                           std::chrono::duration<double>(now - last).count());
+            last = now;
+        }
+    });
+
+    // Control messages typed by hand, e.g. {"quality":12}
+    std::thread([]() {
+        char line[1024];
+        while (g_running && fgets(line, sizeof(line), stdin)) {
+            std::string text(line, strcspn(line, "\r\n"));
+            if (!text.empty()) {
+                broadcastText(text);
+            }
+        }
+    }).detach();
+
+    while (g_running) {
+        sockaddr_in peerAddr = {};
+        socklen_t peerLen = sizeof(peerAddr);
+        int sock = accept(listener, (sockaddr*)&peerAddr, &peerLen);
+        if (sock < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+
+        char peer[INET_ADDRSTRLEN + 8];
+        inet_ntop(AF_INET, &peerAddr.sin_addr, peer, INET_ADDRSTRLEN);
+        snprintf(peer + strlen(peer), 8, ":%u", ntohs(peerAddr.sin_port));
+
+        std::thread(handleConnection, sock, std::string(peer)).detach();
+    }
+
+    g_running = false;
+    close(listener);
+    reporter.join();
+    return 0;
+}